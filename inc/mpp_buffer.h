@@ -309,6 +309,13 @@ MppBufferType mpp_buffer_group_type(MppBufferGroup group);
  */
 MPP_RET mpp_buffer_group_limit_config(MppBufferGroup group, size_t size, RK_S32 count);
 
+/*
+ * size  : 0 - no limit, other - max total size of unused buffer kept in
+ *         internal group. Least recently released buffer will be freed when
+ *         the limit is exceeded.
+ */
+MPP_RET mpp_buffer_group_idle_limit_config(MppBufferGroup group, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -77,6 +77,7 @@ typedef enum MppMetaKey_e {
     KEY_TEMPORAL_ID             = FOURCC_META('t', 'l', 'i', 'd'),
     KEY_LONG_REF_IDX            = FOURCC_META('l', 't', 'i', 'd'),
     KEY_ROI_DATA                = FOURCC_META('r', 'o', 'i', ' '),
+    KEY_ROI_QP_MAP              = FOURCC_META('r', 'q', 'p', 'm'),
     KEY_OSD_DATA                = FOURCC_META('o', 's', 'd', ' '),
     KEY_USER_DATA               = FOURCC_META('u', 's', 'r', 'd'),
 
@@ -23,6 +23,15 @@
 extern "C" {
 #endif
 
+/*
+ * MppPacket release callback
+ * On decoder zero copy input mode (MPP_DEC_SET_PACKET_ZERO_COPY) the data of
+ * the input packet is referenced by mpp instead of copied. The callback will be
+ * called with the packet data pointer when mpp does not access the data any
+ * more. Then the caller can reuse or free the packet data.
+ */
+typedef void (*MppPacketReleaseCb)(void *ctx, void *data);
+
 /*
  * MppPacket interface
  *
@@ -70,6 +79,8 @@ MPP_RET mpp_packet_set_extra_data(MppPacket packet);
 void        mpp_packet_set_buffer(MppPacket packet, MppBuffer buffer);
 MppBuffer   mpp_packet_get_buffer(const MppPacket packet);
 
+void        mpp_packet_set_release_cb(MppPacket packet, MppPacketReleaseCb cb, void *ctx);
+
 /*
  * data access interface
  */
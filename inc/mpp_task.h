@@ -99,15 +99,23 @@ typedef enum {
  * MPP_POLL_BLOCK           - for block poll
  * MPP_POLL_NON_BLOCK       - for non-block poll
  * small than MPP_POLL_MAX  - for poll with timeout in ms
- * small than MPP_POLL_BUTT or larger than MPP_POLL_MAX is invalid value
+ * MPP_POLL_US(us)          - for poll with timeout in us, us should be in
+ *                            range (0, MPP_POLL_MAX * 1000]
+ * other value is invalid value
  */
 typedef enum {
     MPP_POLL_BUTT       = -2,
     MPP_POLL_BLOCK      = -1,
     MPP_POLL_NON_BLOCK  = 0,
     MPP_POLL_MAX        = 8000,
+    MPP_POLL_US_BASE    = 0x10000000,
 } MppPollType;
 
+#define MPP_POLL_US(us)         ((MppPollType)(MPP_POLL_US_BASE + (us)))
+
+/* max task count in one port set by MPP_SET_INPUT / OUTPUT_TASK_COUNT */
+#define MPP_TASK_COUNT_MAX      (32)
+
 /*
  * Mpp timeout define
  * MPP_TIMEOUT_BLOCK            - for block poll
@@ -158,10 +158,57 @@ typedef struct MppApi_t {
      */
     MPP_RET (*control)(MppCtx ctx, MpiCmd cmd, MppParam param);
 
+    // batched advance data flow interface
     /**
-     * @brief The reserved segment
+     * @brief dequeue at most max MppTask with one port lock
+     * @param ctx The context of mpp
+     * @param type input port or output port which are both for data transaction
+     * @param tasks MppTask array for the dequeued tasks
+     * @param max max task count to dequeue
+     * @param count[out] dequeued task count
+     * @return 0 for success at least one task is dequeued, others for failure
+     */
+    MPP_RET (*dequeue_n)(MppCtx ctx, MppPortType type, MppTask *tasks,
+                         RK_S32 max, RK_S32 *count);
+    /**
+     * @brief enqueue count MppTask with one port lock and one wake up
+     * @param ctx The context of mpp
+     * @param type input port or output port which are both for data transaction
+     * @param tasks MppTask array to enqueue
+     * @param count task count in the array
+     * @return 0 for success, others for failure and no task is enqueued
+     */
+    MPP_RET (*enqueue_n)(MppCtx ctx, MppPortType type, MppTask *tasks,
+                         RK_S32 count);
+    /**
+     * @brief decode multiple jpeg packets in one call with advanced mode
+     *        Each packet must have its input buffer and each frame must have
+     *        its output buffer. All the packets are queued in batch and the
+     *        decoder handles them in one wake up. Now only mjpeg decoder is
+     *        supported.
+     *        The packets in one round trip are limited by the task queue
+     *        depth which is 1 by default for mjpeg decoder. Set the batch
+     *        size by MPP_SET_INPUT_TASK_COUNT and MPP_SET_OUTPUT_TASK_COUNT
+     *        before mpp_init() to handle the whole batch in one wake up.
+     * @param ctx The context of mpp, created by mpp_create() and initiated
+     *            by mpp_init().
+     * @param packets input packet array
+     * @param frames output frame array with buffer, one for each packet
+     * @param results[out] decode result for each packet
+     * @param count packet count in the array
+     * @return 0 for all packets are processed, check results for each one.
+     *         On failure the packets already sent are still collected and
+     *         the packets not sent are marked as failed in results.
+     */
+    MPP_RET (*decode_batch)(MppCtx ctx, MppPacket *packets, MppFrame *frames,
+                            MPP_RET *results, RK_S32 count);
+
+    /**
+     * @brief The reserved segment, the batched functions are taken from it
+     *        Each function pointer takes sizeof(void *) bytes so MppApi
+     *        keeps its size on both 32-bit and 64-bit platform.
      */
-    RK_U32 reserv[16];
+    RK_U32 reserv[16 - 3 * sizeof(void *) / sizeof(RK_U32)];
 } MppApi;
 
 
@@ -63,6 +63,38 @@ typedef enum {
      */
     MPP_SET_INPUT_TIMEOUT,              /* parameter type RK_S64 */
     MPP_SET_OUTPUT_TIMEOUT,             /* parameter type RK_S64 */
+    /*
+     * Get output eventfd, parameter type RK_S32 *
+     * The fd is readable while decoder output frame or encoder output packet
+     * is ready. User can wait on it with poll / epoll and then get output in
+     * non-block mode. The fd is owned by mpp context, do not close it.
+     */
+    MPP_GET_OUTPUT_EVENT_FD,
+    /*
+     * Latency statistics since init or last reset, refer to rk_mpi_stat.h
+     * MPP_GET_LATENCY_STAT     - parameter type MppLatencyStat *
+     * MPP_RESET_LATENCY_STAT   - parameter is not used
+     */
+    MPP_GET_LATENCY_STAT,
+    MPP_RESET_LATENCY_STAT,
+    /*
+     * Task queue depth of input / output port, parameter type RK_S32 *
+     * Set before mpp_init. Range [0, MPP_TASK_COUNT_MAX] and zero for the
+     * default depth. With deeper queue user can keep more tasks in flight
+     * on advanced interface. On simple encoder interface put_frame returns
+     * before the frame is encoded so the frame should be kept until its
+     * packet is got.
+     */
+    MPP_SET_INPUT_TASK_COUNT,
+    MPP_SET_OUTPUT_TASK_COUNT,
+    /*
+     * Hardware scheduling among the contexts in one process, refer to
+     * rk_mpi_stat.h
+     * MPP_SET_HW_SCHED_CFG     - parameter type MppHwSchedCfg *
+     * MPP_GET_HW_SCHED_STAT    - parameter type MppHwSchedStat *
+     */
+    MPP_SET_HW_SCHED_CFG,
+    MPP_GET_HW_SCHED_STAT,
     MPP_CMD_END,
 
     MPP_CODEC_CMD_BASE                  = CMD_MODULE_CODEC,
@@ -83,6 +115,13 @@ typedef enum {
     MPP_DEC_SET_DISABLE_ERROR,          /* When set it will disable sw/hw error (H.264 / H.265) */
     MPP_DEC_SET_IMMEDIATE_OUT,
     MPP_DEC_SET_ENABLE_DEINTERLACE,     /* MPP enable deinterlace by default. Vpuapi can disable it */
+    /*
+     * Zero copy input mode, parameter RK_U32
+     * When enabled put_packet will reference the input packet data instead of
+     * copy it. The data should be kept valid with 256 bytes readable padding
+     * until the release callback set by mpp_packet_set_release_cb is called.
+     */
+    MPP_DEC_SET_PACKET_ZERO_COPY,
     MPP_DEC_CMD_END,
 
     MPP_ENC_CMD_BASE                    = CMD_MODULE_CODEC | CMD_CTX_ID_ENC,
@@ -140,6 +179,14 @@ typedef enum {
     MPP_ENC_CFG_MISC                    = CMD_MODULE_CODEC | CMD_CTX_ID_ENC | CMD_ENC_CFG_MISC,
     MPP_ENC_SET_HEADER_MODE,            /* set MppEncHeaderMode */
     MPP_ENC_GET_HEADER_MODE,            /* get MppEncHeaderMode */
+    /*
+     * Pipeline mode, parameter RK_U32, need to setup before init
+     * When enabled encoder keeps two frames in flight and prepares next frame
+     * while hardware is encoding current one. put_frame returns before the
+     * frame is encoded so the input MppFrame and its buffer should be kept
+     * until its packet is got. Rate control feedback is delayed by one frame.
+     */
+    MPP_ENC_SET_TASK_PIPELINE,
 
     MPP_ENC_CFG_SPLIT                   = CMD_MODULE_CODEC | CMD_CTX_ID_ENC | CMD_ENC_CFG_SPLIT,
     MPP_ENC_SET_SPLIT,                  /* set MppEncSliceSplit structure */
@@ -164,6 +211,7 @@ typedef enum {
     MPI_CMD_BUTT,
 } MpiCmd;
 
+#include "rk_mpi_stat.h"
 #include "rk_venc_cmd.h"
 #include "rk_venc_cfg.h"
 #include "rk_venc_ref.h"
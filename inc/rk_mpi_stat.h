@@ -0,0 +1,120 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RK_MPI_STAT_H__
+#define __RK_MPI_STAT_H__
+
+#include "rk_type.h"
+
+/*
+ * Per context latency statistics got by MPP_GET_LATENCY_STAT
+ *
+ * The latency is always recorded in microsecond by decoder / encoder threads.
+ *
+ * MPP_LATENCY_IN_OUT       - decoder: packet put to frame output
+ *                            encoder: frame put to packet output
+ * MPP_LATENCY_INPUT_WAIT   - input packet / frame waiting in input queue
+ * MPP_LATENCY_PARSE        - decoder: parser prepare and parse of one frame
+ *                            encoder: software processing before gen_regs
+ * MPP_LATENCY_GEN_REGS     - hal register generation
+ * MPP_LATENCY_HW           - hardware start to hardware wait done
+ * MPP_LATENCY_CODEC_WAIT   - decoder parser thread / encoder thread idle wait
+ * MPP_LATENCY_HAL_WAIT     - decoder hal thread idle wait
+ *
+ * The percentile value is the upper bound of the histogram bucket which is
+ * within 1/16 of the real value.
+ */
+typedef enum MppLatencyType_e {
+    MPP_LATENCY_IN_OUT,
+    MPP_LATENCY_INPUT_WAIT,
+    MPP_LATENCY_PARSE,
+    MPP_LATENCY_GEN_REGS,
+    MPP_LATENCY_HW,
+    MPP_LATENCY_CODEC_WAIT,
+    MPP_LATENCY_HAL_WAIT,
+    MPP_LATENCY_BUTT,
+} MppLatencyType;
+
+/* name of each MppLatencyType, used to initialize a MPP_LATENCY_BUTT array */
+#define MPP_LATENCY_NAMES { \
+    "in_out",               \
+    "input_wait",           \
+    "parse",                \
+    "gen_regs",             \
+    "hw",                   \
+    "codec_wait",           \
+    "hal_wait",             \
+}
+
+typedef struct MppLatencyInfo_t {
+    RK_S64      count;
+    RK_S64      sum;
+    RK_S64      min;
+    RK_S64      max;
+    RK_S64      p50;
+    RK_S64      p90;
+    RK_S64      p99;
+    RK_S64      p999;
+} MppLatencyInfo;
+
+typedef struct MppLatencyStat_t {
+    MppLatencyInfo  info[MPP_LATENCY_BUTT];
+} MppLatencyStat;
+
+/*
+ * Hardware scheduling config set by MPP_SET_HW_SCHED_CFG
+ *
+ * The mpp contexts in one process sharing the same hardware are scheduled by
+ * weighted fair queuing on hardware occupied time. The scheduler is disabled
+ * by default and enabled by env mpp_dev_sched_depth.
+ *
+ * priority     - [MPP_HW_PRIORITY_MIN, MPP_HW_PRIORITY_RT]
+ *                Hardware time share is in proportion to 1 << priority.
+ *                MPP_HW_PRIORITY_RT is served before all other priorities.
+ * pts_scale    - microsecond per pts tick, 1 for microsecond pts and 1000 for
+ *                millisecond pts. Zero is treated as 1.
+ * deadline     - latency budget in microsecond from frame pts. Zero disables
+ *                deadline. The first pts is mapped to the current time and
+ *                the task close to its deadline is served first.
+ */
+#define MPP_HW_PRIORITY_MIN         (0)
+#define MPP_HW_PRIORITY_DEFAULT     (4)
+#define MPP_HW_PRIORITY_RT          (7)
+
+typedef struct MppHwSchedCfg_t {
+    RK_S32      priority;
+    RK_S32      pts_scale;
+    RK_S64      deadline;
+} MppHwSchedCfg;
+
+/*
+ * Hardware scheduling statistics got by MPP_GET_HW_SCHED_STAT
+ *
+ * count        - hardware task count
+ * hw_time      - hardware occupied time in us from send to wait done
+ * wait_time    - time in us waiting for other contexts before send
+ * wait_max     - max wait time in us of one task
+ * deadline_miss - task count finished after its deadline
+ */
+typedef struct MppHwSchedStat_t {
+    RK_S64      count;
+    RK_S64      hw_time;
+    RK_S64      wait_time;
+    RK_S64      wait_max;
+    RK_S64      deadline_miss;
+} MppHwSchedStat;
+
+#endif /*__RK_MPI_STAT_H__*/
@@ -1083,6 +1083,21 @@ typedef struct MppEncROICfg_t {
     MppEncROIRegion     *regions;      /**< ROI parameters */
 } MppEncROICfg;
 
+/**
+ * @brief MPP encoder's per block qp map
+ *
+ * The map has one qp value for each 16x16 block in raster order. It is set
+ * by KEY_ROI_QP_MAP meta on the input frame and ROI regions are applied on
+ * top of it. Supported in vepu541 / vepu540.
+ */
+typedef struct MppEncROIQpMap_t {
+    RK_U16              width;          /**< block count in horizontal */
+    RK_U16              height;         /**< block count in vertical */
+    RK_U16              stride;         /**< qp count of one block line */
+    RK_U8               abs_qp_en;      /**< absolute qp enable flag */
+    RK_S8               *qp;            /**< absolute / relative qp of each block */
+} MppEncROIQpMap;
+
 /*
  * Mpp OSD parameter
  *
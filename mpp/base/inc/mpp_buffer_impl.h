@@ -19,6 +19,7 @@
 
 #include "mpp_list.h"
 #include "mpp_common.h"
+#include "mpp_thread.h"
 #include "mpp_allocator.h"
 
 #define MPP_BUF_DBG_FUNCTION            (0x00000001)
@@ -27,6 +28,10 @@
 #define MPP_BUF_DBG_CLR_ON_EXIT         (0x00000010)
 #define MPP_BUF_DBG_DUMP_ON_EXIT        (0x00000020)
 #define MPP_BUF_DBG_CHECK_SIZE          (0x00000100)
+#define MPP_BUF_DBG_POOL_STAT           (0x00000200)
+
+/* power of two size class for unused buffer lookup */
+#define MPP_BUF_SIZE_CLASS_COUNT        32
 
 #define mpp_buf_dbg(flag, fmt, ...)     _mpp_dbg(mpp_buffer_debug, flag, fmt, ## __VA_ARGS__)
 #define mpp_buf_dbg_f(flag, fmt, ...)   _mpp_dbg_f(mpp_buffer_debug, flag, fmt, ## __VA_ARGS__)
@@ -60,13 +65,21 @@ struct MppBufferImpl_t {
     // used flag is for used/unused list detection
     RK_U32              used;
     RK_U32              internal;
-    RK_S32              ref_count;
+    /*
+     * ref_count is updated with atomic operation.
+     * Only the 0 <-> 1 transition requires group buf_lock for list moving.
+     */
+    volatile RK_S32     ref_count;
     struct list_head    list_status;
+    // link to size class list in group when buffer is unused
+    struct list_head    list_class;
 };
 
 struct MppBufferGroupImpl_t {
     char                tag[MPP_TAG_SIZE];
     const char          *caller;
+    /* lock for buffer list, counter and log in this group */
+    pthread_mutex_t     buf_lock;
     RK_U32              group_id;
     MppBufferMode       mode;
     MppBufferType       type;
@@ -81,6 +94,21 @@ struct MppBufferGroupImpl_t {
     RK_S32              count_used;
     RK_S32              count_unused;
 
+    /*
+     * idle memory control for internal group
+     * idle_limit   - high watermark of unused buffer size. When it is exceeded
+     *                the least recently released buffer will be evicted.
+     *                0 - no limit, unused buffer smaller than the request
+     *                    is released on lookup
+     */
+    size_t              idle_limit;
+    size_t              idle_usage;
+    // pool statistics
+    RK_S64              hit_count;
+    RK_S64              miss_count;
+    RK_S64              evict_count;
+    size_t              evict_size;
+
     MppAllocator        allocator;
     MppAllocatorApi     *alloc_api;
 
@@ -92,6 +120,8 @@ struct MppBufferGroupImpl_t {
     RK_U32              clear_on_exit;
     // is_orphan: 0 - normal group 1 - orphan group
     RK_U32              is_orphan;
+    // is_misc: 0 - normal group 1 - misc group
+    RK_U32              is_misc;
 
     // buffer log function
     RK_U32              log_runtime_en;
@@ -104,7 +134,12 @@ struct MppBufferGroupImpl_t {
 
     // link to list_status in MppBufferImpl
     struct list_head    list_used;
+    // unused list is in release order for eviction
     struct list_head    list_unused;
+
+    // link to list_class in MppBufferImpl and bitmap of non-empty class
+    struct list_head    list_class[MPP_BUF_SIZE_CLASS_COUNT];
+    RK_U32              class_mask;
 };
 
 #ifdef __cplusplus
@@ -122,9 +157,9 @@ extern RK_U32 mpp_buffer_debug;
  *                            It required map to access. This is an optimization
  *                            for reducing virtual memory usage.
  *
- *  mpp_buffer_get_unused   : get unused buffer with size. it will first search
- *                            the unused list. if failed it will create on from
- *                            group allocator.
+ *  mpp_buffer_get_unused   : get unused buffer with size. it will do best-fit
+ *                            search on the size class of unused buffer. if
+ *                            failed it will create on from group allocator.
  *
  *  mpp_buffer_ref_inc      : increase buffer's reference counter. if it is unused
  *                            then it will be moved to used list.
@@ -151,6 +186,13 @@ MPP_RET mpp_buffer_group_deinit(MppBufferGroupImpl *p);
 MPP_RET mpp_buffer_group_reset(MppBufferGroupImpl *p);
 MPP_RET mpp_buffer_group_set_callback(MppBufferGroupImpl *p,
                                       MppBufCallback callback, void *arg);
+MPP_RET mpp_buffer_group_set_idle_limit(MppBufferGroupImpl *p, size_t size);
+/*
+ * Prepare count buffers with size in internal group and evict the unused
+ * buffer smaller than size. Used on info change to avoid allocation on
+ * decoding.
+ */
+MPP_RET mpp_buffer_group_prewarm(MppBufferGroupImpl *p, size_t size, RK_S32 count);
 // mpp_buffer_group helper function
 void mpp_buffer_group_dump(MppBufferGroupImpl *p);
 void mpp_buffer_service_dump();
@@ -119,6 +119,12 @@ struct MppFrameImpl_t {
      */
     RK_U32          fbc_offset;
 
+    /*
+     * time of the input packet put into mpp for latency statistics
+     * NOTE: only access internally
+     */
+    RK_S64          in_time;
+
     /*
      * pointer for multiple frame output at one time
      */
@@ -22,6 +22,7 @@
 #define MPP_PACKET_FLAG_EOS             (0x00000001)
 #define MPP_PACKET_FLAG_EXTRA_DATA      (0x00000002)
 #define MPP_PACKET_FLAG_INTERNAL        (0x00000004)
+#define MPP_PACKET_FLAG_REFERENCE       (0x00000008)
 
 /*
  * mpp_packet_imp structure
@@ -32,6 +33,7 @@
  * length   : valid data length
  * pts      : packet pts
  * dts      : packet dts
+ * in_time  : time of putting into mpp for latency statistics
  */
 typedef struct MppPacketImpl_t {
     const char  *name;
@@ -43,11 +45,16 @@ typedef struct MppPacketImpl_t {
 
     RK_S64      pts;
     RK_S64      dts;
+    RK_S64      in_time;
 
     RK_U32      flag;
 
     MppBuffer   buffer;
     MppMeta     meta;
+
+    /* release callback for reference packet */
+    MppPacketReleaseCb  release;
+    void        *release_ctx;
 } MppPacketImpl;
 
 #ifdef __cplusplus
@@ -57,6 +64,12 @@ extern "C" {
  * mpp_packet_reset is only used internelly and should NOT be used outside
  */
 MPP_RET mpp_packet_reset(MppPacketImpl *packet);
+/*
+ * mpp_packet_ref_init create a packet referencing the source data without copy
+ * The source data should be valid until the packet is deinit and the source
+ * packet release callback is called.
+ */
+MPP_RET mpp_packet_ref_init(MppPacket *packet, const MppPacket src);
 MPP_RET mpp_packet_copy(MppPacket dst, MppPacket src);
 MPP_RET mpp_packet_append(MppPacket dst, MppPacket src);
 
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_STARTCODE_H__
+#define __MPP_STARTCODE_H__
+
+#include "rk_type.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Find the first 0x000001 start code prefix fully inside buf.
+ * Return the offset of the first 0x00 byte or -1 if not found.
+ * SSE2 / NEON is used when available with scalar fallback.
+ */
+RK_S32 mpp_find_start_code(const RK_U8 *buf, RK_S32 len);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* __MPP_STARTCODE_H__ */
@@ -68,6 +68,8 @@ typedef struct MppTaskImpl_t {
     MppTaskQueue        queue;
     RK_S32              index;
     MppTaskStatus       status;
+    /* time of last enqueue for latency statistics */
+    RK_S64              enqueue_time;
 
     MppMeta             meta;
 } MppTaskImpl;
@@ -78,6 +80,16 @@ extern "C" {
 
 MPP_RET check_mpp_task_name(MppTask task);
 
+/*
+ * MppPollType helper
+ *
+ * mpp_poll_type_check  - return MPP_OK when timeout is a valid MppPollType
+ * mpp_poll_timeout_us  - convert the valid MppPollType to timeout in us
+ *                        negative for block and zero for non-block
+ */
+MPP_RET mpp_poll_type_check(MppPollType timeout);
+RK_S64  mpp_poll_timeout_us(MppPollType timeout);
+
 /*
  * Mpp task queue function:
  *
@@ -112,12 +124,41 @@ MppPort mpp_task_queue_get_port(MppTaskQueue queue, MppPortType type);
 #define mpp_port_dequeue(port, task) _mpp_port_dequeue(__FUNCTION__, port, task)
 #define mpp_port_enqueue(port, task) _mpp_port_enqueue(__FUNCTION__, port, task)
 #define mpp_port_awake(port) _mpp_port_awake(__FUNCTION__, port)
+#define mpp_port_dequeue_n(port, tasks, max, count) \
+    _mpp_port_dequeue_n(__FUNCTION__, port, tasks, max, count)
+#define mpp_port_enqueue_n(port, tasks, count) \
+    _mpp_port_enqueue_n(__FUNCTION__, port, tasks, count)
+#define mpp_port_cancel_n(port, tasks, count) \
+    _mpp_port_cancel_n(__FUNCTION__, port, tasks, count)
 
 MPP_RET _mpp_port_poll(const char *caller, MppPort port, MppPollType timeout);
 MPP_RET _mpp_port_dequeue(const char *caller, MppPort port, MppTask *task);
 MPP_RET _mpp_port_enqueue(const char *caller, MppPort port, MppTask task);
 MPP_RET _mpp_port_awake(const char *caller, MppPort port);
 
+/*
+ * Batched dequeue / enqueue
+ *
+ * The whole batch is done with one queue lock, one condition signal and one
+ * eventfd update. dequeue_n returns MPP_OK when at least one task is got.
+ * enqueue_n checks all tasks first and enqueues nothing on failure.
+ * cancel_n puts the dequeued tasks back to the port without passing them to
+ * the other side. They are dequeued again first in the same order.
+ */
+MPP_RET _mpp_port_dequeue_n(const char *caller, MppPort port, MppTask *tasks,
+                            RK_S32 max, RK_S32 *count);
+MPP_RET _mpp_port_enqueue_n(const char *caller, MppPort port, MppTask *tasks,
+                            RK_S32 count);
+MPP_RET _mpp_port_cancel_n(const char *caller, MppPort port, MppTask *tasks,
+                           RK_S32 count);
+
+/*
+ * Attach an eventfd to the port. The eventfd is readable while there is task
+ * ready for dequeue on the port so user can wait on it with poll / epoll.
+ * Pass negative fd to detach. The fd is not owned by the port.
+ */
+MPP_RET mpp_port_set_eventfd(MppPort port, RK_S32 fd);
+
 #ifdef __cplusplus
 }
 #endif
@@ -50,21 +50,121 @@ static MPP_RET update_curbyte(BitReadCtx_t *bitctx)
     return MPP_OK;
 }
 
-/*!
-***********************************************************************
-* \brief
-*   Read |num_bits| (1 to 31 inclusive) from the stream and return them
-*   in |out|, with first bit in the stream as MSB in |out| at position
-*   (|num_bits| - 1)
-***********************************************************************
-*/
-MPP_RET mpp_read_bits(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_S32 *out)
+/*
+ * 64-bit cache window fast path
+ *
+ * The context state is still kept on byte unit (data_ / bytes_left_ /
+ * curr_byte_) because parsers access these fields directly. The fast path
+ * builds a 64-bit window with the remaining bits of curr_byte_ followed by the
+ * next 8 bytes, reads from it and then advances the byte state in one step.
+ *
+ * Emulation prevention bytes are removed lazily: the fast path is only taken
+ * when none of the bytes to be consumed is 0x03. Otherwise or near the end of
+ * the stream the byte by byte path with full 0x000003 detection is used.
+ */
+static RK_U64 bitread_load_be64(const RK_U8 *p)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    RK_U64 val;
+
+    memcpy(&val, p, sizeof(val));
+    return __builtin_bswap64(val);
+#else
+    RK_U64 val = 0;
+    RK_S32 i;
+
+    for (i = 0; i < 8; i++)
+        val = (val << 8) | p[i];
+
+    return val;
+#endif
+}
+
+static RK_S32 bitread_clz64(RK_U64 val)
+{
+#if defined(__GNUC__)
+    return __builtin_clzll(val);
+#else
+    RK_S32 n = 0;
+
+    while (!(val & 0x8000000000000000ULL)) {
+        val <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* mark the MSB of each byte which may be 0x03 */
+static RK_U64 bitread_epb_mask(RK_U64 val)
+{
+    RK_U64 x = val ^ 0x0303030303030303ULL;
+
+    return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+}
+
+/*
+ * Get the window with at least num_bits (0 - 64) valid bits from MSB.
+ * Return 0 when the fast path can not be used.
+ */
+static RK_S32 bitread_peek(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_U64 *win)
+{
+    RK_S32 remain = bitctx->num_remaining_bits_in_curr_byte_;
+    RK_U64 curr = (remain) ? (RK_U64)bitctx->curr_byte_ << (64 - remain) : 0;
+    RK_U64 next;
+    RK_S32 bytes;
+
+    if (num_bits <= remain) {
+        *win = curr;
+        return 1;
+    }
+
+    if (bitctx->bytes_left_ < 8)
+        return 0;
+
+    next = bitread_load_be64(bitctx->data_);
+    bytes = (num_bits - remain + 7) >> 3;
+
+    if (bitctx->need_prevention_detection &&
+        (bitread_epb_mask(next) >> (64 - bytes * 8)))
+        return 0;
+
+    *win = curr | (next >> remain);
+    return 1;
+}
+
+/* consume num_bits checked by bitread_peek */
+static void bitread_flush(BitReadCtx_t *bitctx, RK_S32 num_bits)
+{
+    RK_S32 remain = bitctx->num_remaining_bits_in_curr_byte_;
+    RK_S32 bytes;
+    RK_U8 *data;
+
+    bitctx->used_bits += num_bits;
+
+    if (num_bits <= remain) {
+        bitctx->num_remaining_bits_in_curr_byte_ = remain - num_bits;
+        return;
+    }
+
+    bytes = (num_bits - remain + 7) >> 3;
+    data = bitctx->data_ + bytes;
+
+    if (bytes > 1)
+        bitctx->prev_two_bytes_ = (data[-2] << 8) | data[-1];
+    else
+        bitctx->prev_two_bytes_ = (bitctx->prev_two_bytes_ << 8) | data[-1];
+
+    bitctx->curr_byte_ = data[-1];
+    bitctx->data_ = data;
+    bitctx->bytes_left_ -= bytes;
+    bitctx->num_remaining_bits_in_curr_byte_ = remain + bytes * 8 - num_bits;
+}
+
+static MPP_RET bitread_read_slow(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_S32 *out)
 {
     RK_S32 bits_left = num_bits;
     *out = 0;
-    if (num_bits > 31) {
-        return  MPP_ERR_READ_BIT;
-    }
     while (bitctx->num_remaining_bits_in_curr_byte_ < bits_left) {
         // Take all that's left in current byte, shift to make space for the rest.
         *out |= (bitctx->curr_byte_ << (bits_left - bitctx->num_remaining_bits_in_curr_byte_));
@@ -80,6 +180,35 @@ MPP_RET mpp_read_bits(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_S32 *out)
 
     return MPP_OK;
 }
+
+/*!
+***********************************************************************
+* \brief
+*   Read |num_bits| (1 to 31 inclusive) from the stream and return them
+*   in |out|, with first bit in the stream as MSB in |out| at position
+*   (|num_bits| - 1)
+***********************************************************************
+*/
+MPP_RET mpp_read_bits(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_S32 *out)
+{
+    RK_U64 win;
+
+    if (num_bits > 31) {
+        *out = 0;
+        return  MPP_ERR_READ_BIT;
+    }
+    if (num_bits <= 0) {
+        *out = 0;
+        return MPP_OK;
+    }
+    if (bitread_peek(bitctx, num_bits, &win)) {
+        *out = (RK_S32)(win >> (64 - num_bits));
+        bitread_flush(bitctx, num_bits);
+        return MPP_OK;
+    }
+
+    return bitread_read_slow(bitctx, num_bits, out);
+}
 /*!
 ***********************************************************************
 * \brief
@@ -89,10 +218,17 @@ MPP_RET mpp_read_bits(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_S32 *out)
 MPP_RET mpp_read_longbits(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_U32 *out)
 {
     RK_S32 val = 0, val1 = 0;
+    RK_U64 win;
 
     if (num_bits < 32)
         return mpp_read_bits(bitctx, num_bits, (RK_S32 *)out);
 
+    if (num_bits == 32 && bitread_peek(bitctx, num_bits, &win)) {
+        *out = (RK_U32)(win >> 32);
+        bitread_flush(bitctx, num_bits);
+        return MPP_OK;
+    }
+
     if (mpp_read_bits(bitctx, 16, &val)) {
         return  MPP_ERR_READ_BIT;
     }
@@ -113,6 +249,12 @@ MPP_RET mpp_read_longbits(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_U32 *out)
 MPP_RET mpp_skip_bits(BitReadCtx_t *bitctx, RK_S32 num_bits)
 {
     RK_S32 bits_left = num_bits;
+    RK_U64 win;
+
+    if (num_bits <= 64 && bitread_peek(bitctx, num_bits, &win)) {
+        bitread_flush(bitctx, num_bits);
+        return MPP_OK;
+    }
 
     while (bitctx->num_remaining_bits_in_curr_byte_ < bits_left) {
         // Take all that's left in current byte, shift to make space for the rest.
@@ -151,8 +293,15 @@ MPP_RET mpp_skip_longbits(BitReadCtx_t *bitctx, RK_S32 num_bits)
 MPP_RET mpp_show_bits(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_S32 *out)
 {
     MPP_RET ret = MPP_ERR_UNKNOW;
-    BitReadCtx_t tmp_ctx = *bitctx;
+    BitReadCtx_t tmp_ctx;
+    RK_U64 win;
 
+    if (num_bits > 0 && num_bits <= 32 && bitread_peek(bitctx, num_bits, &win)) {
+        *out = (RK_S32)(win >> (64 - num_bits));
+        return MPP_OK;
+    }
+
+    tmp_ctx = *bitctx;
     if (num_bits < 32)
         ret = mpp_read_bits(&tmp_ctx, num_bits, out);
     else
@@ -186,6 +335,28 @@ MPP_RET mpp_read_ue(BitReadCtx_t *bitctx, RK_U32 *val)
     RK_S32 num_bits = -1;
     RK_S32 bit;
     RK_S32 rest;
+    RK_U64 win;
+
+    /*
+     * The 32 bits window covers the code with less than 16 leading zeros
+     * which is the common case and the full 64 bits window covers the code
+     * with less than 32 leading zeros. Count the leading zeros with clz and
+     * take 2 * zeros + 1 bits as value + 1.
+     */
+    if (bitread_peek(bitctx, 32, &win)) {
+        if (!(win >> 48) && !bitread_peek(bitctx, 64, &win))
+            win = 0;
+
+        if (win >> 32) {
+            RK_S32 zeros = bitread_clz64(win);
+            RK_S32 len = zeros * 2 + 1;
+
+            *val = (RK_U32)(win >> (64 - len)) - 1;
+            bitread_flush(bitctx, len);
+            return MPP_OK;
+        }
+    }
+
     // Count the number of contiguous zero bits.
     do {
         if (mpp_read_bits(bitctx, 1, &bit)) {
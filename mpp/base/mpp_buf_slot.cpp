@@ -177,6 +177,16 @@ typedef struct MppBufSlotLog_t {
     SlotStatus          status_out;
 } MppBufSlotLog;
 
+/*
+ * Slot operation history is a fixed ring with SLOT_OPS_MAX_COUNT records.
+ * It is enabled by default so recording must not malloc or take other lock.
+ */
+typedef struct MppBufSlotLogs_t {
+    RK_U32              pos;
+    RK_U32              cnt;
+    MppBufSlotLog       logs[SLOT_OPS_MAX_COUNT];
+} MppBufSlotLogs;
+
 struct MppBufSlotEntry_t {
     MppBufSlotsImpl     *slots;
     struct list_head    list;
@@ -226,12 +236,31 @@ struct MppBufSlotsImpl_t {
     // list for display
     struct list_head    queue[QUEUE_BUTT];
 
-    // list for log
-    mpp_list            *logs;
+    // ring for log
+    MppBufSlotLogs      *logs;
+
+    // free slot bitmap, bit set for slot not on used
+    RK_U32              *free_bits;
+    RK_S32              free_words;
 
     MppBufSlotEntry     *slots;
 };
 
+static RK_S32 slot_ctz32(RK_U32 val)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(val);
+#else
+    RK_S32 n = 0;
+
+    while (!(val & 1)) {
+        val >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
 static RK_U32 default_align_16(RK_U32 val)
 {
     return MPP_ALIGN(val, 16);
@@ -300,13 +329,18 @@ static void _dump_slots(const char *caller, MppBufSlotsImpl *impl)
 
     mpp_log("\nslot operation history:\n\n");
 
-    mpp_list *logs = impl->logs;
+    MppBufSlotLogs *logs = impl->logs;
     if (logs) {
-        while (logs->list_size()) {
-            MppBufSlotLog log;
-            logs->del_at_head(&log, sizeof(log));
+        RK_U32 pos = (logs->pos + SLOT_OPS_MAX_COUNT - logs->cnt) % SLOT_OPS_MAX_COUNT;
+
+        while (logs->cnt) {
+            MppBufSlotLog *log = &logs->logs[pos];
+
             mpp_log("index %2d op: %s status in %08x out %08x",
-                    log.index, op_string[log.ops], log.status_in.val, log.status_out.val);
+                    log->index, op_string[log->ops], log->status_in.val,
+                    log->status_out.val);
+            pos = (pos + 1) % SLOT_OPS_MAX_COUNT;
+            logs->cnt--;
         }
     }
 
@@ -315,21 +349,48 @@ static void _dump_slots(const char *caller, MppBufSlotsImpl *impl)
     return;
 }
 
-static void add_slot_log(mpp_list *logs, RK_S32 index, MppBufSlotOps op, SlotStatus before, SlotStatus after)
+static void add_slot_log(MppBufSlotLogs *logs, RK_S32 index, MppBufSlotOps op, SlotStatus before, SlotStatus after)
 {
     if (logs) {
-        MppBufSlotLog log = {
-            index,
-            op,
-            before,
-            after,
-        };
-        if (logs->list_size() >= SLOT_OPS_MAX_COUNT)
-            logs->del_at_head(NULL, sizeof(log));
-        logs->add_at_tail(&log, sizeof(log));
+        MppBufSlotLog *log = &logs->logs[logs->pos];
+
+        log->index = index;
+        log->ops = op;
+        log->status_in = before;
+        log->status_out = after;
+
+        logs->pos = (logs->pos + 1) % SLOT_OPS_MAX_COUNT;
+        if (logs->cnt < SLOT_OPS_MAX_COUNT)
+            logs->cnt++;
     }
 }
 
+static void resize_free_bits(MppBufSlotsImpl *impl, RK_S32 count)
+{
+    RK_S32 words = (count + 31) / 32;
+
+    if (words > impl->free_words) {
+        impl->free_bits = mpp_realloc(impl->free_bits, RK_U32, words);
+        memset(impl->free_bits + impl->free_words, 0,
+               sizeof(RK_U32) * (words - impl->free_words));
+    }
+    impl->free_words = words;
+
+    // slot over count should never be allocated
+    if (count % 32)
+        impl->free_bits[words - 1] &= (1U << (count % 32)) - 1;
+}
+
+static void update_free_bits(MppBufSlotsImpl *impl, RK_S32 index, RK_U32 on_used)
+{
+    RK_U32 bit = 1U << (index % 32);
+
+    if (on_used)
+        impl->free_bits[index / 32] &= ~bit;
+    else
+        impl->free_bits[index / 32] |= bit;
+}
+
 static void slot_ops_with_log(MppBufSlotsImpl *impl, MppBufSlotEntry *slot, MppBufSlotOps op, void *arg)
 {
     RK_U32 error = 0;
@@ -428,6 +489,8 @@ static void slot_ops_with_log(MppBufSlotsImpl *impl, MppBufSlotEntry *slot, MppB
     } break;
     }
     slot->status = status;
+    if (op == SLOT_INIT || before.on_used != status.on_used)
+        update_free_bits(impl, index, status.on_used);
     buf_slot_dbg(BUF_SLOT_DBG_OPS_RUNTIME, "slot %3d index %2d op: %s arg %010p status in %08x out %08x",
                  impl->slots_idx, index, op_string[op], arg, before.val, status.val);
     add_slot_log(impl->logs, index, op, before, status);
@@ -437,12 +500,14 @@ static void slot_ops_with_log(MppBufSlotsImpl *impl, MppBufSlotEntry *slot, MppB
 
 static void init_slot_entry(MppBufSlotsImpl *impl, RK_S32 pos, RK_S32 count)
 {
-    MppBufSlotEntry *slot = impl->slots;
+    MppBufSlotEntry *slot = impl->slots + pos;
     for (RK_S32 i = 0; i < count; i++, slot++) {
         slot->slots = impl;
         INIT_LIST_HEAD(&slot->list);
         slot->index = pos + i;
+        slot->eos = 0;
         slot->frame = NULL;
+        slot->buffer = NULL;
         slot_ops_with_log(impl, slot, SLOT_INIT, NULL);
     }
 }
@@ -506,8 +571,8 @@ static void clear_slots_impl(MppBufSlotsImpl *impl)
     if (impl->info_set)
         mpp_frame_deinit(&impl->info_set);
 
-    if (impl->logs)
-        delete impl->logs;
+    MPP_FREE(impl->logs);
+    MPP_FREE(impl->free_bits);
 
     if (impl->lock)
         delete impl->lock;
@@ -531,7 +596,7 @@ MPP_RET mpp_buf_slot_init(MppBufSlots *slots)
     mpp_env_get_u32("buf_slot_debug", &buf_slot_debug, BUF_SLOT_DBG_OPS_HISTORY);
 
     do {
-        impl->lock = new Mutex();
+        impl->lock = new Mutex(MUTEX_FAST, "mpp_buf_slot");
         if (NULL == impl->lock)
             break;
 
@@ -540,7 +605,7 @@ MPP_RET mpp_buf_slot_init(MppBufSlots *slots)
         }
 
         if (buf_slot_debug & BUF_SLOT_DBG_OPS_HISTORY) {
-            impl->logs = new mpp_list(NULL);
+            impl->logs = mpp_calloc(MppBufSlotLogs, 1);
             if (NULL == impl->logs)
                 break;
         }
@@ -596,12 +661,14 @@ MPP_RET mpp_buf_slot_setup(MppBufSlots slots, RK_S32 count)
         // first slot setup
         impl->buf_count = impl->new_count = count;
         impl->slots = mpp_calloc(MppBufSlotEntry, count);
+        resize_free_bits(impl, count);
         init_slot_entry(impl, 0, count);
         impl->used_count = 0;
     } else {
         // record the slot count for info changed ready config
         if (count > impl->buf_count) {
-            mpp_realloc(impl->slots, MppBufSlotEntry, count);
+            impl->slots = mpp_realloc(impl->slots, MppBufSlotEntry, count);
+            resize_free_bits(impl, count);
             init_slot_entry(impl, impl->buf_count, (count - impl->buf_count));
         }
         impl->new_count = count;
@@ -639,7 +706,8 @@ MPP_RET mpp_buf_slot_ready(MppBufSlots slots)
 
     // ready mean the info_set will be copy to info as the new configuration
     if (impl->buf_count != impl->new_count) {
-        mpp_realloc(impl->slots, MppBufSlotEntry, impl->new_count);
+        impl->slots = mpp_realloc(impl->slots, MppBufSlotEntry, impl->new_count);
+        resize_free_bits(impl, impl->new_count);
         init_slot_entry(impl, 0, impl->new_count);
     }
     impl->buf_count = impl->new_count;
@@ -647,11 +715,8 @@ MPP_RET mpp_buf_slot_ready(MppBufSlots slots)
     mpp_frame_copy(impl->info, impl->info_set);
     impl->buf_size = mpp_frame_get_buf_size(impl->info);
 
-    if (impl->logs) {
-        mpp_list *logs = impl->logs;
-        while (logs->list_size())
-            logs->del_at_head(NULL, sizeof(MppBufSlotLog));
-    }
+    if (impl->logs)
+        impl->logs->cnt = 0;
     impl->info_changed  = 0;
     return MPP_OK;
 }
@@ -678,10 +743,18 @@ MPP_RET mpp_buf_slot_get_unused(MppBufSlots slots, RK_S32 *index)
     MppBufSlotsImpl *impl = (MppBufSlotsImpl *)slots;
     AutoMutex auto_lock(impl->lock);
     RK_S32 i;
-    MppBufSlotEntry *slot = impl->slots;
-    for (i = 0; i < impl->buf_count; i++, slot++) {
-        if (!slot->status.on_used) {
-            *index = i;
+
+    for (i = 0; i < impl->free_words; i++) {
+        if (impl->free_bits[i]) {
+            RK_S32 pos = i * 32 + slot_ctz32(impl->free_bits[i]);
+            MppBufSlotEntry *slot = &impl->slots[pos];
+
+            // slots grown by setup are not usable until ready
+            if (pos >= impl->buf_count)
+                break;
+
+            slot_assert(impl, !slot->status.on_used);
+            *index = pos;
             slot_ops_with_log(impl, slot, SLOT_SET_ON_USE, NULL);
             slot_ops_with_log(impl, slot, SLOT_SET_NOT_READY, NULL);
             impl->used_count++;
@@ -377,3 +377,14 @@ MPP_RET mpp_buffer_group_limit_config(MppBufferGroup group, size_t size, RK_S32
     return MPP_OK;
 }
 
+MPP_RET mpp_buffer_group_idle_limit_config(MppBufferGroup group, size_t size)
+{
+    if (NULL == group) {
+        mpp_err_f("input invalid group %p\n", group);
+        return MPP_NOK;
+    }
+
+    MppBufferGroupImpl *p = (MppBufferGroupImpl *)group;
+    mpp_assert(p->mode == MPP_BUFFER_INTERNAL);
+    return mpp_buffer_group_set_idle_limit(p, size);
+}
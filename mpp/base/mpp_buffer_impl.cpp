@@ -21,13 +21,22 @@
 #include "mpp_log.h"
 #include "mpp_mem.h"
 #include "mpp_env.h"
+#include "mpp_atomic.h"
 
 #include "mpp_buffer_impl.h"
 
 #define BUFFER_OPS_MAX_COUNT            1024
 
+/* group table size must be power of 2 for id to index mapping */
+#define BUFFER_GROUP_MAX_COUNT          1024
+#define BUFFER_GROUP_ID_MASK            (BUFFER_GROUP_MAX_COUNT - 1)
+#define BUFFER_GROUP_ID_INVALID         ((RK_U32)-1)
+
 #define SEARCH_GROUP_BY_ID(id)  ((MppBufferService::get_instance())->get_group_by_id(id))
 
+#define MPP_BUF_GRP_LOCK(p)     pthread_mutex_lock(&(p)->buf_lock)
+#define MPP_BUF_GRP_UNLOCK(p)   pthread_mutex_unlock(&(p)->buf_lock)
+
 typedef MPP_RET (*BufferOp)(MppAllocator allocator, MppBufferInfo *data);
 
 typedef enum MppBufOps_e {
@@ -57,6 +66,18 @@ typedef struct MppBufLog_t {
     const char          *caller;
 } MppBufLog;
 
+/*
+ * Lock rule:
+ * 1. MppBufferService lock protects group create / destroy and group table.
+ * 2. MppBufferGroupImpl buf_lock protects buffer list / counter / log in group.
+ * 3. Buffer ref_count is atomic. Buffer which is already in used can be
+ *    ref_inc / ref_dec without any lock when buffer log is disabled.
+ *
+ * When both lock are required the service lock must be taken first.
+ * Group lookup by id is done on group table without service lock. It is safe
+ * because the group of a valid buffer will never be destroyed until all the
+ * buffer in the group are released.
+ */
 // use this class only need it to init legacy group before main
 class MppBufferService
 {
@@ -76,6 +97,9 @@ private:
     RK_U32              group_count;
     RK_U32              finalizing;
 
+    // group table for group lookup by id
+    MppBufferGroupImpl  *mGroups[BUFFER_GROUP_MAX_COUNT];
+
     // misc group for internal / externl buffer with different type
     MppBufferGroupImpl  *misc[MPP_BUFFER_MODE_BUTT][MPP_BUFFER_TYPE_BUTT];
     RK_U32              misc_count;
@@ -91,7 +115,7 @@ public:
         return &instance;
     }
     static Mutex *get_lock() {
-        static Mutex lock;
+        static Mutex lock(MUTEX_FAST, "mpp_buf_service");
         return &lock;
     }
 
@@ -193,6 +217,11 @@ static void buffer_group_dump_log(MppBufferGroupImpl *group)
     }
 }
 
+/*
+ * NOTE: group buf_lock should be locked before calling this function.
+ * When the group is orphan and all its buffers are released the caller
+ * should release the group after buf_lock unlocked.
+ */
 static MPP_RET deinit_buffer_no_lock(MppBufferImpl *buffer, const char *caller)
 {
     if (!MppBufferService::get_instance()->is_finalizing()) {
@@ -211,10 +240,6 @@ static MPP_RET deinit_buffer_no_lock(MppBufferImpl *buffer, const char *caller)
         group->buffer_count--;
 
         buffer_group_add_log(group, buffer, BUF_DESTROY, caller);
-
-        if (group->is_orphan && !group->usage) {
-            MppBufferService::get_instance()->put_group(group);
-        }
     } else {
         mpp_assert(MppBufferService::get_instance()->is_finalizing());
     }
@@ -224,6 +249,93 @@ static MPP_RET deinit_buffer_no_lock(MppBufferImpl *buffer, const char *caller)
     return MPP_OK;
 }
 
+static RK_S32 buffer_size_class(size_t size)
+{
+    RK_S32 idx = 0;
+
+    if (size >> (MPP_BUF_SIZE_CLASS_COUNT - 1))
+        return MPP_BUF_SIZE_CLASS_COUNT - 1;
+
+#if defined(__GNUC__)
+    if (size > 1)
+        idx = 31 - __builtin_clz((RK_U32)size);
+#else
+    while (size > 1) {
+        size >>= 1;
+        idx++;
+    }
+#endif
+
+    return idx;
+}
+
+static RK_S32 buffer_ctz32(RK_U32 val)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(val);
+#else
+    RK_S32 n = 0;
+
+    while (!(val & 1)) {
+        val >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/*
+ * NOTE: group buf_lock should be locked before calling unused list functions.
+ * Unused buffer is linked to both unused list in release order and the size
+ * class list for best-fit lookup.
+ */
+static void buffer_add_unused_no_lock(MppBufferGroupImpl *group, MppBufferImpl *buffer)
+{
+    RK_S32 idx = buffer_size_class(buffer->info.size);
+
+    list_add_tail(&buffer->list_status, &group->list_unused);
+    list_add_tail(&buffer->list_class, &group->list_class[idx]);
+    group->class_mask |= (1U << idx);
+    group->count_unused++;
+    group->idle_usage += buffer->info.size;
+}
+
+static void buffer_del_unused_no_lock(MppBufferGroupImpl *group, MppBufferImpl *buffer)
+{
+    RK_S32 idx = buffer_size_class(buffer->info.size);
+
+    list_del_init(&buffer->list_status);
+    list_del_init(&buffer->list_class);
+    if (list_empty(&group->list_class[idx]))
+        group->class_mask &= ~(1U << idx);
+    group->count_unused--;
+    group->idle_usage -= buffer->info.size;
+}
+
+static void buffer_evict_unused_no_lock(MppBufferGroupImpl *group,
+                                        MppBufferImpl *buffer, const char *caller)
+{
+    buffer_del_unused_no_lock(group, buffer);
+    group->evict_count++;
+    group->evict_size += buffer->info.size;
+    deinit_buffer_no_lock(buffer, caller);
+}
+
+/* evict least recently released buffer until idle memory is under limit */
+static void buffer_group_shrink_no_lock(MppBufferGroupImpl *group, const char *caller)
+{
+    if (group->mode != MPP_BUFFER_INTERNAL || !group->idle_limit)
+        return ;
+
+    while (group->idle_usage > group->idle_limit && !list_empty(&group->list_unused)) {
+        MppBufferImpl *buffer = list_entry(group->list_unused.next,
+                                           MppBufferImpl, list_status);
+
+        buffer_evict_unused_no_lock(group, buffer, caller);
+    }
+}
+
+/* NOTE: group buf_lock should be locked before calling this function */
 static MPP_RET inc_buffer_ref_no_lock(MppBufferImpl *buffer, const char *caller)
 {
     MPP_RET ret = MPP_OK;
@@ -233,20 +345,45 @@ static MPP_RET inc_buffer_ref_no_lock(MppBufferImpl *buffer, const char *caller)
         mpp_assert(group);
         buffer->used = 1;
         if (group) {
-            list_del_init(&buffer->list_status);
+            buffer_del_unused_no_lock(group, buffer);
             list_add_tail(&buffer->list_status, &group->list_used);
             group->count_used++;
-            group->count_unused--;
         } else {
             mpp_err_f("unused buffer without group\n");
             ret = MPP_NOK;
         }
     }
-    buffer_group_add_log(group, buffer, BUF_REF_INC, caller);
-    buffer->ref_count++;
+    if (group)
+        buffer_group_add_log(group, buffer, BUF_REF_INC, caller);
+    MPP_FETCH_ADD(&buffer->ref_count, 1);
     return ret;
 }
 
+/*
+ * Fast path for buffer reference counter update.
+ * When the buffer is in used and the counter will not reach zero there is no
+ * list change and no lock is required. Buffer log is recorded under lock so
+ * fast path is disabled when log is enabled.
+ */
+static RK_U32 try_ref_update_no_lock(MppBufferImpl *buffer, MppBufferGroupImpl *group,
+                                     RK_S32 delta)
+{
+    RK_S32 old;
+
+    if (NULL == group || group->log_runtime_en || group->log_history_en)
+        return 0;
+
+    old = buffer->ref_count;
+    while (old > 1 || (old > 0 && delta > 0)) {
+        if (MPP_BOOL_CAS(&buffer->ref_count, old, old + delta))
+            return 1;
+
+        old = buffer->ref_count;
+    }
+
+    return 0;
+}
+
 static void dump_buffer_info(MppBufferImpl *buffer)
 {
     mpp_log("buffer %p fd %4d size %10d ref_count %3d discard %d caller %s\n",
@@ -258,7 +395,6 @@ MPP_RET mpp_buffer_create(const char *tag, const char *caller,
                           MppBufferGroupImpl *group, MppBufferInfo *info,
                           MppBufferImpl **buffer)
 {
-    AutoMutex auto_lock(MppBufferService::get_lock());
     MPP_BUF_FUNCTION_ENTER();
 
     MPP_RET ret = MPP_OK;
@@ -267,8 +403,19 @@ MPP_RET mpp_buffer_create(const char *tag, const char *caller,
 
     if (NULL == group) {
         mpp_err_f("can not create buffer without group\n");
-        ret = MPP_NOK;
-        goto RET;
+        MPP_BUF_FUNCTION_LEAVE();
+        return MPP_NOK;
+    }
+
+    MPP_BUF_GRP_LOCK(group);
+
+    /* unused buffer can not match the request so release it for new one */
+    while (group->mode == MPP_BUFFER_INTERNAL && group->limit_count &&
+           group->buffer_count >= group->limit_count && group->count_unused) {
+        MppBufferImpl *pos = list_entry(group->list_unused.next,
+                                        MppBufferImpl, list_status);
+
+        buffer_evict_unused_no_lock(group, pos, caller);
     }
 
     if (group->limit_count && group->buffer_count >= group->limit_count) {
@@ -312,12 +459,12 @@ MPP_RET mpp_buffer_create(const char *tag, const char *caller,
     p->group_id = group->group_id;
     p->buffer_id = group->buffer_id;
     INIT_LIST_HEAD(&p->list_status);
-    list_add_tail(&p->list_status, &group->list_unused);
+    INIT_LIST_HEAD(&p->list_class);
+    buffer_add_unused_no_lock(group, p);
 
     group->buffer_id++;
     group->usage += info->size;
     group->buffer_count++;
-    group->count_unused++;
 
     buffer_group_add_log(group, p,
                          (group->mode == MPP_BUFFER_INTERNAL) ? (BUF_CREATE) : (BUF_COMMIT),
@@ -331,22 +478,28 @@ MPP_RET mpp_buffer_create(const char *tag, const char *caller,
     if (group->callback)
         group->callback(group->arg, group);
 RET:
+    MPP_BUF_GRP_UNLOCK(group);
     MPP_BUF_FUNCTION_LEAVE();
     return ret;
 }
 
 MPP_RET mpp_buffer_mmap(MppBufferImpl *buffer, const char* caller)
 {
-    AutoMutex auto_lock(MppBufferService::get_lock());
     MPP_BUF_FUNCTION_ENTER();
 
     MPP_RET ret = MPP_NOK;
     MppBufferGroupImpl *group = SEARCH_GROUP_BY_ID(buffer->group_id);
 
     if (group && group->alloc_api && group->alloc_api->mmap) {
-        ret = group->alloc_api->mmap(group->allocator, &buffer->info);
+        MPP_BUF_GRP_LOCK(group);
+        // check again for the buffer may be mapped by other thread
+        if (NULL == buffer->info.ptr)
+            ret = group->alloc_api->mmap(group->allocator, &buffer->info);
+        else
+            ret = MPP_OK;
 
         buffer_group_add_log(group, buffer, BUF_MMAP, caller);
+        MPP_BUF_GRP_UNLOCK(group);
     }
 
     if (ret)
@@ -359,10 +512,23 @@ MPP_RET mpp_buffer_mmap(MppBufferImpl *buffer, const char* caller)
 
 MPP_RET mpp_buffer_ref_inc(MppBufferImpl *buffer, const char* caller)
 {
-    AutoMutex auto_lock(MppBufferService::get_lock());
     MPP_BUF_FUNCTION_ENTER();
 
-    MPP_RET ret = inc_buffer_ref_no_lock(buffer, caller);
+    MPP_RET ret = MPP_OK;
+    MppBufferGroupImpl *group = SEARCH_GROUP_BY_ID(buffer->group_id);
+
+    if (try_ref_update_no_lock(buffer, group, 1)) {
+        MPP_BUF_FUNCTION_LEAVE();
+        return ret;
+    }
+
+    if (group) {
+        MPP_BUF_GRP_LOCK(group);
+        ret = inc_buffer_ref_no_lock(buffer, caller);
+        MPP_BUF_GRP_UNLOCK(group);
+    } else {
+        ret = inc_buffer_ref_no_lock(buffer, caller);
+    }
 
     MPP_BUF_FUNCTION_LEAVE();
     return ret;
@@ -371,38 +537,54 @@ MPP_RET mpp_buffer_ref_inc(MppBufferImpl *buffer, const char* caller)
 
 MPP_RET mpp_buffer_ref_dec(MppBufferImpl *buffer, const char* caller)
 {
-    AutoMutex auto_lock(MppBufferService::get_lock());
     MPP_BUF_FUNCTION_ENTER();
 
     MPP_RET ret = MPP_OK;
+    RK_U32 release_group = 0;
     MppBufferGroupImpl *group = SEARCH_GROUP_BY_ID(buffer->group_id);
-    if (group)
-        buffer_group_add_log(group, buffer, BUF_REF_DEC, caller);
+
+    if (try_ref_update_no_lock(buffer, group, -1)) {
+        MPP_BUF_FUNCTION_LEAVE();
+        return ret;
+    }
+
+    if (NULL == group) {
+        mpp_err_f("buffer %p group %d is not found caller %s\n",
+                  buffer, buffer->group_id, caller);
+        MPP_BUF_FUNCTION_LEAVE();
+        return MPP_NOK;
+    }
+
+    MPP_BUF_GRP_LOCK(group);
+
+    buffer_group_add_log(group, buffer, BUF_REF_DEC, caller);
 
     if (buffer->ref_count <= 0) {
         mpp_err_f("found non-positive ref_count %d caller %s\n",
                   buffer->ref_count, buffer->caller);
         mpp_abort();
         ret = MPP_NOK;
-    } else {
-        buffer->ref_count--;
-        if (0 == buffer->ref_count) {
-            buffer->used = 0;
-            list_del_init(&buffer->list_status);
-            if (group == MppBufferService::get_instance()->get_misc(group->mode, group->type)) {
-                deinit_buffer_no_lock(buffer, caller);
-            } else {
-                if (buffer->discard) {
-                    deinit_buffer_no_lock(buffer, caller);
-                } else {
-                    list_add_tail(&buffer->list_status, &group->list_unused);
-                    group->count_unused++;
-                }
-            }
-            group->count_used--;
-            if (group->callback)
-                group->callback(group->arg, group);
+    } else if (0 == MPP_SUB_FETCH(&buffer->ref_count, 1)) {
+        buffer->used = 0;
+        list_del_init(&buffer->list_status);
+        if (group->is_misc || buffer->discard) {
+            deinit_buffer_no_lock(buffer, caller);
+        } else {
+            buffer_add_unused_no_lock(group, buffer);
+            buffer_group_shrink_no_lock(group, caller);
         }
+        group->count_used--;
+        if (group->callback)
+            group->callback(group->arg, group);
+
+        release_group = group->is_orphan && !group->usage;
+    }
+
+    MPP_BUF_GRP_UNLOCK(group);
+
+    if (release_group) {
+        AutoMutex auto_lock(MppBufferService::get_lock());
+        MppBufferService::get_instance()->put_group(group);
     }
 
     MPP_BUF_FUNCTION_LEAVE();
@@ -411,37 +593,79 @@ MPP_RET mpp_buffer_ref_dec(MppBufferImpl *buffer, const char* caller)
 
 MppBufferImpl *mpp_buffer_get_unused(MppBufferGroupImpl *p, size_t size)
 {
-    AutoMutex auto_lock(MppBufferService::get_lock());
     MPP_BUF_FUNCTION_ENTER();
 
     MppBufferImpl *buffer = NULL;
+    RK_S32 idx = buffer_size_class(size);
+    RK_U32 mask;
+
+    MPP_BUF_GRP_LOCK(p);
+
+    /*
+     * Buffer in higher size class is always larger than buffer in lower class
+     * so the first class with matched buffer has the best-fit one.
+     * Internal group with idle limit does not use buffer larger than 4 times
+     * of the request. It will be kept for the large request and a new buffer
+     * is created.
+     */
+    mask = p->class_mask & (~0U << idx);
+    if (MPP_BUFFER_INTERNAL == p->mode && !p->idle_limit) {
+        /*
+         * Without idle limit the unused buffer smaller than the request is
+         * released as it will not be used after resolution change.
+         */
+        RK_U32 lower = p->class_mask & ~((~0U << idx) << 1);
+
+        while (lower) {
+            MppBufferImpl *pos, *n;
+            RK_S32 i = buffer_ctz32(lower);
 
-    if (!list_empty(&p->list_unused)) {
+            list_for_each_entry_safe(pos, n, &p->list_class[i], MppBufferImpl, list_class) {
+                if (pos->info.size < size)
+                    buffer_evict_unused_no_lock(p, pos, __FUNCTION__);
+            }
+
+            lower &= lower - 1;
+        }
+
+        mask = p->class_mask & (~0U << idx);
+    } else if (MPP_BUFFER_INTERNAL == p->mode && idx + 2 < MPP_BUF_SIZE_CLASS_COUNT) {
+        /* large buffer is kept for large request and evicted by idle limit */
+        mask &= (1U << (idx + 2)) - 1;
+    }
+
+    while (mask) {
         MppBufferImpl *pos, *n;
-        RK_S32 found = 0;
-        RK_S32 search_count = 0;
+        RK_S32 i = buffer_ctz32(mask);
 
-        list_for_each_entry_safe(pos, n, &p->list_unused, MppBufferImpl, list_status) {
+        list_for_each_entry_safe(pos, n, &p->list_class[i], MppBufferImpl, list_class) {
             mpp_buf_dbg(MPP_BUF_DBG_CHECK_SIZE, "request size %d on buf idx %d size %d\n",
                         size, pos->buffer_id, pos->info.size);
-            if (pos->info.size >= size) {
+            if (pos->info.size >= size &&
+                (NULL == buffer || pos->info.size < buffer->info.size)) {
                 buffer = pos;
-                inc_buffer_ref_no_lock(buffer, __FUNCTION__);
-                found = 1;
-                break;
-            } else {
-                if (MPP_BUFFER_INTERNAL == p->mode) {
-                    deinit_buffer_no_lock(pos, __FUNCTION__);
-                    p->count_unused--;
-                } else
-                    search_count++;
+                if (pos->info.size == size)
+                    break;
             }
         }
 
-        if (!found && search_count)
+        if (buffer)
+            break;
+
+        mask &= mask - 1;
+    }
+
+    if (buffer) {
+        inc_buffer_ref_no_lock(buffer, __FUNCTION__);
+        p->hit_count++;
+    } else {
+        p->miss_count++;
+        if (MPP_BUFFER_EXTERNAL == p->mode && p->count_unused)
             mpp_err_f("can not found match buffer with size larger than %d\n", size);
     }
 
+    MPP_BUF_GRP_UNLOCK(p);
+
     MPP_BUF_FUNCTION_LEAVE();
     return buffer;
 }
@@ -502,7 +726,6 @@ MPP_RET mpp_buffer_group_deinit(MppBufferGroupImpl *p)
 
 MPP_RET mpp_buffer_group_reset(MppBufferGroupImpl *p)
 {
-    AutoMutex auto_lock(MppBufferService::get_lock());
     if (NULL == p) {
         mpp_err_f("found NULL pointer\n");
         return MPP_ERR_NULL_PTR;
@@ -510,6 +733,8 @@ MPP_RET mpp_buffer_group_reset(MppBufferGroupImpl *p)
 
     MPP_BUF_FUNCTION_ENTER();
 
+    MPP_BUF_GRP_LOCK(p);
+
     buffer_group_add_log(p, NULL, GRP_RESET, NULL);
 
     if (!list_empty(&p->list_used)) {
@@ -524,19 +749,99 @@ MPP_RET mpp_buffer_group_reset(MppBufferGroupImpl *p)
     if (!list_empty(&p->list_unused)) {
         MppBufferImpl *pos, *n;
         list_for_each_entry_safe(pos, n, &p->list_unused, MppBufferImpl, list_status) {
+            buffer_del_unused_no_lock(p, pos);
             deinit_buffer_no_lock(pos, __FUNCTION__);
-            p->count_unused--;
         }
     }
 
+    MPP_BUF_GRP_UNLOCK(p);
+
     MPP_BUF_FUNCTION_LEAVE();
     return MPP_OK;
 }
 
+MPP_RET mpp_buffer_group_set_idle_limit(MppBufferGroupImpl *p, size_t size)
+{
+    if (NULL == p) {
+        mpp_err_f("found NULL pointer\n");
+        return MPP_ERR_NULL_PTR;
+    }
+
+    MPP_BUF_GRP_LOCK(p);
+    p->idle_limit = size;
+    buffer_group_shrink_no_lock(p, __FUNCTION__);
+    MPP_BUF_GRP_UNLOCK(p);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_buffer_group_prewarm(MppBufferGroupImpl *p, size_t size, RK_S32 count)
+{
+    if (NULL == p || 0 == size) {
+        mpp_err_f("invalid input group %p size %d\n", p, size);
+        return MPP_ERR_VALUE;
+    }
+
+    if (p->mode != MPP_BUFFER_INTERNAL) {
+        mpp_err_f("external group %d can not be prewarmed\n", p->group_id);
+        return MPP_NOK;
+    }
+
+    MPP_BUF_FUNCTION_ENTER();
+
+    MPP_RET ret = MPP_OK;
+    MppBufferImpl *pos, *n;
+    RK_S32 ready = 0;
+    RK_S32 create;
+
+    MPP_BUF_GRP_LOCK(p);
+
+    // unused buffer smaller than new size will never be used again
+    list_for_each_entry_safe(pos, n, &p->list_unused, MppBufferImpl, list_status) {
+        if (pos->info.size < size)
+            buffer_evict_unused_no_lock(p, pos, __FUNCTION__);
+        else
+            ready++;
+    }
+
+    list_for_each_entry_safe(pos, n, &p->list_used, MppBufferImpl, list_status) {
+        if (pos->info.size >= size && !pos->discard)
+            ready++;
+    }
+
+    create = count - ready;
+    if (p->limit_count && create > p->limit_count - p->buffer_count)
+        create = p->limit_count - p->buffer_count;
+
+    MPP_BUF_GRP_UNLOCK(p);
+
+    // mpp_buffer_create takes the group lock by itself
+    while (create-- > 0) {
+        MppBufferInfo info = {
+            p->type,
+            size,
+            NULL,
+            NULL,
+            -1,
+            -1,
+        };
+
+        ret = mpp_buffer_create(NULL, __FUNCTION__, p, &info, NULL);
+        if (ret)
+            break;
+    }
+
+    MPP_BUF_GRP_LOCK(p);
+    buffer_group_shrink_no_lock(p, __FUNCTION__);
+    MPP_BUF_GRP_UNLOCK(p);
+
+    MPP_BUF_FUNCTION_LEAVE();
+    return ret;
+}
+
 MPP_RET mpp_buffer_group_set_callback(MppBufferGroupImpl *p,
                                       MppBufCallback callback, void *arg)
 {
-    AutoMutex auto_lock(MppBufferService::get_lock());
     if (NULL == p) {
         mpp_err_f("found NULL pointer\n");
         return MPP_ERR_NULL_PTR;
@@ -544,8 +849,10 @@ MPP_RET mpp_buffer_group_set_callback(MppBufferGroupImpl *p,
 
     MPP_BUF_FUNCTION_ENTER();
 
+    MPP_BUF_GRP_LOCK(p);
     p->callback = callback;
     p->arg      = arg;
+    MPP_BUF_GRP_UNLOCK(p);
 
     MPP_BUF_FUNCTION_LEAVE();
     return MPP_OK;
@@ -553,11 +860,16 @@ MPP_RET mpp_buffer_group_set_callback(MppBufferGroupImpl *p,
 
 void mpp_buffer_group_dump(MppBufferGroupImpl *group, const char *caller)
 {
+    MPP_BUF_GRP_LOCK(group);
+
     mpp_log("\ndumping buffer group %p id %d from %s\n", group,
             group->group_id, caller);
     mpp_log("mode %s\n", mode2str[group->mode]);
     mpp_log("type %s\n", type2str[group->type]);
     mpp_log("limit size %d count %d\n", group->limit_size, group->limit_count);
+    mpp_log("idle size %d limit %d\n", group->idle_usage, group->idle_limit);
+    mpp_log("hit %lld miss %lld evict %lld size %d\n", group->hit_count,
+            group->miss_count, group->evict_count, group->evict_size);
 
     mpp_log("used buffer count %d\n", group->count_used);
 
@@ -572,6 +884,8 @@ void mpp_buffer_group_dump(MppBufferGroupImpl *group, const char *caller)
     }
 
     buffer_group_dump_log(group);
+
+    MPP_BUF_GRP_UNLOCK(group);
 }
 
 void mpp_buffer_service_dump()
@@ -611,6 +925,9 @@ MppBufferService::MppBufferService()
     INIT_LIST_HEAD(&mListGroup);
     INIT_LIST_HEAD(&mListOrphan);
 
+    for (i = 0; i < BUFFER_GROUP_MAX_COUNT; i++)
+        mGroups[i] = NULL;
+
     // NOTE: Do not create misc group at beginning. Only create on when needed.
     for (i = 0; i < MPP_BUFFER_MODE_BUTT; i++)
         for (j = 0; j < MPP_BUFFER_TYPE_BUTT; j++)
@@ -646,26 +963,35 @@ MppBufferService::~MppBufferService()
         }
     }
 
-    // remove all orphan buffer
+    // orphan group is waiting for its buffer release, just report them
     if (!list_empty(&mListOrphan)) {
-        MppBufferImpl *pos, *n;
+        MppBufferGroupImpl *pos, *n;
 
-        mpp_log_f("cleaning leaked buffer\n");
-        list_for_each_entry_safe(pos, n, &mListOrphan, MppBufferImpl, list_status) {
-            deinit_buffer_no_lock(pos, __FUNCTION__);
+        list_for_each_entry_safe(pos, n, &mListOrphan, MppBufferGroupImpl, list_group) {
+            mpp_log_f("leaked orphan group %s with %d bytes not released\n",
+                      pos->tag, pos->usage);
         }
     }
 }
 
 RK_U32 MppBufferService::get_group_id()
 {
-    // avoid group_id reuse
-    RK_U32 id = group_id++;
-    while (get_group_by_id(group_id)) {
-        group_id++;
+    RK_U32 i;
+
+    // avoid group_id reuse and find an empty slot in group table
+    for (i = 0; i < BUFFER_GROUP_MAX_COUNT; i++) {
+        RK_U32 id = group_id++;
+
+        if (id == BUFFER_GROUP_ID_INVALID)
+            continue;
+
+        if (NULL == mGroups[id & BUFFER_GROUP_ID_MASK]) {
+            group_count++;
+            return id;
+        }
     }
-    group_count++;
-    return id;
+
+    return BUFFER_GROUP_ID_INVALID;
 }
 
 MppBufferGroupImpl *MppBufferService::get_group(const char *tag, const char *caller,
@@ -673,18 +999,31 @@ MppBufferGroupImpl *MppBufferService::get_group(const char *tag, const char *cal
                                                 RK_U32 is_misc)
 {
     MppBufferType buffer_type = (MppBufferType)(type & MPP_BUFFER_TYPE_MASK);
+    RK_U32 id = get_group_id();
+    if (id == BUFFER_GROUP_ID_INVALID) {
+        mpp_err("MppBufferService reach max group count %d\n", BUFFER_GROUP_MAX_COUNT);
+        return NULL;
+    }
+
     MppBufferGroupImpl *p = mpp_calloc(MppBufferGroupImpl, 1);
     if (NULL == p) {
         mpp_err("MppBufferService failed to allocate group context\n");
+        group_count--;
         return NULL;
     }
 
-    RK_U32 id = get_group_id();
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&p->buf_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
 
     INIT_LIST_HEAD(&p->list_logs);
     INIT_LIST_HEAD(&p->list_group);
     INIT_LIST_HEAD(&p->list_used);
     INIT_LIST_HEAD(&p->list_unused);
+    for (RK_S32 i = 0; i < MPP_BUF_SIZE_CLASS_COUNT; i++)
+        INIT_LIST_HEAD(&p->list_class[i]);
 
     mpp_env_get_u32("mpp_buffer_debug", &mpp_buffer_debug, 0);
     p->log_runtime_en   = (mpp_buffer_debug & MPP_BUF_DBG_OPS_RUNTIME) ? (1) : (0);
@@ -714,8 +1053,11 @@ MppBufferGroupImpl *MppBufferService::get_group(const char *tag, const char *cal
     if (is_misc) {
         misc[mode][buffer_type] = p;
         misc_count++;
+        p->is_misc = 1;
     }
 
+    mGroups[id & BUFFER_GROUP_ID_MASK] = p;
+
     return p;
 }
 
@@ -745,19 +1087,23 @@ void MppBufferService::set_misc(MppBufferMode mode, MppBufferType type, MppBuffe
 
 void MppBufferService::put_group(MppBufferGroupImpl *p)
 {
+    RK_U32 destroy = 0;
+
+    MPP_BUF_GRP_LOCK(p);
+
     buffer_group_add_log(p, NULL, GRP_RELEASE, __FUNCTION__);
 
     // remove unused list
     if (!list_empty(&p->list_unused)) {
         MppBufferImpl *pos, *n;
         list_for_each_entry_safe(pos, n, &p->list_unused, MppBufferImpl, list_status) {
+            buffer_del_unused_no_lock(p, pos);
             deinit_buffer_no_lock(pos, __FUNCTION__);
-            p->count_unused--;
         }
     }
 
     if (list_empty(&p->list_used)) {
-        destroy_group(p);
+        destroy = 1;
     } else {
         if (!finalizing ||
             (finalizing && (mpp_buffer_debug & MPP_BUF_DBG_DUMP_ON_EXIT))) {
@@ -782,7 +1128,7 @@ void MppBufferService::put_group(MppBufferGroupImpl *p)
                 p->count_used--;
             }
 
-            destroy_group(p);
+            destroy = 1;
         } else {
             // otherwise move the group to list_orphan and wait for buffer release
             buffer_group_add_log(p, NULL, GRP_ORPHAN, __FUNCTION__);
@@ -791,6 +1137,12 @@ void MppBufferService::put_group(MppBufferGroupImpl *p)
             p->is_orphan = 1;
         }
     }
+
+    MPP_BUF_GRP_UNLOCK(p);
+
+    // NOTE: group without used buffer can only be accessed by its owner here
+    if (destroy)
+        destroy_group(p);
 }
 
 void MppBufferService::destroy_group(MppBufferGroupImpl *group)
@@ -809,6 +1161,11 @@ void MppBufferService::destroy_group(MppBufferGroupImpl *group)
 
     buffer_group_add_log(group, NULL, GRP_DESTROY, __FUNCTION__);
 
+    if (mpp_buffer_debug & MPP_BUF_DBG_POOL_STAT)
+        mpp_log("group %s hit %lld miss %lld evict %lld size %d\n",
+                group->tag, group->hit_count, group->miss_count,
+                group->evict_count, group->evict_size);
+
     if (group->log_history_en) {
         struct list_head *logs = &group->list_logs;
         while (!list_empty(logs)) {
@@ -823,6 +1180,9 @@ void MppBufferService::destroy_group(MppBufferGroupImpl *group)
     mpp_assert(group->allocator);
     mpp_allocator_put(&group->allocator);
     list_del_init(&group->list_group);
+    if (mGroups[group->group_id & BUFFER_GROUP_ID_MASK] == group)
+        mGroups[group->group_id & BUFFER_GROUP_ID_MASK] = NULL;
+    pthread_mutex_destroy(&group->buf_lock);
     mpp_free(group);
     group_count--;
 
@@ -834,20 +1194,9 @@ void MppBufferService::destroy_group(MppBufferGroupImpl *group)
 
 MppBufferGroupImpl *MppBufferService::get_group_by_id(RK_U32 id)
 {
-    MppBufferGroupImpl *pos, *n;
-    list_for_each_entry_safe(pos, n, &mListGroup, MppBufferGroupImpl, list_group) {
-        if (pos->group_id == id) {
-            return pos;
-        }
-    }
-
-    list_for_each_entry_safe(pos, n, &mListOrphan, MppBufferGroupImpl, list_group) {
-        if (pos->group_id == id) {
-            return pos;
-        }
-    }
+    MppBufferGroupImpl *p = mGroups[id & BUFFER_GROUP_ID_MASK];
 
-    return NULL;
+    return (p && p->group_id == id) ? p : NULL;
 }
 
 void MppBufferService::dump_misc_group()
@@ -20,6 +20,7 @@
 
 #include "mpp_mem.h"
 #include "mpp_list.h"
+#include "mpp_mem_pool.h"
 
 #include "mpp_meta_impl.h"
 
@@ -44,6 +45,7 @@ static MppMetaDef meta_defs[] = {
     {   KEY_LONG_REF_IDX,       TYPE_S32,       },
 
     {   KEY_ROI_DATA,           TYPE_PTR,       },
+    {   KEY_ROI_QP_MAP,         TYPE_PTR,       },
     {   KEY_OSD_DATA,           TYPE_PTR,       },
     {   KEY_USER_DATA,          TYPE_PTR,       },
     {   KEY_MV_LIST,            TYPE_PTR,       },
@@ -66,6 +68,10 @@ private:
     struct list_head    mlist_meta;
     struct list_head    mlist_node;
 
+    /* meta and node are created for every frame / packet so use pool */
+    MppMemPool          mpool_meta;
+    MppMemPool          mpool_node;
+
     RK_U32              meta_id;
     RK_U32              meta_count;
     RK_U32              node_count;
@@ -76,7 +82,7 @@ public:
         return &instance;
     }
     static Mutex *get_lock() {
-        static Mutex lock;
+        static Mutex lock(MUTEX_FAST, "mpp_meta");
         return &lock;
     }
 
@@ -105,6 +111,9 @@ MppMetaService::MppMetaService()
 {
     INIT_LIST_HEAD(&mlist_meta);
     INIT_LIST_HEAD(&mlist_node);
+
+    mpool_meta = mpp_mem_pool_init(sizeof(MppMetaImpl));
+    mpool_node = mpp_mem_pool_init(sizeof(MppMetaNode));
 }
 
 MppMetaService::~MppMetaService()
@@ -127,6 +136,15 @@ MppMetaService::~MppMetaService()
             put_node(pos);
         }
     }
+
+    if (mpool_meta) {
+        mpp_mem_pool_deinit(mpool_meta);
+        mpool_meta = NULL;
+    }
+    if (mpool_node) {
+        mpp_mem_pool_deinit(mpool_node);
+        mpool_node = NULL;
+    }
 }
 
 RK_S32 MppMetaService::get_index_of_key(MppMetaKey key, MppMetaType type)
@@ -144,7 +162,7 @@ RK_S32 MppMetaService::get_index_of_key(MppMetaKey key, MppMetaType type)
 
 MppMetaImpl *MppMetaService::get_meta(const char *tag, const char *caller)
 {
-    MppMetaImpl *impl = mpp_malloc(MppMetaImpl, 1);
+    MppMetaImpl *impl = (MppMetaImpl *)mpp_mem_pool_get(mpool_meta);
     if (impl) {
         const char *tag_src = (tag) ? (tag) : (MODULE_TAG);
         strncpy(impl->tag, tag_src, sizeof(impl->tag));
@@ -179,7 +197,7 @@ void MppMetaService::put_meta(MppMetaImpl *meta)
     mpp_assert(meta->node_count == 0);
     list_del_init(&meta->list_meta);
     meta_count--;
-    mpp_free(meta);
+    mpp_mem_pool_put(mpool_meta, meta);
 }
 
 void MppMetaService::inc_ref(MppMetaImpl *meta)
@@ -223,7 +241,7 @@ MppMetaNode *MppMetaService::get_node(MppMetaImpl *meta, RK_S32 type_id)
     MppMetaNode *node = find_node(meta, type_id);
 
     if (NULL == node) {
-        node = mpp_malloc(MppMetaNode, 1);
+        node = (MppMetaNode *)mpp_mem_pool_get(mpool_node);
         if (node) {
             INIT_LIST_HEAD(&node->list_meta);
             INIT_LIST_HEAD(&node->list_node);
@@ -265,7 +283,7 @@ void MppMetaService::put_node(MppMetaNode *node)
     default : {
     } break;
     }
-    mpp_free(node);
+    mpp_mem_pool_put(mpool_node, node);
 }
 
 MPP_RET mpp_meta_get_with_tag(MppMeta *meta, const char *tag, const char *caller)
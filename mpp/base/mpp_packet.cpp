@@ -20,11 +20,19 @@
 
 #include "mpp_log.h"
 #include "mpp_mem.h"
+#include "mpp_mem_pool.h"
 #include "mpp_packet_impl.h"
 #include "mpp_meta_impl.h"
 
 static const char *module_name = MODULE_TAG;
 
+static MppMemPool get_packet_pool()
+{
+    static MppMemPoolHolder pool(MODULE_TAG, sizeof(MppPacketImpl));
+
+    return pool.get();
+}
+
 #define setup_mpp_packet_name(packet) \
     ((MppPacketImpl*)packet)->name = module_name;
 
@@ -45,7 +53,7 @@ MPP_RET mpp_packet_new(MppPacket *packet)
         return MPP_ERR_NULL_PTR;
     }
 
-    MppPacketImpl *p = mpp_calloc(MppPacketImpl, 1);
+    MppPacketImpl *p = (MppPacketImpl *)mpp_mem_pool_get(get_packet_pool());
     *packet = p;
     if (NULL == p) {
         mpp_err_f("malloc failed\n");
@@ -113,6 +121,8 @@ MPP_RET mpp_packet_copy_init(MppPacket *packet, const MppPacket src)
 
     /* copy the source data */
     memcpy(pkt, src_impl, sizeof(*src_impl));
+    /* only the reference packet will call the release callback */
+    ((MppPacketImpl *)pkt)->flag &= ~MPP_PACKET_FLAG_REFERENCE;
 
     /* increase reference of meta data */
     if (src_impl->meta)
@@ -155,6 +165,38 @@ MPP_RET mpp_packet_copy_init(MppPacket *packet, const MppPacket src)
     return MPP_OK;
 }
 
+MPP_RET mpp_packet_ref_init(MppPacket *packet, const MppPacket src)
+{
+    if (NULL == packet || check_is_mpp_packet(src)) {
+        mpp_err_f("found invalid input %p %p\n", packet, src);
+        return MPP_ERR_UNKNOW;
+    }
+
+    *packet = NULL;
+
+    MppPacketImpl *src_impl = (MppPacketImpl *)src;
+    MppPacket pkt;
+    MPP_RET ret = mpp_packet_new(&pkt);
+    if (ret)
+        return ret;
+
+    /* share the source data and increase reference of meta / buffer */
+    memcpy(pkt, src_impl, sizeof(*src_impl));
+
+    if (src_impl->meta)
+        mpp_meta_inc_ref(src_impl->meta);
+
+    if (src_impl->buffer)
+        mpp_buffer_inc_ref(src_impl->buffer);
+
+    MppPacketImpl *p = (MppPacketImpl *)pkt;
+    p->flag &= ~MPP_PACKET_FLAG_INTERNAL;
+    p->flag |= MPP_PACKET_FLAG_REFERENCE;
+
+    *packet = pkt;
+    return MPP_OK;
+}
+
 MPP_RET mpp_packet_deinit(MppPacket *packet)
 {
     if (NULL == packet || check_is_mpp_packet(*packet)) {
@@ -168,13 +210,18 @@ MPP_RET mpp_packet_deinit(MppPacket *packet)
     if (p->buffer)
         mpp_buffer_put(p->buffer);
 
+    /* notify the data owner on reference packet release */
+    if ((p->flag & MPP_PACKET_FLAG_REFERENCE) && p->release)
+        p->release(p->release_ctx, p->data);
+
     if (p->flag & MPP_PACKET_FLAG_INTERNAL)
         mpp_free(p->data);
 
     if (p->meta)
         mpp_meta_put(p->meta);
 
-    mpp_free(p);
+    p->name = NULL;
+    mpp_mem_pool_put(get_packet_pool(), p);
     *packet = NULL;
     return MPP_OK;
 }
@@ -294,6 +341,16 @@ MppBuffer mpp_packet_get_buffer(const MppPacket packet)
     return p->buffer;
 }
 
+void mpp_packet_set_release_cb(MppPacket packet, MppPacketReleaseCb cb, void *ctx)
+{
+    if (check_is_mpp_packet(packet))
+        return ;
+
+    MppPacketImpl *p = (MppPacketImpl *)packet;
+    p->release = cb;
+    p->release_ctx = ctx;
+}
+
 RK_S32 mpp_packet_has_meta(const MppPacket packet)
 {
     if (check_is_mpp_packet(packet))
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MPP_STARTCODE_NEON
+#endif
+
+#include "mpp_startcode.h"
+
+RK_S32 mpp_find_start_code(const RK_U8 *buf, RK_S32 len)
+{
+    RK_S32 i = 0;
+
+    /*
+     * Compare 16 positions at once with three unaligned loads shifted by one
+     * byte: buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1.
+     */
+#if defined(__SSE2__)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi8(1);
+
+        for (; i + 18 <= len; i += 16) {
+            __m128i v0 = _mm_loadu_si128((const __m128i *)(buf + i));
+            __m128i v1 = _mm_loadu_si128((const __m128i *)(buf + i + 1));
+            __m128i v2 = _mm_loadu_si128((const __m128i *)(buf + i + 2));
+            __m128i m = _mm_and_si128(_mm_cmpeq_epi8(v0, zero),
+                                      _mm_cmpeq_epi8(v1, zero));
+            RK_S32 mask;
+
+            m = _mm_and_si128(m, _mm_cmpeq_epi8(v2, one));
+            mask = _mm_movemask_epi8(m);
+            if (mask)
+                return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(MPP_STARTCODE_NEON)
+    {
+        const uint8x16_t zero = vdupq_n_u8(0);
+        const uint8x16_t one = vdupq_n_u8(1);
+
+        for (; i + 18 <= len; i += 16) {
+            uint8x16_t v0 = vld1q_u8(buf + i);
+            uint8x16_t v1 = vld1q_u8(buf + i + 1);
+            uint8x16_t v2 = vld1q_u8(buf + i + 2);
+            uint8x16_t m = vandq_u8(vceqq_u8(v0, zero), vceqq_u8(v1, zero));
+            uint64x2_t m64;
+
+            m = vandq_u8(m, vceqq_u8(v2, one));
+            m64 = vreinterpretq_u64_u8(m);
+            /* found in this block, locate it by scalar loop below */
+            if (vgetq_lane_u64(m64, 0) | vgetq_lane_u64(m64, 1))
+                break;
+        }
+    }
+#endif
+
+    /*
+     * Scalar loop checks buf[i + 2] first. When it is larger than 1 or it is 1
+     * without two leading zeros none of position i, i + 1, i + 2 can start a
+     * start code.
+     */
+    while (i + 2 < len) {
+        RK_U8 c = buf[i + 2];
+
+        if (c > 1) {
+            i += 3;
+        } else if (c == 0) {
+            i++;
+        } else {
+            if (!buf[i] && !buf[i + 1])
+                return i;
+            i += 3;
+        }
+    }
+
+    return -1;
+}
@@ -21,6 +21,8 @@
 #include "mpp_env.h"
 #include "mpp_log.h"
 #include "mpp_mem.h"
+#include "mpp_time.h"
+#include "mpp_eventfd.h"
 
 #include "mpp_task_impl.h"
 #include "mpp_meta_impl.h"
@@ -41,6 +43,8 @@ typedef struct MppTaskStatusInfo_t {
     RK_S32              count;
     MppTaskStatus       status;
     Condition           *cond;
+    /* optional eventfd which is readable while count is not zero */
+    RK_S32              eventfd;
 } MppTaskStatusInfo;
 
 typedef struct MppTaskQueueImpl_t {
@@ -101,6 +105,29 @@ MPP_RET check_mpp_task_name(MppTask task)
     return MPP_NOK;
 }
 
+MPP_RET mpp_poll_type_check(MppPollType timeout)
+{
+    if (timeout > MPP_POLL_BUTT && timeout <= MPP_POLL_MAX)
+        return MPP_OK;
+
+    if (timeout > MPP_POLL_US_BASE &&
+        timeout <= MPP_POLL_US(MPP_POLL_MAX * 1000))
+        return MPP_OK;
+
+    return MPP_NOK;
+}
+
+RK_S64 mpp_poll_timeout_us(MppPollType timeout)
+{
+    if (timeout > MPP_POLL_US_BASE)
+        return (RK_S64)(timeout - MPP_POLL_US_BASE);
+
+    if (timeout > MPP_POLL_NON_BLOCK)
+        return (RK_S64)timeout * 1000;
+
+    return timeout;
+}
+
 static MPP_RET mpp_port_init(MppTaskQueueImpl *queue, MppPortType type, MppPort *port)
 {
     MppPortImpl *impl = mpp_malloc(MppPortImpl, 1);
@@ -181,10 +208,12 @@ MPP_RET _mpp_port_poll(const char *caller, MppPort port, MppPollType timeout)
                                   port_type_str[port_impl->type]);
                 cond->wait(queue->lock);
             } else {
-                mpp_task_dbg_flow("mpp %p %s from %s poll %s port %d timeout wait start\n",
+                RK_S64 timeout_us = mpp_poll_timeout_us(timeout);
+
+                mpp_task_dbg_flow("mpp %p %s from %s poll %s port %lld us timeout wait start\n",
                                   queue->mpp, queue->name, caller,
-                                  port_type_str[port_impl->type], timeout);
-                cond->timedwait(queue->lock, timeout);
+                                  port_type_str[port_impl->type], timeout_us);
+                cond->timedwait_us(queue->lock, timeout_us);
             }
 
             if (curr->count) {
@@ -243,6 +272,8 @@ MPP_RET _mpp_port_dequeue(const char *caller, MppPort port, MppTask *task)
     list_del_init(&task_impl->list);
     curr->count--;
     mpp_assert(curr->count >= 0);
+    if (!curr->count && curr->eventfd >= 0)
+        mpp_eventfd_read(curr->eventfd, NULL, 0);
 
     list_add_tail(&task_impl->list, &next->list);
     next->count++;
@@ -294,6 +325,9 @@ MPP_RET _mpp_port_enqueue(const char *caller, MppPort port, MppTask task)
     list_add_tail(&task_impl->list, &next->list);
     next->count++;
     task_impl->status = next->status;
+    task_impl->enqueue_time = mpp_time();
+    if (next->count == 1 && next->eventfd >= 0)
+        mpp_eventfd_write(next->eventfd, 1);
 
     mpp_task_dbg_flow("mpp %p %s from %s enqueue %s port task %p %s -> %s done\n",
                       queue->mpp, queue->name, caller,
@@ -310,6 +344,200 @@ RET:
     return ret;
 }
 
+MPP_RET _mpp_port_dequeue_n(const char *caller, MppPort port, MppTask *tasks,
+                            RK_S32 max, RK_S32 *count)
+{
+    MppPortImpl *port_impl = (MppPortImpl *)port;
+    MppTaskQueueImpl *queue = port_impl->queue;
+    MppTaskStatusInfo *curr = NULL;
+    MppTaskStatusInfo *next = NULL;
+    RK_S32 cnt = 0;
+
+    AutoMutex auto_lock(queue->lock);
+    MPP_RET ret = MPP_NOK;
+
+    mpp_task_dbg_func("caller %s enter port %p max %d\n", caller, port, max);
+
+    if (!queue->ready) {
+        mpp_err("try to dequeue when %s queue is not ready\n",
+                port_type_str[port_impl->type]);
+        goto RET;
+    }
+
+    curr = &queue->info[port_impl->status_curr];
+    next = &queue->info[port_impl->next_on_dequeue];
+
+    while (cnt < max && curr->count) {
+        MppTaskImpl *task_impl = list_entry(curr->list.next, MppTaskImpl, list);
+
+        check_mpp_task_name(task_impl);
+        list_del_init(&task_impl->list);
+        curr->count--;
+        list_add_tail(&task_impl->list, &next->list);
+        next->count++;
+        task_impl->status = next->status;
+        tasks[cnt++] = (MppTask)task_impl;
+    }
+
+    if (cnt && !curr->count && curr->eventfd >= 0)
+        mpp_eventfd_read(curr->eventfd, NULL, 0);
+
+    mpp_task_dbg_flow("mpp %p %s from %s dequeue %s port %d tasks %s -> %s\n",
+                      queue->mpp, queue->name, caller,
+                      port_type_str[port_impl->type], cnt,
+                      task_status_str[port_impl->status_curr],
+                      task_status_str[port_impl->next_on_dequeue]);
+
+    ret = (cnt) ? (MPP_OK) : (MPP_NOK);
+RET:
+    *count = cnt;
+    mpp_task_dbg_func("caller %s leave port %p count %d ret %d\n", caller, port, cnt, ret);
+
+    return ret;
+}
+
+/* all tasks should be held by the port user and each task listed once */
+static MPP_RET check_port_hold_tasks(const char *caller, MppPortImpl *port_impl,
+                                     MppTask *tasks, RK_S32 count)
+{
+    MppTaskQueueImpl *queue = port_impl->queue;
+    RK_S32 i, j;
+
+    for (i = 0; i < count; i++) {
+        MppTaskImpl *task_impl = (MppTaskImpl *)tasks[i];
+
+        check_mpp_task_name(task_impl);
+        if (task_impl->queue != (MppTaskQueue)queue ||
+            task_impl->status != port_impl->next_on_dequeue) {
+            mpp_err("%s %s port invalid task %p at %d\n", caller,
+                    port_type_str[port_impl->type], task_impl, i);
+            return MPP_NOK;
+        }
+
+        /* task listed twice would be moved and counted twice */
+        for (j = 0; j < i; j++) {
+            if (tasks[j] == tasks[i]) {
+                mpp_err("%s %s port duplicated task %p at %d and %d\n", caller,
+                        port_type_str[port_impl->type], task_impl, j, i);
+                return MPP_NOK;
+            }
+        }
+    }
+
+    return MPP_OK;
+}
+
+MPP_RET _mpp_port_enqueue_n(const char *caller, MppPort port, MppTask *tasks,
+                            RK_S32 count)
+{
+    MppPortImpl *port_impl = (MppPortImpl *)port;
+    MppTaskQueueImpl *queue = port_impl->queue;
+    MppTaskStatusInfo *curr = NULL;
+    MppTaskStatusInfo *next = NULL;
+    RK_S64 time = mpp_time();
+    RK_S32 i;
+
+    AutoMutex auto_lock(queue->lock);
+    MPP_RET ret = MPP_NOK;
+
+    mpp_task_dbg_func("caller %s enter port %p count %d\n", caller, port, count);
+
+    if (!queue->ready) {
+        mpp_err("try to enqueue when %s queue is not ready\n",
+                port_type_str[port_impl->type]);
+        goto RET;
+    }
+
+    if (check_port_hold_tasks(caller, port_impl, tasks, count))
+        goto RET;
+
+    curr = &queue->info[port_impl->next_on_dequeue];
+    next = &queue->info[port_impl->next_on_enqueue];
+
+    for (i = 0; i < count; i++) {
+        MppTaskImpl *task_impl = (MppTaskImpl *)tasks[i];
+
+        list_del_init(&task_impl->list);
+        curr->count--;
+        list_add_tail(&task_impl->list, &next->list);
+        next->count++;
+        task_impl->status = next->status;
+        task_impl->enqueue_time = time;
+    }
+
+    if (count && next->count == count && next->eventfd >= 0)
+        mpp_eventfd_write(next->eventfd, 1);
+
+    mpp_task_dbg_flow("mpp %p %s from %s enqueue %s port %d tasks %s -> %s\n",
+                      queue->mpp, queue->name, caller,
+                      port_type_str[port_impl->type], count,
+                      task_status_str[port_impl->next_on_dequeue],
+                      task_status_str[port_impl->next_on_enqueue]);
+
+    if (count)
+        next->cond->signal();
+    ret = MPP_OK;
+RET:
+    mpp_task_dbg_func("caller %s leave port %p ret %d\n", caller, port, ret);
+
+    return ret;
+}
+
+MPP_RET _mpp_port_cancel_n(const char *caller, MppPort port, MppTask *tasks,
+                           RK_S32 count)
+{
+    MppPortImpl *port_impl = (MppPortImpl *)port;
+    MppTaskQueueImpl *queue = port_impl->queue;
+    MppTaskStatusInfo *curr = NULL;
+    MppTaskStatusInfo *hold = NULL;
+    RK_S32 i;
+
+    AutoMutex auto_lock(queue->lock);
+    MPP_RET ret = MPP_NOK;
+
+    mpp_task_dbg_func("caller %s enter port %p count %d\n", caller, port, count);
+
+    if (!queue->ready) {
+        mpp_err("try to cancel when %s queue is not ready\n",
+                port_type_str[port_impl->type]);
+        goto RET;
+    }
+
+    if (check_port_hold_tasks(caller, port_impl, tasks, count))
+        goto RET;
+
+    curr = &queue->info[port_impl->status_curr];
+    hold = &queue->info[port_impl->next_on_dequeue];
+
+    /* add to list head in reverse order to be dequeued again first */
+    for (i = count - 1; i >= 0; i--) {
+        MppTaskImpl *task_impl = (MppTaskImpl *)tasks[i];
+
+        list_del_init(&task_impl->list);
+        hold->count--;
+        list_add(&task_impl->list, &curr->list);
+        curr->count++;
+        task_impl->status = curr->status;
+    }
+
+    if (count && curr->count == count && curr->eventfd >= 0)
+        mpp_eventfd_write(curr->eventfd, 1);
+
+    mpp_task_dbg_flow("mpp %p %s from %s cancel %s port %d tasks %s -> %s\n",
+                      queue->mpp, queue->name, caller,
+                      port_type_str[port_impl->type], count,
+                      task_status_str[port_impl->next_on_dequeue],
+                      task_status_str[port_impl->status_curr]);
+
+    if (count)
+        curr->cond->signal();
+    ret = MPP_OK;
+RET:
+    mpp_task_dbg_func("caller %s leave port %p ret %d\n", caller, port, ret);
+
+    return ret;
+}
+
 MPP_RET _mpp_port_awake(const char *caller, MppPort port)
 {
     if (port == NULL)
@@ -331,6 +559,26 @@ MPP_RET _mpp_port_awake(const char *caller, MppPort port)
     return MPP_OK;
 }
 
+MPP_RET mpp_port_set_eventfd(MppPort port, RK_S32 fd)
+{
+    if (NULL == port) {
+        mpp_err_f("invalid NULL input port\n");
+        return MPP_ERR_NULL_PTR;
+    }
+
+    MppPortImpl *port_impl = (MppPortImpl *)port;
+    MppTaskQueueImpl *queue = port_impl->queue;
+    AutoMutex auto_lock(queue->lock);
+    MppTaskStatusInfo *curr = &queue->info[port_impl->status_curr];
+
+    curr->eventfd = fd;
+    /* sync eventfd with the tasks already in the port */
+    if (fd >= 0 && curr->count)
+        mpp_eventfd_write(fd, 1);
+
+    return MPP_OK;
+}
+
 MPP_RET mpp_task_queue_init(MppTaskQueue *queue, void *mpp, const char *name)
 {
     if (NULL == queue) {
@@ -371,9 +619,10 @@ MPP_RET mpp_task_queue_init(MppTaskQueue *queue, void *mpp, const char *name)
         p->info[i].count  = 0;
         p->info[i].status = (MppTaskStatus)i;
         p->info[i].cond = cond[i];
+        p->info[i].eventfd = -1;
     }
 
-    lock = new Mutex();
+    lock = new Mutex(MUTEX_FAST, "mpp_task_queue");
     if (NULL == lock) {
         mpp_err_f("new lock failed\n");
         goto RET;
@@ -0,0 +1,324 @@
+/*
+ * Copyright 2015 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_bitread_test"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_time.h"
+#include "mpp_common.h"
+#include "mpp_bitread.h"
+#include "mpp_bitwrite.h"
+
+/*
+ * bit reader correctness check and microbenchmark
+ *
+ * A random syntax element stream is written by bit writer with emulation
+ * prevention bytes. Then it is read back by mpp_bitread and by the legacy
+ * byte by byte reader for comparison.
+ */
+#define BIT_READ_ELEM_COUNT     (64 * 1024)
+#define BIT_READ_BUF_SIZE       (BIT_READ_ELEM_COUNT * 8)
+#define BIT_READ_LOOP           50
+
+typedef enum BitReadOpsType_e {
+    BIT_READ_BITS,
+    BIT_READ_LONG,
+    BIT_READ_UE,
+    BIT_READ_SE,
+    BIT_READ_ZERO,
+    BIT_READ_BUTT,
+} BitReadOpsType;
+
+typedef struct BitReadOps_t {
+    BitReadOpsType  type;
+    RK_S32          val;
+    RK_S32          len;
+} BitReadOps;
+
+/* legacy reader with emulation prevention detection on each byte */
+static MPP_RET legacy_update_curbyte(BitReadCtx_t *bitctx)
+{
+    if (bitctx->bytes_left_ < 1)
+        return MPP_ERR_READ_BIT;
+
+    if (bitctx->need_prevention_detection
+        && (*bitctx->data_ == 0x03)
+        && ((bitctx->prev_two_bytes_ & 0xffff) == 0)) {
+        ++bitctx->data_;
+        --bitctx->bytes_left_;
+        bitctx->prev_two_bytes_ = 0xffff;
+        if (bitctx->bytes_left_ < 1)
+            return MPP_ERR_READ_BIT;
+    }
+
+    bitctx->curr_byte_ = *bitctx->data_++ & 0xff;
+    --bitctx->bytes_left_;
+    bitctx->num_remaining_bits_in_curr_byte_ = 8;
+    bitctx->prev_two_bytes_ = (bitctx->prev_two_bytes_ << 8) | bitctx->curr_byte_;
+
+    return MPP_OK;
+}
+
+static MPP_RET legacy_read_bits(BitReadCtx_t *bitctx, RK_S32 num_bits, RK_S32 *out)
+{
+    RK_S32 bits_left = num_bits;
+
+    *out = 0;
+    while (bitctx->num_remaining_bits_in_curr_byte_ < bits_left) {
+        *out |= (bitctx->curr_byte_ << (bits_left - bitctx->num_remaining_bits_in_curr_byte_));
+        bits_left -= bitctx->num_remaining_bits_in_curr_byte_;
+        if (legacy_update_curbyte(bitctx))
+            return MPP_ERR_READ_BIT;
+    }
+    *out |= (bitctx->curr_byte_ >> (bitctx->num_remaining_bits_in_curr_byte_ - bits_left));
+    *out &= ((1 << num_bits) - 1);
+    bitctx->num_remaining_bits_in_curr_byte_ -= bits_left;
+    bitctx->used_bits += num_bits;
+
+    return MPP_OK;
+}
+
+static MPP_RET legacy_read_ue(BitReadCtx_t *bitctx, RK_U32 *val)
+{
+    RK_S32 num_bits = -1;
+    RK_S32 bit;
+    RK_S32 rest;
+
+    do {
+        if (legacy_read_bits(bitctx, 1, &bit))
+            return MPP_ERR_READ_BIT;
+        num_bits++;
+    } while (bit == 0);
+
+    *val = (1 << num_bits) - 1;
+    if (num_bits > 0) {
+        if (legacy_read_bits(bitctx, num_bits, &rest))
+            return MPP_ERR_READ_BIT;
+        *val += rest;
+    }
+
+    return MPP_OK;
+}
+
+static void gen_ops(BitReadOps *ops, RK_S32 count)
+{
+    RK_S32 i;
+
+    srand(0x1234);
+
+    for (i = 0; i < count; i++) {
+        BitReadOps *op = &ops[i];
+        RK_S32 sel = rand() % 64;
+
+        if (sel < 24) {
+            op->type = BIT_READ_UE;
+            op->val = (sel < 20) ? rand() % 16 : rand() % (1 << 18);
+        } else if (sel < 36) {
+            op->type = BIT_READ_SE;
+            op->val = rand() % 64 - 32;
+        } else if (sel < 58) {
+            op->type = BIT_READ_BITS;
+            op->len = rand() % 24 + 1;
+            op->val = rand() & ((1 << op->len) - 1);
+        } else if (sel < 63) {
+            op->type = BIT_READ_LONG;
+            op->len = 32;
+            op->val = (rand() << 16) ^ rand();
+        } else {
+            /* zero run to generate emulation prevention bytes */
+            op->type = BIT_READ_ZERO;
+            op->len = 24;
+            op->val = 0;
+        }
+    }
+}
+
+static RK_S32 write_ops(BitReadOps *ops, RK_S32 count, RK_U8 *buf, RK_S32 size)
+{
+    MppWriteCtx writer;
+    RK_S32 i;
+
+    mpp_writer_init(&writer, buf, size);
+
+    for (i = 0; i < count; i++) {
+        BitReadOps *op = &ops[i];
+
+        switch (op->type) {
+        case BIT_READ_BITS :
+        case BIT_READ_ZERO : {
+            mpp_writer_put_bits(&writer, op->val, op->len);
+        } break;
+        case BIT_READ_LONG : {
+            mpp_writer_put_bits(&writer, (RK_U32)op->val >> 16, 16);
+            mpp_writer_put_bits(&writer, op->val & 0xffff, 16);
+        } break;
+        case BIT_READ_UE : {
+            mpp_writer_put_ue(&writer, op->val);
+        } break;
+        case BIT_READ_SE : {
+            mpp_writer_put_se(&writer, op->val);
+        } break;
+        default : {
+        } break;
+        }
+    }
+
+    mpp_writer_trailing(&writer);
+
+    mpp_log("write %d elements to %d bytes with %d emulation prevention bytes\n",
+            count, mpp_writer_bytes(&writer), writer.emul_cnt);
+
+    return mpp_writer_bytes(&writer);
+}
+
+static MPP_RET read_ops(BitReadCtx_t *bitctx, BitReadOps *ops, RK_S32 count)
+{
+    RK_S32 i;
+
+    for (i = 0; i < count; i++) {
+        BitReadOps *op = &ops[i];
+        RK_S32 val = 0;
+
+        switch (op->type) {
+        case BIT_READ_BITS :
+        case BIT_READ_ZERO : {
+            READ_BITS(bitctx, op->len, &val);
+        } break;
+        case BIT_READ_LONG : {
+            READ_BITS_LONG(bitctx, op->len, &val);
+        } break;
+        case BIT_READ_UE : {
+            READ_UE(bitctx, &val);
+        } break;
+        case BIT_READ_SE : {
+            READ_SE(bitctx, &val);
+        } break;
+        default : {
+        } break;
+        }
+
+        if (val != op->val) {
+            mpp_err("element %d type %d mismatch read %d expect %d\n",
+                    i, op->type, val, op->val);
+            return MPP_NOK;
+        }
+    }
+
+    return MPP_OK;
+
+__BITREAD_ERR:
+    mpp_err("element %d read failed at bit %d\n", i, bitctx->used_bits);
+    return bitctx->ret;
+}
+
+static MPP_RET legacy_read_ops(BitReadCtx_t *bitctx, BitReadOps *ops, RK_S32 count)
+{
+    RK_S32 i;
+
+    for (i = 0; i < count; i++) {
+        BitReadOps *op = &ops[i];
+        RK_S32 val = 0;
+        RK_S32 val1 = 0;
+        RK_U32 ue = 0;
+
+        switch (op->type) {
+        case BIT_READ_BITS :
+        case BIT_READ_ZERO : {
+            bitctx->ret = legacy_read_bits(bitctx, op->len, &val);
+        } break;
+        case BIT_READ_LONG : {
+            bitctx->ret = legacy_read_bits(bitctx, 16, &val);
+            bitctx->ret |= legacy_read_bits(bitctx, 16, &val1);
+            val = (val << 16) | val1;
+        } break;
+        case BIT_READ_UE : {
+            bitctx->ret = legacy_read_ue(bitctx, &ue);
+            val = ue;
+        } break;
+        case BIT_READ_SE : {
+            bitctx->ret = legacy_read_ue(bitctx, &ue);
+            val = (ue & 1) ? (RK_S32)((ue >> 1) + 1) : -(RK_S32)(ue >> 1);
+        } break;
+        default : {
+        } break;
+        }
+
+        if (bitctx->ret || val != op->val) {
+            mpp_err("legacy element %d type %d mismatch read %d expect %d\n",
+                    i, op->type, val, op->val);
+            return MPP_NOK;
+        }
+    }
+
+    return MPP_OK;
+}
+
+int main()
+{
+    MPP_RET ret = MPP_NOK;
+    BitReadOps *ops = mpp_calloc(BitReadOps, BIT_READ_ELEM_COUNT);
+    RK_U8 *buf = mpp_calloc(RK_U8, BIT_READ_BUF_SIZE);
+    BitReadCtx_t bitctx;
+    RK_S64 time_start;
+    RK_S64 time_new = 0;
+    RK_S64 time_legacy = 0;
+    RK_S32 size;
+    RK_S32 i;
+
+    mpp_log("mpp_bitread_test start\n");
+
+    if (NULL == ops || NULL == buf) {
+        mpp_err("malloc failed\n");
+        goto DONE;
+    }
+
+    gen_ops(ops, BIT_READ_ELEM_COUNT);
+    size = write_ops(ops, BIT_READ_ELEM_COUNT, buf, BIT_READ_BUF_SIZE);
+
+    for (i = 0; i < BIT_READ_LOOP; i++) {
+        time_start = mpp_time();
+        mpp_set_bitread_ctx(&bitctx, buf, size);
+        mpp_set_pre_detection(&bitctx);
+        ret = read_ops(&bitctx, ops, BIT_READ_ELEM_COUNT);
+        time_new += mpp_time() - time_start;
+        if (ret)
+            goto DONE;
+
+        time_start = mpp_time();
+        mpp_set_bitread_ctx(&bitctx, buf, size);
+        mpp_set_pre_detection(&bitctx);
+        ret = legacy_read_ops(&bitctx, ops, BIT_READ_ELEM_COUNT);
+        time_legacy += mpp_time() - time_start;
+        if (ret)
+            goto DONE;
+    }
+
+    mpp_log("read %d elements x %d loop\n", BIT_READ_ELEM_COUNT, BIT_READ_LOOP);
+    mpp_log("legacy reader %8lld us\n", time_legacy);
+    mpp_log("mpp_bitread   %8lld us - speedup %.2f\n", time_new,
+            (float)time_legacy / MPP_MAX(time_new, 1));
+
+DONE:
+    MPP_FREE(ops);
+    MPP_FREE(buf);
+
+    mpp_log("mpp_bitread_test %s\n", ret ? "failed" : "success");
+    return ret;
+}
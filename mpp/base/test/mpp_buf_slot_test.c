@@ -0,0 +1,241 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_buf_slot_test"
+
+#include <sched.h>
+#include <string.h>
+
+#include "mpp_log.h"
+#include "mpp_time.h"
+#include "mpp_thread.h"
+#include "mpp_buf_slot.h"
+
+/*
+ * buffer slot churn benchmark
+ *
+ * Three threads work on one MppBufSlots like the decoder pipeline:
+ * parser  - get unused slot, mark codec ready / use and send to hal
+ * hal     - mark hal output, enqueue for display and mark decoded
+ * user    - dequeue display slot and release codec use
+ */
+#define BUF_SLOT_TEST_LOOP      100000
+
+typedef struct BufSlotTestCtx_t {
+    MppBufSlots     slots;
+    RK_S32          loop;
+    MPP_RET         ret;
+} BufSlotTestCtx;
+
+static void *slot_parser_thread(void *arg)
+{
+    BufSlotTestCtx *ctx = (BufSlotTestCtx *)arg;
+    MppBufSlots slots = ctx->slots;
+    RK_S32 index;
+    RK_S32 i;
+
+    for (i = 0; i < ctx->loop; i++) {
+        while (mpp_slots_get_unused_count(slots) <= 0)
+            sched_yield();
+
+        if (mpp_buf_slot_get_unused(slots, &index)) {
+            ctx->ret = MPP_NOK;
+            break;
+        }
+
+        mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_READY);
+        mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_USE);
+        mpp_buf_slot_enqueue(slots, index, QUEUE_DEINTERLACE);
+    }
+
+    return NULL;
+}
+
+static void *slot_hal_thread(void *arg)
+{
+    BufSlotTestCtx *ctx = (BufSlotTestCtx *)arg;
+    MppBufSlots slots = ctx->slots;
+    RK_S32 index;
+    RK_S32 i = 0;
+
+    while (i < ctx->loop) {
+        if (mpp_buf_slot_dequeue(slots, &index, QUEUE_DEINTERLACE)) {
+            sched_yield();
+            continue;
+        }
+
+        mpp_buf_slot_set_flag(slots, index, SLOT_HAL_OUTPUT);
+        mpp_buf_slot_enqueue(slots, index, QUEUE_DISPLAY);
+        mpp_buf_slot_clr_flag(slots, index, SLOT_HAL_OUTPUT);
+        i++;
+    }
+
+    return NULL;
+}
+
+static void *slot_user_thread(void *arg)
+{
+    BufSlotTestCtx *ctx = (BufSlotTestCtx *)arg;
+    MppBufSlots slots = ctx->slots;
+    RK_S32 index;
+    RK_S32 i = 0;
+
+    while (i < ctx->loop) {
+        if (mpp_buf_slot_dequeue(slots, &index, QUEUE_DISPLAY)) {
+            sched_yield();
+            continue;
+        }
+
+        mpp_buf_slot_clr_flag(slots, index, SLOT_CODEC_USE);
+        i++;
+    }
+
+    return NULL;
+}
+
+static MPP_RET buf_slot_test_run(RK_S32 count)
+{
+    BufSlotTestCtx ctx;
+    pthread_t thd[3];
+    RK_S64 time_start;
+    RK_S64 time_end;
+    MPP_RET ret;
+
+    memset(&ctx, 0, sizeof(ctx));
+
+    ret = mpp_buf_slot_init(&ctx.slots);
+    if (ret)
+        return ret;
+
+    mpp_buf_slot_setup(ctx.slots, count);
+    ctx.loop = BUF_SLOT_TEST_LOOP;
+
+    time_start = mpp_time();
+
+    pthread_create(&thd[0], NULL, slot_parser_thread, &ctx);
+    pthread_create(&thd[1], NULL, slot_hal_thread, &ctx);
+    pthread_create(&thd[2], NULL, slot_user_thread, &ctx);
+
+    pthread_join(thd[0], NULL);
+    pthread_join(thd[1], NULL);
+    pthread_join(thd[2], NULL);
+
+    time_end = mpp_time();
+
+    /* each frame has 10 slot operations */
+    mpp_log("slot count %2d frames %d cost %6lld us - %6.2f Mops/s\n",
+            count, ctx.loop, time_end - time_start,
+            (float)ctx.loop * 10 / (time_end - time_start));
+
+    if (mpp_slots_get_used_count(ctx.slots)) {
+        mpp_err("slot count %d used count %d after churn\n", count,
+                mpp_slots_get_used_count(ctx.slots));
+        ctx.ret = MPP_NOK;
+    }
+
+    mpp_buf_slot_deinit(ctx.slots);
+
+    return ctx.ret;
+}
+
+static MPP_RET buf_slot_test_alloc(RK_S32 count)
+{
+    MppBufSlots slots = NULL;
+    MPP_RET ret = MPP_NOK;
+    RK_S32 index;
+    RK_S32 i;
+
+    mpp_buf_slot_init(&slots);
+    mpp_buf_slot_setup(slots, count);
+
+    /* slot should be allocated from the lowest free index */
+    for (i = 0; i < count; i++) {
+        mpp_buf_slot_get_unused(slots, &index);
+        mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_READY);
+        mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_USE);
+        if (index != i) {
+            mpp_err("get slot %d expect %d\n", index, i);
+            goto DONE;
+        }
+    }
+
+    if (mpp_slots_get_unused_count(slots))
+        goto DONE;
+
+    mpp_buf_slot_clr_flag(slots, count - 1, SLOT_CODEC_USE);
+    mpp_buf_slot_clr_flag(slots, count / 2, SLOT_CODEC_USE);
+
+    mpp_buf_slot_get_unused(slots, &index);
+    if (index != count / 2) {
+        mpp_err("get slot %d expect %d\n", index, count / 2);
+        goto DONE;
+    }
+    mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_READY);
+    mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_USE);
+
+    mpp_buf_slot_get_unused(slots, &index);
+    if (index != count - 1) {
+        mpp_err("get slot %d expect %d\n", index, count - 1);
+        goto DONE;
+    }
+    mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_READY);
+    mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_USE);
+
+    /* grow on setup should keep the slots in use */
+    mpp_buf_slot_setup(slots, count * 2);
+    mpp_buf_slot_clr_flag(slots, count / 2, SLOT_CODEC_USE);
+
+    mpp_buf_slot_get_unused(slots, &index);
+    if (index != count / 2) {
+        mpp_err("get slot %d expect %d after grow\n", index, count / 2);
+        goto DONE;
+    }
+    mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_READY);
+    mpp_buf_slot_set_flag(slots, index, SLOT_CODEC_USE);
+
+    ret = MPP_OK;
+DONE:
+    for (i = 0; i < count; i++)
+        mpp_buf_slot_clr_flag(slots, i, SLOT_CODEC_USE);
+
+    mpp_buf_slot_deinit(slots);
+    return ret;
+}
+
+int main()
+{
+    static RK_S32 counts[] = { 8, 32, 33, 64 };
+    MPP_RET ret = MPP_OK;
+    RK_U32 i;
+
+    mpp_log("mpp_buf_slot_test start\n");
+
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        ret = buf_slot_test_alloc(counts[i]);
+        if (ret)
+            goto DONE;
+    }
+
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        ret = buf_slot_test_run(counts[i]);
+        if (ret)
+            goto DONE;
+    }
+
+DONE:
+    mpp_log("mpp_buf_slot_test %s\n", ret ? "failed" : "success");
+    return ret;
+}
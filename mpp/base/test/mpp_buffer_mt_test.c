@@ -0,0 +1,191 @@
+/*
+ * Copyright 2015 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_buffer_mt_test"
+
+#include <string.h>
+
+#include "mpp_log.h"
+#include "mpp_env.h"
+#include "mpp_time.h"
+#include "mpp_common.h"
+#include "mpp_buffer.h"
+
+/*
+ * buffer service contention benchmark
+ *
+ * private case : each thread get / ref / put buffer on its own group
+ * shared  case : all threads ref_inc / ref_dec the same buffers
+ */
+#define MPP_BUFFER_MT_MAX_THREAD        16
+#define MPP_BUFFER_MT_BUF_COUNT         8
+#define MPP_BUFFER_MT_BUF_SIZE          (SZ_1K)
+#define MPP_BUFFER_MT_LOOP              20000
+
+typedef struct MppBufferMtCtx_t {
+    pthread_t       thd;
+    RK_S32          idx;
+    RK_S32          loop;
+    MppBufferGroup  group;
+    MppBuffer       *shared;
+    RK_S32          ops;
+    MPP_RET         ret;
+} MppBufferMtCtx;
+
+static void *buffer_private_worker(void *arg)
+{
+    MppBufferMtCtx *ctx = (MppBufferMtCtx *)arg;
+    MppBuffer buf[MPP_BUFFER_MT_BUF_COUNT];
+    RK_S32 i, j;
+
+    for (i = 0; i < ctx->loop; i++) {
+        for (j = 0; j < MPP_BUFFER_MT_BUF_COUNT; j++) {
+            ctx->ret = mpp_buffer_get(ctx->group, &buf[j], MPP_BUFFER_MT_BUF_SIZE);
+            if (ctx->ret)
+                return NULL;
+
+            mpp_buffer_inc_ref(buf[j]);
+            mpp_buffer_put(buf[j]);
+        }
+
+        for (j = 0; j < MPP_BUFFER_MT_BUF_COUNT; j++)
+            mpp_buffer_put(buf[j]);
+
+        ctx->ops += MPP_BUFFER_MT_BUF_COUNT * 4;
+    }
+
+    return NULL;
+}
+
+static void *buffer_shared_worker(void *arg)
+{
+    MppBufferMtCtx *ctx = (MppBufferMtCtx *)arg;
+    RK_S32 i, j;
+
+    for (i = 0; i < ctx->loop; i++) {
+        for (j = 0; j < MPP_BUFFER_MT_BUF_COUNT; j++)
+            mpp_buffer_inc_ref(ctx->shared[j]);
+
+        for (j = 0; j < MPP_BUFFER_MT_BUF_COUNT; j++)
+            mpp_buffer_put(ctx->shared[j]);
+
+        ctx->ops += MPP_BUFFER_MT_BUF_COUNT * 2;
+    }
+
+    return NULL;
+}
+
+static MPP_RET buffer_mt_run(RK_S32 thread_count, RK_S32 shared)
+{
+    MppBufferMtCtx ctx[MPP_BUFFER_MT_MAX_THREAD];
+    MppBuffer shared_buf[MPP_BUFFER_MT_BUF_COUNT];
+    MppBufferGroup shared_group = NULL;
+    MPP_RET ret = MPP_OK;
+    RK_S64 time_start, time_end;
+    RK_S64 ops = 0;
+    RK_S32 i;
+
+    memset(ctx, 0, sizeof(ctx));
+    memset(shared_buf, 0, sizeof(shared_buf));
+
+    if (shared) {
+        ret = mpp_buffer_group_get_internal(&shared_group, MPP_BUFFER_TYPE_NORMAL);
+        if (ret)
+            return ret;
+
+        for (i = 0; i < MPP_BUFFER_MT_BUF_COUNT; i++) {
+            ret = mpp_buffer_get(shared_group, &shared_buf[i], MPP_BUFFER_MT_BUF_SIZE);
+            if (ret)
+                goto DONE;
+        }
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        ctx[i].idx = i;
+        ctx[i].loop = MPP_BUFFER_MT_LOOP;
+        ctx[i].shared = shared_buf;
+
+        if (!shared) {
+            ret = mpp_buffer_group_get_internal(&ctx[i].group, MPP_BUFFER_TYPE_NORMAL);
+            if (ret)
+                goto DONE;
+        }
+    }
+
+    time_start = mpp_time();
+
+    for (i = 0; i < thread_count; i++)
+        pthread_create(&ctx[i].thd, NULL,
+                       shared ? buffer_shared_worker : buffer_private_worker,
+                       &ctx[i]);
+
+    for (i = 0; i < thread_count; i++) {
+        pthread_join(ctx[i].thd, NULL);
+        ops += ctx[i].ops;
+        if (ctx[i].ret)
+            ret = ctx[i].ret;
+    }
+
+    time_end = mpp_time();
+
+    mpp_log("%s group %2d threads %8lld ops in %6lld us - %6.2f Mops/s\n",
+            shared ? "shared " : "private", thread_count, ops,
+            time_end - time_start,
+            (float)ops / (time_end - time_start));
+
+DONE:
+    for (i = 0; i < thread_count; i++) {
+        if (ctx[i].group)
+            mpp_buffer_group_put(ctx[i].group);
+    }
+
+    for (i = 0; i < MPP_BUFFER_MT_BUF_COUNT; i++) {
+        if (shared_buf[i])
+            mpp_buffer_put(shared_buf[i]);
+    }
+
+    if (shared_group)
+        mpp_buffer_group_put(shared_group);
+
+    return ret;
+}
+
+int main()
+{
+    MPP_RET ret = MPP_OK;
+    RK_S32 count;
+
+    mpp_log("mpp_buffer_mt_test start\n");
+
+    for (count = 1; count <= MPP_BUFFER_MT_MAX_THREAD; count <<= 1) {
+        ret = buffer_mt_run(count, 0);
+        if (ret)
+            goto MPP_BUFFER_failed;
+    }
+
+    for (count = 1; count <= MPP_BUFFER_MT_MAX_THREAD; count <<= 1) {
+        ret = buffer_mt_run(count, 1);
+        if (ret)
+            goto MPP_BUFFER_failed;
+    }
+
+    mpp_log("mpp_buffer_mt_test success\n");
+    return ret;
+
+MPP_BUFFER_failed:
+    mpp_log("mpp_buffer_mt_test failed\n");
+    return ret;
+}
@@ -26,6 +26,7 @@
 #include "mpp_common.h"
 #include "mpp_buffer.h"
 #include "mpp_allocator.h"
+#include "mpp_buffer_impl.h"
 
 #define MPP_BUFFER_TEST_DEBUG_FLAG      (0xf)
 #define MPP_BUFFER_TEST_SIZE            (SZ_1K*4)
@@ -239,6 +240,91 @@ int main()
         group = NULL;
     }
 
+    mpp_log("mpp_buffer_test size class mode start\n");
+
+    ret = mpp_buffer_group_get_internal(&group, MPP_BUFFER_TYPE_ION);
+    if (MPP_OK != ret) {
+        mpp_err("mpp_buffer_test mpp_buffer_group_get failed\n");
+        goto MPP_BUFFER_failed;
+    }
+
+    /* best-fit keeps the other buffers only with idle limit */
+    mpp_buffer_group_idle_limit_config(group, SZ_1M);
+
+    /* release large buffer first so first-fit on release order gets it */
+    for (i = 0; i < 3; i++) {
+        ret = mpp_buffer_get(group, &normal_buffer[i], SZ_64K >> (i * 2));
+        if (MPP_OK != ret) {
+            mpp_err("mpp_buffer_test mpp_buffer_get size class failed\n");
+            goto MPP_BUFFER_failed;
+        }
+    }
+
+    for (i = 0; i < 3; i++) {
+        mpp_buffer_put(normal_buffer[i]);
+        normal_buffer[i] = NULL;
+    }
+
+    /* 10K request should get 16K buffer and keep the others */
+    ret = mpp_buffer_get(group, &normal_buffer[0], SZ_1K * 10);
+    if (MPP_OK != ret || mpp_buffer_get_size(normal_buffer[0]) != SZ_16K ||
+        mpp_buffer_group_usage(group) != SZ_64K + SZ_16K + SZ_4K) {
+        mpp_err("mpp_buffer_test best-fit failed size %d usage %d\n",
+                mpp_buffer_get_size(normal_buffer[0]),
+                mpp_buffer_group_usage(group));
+        ret = MPP_NOK;
+        goto MPP_BUFFER_failed;
+    }
+
+    /* 1K request should not take the 4K buffer which is 4 times larger */
+    ret = mpp_buffer_get(group, &normal_buffer[1], SZ_1K);
+    if (MPP_OK != ret || mpp_buffer_get_size(normal_buffer[1]) != SZ_1K) {
+        mpp_err("mpp_buffer_test small request failed\n");
+        ret = MPP_NOK;
+        goto MPP_BUFFER_failed;
+    }
+
+    /* idle watermark evicts the least recently released 64K buffer */
+    mpp_buffer_group_idle_limit_config(group, SZ_32K);
+    if (mpp_buffer_group_usage(group) != SZ_16K + SZ_4K + SZ_1K) {
+        mpp_err("mpp_buffer_test idle limit failed usage %d\n",
+                mpp_buffer_group_usage(group));
+        ret = MPP_NOK;
+        goto MPP_BUFFER_failed;
+    }
+
+    mpp_buffer_put(normal_buffer[0]);
+    mpp_buffer_put(normal_buffer[1]);
+    normal_buffer[0] = NULL;
+    normal_buffer[1] = NULL;
+
+    /* prewarm evicts all smaller unused buffer and creates new buffers */
+    ret = mpp_buffer_group_prewarm((MppBufferGroupImpl *)group, SZ_8K, 3);
+    if (MPP_OK != ret || mpp_buffer_group_usage(group) != SZ_16K + SZ_8K * 2) {
+        mpp_err("mpp_buffer_test prewarm failed usage %d\n",
+                mpp_buffer_group_usage(group));
+        ret = MPP_NOK;
+        goto MPP_BUFFER_failed;
+    }
+
+    /* without idle limit unused buffer smaller than request is released */
+    mpp_buffer_group_idle_limit_config(group, 0);
+    ret = mpp_buffer_get(group, &normal_buffer[0], SZ_16K);
+    if (MPP_OK != ret || mpp_buffer_group_usage(group) != SZ_16K) {
+        mpp_err("mpp_buffer_test no idle limit failed usage %d\n",
+                mpp_buffer_group_usage(group));
+        ret = MPP_NOK;
+        goto MPP_BUFFER_failed;
+    }
+
+    mpp_buffer_put(normal_buffer[0]);
+    normal_buffer[0] = NULL;
+
+    mpp_buffer_group_put(group);
+    group = NULL;
+
+    mpp_log("mpp_buffer_test size class mode success\n");
+
     mpp_log("mpp_buffer_test success\n");
 
     ret = mpp_buffer_get(NULL, &legacy_buffer, MPP_BUFFER_TEST_SIZE);
@@ -19,15 +19,22 @@
 #include <stdlib.h>
 
 #include "mpp_log.h"
-#include "mpp_packet.h"
+#include "mpp_packet_impl.h"
 
 #define MPP_PACKET_TEST_SIZE    1024
 
+static void packet_release(void *ctx, void *data)
+{
+    *((void **)ctx) = data;
+}
+
 int main()
 {
     MPP_RET ret = MPP_ERR_UNKNOW;
     MppPacket packet = NULL;
+    MppPacket ref = NULL;
     void *data = NULL;
+    void *released = NULL;
     size_t size = MPP_PACKET_TEST_SIZE;
 
     mpp_log("mpp_packet_test start\n");
@@ -48,6 +55,22 @@ int main()
         mpp_err("mpp_packet_test mpp_packet_set_eos failed\n");
         goto MPP_PACKET_failed;
     }
+
+    /* reference packet shares data and calls release callback on deinit */
+    mpp_packet_set_release_cb(packet, packet_release, &released);
+    ret = mpp_packet_ref_init(&ref, packet);
+    if (MPP_OK != ret || mpp_packet_get_data(ref) != data) {
+        mpp_err("mpp_packet_test mpp_packet_ref_init failed\n");
+        ret = MPP_NOK;
+        goto MPP_PACKET_failed;
+    }
+    mpp_packet_deinit(&ref);
+    if (released != data) {
+        mpp_err("mpp_packet_test release callback failed\n");
+        ret = MPP_NOK;
+        goto MPP_PACKET_failed;
+    }
+
     mpp_packet_deinit(&packet);
 
     free(data);
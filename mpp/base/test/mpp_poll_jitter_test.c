@@ -0,0 +1,153 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_poll_jitter_test"
+
+#include "rk_mpi.h"
+
+#include "mpp_env.h"
+#include "mpp_log.h"
+#include "mpp_hist.h"
+#include "mpp_time.h"
+#include "mpp_platform.h"
+#include "mpp_task_impl.h"
+
+/*
+ * timed wait wake up jitter benchmark
+ *
+ * Measure the overshoot of wake up time over the timeout on empty port poll
+ * and empty decoder get_frame. The get_frame case runs the decoder on mock
+ * device so it does not need the hardware.
+ */
+#define POLL_JITTER_LOOP        200
+
+static void show_jitter(const char *name, RK_S64 timeout_us, MppHist hist)
+{
+    mpp_log("%-9s timeout %5lld us overshoot us: p50 %5lld p90 %5lld p99 %5lld max %5lld\n",
+            name, timeout_us, mpp_hist_get_percentile(hist, 500),
+            mpp_hist_get_percentile(hist, 900),
+            mpp_hist_get_percentile(hist, 990),
+            mpp_hist_get_max(hist));
+}
+
+static MPP_RET poll_jitter_port(MppPollType timeout)
+{
+    MppTaskQueue queue = NULL;
+    MppPort port = NULL;
+    MppHist hist = NULL;
+    RK_S64 timeout_us = mpp_poll_timeout_us(timeout);
+    MPP_RET ret = MPP_NOK;
+    RK_S32 i;
+
+    mpp_task_queue_init(&queue, NULL, "jitter");
+    mpp_task_queue_setup(queue, 4);
+    /* all tasks are in input port so output port poll is always timeout */
+    port = mpp_task_queue_get_port(queue, MPP_PORT_OUTPUT);
+    hist = mpp_hist_get("poll");
+
+    for (i = 0; i < POLL_JITTER_LOOP; i++) {
+        RK_S64 start = mpp_time();
+
+        if (MPP_OK == mpp_port_poll(port, timeout)) {
+            mpp_err("poll on empty port return ok\n");
+            goto DONE;
+        }
+        mpp_hist_record(hist, mpp_time() - start - timeout_us);
+    }
+
+    show_jitter("poll", timeout_us, hist);
+    ret = MPP_OK;
+DONE:
+    mpp_hist_put(hist);
+    mpp_task_queue_deinit(queue);
+    return ret;
+}
+
+static MPP_RET poll_jitter_get_frame(MppPollType timeout)
+{
+    MppCtx ctx = NULL;
+    MppApi *mpi = NULL;
+    MppHist hist = NULL;
+    MppFrame frame = NULL;
+    RK_S64 timeout_us = mpp_poll_timeout_us(timeout);
+    MPP_RET ret = MPP_NOK;
+    RK_S32 i;
+
+    if (mpp_create(&ctx, &mpi))
+        return MPP_NOK;
+
+    /* failed init may leave the context half setup so do not destroy it */
+    if (mpp_init(ctx, MPP_CTX_DEC, MPP_VIDEO_CodingAVC)) {
+        mpp_err("mpp_init decoder failed\n");
+        return MPP_NOK;
+    }
+
+    ret = mpi->control(ctx, MPP_SET_OUTPUT_TIMEOUT, &timeout);
+    if (ret)
+        goto DONE;
+
+    hist = mpp_hist_get("get_frame");
+
+    for (i = 0; i < POLL_JITTER_LOOP; i++) {
+        RK_S64 start = mpp_time();
+
+        if (MPP_ERR_TIMEOUT != mpi->decode_get_frame(ctx, &frame)) {
+            mpp_err("get_frame on empty decoder does not timeout\n");
+            ret = MPP_NOK;
+            goto DONE;
+        }
+        mpp_hist_record(hist, mpp_time() - start - timeout_us);
+    }
+
+    show_jitter("get_frame", timeout_us, hist);
+DONE:
+    if (hist)
+        mpp_hist_put(hist);
+    mpp_destroy(ctx);
+    return ret;
+}
+
+int main()
+{
+    static MppPollType timeouts[] = {
+        (MppPollType)1,
+        MPP_POLL_US(100),
+    };
+    MPP_RET ret = MPP_OK;
+    RK_U32 i;
+
+    mpp_log("mpp_poll_jitter_test start\n");
+
+    /* decoder on mock device before the first platform query */
+    mpp_env_set_u32("mpp_device_mock", 1);
+    mpp_env_set_u32("mpp_vcodec_type", HAVE_VDPU1);
+
+    for (i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); i++) {
+        ret = poll_jitter_port(timeouts[i]);
+        if (ret)
+            goto DONE;
+    }
+
+    for (i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); i++) {
+        ret = poll_jitter_get_frame(timeouts[i]);
+        if (ret)
+            goto DONE;
+    }
+
+DONE:
+    mpp_log("mpp_poll_jitter_test %s\n", ret ? "failed" : "success");
+    return ret;
+}
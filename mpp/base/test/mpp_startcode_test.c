@@ -0,0 +1,150 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_startcode_test"
+
+#include <stdlib.h>
+
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_time.h"
+#include "mpp_common.h"
+#include "mpp_startcode.h"
+
+#define STARTCODE_BUF_SIZE      (SZ_1M)
+#define STARTCODE_NALU_SIZE     (SZ_64K)
+#define STARTCODE_LOOP          20
+
+static RK_S32 find_start_code_byte(const RK_U8 *buf, RK_S32 len)
+{
+    RK_U32 state = 0xffffffff;
+    RK_S32 i;
+
+    for (i = 0; i < len; i++) {
+        state = (state << 8) | buf[i];
+        if ((state & 0x00ffffff) == 0x000001)
+            return i - 2;
+    }
+
+    return -1;
+}
+
+/* random payload with some zero bytes and 0x000001 every nalu size */
+static void gen_stream(RK_U8 *buf, RK_S32 size)
+{
+    RK_S32 i;
+
+    srand(0x5678);
+
+    for (i = 0; i < size; i++) {
+        RK_S32 sel = rand() % 32;
+
+        buf[i] = (sel < 1) ? 0 : (sel < 2) ? 1 : rand() & 0xff;
+    }
+
+    for (i = 0; i + 3 < size; i++) {
+        if (!buf[i] && !buf[i + 1] && buf[i + 2] <= 3)
+            buf[i + 2] = 3;
+    }
+
+    for (i = STARTCODE_NALU_SIZE; i + 3 < size; i += STARTCODE_NALU_SIZE + rand() % 64) {
+        buf[i] = 0;
+        buf[i + 1] = 0;
+        buf[i + 2] = 1;
+    }
+}
+
+int main()
+{
+    MPP_RET ret = MPP_NOK;
+    RK_U8 *buf = mpp_malloc(RK_U8, STARTCODE_BUF_SIZE);
+    RK_S64 time_start;
+    RK_S64 time_new = 0;
+    RK_S64 time_byte = 0;
+    RK_S32 count = 0;
+    RK_S32 loop;
+
+    mpp_log("mpp_startcode_test start\n");
+
+    if (NULL == buf) {
+        mpp_err("malloc failed\n");
+        goto DONE;
+    }
+
+    gen_stream(buf, STARTCODE_BUF_SIZE);
+
+    /* check all start offset and length near the buffer end */
+    for (loop = 0; loop < 64; loop++) {
+        RK_S32 base = STARTCODE_NALU_SIZE - 32 + loop;
+        RK_S32 len;
+
+        for (len = 0; len < 64; len++) {
+            RK_S32 ref = find_start_code_byte(buf + base, len);
+            RK_S32 pos = mpp_find_start_code(buf + base, len);
+
+            if (ref != pos) {
+                mpp_err("base %d len %d mismatch found %d expect %d\n",
+                        base, len, pos, ref);
+                goto DONE;
+            }
+        }
+    }
+
+    for (loop = 0; loop < STARTCODE_LOOP; loop++) {
+        RK_S32 offset = 0;
+
+        count = 0;
+        time_start = mpp_time();
+        while (offset < STARTCODE_BUF_SIZE) {
+            RK_S32 pos = mpp_find_start_code(buf + offset, STARTCODE_BUF_SIZE - offset);
+
+            if (pos < 0)
+                break;
+            offset += pos + 3;
+            count++;
+        }
+        time_new += mpp_time() - time_start;
+
+        offset = 0;
+        time_start = mpp_time();
+        while (offset < STARTCODE_BUF_SIZE) {
+            RK_S32 pos = find_start_code_byte(buf + offset, STARTCODE_BUF_SIZE - offset);
+
+            if (pos < 0)
+                break;
+            offset += pos + 3;
+            count--;
+        }
+        time_byte += mpp_time() - time_start;
+
+        if (count) {
+            mpp_err("start code count mismatch %d\n", count);
+            goto DONE;
+        }
+    }
+
+    mpp_log("scan %d bytes x %d loop\n", STARTCODE_BUF_SIZE, STARTCODE_LOOP);
+    mpp_log("byte scanner     %8lld us\n", time_byte);
+    mpp_log("mpp_start_code   %8lld us - speedup %.2f\n", time_new,
+            (float)time_byte / MPP_MAX(time_new, 1));
+    ret = MPP_OK;
+
+DONE:
+    MPP_FREE(buf);
+
+    mpp_log("mpp_startcode_test %s\n", ret ? "failed" : "success");
+    return ret;
+}
@@ -1,11 +1,15 @@
+#include <poll.h>
+
 #include "mpp_log.h"
 #include "mpp_time.h"
 #include "mpp_thread.h"
+#include "mpp_eventfd.h"
 
 #include "mpp_task.h"
 #include "mpp_task_impl.h"
 
 #define MAX_TASK_LOOP   10000
+#define BATCH_TASK_CNT  16
 
 static MppTaskQueue input  = NULL;
 static MppTaskQueue output = NULL;
@@ -191,6 +195,171 @@ void serial_task(void)
     }
 }
 
+static RK_S32 eventfd_ready(RK_S32 fd)
+{
+    struct pollfd nfds;
+
+    nfds.fd = fd;
+    nfds.events = POLLIN;
+
+    return (poll(&nfds, 1, 0) == 1) && (nfds.revents & POLLIN);
+}
+
+MPP_RET eventfd_task(void)
+{
+    MppTask task = NULL;
+    MPP_RET ret = MPP_NOK;
+    MppPort port_oi = mpp_task_queue_get_port(output, MPP_PORT_INPUT);
+    MppPort port_oo = mpp_task_queue_get_port(output, MPP_PORT_OUTPUT);
+    RK_S32 fd = mpp_eventfd_get(0);
+
+    mpp_port_set_eventfd(port_oo, fd);
+    if (eventfd_ready(fd))
+        goto DONE;
+
+    mpp_port_dequeue(port_oi, &task);
+    mpp_port_enqueue(port_oi, task);
+    if (!eventfd_ready(fd))
+        goto DONE;
+
+    mpp_port_dequeue(port_oo, &task);
+    if (eventfd_ready(fd))
+        goto DONE;
+
+    mpp_port_enqueue(port_oo, task);
+    ret = MPP_OK;
+DONE:
+    mpp_port_set_eventfd(port_oo, -1);
+    mpp_eventfd_put(fd);
+    return ret;
+}
+
+/*
+ * batch test: user thread and worker thread move tasks through one queue
+ * with depth BATCH_TASK_CNT and at most batch tasks on each transaction
+ */
+typedef struct BatchTaskCtx_t {
+    MppPort     port;
+    RK_S32      batch;
+} BatchTaskCtx;
+
+static void *batch_task_worker(void *arg)
+{
+    BatchTaskCtx *ctx = (BatchTaskCtx *)arg;
+    MppTask tasks[BATCH_TASK_CNT];
+    RK_S32 done = 0;
+    RK_S32 count = 0;
+
+    while (done < MAX_TASK_LOOP * 4) {
+        mpp_port_poll(ctx->port, MPP_POLL_BLOCK);
+        if (mpp_port_dequeue_n(ctx->port, tasks, ctx->batch, &count))
+            continue;
+
+        mpp_port_enqueue_n(ctx->port, tasks, count);
+        done += count;
+    }
+
+    return NULL;
+}
+
+MPP_RET batch_task(RK_S32 batch)
+{
+    MppTaskQueue queue = NULL;
+    BatchTaskCtx user;
+    BatchTaskCtx worker;
+    pthread_t thd_user;
+    pthread_t thd_worker;
+    RK_S64 time_start, time_end;
+    void *dummy;
+
+    mpp_task_queue_init(&queue, NULL, "test_batch");
+    mpp_task_queue_setup(queue, BATCH_TASK_CNT);
+
+    user.port = mpp_task_queue_get_port(queue, MPP_PORT_INPUT);
+    user.batch = batch;
+    worker.port = mpp_task_queue_get_port(queue, MPP_PORT_OUTPUT);
+    worker.batch = batch;
+
+    time_start = mpp_time();
+    pthread_create(&thd_user, NULL, batch_task_worker, &user);
+    pthread_create(&thd_worker, NULL, batch_task_worker, &worker);
+    pthread_join(thd_user, &dummy);
+    pthread_join(thd_worker, &dummy);
+    time_end = mpp_time();
+
+    mpp_log("batch %2d move %d tasks cost %lld us\n", batch,
+            MAX_TASK_LOOP * 4, time_end - time_start);
+
+    mpp_task_queue_deinit(queue);
+    return MPP_OK;
+}
+
+/* enqueue_n with one task listed twice is rejected and moves no task */
+MPP_RET batch_task_dup(void)
+{
+    MppTaskQueue queue = NULL;
+    MppPort port;
+    MppPort port_out;
+    MppTask tasks[4];
+    RK_S32 count = 0;
+    MPP_RET ret = MPP_NOK;
+
+    mpp_task_queue_init(&queue, NULL, "test_dup");
+    mpp_task_queue_setup(queue, 4);
+    port = mpp_task_queue_get_port(queue, MPP_PORT_INPUT);
+    port_out = mpp_task_queue_get_port(queue, MPP_PORT_OUTPUT);
+
+    if (mpp_port_dequeue_n(port, tasks, 2, &count) || count != 2)
+        goto DONE;
+
+    tasks[2] = tasks[0];
+    if (MPP_OK == mpp_port_enqueue_n(port, tasks, 3)) {
+        mpp_err("duplicated task is enqueued\n");
+        goto DONE;
+    }
+
+    /* the two tasks are still dequeued and are moved once on enqueue */
+    if (mpp_port_enqueue_n(port, tasks, 2) ||
+        mpp_port_dequeue_n(port_out, tasks, 4, &count) || count != 2 ||
+        mpp_port_enqueue_n(port_out, tasks, count))
+        goto DONE;
+
+    ret = MPP_OK;
+DONE:
+    mpp_log("batch duplicated task check %s\n", ret ? "failed" : "done");
+    mpp_task_queue_deinit(queue);
+    return ret;
+}
+
+/* canceled tasks are back on the port and dequeued again first in order */
+MPP_RET batch_task_cancel(void)
+{
+    MppTaskQueue queue = NULL;
+    MppPort port;
+    MppTask tasks[2];
+    MppTask again[4];
+    RK_S32 count = 0;
+    MPP_RET ret = MPP_NOK;
+
+    mpp_task_queue_init(&queue, NULL, "test_cancel");
+    mpp_task_queue_setup(queue, 4);
+    port = mpp_task_queue_get_port(queue, MPP_PORT_INPUT);
+
+    if (mpp_port_dequeue_n(port, tasks, 2, &count) || count != 2 ||
+        mpp_port_cancel_n(port, tasks, 2))
+        goto DONE;
+
+    if (mpp_port_dequeue_n(port, again, 4, &count) || count != 4 ||
+        again[0] != tasks[0] || again[1] != tasks[1])
+        goto DONE;
+
+    ret = mpp_port_cancel_n(port, again, count);
+DONE:
+    mpp_log("batch cancel task check %s\n", ret ? "failed" : "done");
+    mpp_task_queue_deinit(queue);
+    return ret;
+}
+
 int main()
 {
     RK_S64 time_start, time_end;
@@ -242,6 +411,15 @@ int main()
 
     mpp_debug = 0;
 
+    if (eventfd_task())
+        mpp_err("mpp task eventfd test failed\n");
+
+    batch_task(1);
+    batch_task(4);
+    batch_task(BATCH_TASK_CNT);
+    batch_task_dup();
+    batch_task_cancel();
+
     mpp_task_queue_deinit(input);
     mpp_task_queue_deinit(output);
 
@@ -22,6 +22,7 @@
 
 #include "mpp_mem.h"
 #include "mpp_packet_impl.h"
+#include "mpp_startcode.h"
 #include "hal_task.h"
 
 #include "h264d_global.h"
@@ -552,23 +553,56 @@ MPP_RET parse_prepare(H264dInputCtx_t *p_Inp, H264dCurCtx_t *p_Cur)
         goto __RETURN;
     }
     while (pkt_impl->length > 0) {
-        p_strm->curdata = &p_Inp->in_buf[p_strm->nalu_offset++];
-        pkt_impl->length--;
-        p_strm->prefixdata = (p_strm->prefixdata << 8) | (*p_strm->curdata);
-        if (p_strm->startcode_found) {
-            if (p_strm->nalu_len >= p_strm->nalu_max_size) {
-                FUN_CHECK(ret = realloc_buffer(&p_strm->nalu_buf, &p_strm->nalu_max_size, NALU_BUF_ADD_SIZE));
+        /*
+         * When the last byte is not zero no start code can end in the next
+         * two bytes. Then if the nalu header has been judged or no start code
+         * has been found yet jump to the next start code and copy the bytes
+         * in one go.
+         */
+        if ((p_strm->prefixdata & 0xff) &&
+            (!p_strm->startcode_found || p_strm->nalu_len >= NALU_TYPE_EXT_LENGTH)) {
+            RK_U8 *buf = &p_Inp->in_buf[p_strm->nalu_offset];
+            RK_S32 len = mpp_find_start_code(buf, (RK_S32)pkt_impl->length);
+            RK_S32 i;
+
+            len = (len < 0) ? (RK_S32)pkt_impl->length : len + START_PREFIX_3BYTE;
+
+            if (p_strm->startcode_found) {
+                if (p_strm->nalu_len + len > p_strm->nalu_max_size) {
+                    RK_U32 add_size = p_strm->nalu_len + len - p_strm->nalu_max_size;
+
+                    FUN_CHECK(ret = realloc_buffer(&p_strm->nalu_buf, &p_strm->nalu_max_size,
+                                                   MPP_MAX(NALU_BUF_ADD_SIZE, add_size)));
+                }
+                memcpy(&p_strm->nalu_buf[p_strm->nalu_len], buf, len);
+                p_strm->nalu_len += len;
             }
-            p_strm->nalu_buf[p_strm->nalu_len++] = *p_strm->curdata;
-            if ((p_strm->nalu_len == NALU_TYPE_NORMAL_LENGTH)
-                || (p_strm->nalu_len == NALU_TYPE_EXT_LENGTH)) {
-                FUN_CHECK(ret = judge_is_new_frame(p_Cur, p_strm));
-                if (p_Cur->p_Dec->is_new_frame) {
-                    FUN_CHECK(ret = add_empty_nalu(&p_Cur->strm));
-                    p_Cur->strm.head_offset = 0;
-                    p_Cur->p_Inp->task_valid = 1;
-                    p_Cur->p_Dec->is_new_frame = 0;
-                    break;
+
+            for (i = MPP_MAX(0, len - 4); i < len; i++)
+                p_strm->prefixdata = (p_strm->prefixdata << 8) | buf[i];
+
+            p_strm->curdata = &buf[len - 1];
+            p_strm->nalu_offset += len;
+            pkt_impl->length -= len;
+        } else {
+            p_strm->curdata = &p_Inp->in_buf[p_strm->nalu_offset++];
+            pkt_impl->length--;
+            p_strm->prefixdata = (p_strm->prefixdata << 8) | (*p_strm->curdata);
+            if (p_strm->startcode_found) {
+                if (p_strm->nalu_len >= p_strm->nalu_max_size) {
+                    FUN_CHECK(ret = realloc_buffer(&p_strm->nalu_buf, &p_strm->nalu_max_size, NALU_BUF_ADD_SIZE));
+                }
+                p_strm->nalu_buf[p_strm->nalu_len++] = *p_strm->curdata;
+                if ((p_strm->nalu_len == NALU_TYPE_NORMAL_LENGTH)
+                    || (p_strm->nalu_len == NALU_TYPE_EXT_LENGTH)) {
+                    FUN_CHECK(ret = judge_is_new_frame(p_Cur, p_strm));
+                    if (p_Cur->p_Dec->is_new_frame) {
+                        FUN_CHECK(ret = add_empty_nalu(&p_Cur->strm));
+                        p_Cur->strm.head_offset = 0;
+                        p_Cur->p_Inp->task_valid = 1;
+                        p_Cur->p_Dec->is_new_frame = 0;
+                        break;
+                    }
                 }
             }
         }
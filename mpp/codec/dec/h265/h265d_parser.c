@@ -31,6 +31,7 @@
 #include "mpp_mem.h"
 #include "mpp_bitread.h"
 #include "mpp_packet_impl.h"
+#include "mpp_startcode.h"
 
 #include "h265d_parser.h"
 #include "h265d_syntax.h"
@@ -56,6 +57,26 @@ static RK_S32 hevc_find_frame_end(SplitContext_t *sc, const RK_U8 *buf,
     for (i = 0; i < buf_size; i++) {
         int nut, layer_id;
 
+        /*
+         * Once the state is all from this buffer jump to the byte which is
+         * 5 bytes after next start code and rebuild the state from buffer.
+         */
+        if (i >= 5) {
+            RK_S32 pos = mpp_find_start_code(buf + i - 5, buf_size - i + 5);
+            RK_S32 next = (pos < 0) ? buf_size : MPP_MIN(i + pos, buf_size);
+
+            if (next > i) {
+                RK_S32 j;
+
+                for (j = MPP_MAX(i, next - 8); j < next; j++)
+                    sc->state64 = (sc->state64 << 8) | buf[j];
+
+                i = next;
+                if (i >= buf_size)
+                    break;
+            }
+        }
+
         sc->state64 = (sc->state64 << 8) | buf[i];
 
         if (((sc->state64 >> 3 * 8) & 0xFFFFFF) != START_CODE)
@@ -1450,6 +1471,19 @@ RK_S32 mpp_hevc_extract_rbsp(HEVCContext *s, const RK_U8 *src, int length,
     }
 #endif
 
+    /*
+     * Parser only reads the slice header through the emulation prevention
+     * aware bit reader and slice data is copied to hardware stream buffer in
+     * h265d_syntax_fill_slice. So VCL NAL is referenced in place instead of
+     * copying the whole payload. Parameter set and SEI are still copied for
+     * they are short and may be kept across packets.
+     */
+    if (!s->rbsp_copy && ((src[0] >> 1) & 0x3f) < NAL_VPS) {
+        nal->data = src;
+        nal->size = length;
+        return length;
+    }
+
     if (length + MPP_INPUT_BUFFER_PADDING_SIZE > nal->rbsp_buffer_size) {
         RK_S32 min_size = length + MPP_INPUT_BUFFER_PADDING_SIZE;
         mpp_free(nal->rbsp_buffer);
@@ -1964,6 +1998,7 @@ MPP_RET h265d_init(void *ctx, ParserCfg *parser_cfg)
 
     //  mpp_env_set_u32("h265d_debug", H265D_DBG_REF);
     mpp_env_get_u32("h265d_debug", &h265d_debug, 0);
+    mpp_env_get_u32("h265d_rbsp_copy", &s->rbsp_copy, 0);
 
     ret = hevc_init_context(h265dctx);
 
@@ -527,6 +527,8 @@ typedef struct HEVCContext {
     HEVCNAL *nals;
     RK_S32 nb_nals;
     RK_S32 nals_allocated;
+    // copy whole VCL NAL to rbsp buffer instead of referencing it in place
+    RK_U32 rbsp_copy;
     // type of the first VCL NAL of the current frame
     enum NALUnitType first_nal_type;
 
@@ -367,6 +367,11 @@ RK_S32 h265d_syntax_fill_slice(void *ctx, RK_S32 input_index)
         current += start_code_size;
         position += start_code_size;
         memcpy(current, h->nals[i].data, h->nals[i].size);
+        /*
+         * VCL NAL may reference the input packet which is released after
+         * prepare so slice header is parsed from the stream buffer copy.
+         */
+        h->nals[i].data = current;
         // mpp_log("h->nals[%d].size = %d", i, h->nals[i].size);
         fill_slice_short(&ctx_pic->slice_short[count], position, h->nals[i].size);
         init_slice_cut_param(&ctx_pic->slice_cut_param[count]);
@@ -0,0 +1,279 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "h265d_parser_test"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mpp_env.h"
+#include "mpp_mem.h"
+#include "mpp_log.h"
+#include "mpp_time.h"
+#include "mpp_common.h"
+
+#include "h265d_api.h"
+
+/*
+ * Parser only benchmark of h265d prepare stage which splits the stream into
+ * NAL units and builds the hardware stream. Default input is a generated
+ * high bitrate intra stream, 1.5MB IDR frame in 4 slices is about 360Mbps
+ * on 4K 30fps. Real stream in annexb format can be given as the only
+ * argument.
+ *
+ * Both rbsp copy mode and in place mode are run and the hardware stream
+ * should be identical.
+ */
+#define BENCH_FRAME_SIZE        (SZ_1M + SZ_512K)
+#define BENCH_FRAME_COUNT       8
+#define BENCH_SLICE_COUNT       4
+#define BENCH_LOOP              10
+#define BENCH_READ_SIZE         SZ_512K
+
+typedef struct ParserBench_t {
+    RK_U8           *buf;
+    RK_S32          size;
+    RK_U32          need_split;
+    // frame start position of generated stream
+    RK_S32          frame_pos[BENCH_FRAME_COUNT + 1];
+
+    // result of one run
+    RK_S32          tasks;
+    RK_U32          crc;
+    RK_S64          time;
+} ParserBench;
+
+static RK_U32 bench_rand(RK_U32 *seed)
+{
+    RK_U32 x = *seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+
+    return x;
+}
+
+/* IDR_W_RADL slices with random payload and emulation prevention bytes */
+static RK_S32 bench_gen_stream(ParserBench *bench, RK_U32 seed)
+{
+    RK_U8 *buf = bench->buf;
+    RK_S32 slice_size = BENCH_FRAME_SIZE / BENCH_SLICE_COUNT;
+    RK_S32 pos = 0;
+    RK_S32 i, j, k;
+
+    for (i = 0; i < BENCH_FRAME_COUNT; i++) {
+        bench->frame_pos[i] = pos;
+
+        for (j = 0; j < BENCH_SLICE_COUNT; j++) {
+            RK_S32 zeros = 0;
+
+            buf[pos++] = 0;
+            buf[pos++] = 0;
+            buf[pos++] = 1;
+            buf[pos++] = 19 << 1;
+            buf[pos++] = 1;
+            // first_slice_segment_in_pic_flag and no_output_of_prior_pics_flag
+            buf[pos++] = j ? 0x40 : 0xc0;
+
+            for (k = 0; k < slice_size; k++) {
+                RK_U8 val = bench_rand(&seed) >> 24;
+
+                if (zeros >= 2 && val <= 3) {
+                    buf[pos++] = 3;
+                    zeros = 0;
+                }
+
+                buf[pos++] = val;
+                zeros = val ? 0 : zeros + 1;
+            }
+
+            // avoid trailing zero
+            buf[pos++] = 0x80;
+        }
+    }
+
+    bench->frame_pos[i] = pos;
+
+    return pos;
+}
+
+static RK_U32 bench_crc(RK_U32 crc, RK_U8 *data, RK_S32 size)
+{
+    RK_S32 i;
+
+    for (i = 0; i < size; i++)
+        crc = (crc << 5) + (crc >> 27) + data[i];
+
+    return crc;
+}
+
+static MPP_RET bench_run(ParserBench *bench, RK_U32 rbsp_copy)
+{
+    const ParserApi *api = &api_h265d_parser;
+    void *ctx = mpp_calloc_size(void, api->ctx_size);
+    MppBufSlots slots = NULL;
+    ParserCfg cfg;
+    HalDecTask task;
+    MPP_RET ret = MPP_NOK;
+    RK_S32 loop;
+
+    if (NULL == ctx || mpp_buf_slot_init(&slots)) {
+        MPP_FREE(ctx);
+        return MPP_ERR_MALLOC;
+    }
+
+    // parser read the mode on init
+    mpp_env_set_u32("h265d_rbsp_copy", rbsp_copy);
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.coding = MPP_VIDEO_CodingHEVC;
+    cfg.frame_slots = slots;
+    cfg.need_split = bench->need_split;
+
+    if (api->init(ctx, &cfg))
+        goto DONE;
+
+    bench->tasks = 0;
+    bench->crc = 0;
+    bench->time = 0;
+
+    for (loop = 0; loop < BENCH_LOOP; loop++) {
+        RK_S32 frame = 0;
+        RK_S32 pos = 0;
+
+        while (pos < bench->size) {
+            // split mode reads the file by block and the last one is eos
+            RK_S32 size = bench->need_split ?
+                          MPP_MIN(BENCH_READ_SIZE, bench->size - pos) :
+                          (bench->frame_pos[frame + 1] - pos);
+            MppPacket pkt = NULL;
+            RK_S64 start;
+
+            mpp_packet_init(&pkt, bench->buf + pos, size);
+            if (bench->need_split && pos + size >= bench->size)
+                mpp_packet_set_eos(pkt);
+
+            do {
+                memset(&task, 0, sizeof(task));
+                task.input = -1;
+
+                start = mpp_time();
+                api->prepare(ctx, pkt, &task);
+                bench->time += mpp_time() - start;
+
+                if (task.valid) {
+                    MppPacket stream = task.input_packet;
+
+                    bench->tasks++;
+                    bench->crc = bench_crc(bench->crc,
+                                           (RK_U8 *)mpp_packet_get_data(stream),
+                                           (RK_S32)mpp_packet_get_length(stream));
+                }
+            } while (mpp_packet_get_length(pkt));
+
+            mpp_packet_deinit(&pkt);
+            pos += size;
+            frame++;
+        }
+
+        api->reset(ctx);
+    }
+
+    ret = MPP_OK;
+DONE:
+    api->deinit(ctx);
+    mpp_buf_slot_deinit(slots);
+    mpp_free(ctx);
+    return ret;
+}
+
+static void bench_show(ParserBench *bench, const char *name)
+{
+    RK_S64 bytes = (RK_S64)bench->size * BENCH_LOOP;
+
+    mpp_log("%-8s tasks %4d time %8lld us %6lld us/task %6lld MB/s crc %08x\n",
+            name, bench->tasks, bench->time,
+            bench->time / MPP_MAX(bench->tasks, 1),
+            bytes / MPP_MAX(bench->time, 1), bench->crc);
+}
+
+int main(int argc, char **argv)
+{
+    ParserBench bench;
+    RK_U32 copy_crc;
+    RK_S32 copy_tasks;
+    MPP_RET ret = MPP_NOK;
+
+    mpp_log("h265d parser test start\n");
+
+    memset(&bench, 0, sizeof(bench));
+
+    if (argc > 1) {
+        FILE *fp = fopen(argv[1], "rb");
+
+        if (NULL == fp) {
+            mpp_err("failed to open %s\n", argv[1]);
+            return MPP_NOK;
+        }
+
+        fseek(fp, 0, SEEK_END);
+        bench.size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+
+        bench.buf = mpp_malloc(RK_U8, bench.size);
+        if (bench.buf)
+            bench.size = fread(bench.buf, 1, bench.size, fp);
+        bench.need_split = 1;
+        fclose(fp);
+    } else {
+        // worst case of emulation prevention is one byte on every two bytes
+        bench.buf = mpp_malloc(RK_U8, BENCH_FRAME_SIZE * 3 / 2 * BENCH_FRAME_COUNT);
+        if (bench.buf)
+            bench.size = bench_gen_stream(&bench, 0x12345678);
+    }
+
+    if (NULL == bench.buf) {
+        mpp_err("failed to prepare stream\n");
+        goto DONE;
+    }
+
+    mpp_log("stream size %d loop %d\n", bench.size, BENCH_LOOP);
+
+    if (bench_run(&bench, 1))
+        goto DONE;
+    bench_show(&bench, "copy");
+
+    copy_crc = bench.crc;
+    copy_tasks = bench.tasks;
+
+    if (bench_run(&bench, 0))
+        goto DONE;
+    bench_show(&bench, "in place");
+
+    if (bench.crc != copy_crc || bench.tasks != copy_tasks || !bench.tasks) {
+        mpp_err("stream mismatch tasks %d vs %d crc %08x vs %08x\n",
+                bench.tasks, copy_tasks, bench.crc, copy_crc);
+        goto DONE;
+    }
+
+    ret = MPP_OK;
+DONE:
+    MPP_FREE(bench.buf);
+    mpp_log("h265d parser test %s\n", ret ? "failed" : "success");
+    return ret;
+}
@@ -17,6 +17,8 @@
 
 #define MODULE_TAG "jpegd_parser"
 
+#include <string.h>
+
 #include "mpp_env.h"
 #include "mpp_mem.h"
 #include "mpp_bitread.h"
@@ -33,27 +35,38 @@ RK_U32 jpegd_debug = 0x0;
 static RK_S32 jpegd_find_marker(const RK_U8 **pbuf_ptr, const RK_U8 *buf_end)
 {
     const RK_U8 *buf_ptr;
-    unsigned int v, v2;
-    int val;
+    const RK_U8 *buf_start;
+    int val = -1;
     int skipped = 0;
 
-    buf_ptr = *pbuf_ptr;
+    buf_ptr = buf_start = *pbuf_ptr;
+    /* jump between 0xff bytes by memchr instead of checking byte by byte */
     while (buf_end - buf_ptr > 1) {
-        v  = *buf_ptr++;
-        v2 = *buf_ptr;
-        if ((v == 0xff) && (v2 >= 0xc0) && (v2 <= 0xfe) && buf_ptr < buf_end) {
-            val = *buf_ptr++;
+        buf_ptr = memchr(buf_ptr, 0xff, buf_end - buf_ptr - 1);
+        if (NULL == buf_ptr)
+            break;
+
+        if ((buf_ptr[1] >= 0xc0) && (buf_ptr[1] <= 0xfe)) {
+            val = buf_ptr[1];
+            buf_ptr += 2;
+            skipped = buf_ptr - buf_start - 2;
             goto found;
-        } else if ((v == 0x89) && (v2 == 0x50)) {
-            // many usb camera go here, log if set jpegd debug
-            jpegd_dbg_marker("input img maybe png format,check it\n");
         }
-        skipped++;
+        buf_ptr++;
     }
     buf_ptr = buf_end;
-    val = -1;
+    skipped = MPP_MAX(buf_end - buf_start - 1, 0);
 
 found:
+    if (jpegd_debug & JPEGD_DBG_STARTCODE) {
+        const RK_U8 *p;
+
+        for (p = buf_start; p < buf_start + skipped; p++) {
+            // many usb camera go here, log if set jpegd debug
+            if ((p[0] == 0x89) && (p[1] == 0x50))
+                jpegd_dbg_marker("input img maybe png format,check it\n");
+        }
+    }
     jpegd_dbg_marker("find_marker skipped %d bytes\n", skipped);
     *pbuf_ptr = buf_ptr;
     return val;
@@ -1184,7 +1197,7 @@ static MPP_RET jpegd_deinit(void *ctx)
     }
 
     if (JpegCtx->output_frame) {
-        mpp_free(JpegCtx->output_frame);
+        mpp_frame_deinit(&JpegCtx->output_frame);
     }
 
     if (JpegCtx->copy_flag) {
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "vp9d_adapt_test"
+
+#include <string.h>
+
+#include "mpp_err.h"
+#include "mpp_log.h"
+#include "mpp_time.h"
+#include "mpp_common.h"
+
+#include "vp9d_adapt.h"
+
+/*
+ * Coefficient probability table size of one frame context, the same as
+ * coef[4][2][2][6][6][3] in VP9Context.
+ */
+#define ADAPT_TEST_PROB_NUM     (4 * 2 * 2 * 6 * 6 * 3)
+#define ADAPT_TEST_ROUND        200
+#define ADAPT_TEST_BENCH_LOOP   20000
+
+typedef enum AdaptTestCount_e {
+    /* counts from small to about 1M per branch like 4K frame */
+    COUNT_NATURAL,
+    /* zero and tiny counts around max count */
+    COUNT_SMALL,
+    /* counts around the vector path limit */
+    COUNT_LIMIT,
+    /* full 32bit range with overflow of ct0 + ct1 */
+    COUNT_FULL,
+    COUNT_BUTT,
+} AdaptTestCount;
+
+static RK_U32 test_rand(RK_U32 *seed)
+{
+    RK_U32 x = *seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+
+    return x;
+}
+
+static RK_U32 test_count(RK_U32 *seed, AdaptTestCount type)
+{
+    RK_U32 val = test_rand(seed);
+
+    switch (type) {
+    case COUNT_NATURAL : {
+        /* about one in eight branches is not hit */
+        if (!(val & 7))
+            return 0;
+
+        return test_rand(seed) & ((1 << ((val >> 3) % 21)) - 1);
+    } break;
+    case COUNT_SMALL : {
+        return val % 32;
+    } break;
+    case COUNT_LIMIT : {
+        return (1 << 22) - 8 + val % 16;
+    } break;
+    default : {
+    } break;
+    }
+
+    return val;
+}
+
+static void test_gen(RK_U8 *prob, RK_U32 *ct0, RK_U32 *ct1, RK_U32 *seed,
+                     AdaptTestCount type)
+{
+    RK_S32 i;
+
+    for (i = 0; i < ADAPT_TEST_PROB_NUM; i++) {
+        prob[i] = test_rand(seed);
+        ct0[i] = test_count(seed, type);
+        ct1[i] = test_count(seed, type);
+    }
+}
+
+static MPP_RET test_check(RK_U32 *seed)
+{
+    static const RK_S32 cfgs[][2] = {
+        { VP9D_ADAPT_COEF_MAX_COUNT, 112 },
+        { VP9D_ADAPT_COEF_MAX_COUNT, 128 },
+        { VP9D_ADAPT_MODE_MAX_COUNT, VP9D_ADAPT_MODE_UPDATE_FACTOR },
+    };
+    RK_U8 prob[ADAPT_TEST_PROB_NUM];
+    RK_U8 ref[ADAPT_TEST_PROB_NUM];
+    RK_U8 dst[ADAPT_TEST_PROB_NUM];
+    RK_U32 ct0[ADAPT_TEST_PROB_NUM];
+    RK_U32 ct1[ADAPT_TEST_PROB_NUM];
+    RK_S32 round;
+    RK_S32 type;
+    RK_U32 i;
+
+    for (round = 0; round < ADAPT_TEST_ROUND; round++) {
+        for (type = 0; type < COUNT_BUTT; type++) {
+            test_gen(prob, ct0, ct1, seed, (AdaptTestCount)type);
+
+            for (i = 0; i < MPP_ARRAY_ELEMS(cfgs); i++) {
+                /* odd length and offset to cover the scalar tail */
+                RK_S32 offset = test_rand(seed) % 4;
+                RK_S32 count = ADAPT_TEST_PROB_NUM - offset - test_rand(seed) % 4;
+                RK_S32 j;
+
+                memcpy(ref, prob, sizeof(prob));
+                memcpy(dst, prob, sizeof(prob));
+
+                vp9d_merge_probs_c(ref + offset, ct0 + offset, ct1 + offset, count,
+                                   cfgs[i][0], cfgs[i][1]);
+                vp9d_merge_probs(dst + offset, ct0 + offset, ct1 + offset, count,
+                                 cfgs[i][0], cfgs[i][1]);
+
+                if (!memcmp(ref, dst, sizeof(ref)))
+                    continue;
+
+                for (j = 0; j < ADAPT_TEST_PROB_NUM; j++) {
+                    if (ref[j] != dst[j])
+                        break;
+                }
+
+                mpp_err("round %d type %d cfg %d mismatch at %d\n", round, type, i, j);
+                mpp_err("prob %d ct0 %u ct1 %u expect %d get %d\n",
+                        prob[j], ct0[j], ct1[j], ref[j], dst[j]);
+                return MPP_NOK;
+            }
+        }
+    }
+
+    mpp_log("bit exact check %d rounds done\n", ADAPT_TEST_ROUND);
+
+    return MPP_OK;
+}
+
+static void test_bench(RK_U32 *seed)
+{
+    RK_U8 prob[ADAPT_TEST_PROB_NUM];
+    RK_U32 ct0[ADAPT_TEST_PROB_NUM];
+    RK_U32 ct1[ADAPT_TEST_PROB_NUM];
+    RK_S64 time_c = 0;
+    RK_S64 time_simd = 0;
+    RK_S64 start;
+    RK_S32 i;
+
+    test_gen(prob, ct0, ct1, seed, COUNT_NATURAL);
+
+    start = mpp_time();
+    for (i = 0; i < ADAPT_TEST_BENCH_LOOP; i++)
+        vp9d_merge_probs_c(prob, ct0, ct1, ADAPT_TEST_PROB_NUM,
+                           VP9D_ADAPT_COEF_MAX_COUNT, 112);
+    time_c = mpp_time() - start;
+
+    start = mpp_time();
+    for (i = 0; i < ADAPT_TEST_BENCH_LOOP; i++)
+        vp9d_merge_probs(prob, ct0, ct1, ADAPT_TEST_PROB_NUM,
+                         VP9D_ADAPT_COEF_MAX_COUNT, 112);
+    time_simd = mpp_time() - start;
+
+    mpp_log("merge %d coef probs x %d loop\n", ADAPT_TEST_PROB_NUM,
+            ADAPT_TEST_BENCH_LOOP);
+    mpp_log("scalar   %8lld us %6.2f us/frame\n", time_c,
+            (float)time_c / ADAPT_TEST_BENCH_LOOP);
+    mpp_log("vector   %8lld us %6.2f us/frame - speedup %.2f\n", time_simd,
+            (float)time_simd / ADAPT_TEST_BENCH_LOOP,
+            (float)time_c / MPP_MAX(time_simd, 1));
+}
+
+int main()
+{
+    RK_U32 seed = 0x12345678;
+    MPP_RET ret;
+
+    mpp_log("vp9d_adapt_test start\n");
+
+    ret = test_check(&seed);
+    if (!ret)
+        test_bench(&seed);
+
+    mpp_log("vp9d_adapt_test %s\n", ret ? "failed" : "success");
+    return ret;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "mpp_common.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VP9D_ADAPT_NEON
+#endif
+
+#include "vp9d_adapt.h"
+
+#define FASTDIV(a,b) ((RK_U32)((((RK_U64)a) * vpx_inverse[b]) >> 32))
+
+/*
+ * Vector path handles the lanes with count below 1 << 22 where
+ * (ct0 << 8) + (ct >> 1) does not overflow signed 32bit and ct is exact in
+ * float, larger count is left to the scalar path. Update factor is limited
+ * to 128 so the merge product fits in 16bit.
+ */
+#define ADAPT_COUNT_LIMIT       (~((1U << 22) - 1))
+#define ADAPT_FACTOR_MAX        128
+
+#if defined(__SSE2__)
+/* low 32bit of 32bit x 32bit product */
+static __inline __m128i mul_u32_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/* high 32bit of 32bit x 32bit product */
+static __inline __m128i mulhi_u32_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+}
+#endif
+
+void vp9d_merge_probs_c(RK_U8 *prob, const RK_U32 *ct0, const RK_U32 *ct1,
+                        RK_S32 count, RK_S32 max_count, RK_S32 update_factor)
+{
+    RK_S32 i;
+
+    for (i = 0; i < count; i++) {
+        RK_U32 ct = ct0[i] + ct1[i], p2, p1;
+        RK_S32 uf;
+
+        if (!ct)
+            continue;
+
+        p1 = prob[i];
+        p2 = ((ct0[i] << 8) + (ct >> 1)) / ct;
+        p2 = mpp_clip(p2, 1, 255);
+        ct = MPP_MIN(ct, (RK_U32)max_count);
+        uf = FASTDIV(update_factor * ct, max_count);
+
+        // (p1 * (256 - update_factor) + p2 * update_factor + 128) >> 8
+        prob[i] = p1 + (((p2 - p1) * uf + 128) >> 8);
+    }
+}
+
+void vp9d_merge_probs(RK_U8 *prob, const RK_U32 *ct0, const RK_U32 *ct1,
+                      RK_S32 count, RK_S32 max_count, RK_S32 update_factor)
+{
+    RK_S32 i = 0;
+
+    if (update_factor > ADAPT_FACTOR_MAX) {
+        vp9d_merge_probs_c(prob, ct0, ct1, count, max_count, update_factor);
+        return;
+    }
+
+#if defined(__SSE2__)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i limit = _mm_set1_epi32(ADAPT_COUNT_LIMIT);
+        const __m128i v255 = _mm_set1_epi32(255);
+        const __m128i round = _mm_set1_epi32(128);
+        const __m128i vmax = _mm_set1_epi32(max_count);
+        const __m128i vuf = _mm_set1_epi32(update_factor);
+        const __m128i vinv = _mm_set1_epi32(vpx_inverse[max_count]);
+
+        for (; i + 4 <= count; i += 4) {
+            __m128i c0 = _mm_loadu_si128((const __m128i *)(ct0 + i));
+            __m128i c1 = _mm_loadu_si128((const __m128i *)(ct1 + i));
+            __m128i big = _mm_and_si128(_mm_or_si128(c0, c1), limit);
+            __m128i ct, num, q, r, p1, p2, f, mask;
+            RK_U32 val;
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(big, zero)) != 0xffff) {
+                vp9d_merge_probs_c(prob + i, ct0 + i, ct1 + i, 4,
+                                   max_count, update_factor);
+                continue;
+            }
+
+            /*
+             * p2 = ((ct0 << 8) + (ct >> 1)) / ct
+             * float quotient is off by at most one and corrected by remainder
+             */
+            ct = _mm_add_epi32(c0, c1);
+            num = _mm_add_epi32(_mm_slli_epi32(c0, 8), _mm_srli_epi32(ct, 1));
+            q = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(num), _mm_cvtepi32_ps(ct)));
+            r = _mm_sub_epi32(num, mul_u32_sse2(q, ct));
+            mask = _mm_cmpgt_epi32(zero, r);
+            q = _mm_add_epi32(q, mask);
+            r = _mm_add_epi32(r, _mm_and_si128(mask, ct));
+            q = _mm_sub_epi32(q, _mm_cmpgt_epi32(r, _mm_sub_epi32(ct, _mm_set1_epi32(1))));
+
+            /* clip to [1, 255] */
+            p2 = _mm_sub_epi32(q, _mm_cmpeq_epi32(q, zero));
+            mask = _mm_cmpgt_epi32(p2, v255);
+            p2 = _mm_or_si128(_mm_andnot_si128(mask, p2), _mm_and_si128(mask, v255));
+
+            /* uf = FASTDIV(update_factor * MPP_MIN(ct, max_count), max_count) */
+            mask = _mm_cmpgt_epi32(ct, vmax);
+            f = _mm_or_si128(_mm_andnot_si128(mask, ct), _mm_and_si128(mask, vmax));
+            f = mulhi_u32_sse2(_mm_mullo_epi16(f, vuf), vinv);
+
+            memcpy(&val, prob + i, sizeof(val));
+            p1 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(val), zero), zero);
+
+            /* p1 + (((p2 - p1) * uf + 128) >> 8) in 16bit product */
+            p2 = _mm_mullo_epi16(_mm_packs_epi32(_mm_sub_epi32(p2, p1), zero),
+                                 _mm_packs_epi32(f, zero));
+            p2 = _mm_srai_epi32(_mm_unpacklo_epi16(zero, p2), 16);
+            p2 = _mm_add_epi32(p1, _mm_srai_epi32(_mm_add_epi32(p2, round), 8));
+
+            /* zero count keeps the old probability */
+            mask = _mm_cmpeq_epi32(ct, zero);
+            p2 = _mm_or_si128(_mm_and_si128(mask, p1), _mm_andnot_si128(mask, p2));
+
+            p2 = _mm_packs_epi32(p2, zero);
+            val = _mm_cvtsi128_si32(_mm_packus_epi16(p2, zero));
+            memcpy(prob + i, &val, sizeof(val));
+        }
+    }
+#elif defined(VP9D_ADAPT_NEON)
+    {
+        const uint32x4_t limit = vdupq_n_u32(ADAPT_COUNT_LIMIT);
+        const uint32x4_t vmax = vdupq_n_u32(max_count);
+        const uint32x4_t vuf = vdupq_n_u32(update_factor);
+        const uint32x2_t vinv = vdup_n_u32(vpx_inverse[max_count]);
+
+        for (; i + 4 <= count; i += 4) {
+            uint32x4_t c0 = vld1q_u32(ct0 + i);
+            uint32x4_t c1 = vld1q_u32(ct1 + i);
+            uint32x4_t big = vandq_u32(vorrq_u32(c0, c1), limit);
+            uint32x2_t any = vorr_u32(vget_low_u32(big), vget_high_u32(big));
+            uint32x4_t ct, num, f, mask;
+            float32x4_t fct, rcp;
+            int32x4_t q, r, p1, p2;
+            RK_U32 val;
+
+            if (vget_lane_u32(vpmax_u32(any, any), 0)) {
+                vp9d_merge_probs_c(prob + i, ct0 + i, ct1 + i, 4,
+                                   max_count, update_factor);
+                continue;
+            }
+
+            /*
+             * p2 = ((ct0 << 8) + (ct >> 1)) / ct
+             * reciprocal with two newton steps is off by at most one and
+             * corrected by remainder
+             */
+            ct = vaddq_u32(c0, c1);
+            num = vaddq_u32(vshlq_n_u32(c0, 8), vshrq_n_u32(ct, 1));
+            fct = vcvtq_f32_u32(ct);
+            rcp = vrecpeq_f32(fct);
+            rcp = vmulq_f32(rcp, vrecpsq_f32(fct, rcp));
+            rcp = vmulq_f32(rcp, vrecpsq_f32(fct, rcp));
+            q = vcvtq_s32_f32(vmulq_f32(vcvtq_f32_u32(num), rcp));
+            r = vsubq_s32(vreinterpretq_s32_u32(num),
+                          vmulq_s32(q, vreinterpretq_s32_u32(ct)));
+            mask = vcltq_s32(r, vdupq_n_s32(0));
+            q = vaddq_s32(q, vreinterpretq_s32_u32(mask));
+            r = vaddq_s32(r, vreinterpretq_s32_u32(vandq_u32(mask, ct)));
+            mask = vcgeq_s32(r, vreinterpretq_s32_u32(ct));
+            q = vsubq_s32(q, vreinterpretq_s32_u32(mask));
+
+            q = vminq_s32(vmaxq_s32(q, vdupq_n_s32(1)), vdupq_n_s32(255));
+
+            /* uf = FASTDIV(update_factor * MPP_MIN(ct, max_count), max_count) */
+            f = vmulq_u32(vminq_u32(ct, vmax), vuf);
+            f = vcombine_u32(vshrn_n_u64(vmull_u32(vget_low_u32(f), vinv), 32),
+                             vshrn_n_u64(vmull_u32(vget_high_u32(f), vinv), 32));
+
+            memcpy(&val, prob + i, sizeof(val));
+            p1 = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(
+                                                     vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(val))))));
+
+            /* p1 + (((p2 - p1) * uf + 128) >> 8) */
+            p2 = vmulq_s32(vsubq_s32(q, p1), vreinterpretq_s32_u32(f));
+            p2 = vaddq_s32(p1, vshrq_n_s32(vaddq_s32(p2, vdupq_n_s32(128)), 8));
+
+            /* zero count keeps the old probability */
+            mask = vceqq_u32(ct, vdupq_n_u32(0));
+            p2 = vbslq_s32(mask, p1, p2);
+
+            {
+                uint16x4_t p16 = vmovn_u32(vreinterpretq_u32_s32(p2));
+                uint8x8_t p8 = vmovn_u16(vcombine_u16(p16, p16));
+
+                val = vget_lane_u32(vreinterpret_u32_u8(p8), 0);
+                memcpy(prob + i, &val, sizeof(val));
+            }
+        }
+    }
+#endif
+
+    if (i < count)
+        vp9d_merge_probs_c(prob + i, ct0 + i, ct1 + i, count - i,
+                           max_count, update_factor);
+}
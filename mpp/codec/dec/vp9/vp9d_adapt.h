@@ -0,0 +1,50 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __VP9D_ADAPT_H__
+#define __VP9D_ADAPT_H__
+
+#include "rk_type.h"
+
+/*
+ * Backward probability adaptation
+ *
+ * prob[i] is merged with the probability of branch count ct0[i] / ct1[i].
+ * Probability with zero count is not changed.
+ *
+ * vp9d_merge_probs uses SSE2 / NEON when available and the result is bit
+ * exact with vp9d_merge_probs_c.
+ */
+#define VP9D_ADAPT_COEF_MAX_COUNT       24
+#define VP9D_ADAPT_MODE_MAX_COUNT       20
+#define VP9D_ADAPT_MODE_UPDATE_FACTOR   128
+
+extern const RK_U32 vpx_inverse[257];
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vp9d_merge_probs(RK_U8 *prob, const RK_U32 *ct0, const RK_U32 *ct1,
+                      RK_S32 count, RK_S32 max_count, RK_S32 update_factor);
+void vp9d_merge_probs_c(RK_U8 *prob, const RK_U32 *ct0, const RK_U32 *ct1,
+                        RK_S32 count, RK_S32 max_count, RK_S32 update_factor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VP9D_ADAPT_H__ */
@@ -26,6 +26,7 @@
 #include "mpp_packet_impl.h"
 
 #include "vp9data.h"
+#include "vp9d_adapt.h"
 #include "vp9d_codec.h"
 #include "vp9d_parser.h"
 
@@ -54,10 +55,6 @@ static RK_S32 dec_num = 0;
 static RK_S32 count = 0;
 #endif
 
-#ifndef FASTDIV
-#   define FASTDIV(a,b) ((RK_U32)((((RK_U64)a) * vpx_inverse[b]) >> 32))
-#endif /* FASTDIV */
-
 /* a*inverse[b]>>32 == a/b for all 0<=a<=16909558 && 2<=b<=256
  * for a>16909558, is an overestimate by less than 1 part in 1<<24 */
 const RK_U32 vpx_inverse[257] = {
@@ -303,13 +300,15 @@ static  RK_S32 vp9_frame_free(VP9Context *s)
         if (s->frames[i].ref) {
             vp9_unref_frame(s, &s->frames[i]);
         }
-        mpp_free(s->frames[i].f);
+        if (s->frames[i].f)
+            mpp_frame_deinit(&s->frames[i].f);
     }
     for (i = 0; i < 8; i++) {
         if (s->refs[i].ref) {
             vp9_unref_frame(s, &s->refs[i]);
         }
-        mpp_free(s->refs[i].f);
+        if (s->refs[i].f)
+            mpp_frame_deinit(&s->refs[i].f);
     }
     return 0;
 }
@@ -1256,22 +1255,45 @@ static RK_S32 decode_parser_header(Vp9CodecContext *ctx,
     return (RK_S32)((data2 - data) + size2);
 }
 
-static void adapt_prob(RK_U8 *p, RK_U32 ct0, RK_U32 ct1,
-                       RK_S32 max_count, RK_S32 update_factor)
+/*
+ * Mode probabilities are collected and merged in one vp9d_merge_probs call.
+ * Each probability is adapted once from the counts so the order of merge
+ * does not matter.
+ */
+#define VP9_ADAPT_BATCH_MAX     512
+
+typedef struct Vp9AdaptBatch_t {
+    RK_S32  count;
+    RK_U8   *ptr[VP9_ADAPT_BATCH_MAX];
+    RK_U8   prob[VP9_ADAPT_BATCH_MAX];
+    RK_U32  ct0[VP9_ADAPT_BATCH_MAX];
+    RK_U32  ct1[VP9_ADAPT_BATCH_MAX];
+} Vp9AdaptBatch;
+
+static void adapt_prob(Vp9AdaptBatch *batch, RK_U8 *p, RK_U32 ct0, RK_U32 ct1)
 {
-    RK_U32 ct = ct0 + ct1, p2, p1;
+    RK_S32 idx = batch->count;
 
-    if (!ct)
-        return;
+    mpp_assert(idx < VP9_ADAPT_BATCH_MAX);
+
+    batch->ptr[idx] = p;
+    batch->prob[idx] = *p;
+    batch->ct0[idx] = ct0;
+    batch->ct1[idx] = ct1;
+    batch->count++;
+}
+
+static void adapt_batch_merge(Vp9AdaptBatch *batch)
+{
+    RK_S32 i;
 
-    p1 = *p;
-    p2 = ((ct0 << 8) + (ct >> 1)) / ct;
-    p2 = mpp_clip(p2, 1, 255);
-    ct = MPP_MIN(ct, (RK_U32)max_count);
-    update_factor = FASTDIV(update_factor * ct, max_count);
+    vp9d_merge_probs(batch->prob, batch->ct0, batch->ct1, batch->count,
+                     VP9D_ADAPT_MODE_MAX_COUNT, VP9D_ADAPT_MODE_UPDATE_FACTOR);
 
-    // (p1 * (256 - update_factor) + p2 * update_factor + 128) >> 8
-    *p = p1 + (((p2 - p1) * update_factor + 128) >> 8);
+    for (i = 0; i < batch->count; i++)
+        *batch->ptr[i] = batch->prob[i];
+
+    batch->count = 0;
 }
 
 static void adapt_probs(VP9Context *s)
@@ -1279,31 +1301,42 @@ static void adapt_probs(VP9Context *s)
     RK_S32 i, j, k, l, m;
     prob_context *p = &s->prob_ctx[s->framectxid].p;
     RK_S32 uf = (s->keyframe || s->intraonly || !s->last_keyframe) ? 112 : 128;
+    RK_U32 ct0[sizeof(s->counts.coef) / sizeof(RK_U32)];
+    RK_U32 ct1[sizeof(s->counts.coef) / sizeof(RK_U32)];
+    Vp9AdaptBatch batch;
 
     // coefficients
-    for (i = 0; i < 4; i++)
-        for (j = 0; j < 2; j++)
-            for (k = 0; k < 2; k++)
-                for (l = 0; l < 6; l++)
-                    for (m = 0; m < 6; m++) {
-                        RK_U8 *pp = s->prob_ctx[s->framectxid].coef[i][j][k][l][m];
-                        RK_U32 *e = s->counts.eob[i][j][k][l][m];
-                        RK_U32 *c = s->counts.coef[i][j][k][l][m];
-
-                        if (l == 0 && m >= 3) // dc only has 3 pt
-                            break;
-                        /*  if(i == 0 && j == 0 && k== 1 && l == 0){
-                             mpp_log("e[0] = 0x%x e[1] = 0x%x c[0] = 0x%x c[1] = 0x%x c[2] = 0x%x \n",
-                             e[0],e[1],c[0],c[1],c[2]);
-                             mpp_log("pp[0] = 0x%x pp[1] = 0x%x pp[2] = 0x%x",pp[0],pp[1],pp[2]);
-                          }*/
-                        adapt_prob(&pp[0], e[0], e[1], 24, uf);
-                        adapt_prob(&pp[1], c[0], c[1] + c[2], 24, uf);
-                        adapt_prob(&pp[2], c[1], c[2], 24, uf);
-                        /* if(i == 0 && j == 0 && k== 1 && l == 0){
-                            mpp_log("after pp[0] = 0x%x pp[1] = 0x%x pp[2] = 0x%x",pp[0],pp[1],pp[2]);
-                         }*/
-                    }
+    {
+        RK_U32 *c0 = ct0;
+        RK_U32 *c1 = ct1;
+
+        for (i = 0; i < 4; i++)
+            for (j = 0; j < 2; j++)
+                for (k = 0; k < 2; k++)
+                    for (l = 0; l < 6; l++)
+                        for (m = 0; m < 6; m++, c0 += 3, c1 += 3) {
+                            RK_U32 *e = s->counts.eob[i][j][k][l][m];
+                            RK_U32 *c = s->counts.coef[i][j][k][l][m];
+
+                            // dc only has 3 pt, zero count keeps the prob
+                            if (l == 0 && m >= 3) {
+                                memset(c0, 0, sizeof(*c0) * 3);
+                                memset(c1, 0, sizeof(*c1) * 3);
+                                continue;
+                            }
+
+                            c0[0] = e[0];
+                            c1[0] = e[1];
+                            c0[1] = c[0];
+                            c1[1] = c[1] + c[2];
+                            c0[2] = c[1];
+                            c1[2] = c[2];
+                        }
+
+        vp9d_merge_probs(&s->prob_ctx[s->framectxid].coef[0][0][0][0][0][0],
+                         ct0, ct1, MPP_ARRAY_ELEMS(ct0),
+                         VP9D_ADAPT_COEF_MAX_COUNT, uf);
+    }
 #ifdef dump
     fwrite(&s->counts, 1, sizeof(s->counts), vp9_p_fp);
     fflush(vp9_p_fp);
@@ -1317,25 +1350,27 @@ static void adapt_probs(VP9Context *s)
         return;
     }
 
+    batch.count = 0;
+
     // skip flag
     for (i = 0; i < 3; i++)
-        adapt_prob(&p->skip[i], s->counts.skip[i][0], s->counts.skip[i][1], 20, 128);
+        adapt_prob(&batch, &p->skip[i], s->counts.skip[i][0], s->counts.skip[i][1]);
 
     // intra/inter flag
     for (i = 0; i < 4; i++)
-        adapt_prob(&p->intra[i], s->counts.intra[i][0], s->counts.intra[i][1], 20, 128);
+        adapt_prob(&batch, &p->intra[i], s->counts.intra[i][0], s->counts.intra[i][1]);
 
     // comppred flag
     if (s->comppredmode == PRED_SWITCHABLE) {
         for (i = 0; i < 5; i++)
-            adapt_prob(&p->comp[i], s->counts.comp[i][0], s->counts.comp[i][1], 20, 128);
+            adapt_prob(&batch, &p->comp[i], s->counts.comp[i][0], s->counts.comp[i][1]);
     }
 
     // reference frames
     if (s->comppredmode != PRED_SINGLEREF) {
         for (i = 0; i < 5; i++)
-            adapt_prob(&p->comp_ref[i], s->counts.comp_ref[i][0],
-                       s->counts.comp_ref[i][1], 20, 128);
+            adapt_prob(&batch, &p->comp_ref[i], s->counts.comp_ref[i][0],
+                       s->counts.comp_ref[i][1]);
     }
 
     if (s->comppredmode != PRED_COMPREF) {
@@ -1343,8 +1378,8 @@ static void adapt_probs(VP9Context *s)
             RK_U8 *pp = p->single_ref[i];
             RK_U32 (*c)[2] = s->counts.single_ref[i];
 
-            adapt_prob(&pp[0], c[0][0], c[0][1], 20, 128);
-            adapt_prob(&pp[1], c[1][0], c[1][1], 20, 128);
+            adapt_prob(&batch, &pp[0], c[0][0], c[0][1]);
+            adapt_prob(&batch, &pp[1], c[1][0], c[1][1]);
         }
     }
 
@@ -1355,9 +1390,9 @@ static void adapt_probs(VP9Context *s)
             RK_U32 *c = s->counts.partition[i][j];
             // mpp_log("befor pp[0] = 0x%x pp[1] = 0x%x pp[2] = 0x%x",pp[0],pp[1],pp[2]);
             // mpp_log("befor c[0] = 0x%x c[1] = 0x%x c[2] = 0x%x",c[0],c[1],c[2]);
-            adapt_prob(&pp[0], c[0], c[1] + c[2] + c[3], 20, 128);
-            adapt_prob(&pp[1], c[1], c[2] + c[3], 20, 128);
-            adapt_prob(&pp[2], c[2], c[3], 20, 128);
+            adapt_prob(&batch, &pp[0], c[0], c[1] + c[2] + c[3]);
+            adapt_prob(&batch, &pp[1], c[1], c[2] + c[3]);
+            adapt_prob(&batch, &pp[2], c[2], c[3]);
             // mpp_log(" after pp[0] = 0x%x pp[1] = 0x%x pp[2] = 0x%x",pp[0],pp[1],pp[2]);
         }
 
@@ -1366,12 +1401,12 @@ static void adapt_probs(VP9Context *s)
         for (i = 0; i < 2; i++) {
             RK_U32 *c16 = s->counts.tx16p[i], *c32 = s->counts.tx32p[i];
 
-            adapt_prob(&p->tx8p[i], s->counts.tx8p[i][0], s->counts.tx8p[i][1], 20, 128);
-            adapt_prob(&p->tx16p[i][0], c16[0], c16[1] + c16[2], 20, 128);
-            adapt_prob(&p->tx16p[i][1], c16[1], c16[2], 20, 128);
-            adapt_prob(&p->tx32p[i][0], c32[0], c32[1] + c32[2] + c32[3], 20, 128);
-            adapt_prob(&p->tx32p[i][1], c32[1], c32[2] + c32[3], 20, 128);
-            adapt_prob(&p->tx32p[i][2], c32[2], c32[3], 20, 128);
+            adapt_prob(&batch, &p->tx8p[i], s->counts.tx8p[i][0], s->counts.tx8p[i][1]);
+            adapt_prob(&batch, &p->tx16p[i][0], c16[0], c16[1] + c16[2]);
+            adapt_prob(&batch, &p->tx16p[i][1], c16[1], c16[2]);
+            adapt_prob(&batch, &p->tx32p[i][0], c32[0], c32[1] + c32[2] + c32[3]);
+            adapt_prob(&batch, &p->tx32p[i][1], c32[1], c32[2] + c32[3]);
+            adapt_prob(&batch, &p->tx32p[i][2], c32[2], c32[3]);
         }
     }
 
@@ -1381,8 +1416,8 @@ static void adapt_probs(VP9Context *s)
             RK_U8 *pp = p->filter[i];
             RK_U32 *c = s->counts.filter[i];
 
-            adapt_prob(&pp[0], c[0], c[1] + c[2], 20, 128);
-            adapt_prob(&pp[1], c[1], c[2], 20, 128);
+            adapt_prob(&batch, &pp[0], c[0], c[1] + c[2]);
+            adapt_prob(&batch, &pp[1], c[1], c[2]);
         }
     }
 
@@ -1391,9 +1426,9 @@ static void adapt_probs(VP9Context *s)
         RK_U8 *pp = p->mv_mode[i];
         RK_U32 *c = s->counts.mv_mode[i];
 
-        adapt_prob(&pp[0], c[2], c[1] + c[0] + c[3], 20, 128);
-        adapt_prob(&pp[1], c[0], c[1] + c[3], 20, 128);
-        adapt_prob(&pp[2], c[1], c[3], 20, 128);
+        adapt_prob(&batch, &pp[0], c[2], c[1] + c[0] + c[3]);
+        adapt_prob(&batch, &pp[1], c[0], c[1] + c[3]);
+        adapt_prob(&batch, &pp[2], c[1], c[3]);
     }
 
     // mv joints
@@ -1401,9 +1436,9 @@ static void adapt_probs(VP9Context *s)
         RK_U8 *pp = p->mv_joint;
         RK_U32 *c = s->counts.mv_joint;
 
-        adapt_prob(&pp[0], c[0], c[1] + c[2] + c[3], 20, 128);
-        adapt_prob(&pp[1], c[1], c[2] + c[3], 20, 128);
-        adapt_prob(&pp[2], c[2], c[3], 20, 128);
+        adapt_prob(&batch, &pp[0], c[0], c[1] + c[2] + c[3]);
+        adapt_prob(&batch, &pp[1], c[1], c[2] + c[3]);
+        adapt_prob(&batch, &pp[2], c[2], c[3]);
     }
 
     // mv components
@@ -1411,52 +1446,52 @@ static void adapt_probs(VP9Context *s)
         RK_U8 *pp;
         RK_U32 *c, (*c2)[2], sum;
 
-        adapt_prob(&p->mv_comp[i].sign, s->counts.sign[i][0],
-                   s->counts.sign[i][1], 20, 128);
+        adapt_prob(&batch, &p->mv_comp[i].sign, s->counts.sign[i][0],
+                   s->counts.sign[i][1]);
 
         pp = p->mv_comp[i].classes;
         c = s->counts.classes[i];
         sum = c[1] + c[2] + c[3] + c[4] + c[5] + c[6] + c[7] + c[8] + c[9] + c[10];
-        adapt_prob(&pp[0], c[0], sum, 20, 128);
+        adapt_prob(&batch, &pp[0], c[0], sum);
         sum -= c[1];
-        adapt_prob(&pp[1], c[1], sum, 20, 128);
+        adapt_prob(&batch, &pp[1], c[1], sum);
         sum -= c[2] + c[3];
-        adapt_prob(&pp[2], c[2] + c[3], sum, 20, 128);
-        adapt_prob(&pp[3], c[2], c[3], 20, 128);
+        adapt_prob(&batch, &pp[2], c[2] + c[3], sum);
+        adapt_prob(&batch, &pp[3], c[2], c[3]);
         sum -= c[4] + c[5];
-        adapt_prob(&pp[4], c[4] + c[5], sum, 20, 128);
-        adapt_prob(&pp[5], c[4], c[5], 20, 128);
+        adapt_prob(&batch, &pp[4], c[4] + c[5], sum);
+        adapt_prob(&batch, &pp[5], c[4], c[5]);
         sum -= c[6];
-        adapt_prob(&pp[6], c[6], sum, 20, 128);
-        adapt_prob(&pp[7], c[7] + c[8], c[9] + c[10], 20, 128);
-        adapt_prob(&pp[8], c[7], c[8], 20, 128);
-        adapt_prob(&pp[9], c[9], c[10], 20, 128);
+        adapt_prob(&batch, &pp[6], c[6], sum);
+        adapt_prob(&batch, &pp[7], c[7] + c[8], c[9] + c[10]);
+        adapt_prob(&batch, &pp[8], c[7], c[8]);
+        adapt_prob(&batch, &pp[9], c[9], c[10]);
 
-        adapt_prob(&p->mv_comp[i].class0, s->counts.class0[i][0],
-                   s->counts.class0[i][1], 20, 128);
+        adapt_prob(&batch, &p->mv_comp[i].class0, s->counts.class0[i][0],
+                   s->counts.class0[i][1]);
         pp = p->mv_comp[i].bits;
         c2 = s->counts.bits[i];
         for (j = 0; j < 10; j++)
-            adapt_prob(&pp[j], c2[j][0], c2[j][1], 20, 128);
+            adapt_prob(&batch, &pp[j], c2[j][0], c2[j][1]);
 
         for (j = 0; j < 2; j++) {
             pp = p->mv_comp[i].class0_fp[j];
             c = s->counts.class0_fp[i][j];
-            adapt_prob(&pp[0], c[0], c[1] + c[2] + c[3], 20, 128);
-            adapt_prob(&pp[1], c[1], c[2] + c[3], 20, 128);
-            adapt_prob(&pp[2], c[2], c[3], 20, 128);
+            adapt_prob(&batch, &pp[0], c[0], c[1] + c[2] + c[3]);
+            adapt_prob(&batch, &pp[1], c[1], c[2] + c[3]);
+            adapt_prob(&batch, &pp[2], c[2], c[3]);
         }
         pp = p->mv_comp[i].fp;
         c = s->counts.fp[i];
-        adapt_prob(&pp[0], c[0], c[1] + c[2] + c[3], 20, 128);
-        adapt_prob(&pp[1], c[1], c[2] + c[3], 20, 128);
-        adapt_prob(&pp[2], c[2], c[3], 20, 128);
+        adapt_prob(&batch, &pp[0], c[0], c[1] + c[2] + c[3]);
+        adapt_prob(&batch, &pp[1], c[1], c[2] + c[3]);
+        adapt_prob(&batch, &pp[2], c[2], c[3]);
 
         if (s->highprecisionmvs) {
-            adapt_prob(&p->mv_comp[i].class0_hp, s->counts.class0_hp[i][0],
-                       s->counts.class0_hp[i][1], 20, 128);
-            adapt_prob(&p->mv_comp[i].hp, s->counts.hp[i][0],
-                       s->counts.hp[i][1], 20, 128);
+            adapt_prob(&batch, &p->mv_comp[i].class0_hp, s->counts.class0_hp[i][0],
+                       s->counts.class0_hp[i][1]);
+            adapt_prob(&batch, &p->mv_comp[i].hp, s->counts.hp[i][0],
+                       s->counts.hp[i][1]);
         }
     }
 
@@ -1466,22 +1501,22 @@ static void adapt_probs(VP9Context *s)
         RK_U32 *c = s->counts.y_mode[i], sum, s2;
 
         sum = c[0] + c[1] + c[3] + c[4] + c[5] + c[6] + c[7] + c[8] + c[9];
-        adapt_prob(&pp[0], c[DC_PRED], sum, 20, 128);
+        adapt_prob(&batch, &pp[0], c[DC_PRED], sum);
         sum -= c[TM_VP8_PRED];
-        adapt_prob(&pp[1], c[TM_VP8_PRED], sum, 20, 128);
+        adapt_prob(&batch, &pp[1], c[TM_VP8_PRED], sum);
         sum -= c[VERT_PRED];
-        adapt_prob(&pp[2], c[VERT_PRED], sum, 20, 128);
+        adapt_prob(&batch, &pp[2], c[VERT_PRED], sum);
         s2 = c[HOR_PRED] + c[DIAG_DOWN_RIGHT_PRED] + c[VERT_RIGHT_PRED];
         sum -= s2;
-        adapt_prob(&pp[3], s2, sum, 20, 128);
+        adapt_prob(&batch, &pp[3], s2, sum);
         s2 -= c[HOR_PRED];
-        adapt_prob(&pp[4], c[HOR_PRED], s2, 20, 128);
-        adapt_prob(&pp[5], c[DIAG_DOWN_RIGHT_PRED], c[VERT_RIGHT_PRED], 20, 128);
+        adapt_prob(&batch, &pp[4], c[HOR_PRED], s2);
+        adapt_prob(&batch, &pp[5], c[DIAG_DOWN_RIGHT_PRED], c[VERT_RIGHT_PRED]);
         sum -= c[DIAG_DOWN_LEFT_PRED];
-        adapt_prob(&pp[6], c[DIAG_DOWN_LEFT_PRED], sum, 20, 128);
+        adapt_prob(&batch, &pp[6], c[DIAG_DOWN_LEFT_PRED], sum);
         sum -= c[VERT_LEFT_PRED];
-        adapt_prob(&pp[7], c[VERT_LEFT_PRED], sum, 20, 128);
-        adapt_prob(&pp[8], c[HOR_DOWN_PRED], c[HOR_UP_PRED], 20, 128);
+        adapt_prob(&batch, &pp[7], c[VERT_LEFT_PRED], sum);
+        adapt_prob(&batch, &pp[8], c[HOR_DOWN_PRED], c[HOR_UP_PRED]);
     }
 
     // uv intra modes
@@ -1490,23 +1525,25 @@ static void adapt_probs(VP9Context *s)
         RK_U32 *c = s->counts.uv_mode[i], sum, s2;
 
         sum = c[0] + c[1] + c[3] + c[4] + c[5] + c[6] + c[7] + c[8] + c[9];
-        adapt_prob(&pp[0], c[DC_PRED], sum, 20, 128);
+        adapt_prob(&batch, &pp[0], c[DC_PRED], sum);
         sum -= c[TM_VP8_PRED];
-        adapt_prob(&pp[1], c[TM_VP8_PRED], sum, 20, 128);
+        adapt_prob(&batch, &pp[1], c[TM_VP8_PRED], sum);
         sum -= c[VERT_PRED];
-        adapt_prob(&pp[2], c[VERT_PRED], sum, 20, 128);
+        adapt_prob(&batch, &pp[2], c[VERT_PRED], sum);
         s2 = c[HOR_PRED] + c[DIAG_DOWN_RIGHT_PRED] + c[VERT_RIGHT_PRED];
         sum -= s2;
-        adapt_prob(&pp[3], s2, sum, 20, 128);
+        adapt_prob(&batch, &pp[3], s2, sum);
         s2 -= c[HOR_PRED];
-        adapt_prob(&pp[4], c[HOR_PRED], s2, 20, 128);
-        adapt_prob(&pp[5], c[DIAG_DOWN_RIGHT_PRED], c[VERT_RIGHT_PRED], 20, 128);
+        adapt_prob(&batch, &pp[4], c[HOR_PRED], s2);
+        adapt_prob(&batch, &pp[5], c[DIAG_DOWN_RIGHT_PRED], c[VERT_RIGHT_PRED]);
         sum -= c[DIAG_DOWN_LEFT_PRED];
-        adapt_prob(&pp[6], c[DIAG_DOWN_LEFT_PRED], sum, 20, 128);
+        adapt_prob(&batch, &pp[6], c[DIAG_DOWN_LEFT_PRED], sum);
         sum -= c[VERT_LEFT_PRED];
-        adapt_prob(&pp[7], c[VERT_LEFT_PRED], sum, 20, 128);
-        adapt_prob(&pp[8], c[HOR_DOWN_PRED], c[HOR_UP_PRED], 20, 128);
+        adapt_prob(&batch, &pp[7], c[VERT_LEFT_PRED], sum);
+        adapt_prob(&batch, &pp[8], c[HOR_DOWN_PRED], c[HOR_UP_PRED]);
     }
+
+    adapt_batch_merge(&batch);
 #if 0 //def dump
     fwrite(s->counts.y_mode, 1, sizeof(s->counts.y_mode), vp9_p_fp1);
     fwrite(s->counts.uv_mode, 1, sizeof(s->counts.uv_mode), vp9_p_fp1);
@@ -73,6 +73,8 @@ typedef struct MppDecImpl_t {
     // 7. parser do reset and signal mpp_dec
     // 8. mpp_dec reset done
     RK_U32              reset_flag;
+    // set on stop to break the wait on full output frame ring
+    RK_U32              stop_flag;
 
     RK_U32              hal_reset_post;
     RK_U32              hal_reset_done;
@@ -88,12 +90,17 @@ typedef struct MppDecImpl_t {
     RK_U32              enable_deinterlace;
 
     // dec parser thread runtime resource context
+    void                *parser_task;
     MppPacket           mpp_pkt_in;
+    RK_S64              mpp_pkt_in_time;
     void                *mpp;
     void                *vproc;
 
     // statistics data
     RK_U32              statistics_en;
+    // wait start time of the thread running on worker pool
+    RK_S64              parser_wait_start;
+    RK_S64              hal_wait_start;
     MppClock            clocks[DEC_TIMING_BUTT];
 } MppDecImpl;
 
@@ -101,6 +108,7 @@ typedef struct MppDecImpl_t {
 extern "C" {
 #endif
 
+void mpp_dec_put_output(MppDecImpl *dec, MppFrame frame);
 
 #ifdef __cplusplus
 }
@@ -154,6 +154,8 @@ typedef void* MppEnc;
 typedef struct MppEncInitCfg_t {
     MppCodingType       coding;
     void                *mpp;
+    /* frames in flight, 2 for pipeline mode when hal supports it */
+    RK_S32              task_count;
 } MppEncInitCfg;
 
 #ifdef __cplusplus
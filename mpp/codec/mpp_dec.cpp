@@ -22,6 +22,9 @@
 #include "mpp_mem.h"
 #include "mpp_log.h"
 #include "mpp_time.h"
+#include "mpp_atomic.h"
+#include "mpp_eventfd.h"
+#include "mpp_worker.h"
 
 #include "mpp.h"
 #include "mpp_dec_impl.h"
@@ -49,6 +52,9 @@ static RK_U32 mpp_dec_debug = 0;
 #define dec_dbg_reset(fmt, ...)         mpp_dec_dbg(MPP_DEC_DBG_RESET, fmt, ## __VA_ARGS__)
 #define dec_dbg_notify(fmt, ...)        mpp_dec_dbg_f(MPP_DEC_DBG_NOTIFY, fmt, ## __VA_ARGS__)
 
+/* wait slice in us on full output frame ring to check reset and stop */
+#define MPP_DEC_OUTPUT_WAIT             (10000)
+
 typedef union PaserTaskWait_u {
     RK_U32          val;
     struct {
@@ -101,6 +107,9 @@ typedef struct DecTask_t {
     MppBuffer       hal_pkt_buf_in;
     MppBuffer       hal_frm_buf_out;
 
+    /* parser prepare and parse time of current task for statistics */
+    RK_S64          parse_time;
+
     HalTaskInfo     info;
 } DecTask;
 
@@ -117,6 +126,8 @@ static void dec_task_init(DecTask *task)
     task->hal_pkt_buf_in  = NULL;
     task->hal_frm_buf_out = NULL;
 
+    task->parse_time = 0;
+
     hal_task_info_init(&task->info, MPP_CTX_DEC);
 }
 
@@ -176,7 +187,10 @@ static RK_U32 reset_parser_thread(Mpp *mpp, DecTask *task)
     hal->signal();
     hal->unlock();
 
+    // hal job may need a worker to finish the reset
+    mpp_worker_block_enter();
     sem_wait(&dec->hal_reset);
+    mpp_worker_block_leave();
 
     dec_dbg_reset("reset: parser check hal proc task empty start\n");
 
@@ -257,6 +271,35 @@ static RK_U32 reset_parser_thread(Mpp *mpp, DecTask *task)
 }
 
 /* Overall mpp_dec output frame function */
+/*
+ * Full output ring holds the calling thread until user gets frame. Reset and
+ * stop break the wait and drop the frame as the ring will be flushed.
+ */
+void mpp_dec_put_output(MppDecImpl *dec, MppFrame frame)
+{
+    Mpp *mpp = (Mpp *)dec->mpp;
+    MPP_RET ret = mpp_ring_put(mpp->mFrames, frame);
+
+    if (ret) {
+        mpp_worker_block_enter();
+        do {
+            ret = mpp_ring_put_wait(mpp->mFrames, frame, MPP_DEC_OUTPUT_WAIT);
+        } while (ret && !dec->reset_flag && !dec->stop_flag);
+        mpp_worker_block_leave();
+    }
+
+    if (ret) {
+        dec_dbg_reset("drop frame pts %lld on %s\n", mpp_frame_get_pts(frame),
+                      dec->reset_flag ? "reset" : "stop");
+        mpp_frame_deinit(&frame);
+        return ;
+    }
+
+    MPP_FETCH_ADD(&mpp->mFramePutCount, 1);
+    if (mpp->mOutputEventFd >= 0)
+        mpp_eventfd_write(mpp->mOutputEventFd, 1);
+}
+
 static void mpp_dec_put_frame(Mpp *mpp, RK_S32 index, HalDecTaskFlag flags)
 {
     MppDecImpl *dec = (MppDecImpl *)mpp->mDec;
@@ -384,20 +427,19 @@ static void mpp_dec_put_frame(Mpp *mpp, RK_S32 index, HalDecTaskFlag flags)
         dec_vproc_signal(dec->vproc);
     } else {
         // direct output -> copy a new MppFrame and output
-        mpp_list *list = mpp->mFrames;
         MppFrame out = NULL;
 
         mpp_frame_init(&out);
         mpp_frame_copy(out, frame);
 
+        if (!change && ((MppFrameImpl *)out)->in_time)
+            mpp_hist_record_atomic(mpp->mLatency[MPP_LATENCY_IN_OUT],
+                                   mpp_time() - ((MppFrameImpl *)out)->in_time);
+
         if (mpp_debug & MPP_DBG_PTS)
             mpp_log("output frame pts %lld\n", mpp_frame_get_pts(out));
 
-        list->lock();
-        list->add_at_tail(&out, sizeof(out));
-        mpp->mFramePutCount++;
-        list->signal();
-        list->unlock();
+        mpp_dec_put_output(dec, out);
 
         if (fake_frame)
             mpp_frame_deinit(&frame);
@@ -507,18 +549,18 @@ static MPP_RET try_proc_dec_task(Mpp *mpp, DecTask *task)
      * 2. get packet for parser preparing
      */
     if (!dec->mpp_pkt_in && !task->status.curr_task_rdy) {
-        mpp_list *packets = mpp->mPackets;
-        AutoMutex autolock(packets->mutex());
-
-        if (!packets->list_size()) {
+        if (mpp_ring_get(mpp->mPackets, &dec->mpp_pkt_in, 0)) {
             task->wait.dec_pkt_in = 1;
             return MPP_NOK;
         }
 
         task->wait.dec_pkt_in = 0;
-        packets->del_at_head(&dec->mpp_pkt_in, sizeof(dec->mpp_pkt_in));
         mpp->mPacketGetCount++;
 
+        dec->mpp_pkt_in_time = ((MppPacketImpl *)dec->mpp_pkt_in)->in_time;
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_INPUT_WAIT],
+                        mpp_time() - dec->mpp_pkt_in_time);
+
         if (dec->use_preset_time_order) {
             MppPacket pkt_in = NULL;
             mpp_list *ts = mpp->mTimeStamps;
@@ -563,10 +605,14 @@ static MPP_RET try_proc_dec_task(Mpp *mpp, DecTask *task)
             mpp_log("input packet pts %lld\n",
                     mpp_packet_get_pts(dec->mpp_pkt_in));
 
+        RK_S64 start = mpp_time();
+
         mpp_clock_start(dec->clocks[DEC_PRS_PREPARE]);
         mpp_parser_prepare(dec->parser, dec->mpp_pkt_in, task_dec);
         mpp_clock_pause(dec->clocks[DEC_PRS_PREPARE]);
 
+        task->parse_time += mpp_time() - start;
+
         if (0 == mpp_packet_get_length(dec->mpp_pkt_in)) {
             mpp_packet_deinit(&dec->mpp_pkt_in);
             dec->mpp_pkt_in = NULL;
@@ -666,7 +712,7 @@ static MPP_RET try_proc_dec_task(Mpp *mpp, DecTask *task)
 
     /* too many frame delay in dispaly queue */
     if (mpp->mFrames) {
-        task->wait.dis_que_full = (mpp->mFrames->list_size() > 4) ? 1 : 0;
+        task->wait.dis_que_full = (mpp_ring_size(mpp->mFrames) > 4) ? 1 : 0;
         if (task->wait.dis_que_full)
             return MPP_ERR_DISPLAY_FULL;
     }
@@ -692,10 +738,26 @@ static MPP_RET try_proc_dec_task(Mpp *mpp, DecTask *task)
      *    4. detect whether output index has MppBuffer and task valid
      */
     if (!task->status.task_parsed_rdy) {
+        RK_S64 start = mpp_time();
+
         mpp_clock_start(dec->clocks[DEC_PRS_PARSE]);
         mpp_parser_parse(dec->parser, task_dec);
         mpp_clock_pause(dec->clocks[DEC_PRS_PARSE]);
         task->status.task_parsed_rdy = 1;
+
+        task->parse_time += mpp_time() - start;
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_PARSE], task->parse_time);
+        task->parse_time = 0;
+
+        /* mark output frame with its input packet time for in-out latency */
+        if (task_dec->valid && task_dec->output >= 0) {
+            MppFrame frame = NULL;
+
+            mpp_buf_slot_get_prop(frame_slots, task_dec->output,
+                                  SLOT_FRAME_PTR, &frame);
+            if (frame)
+                ((MppFrameImpl *)frame)->in_time = dec->mpp_pkt_in_time;
+        }
     }
 
     if (task_dec->output < 0 || !task_dec->valid) {
@@ -800,9 +862,26 @@ static MPP_RET try_proc_dec_task(Mpp *mpp, DecTask *task)
         return MPP_NOK;
 
     /* generating registers table */
-    mpp_clock_start(dec->clocks[DEC_HAL_GEN_REG]);
-    mpp_hal_reg_gen(dec->hal, &task->info);
-    mpp_clock_pause(dec->clocks[DEC_HAL_GEN_REG]);
+    {
+        RK_S64 start = mpp_time();
+
+        mpp_clock_start(dec->clocks[DEC_HAL_GEN_REG]);
+        mpp_hal_reg_gen(dec->hal, &task->info);
+        mpp_clock_pause(dec->clocks[DEC_HAL_GEN_REG]);
+
+        task_dec->hw_start_time = mpp_time();
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_GEN_REGS],
+                        task_dec->hw_start_time - start);
+    }
+
+    /* output frame pts is the deadline hint for hardware scheduler */
+    {
+        MppFrame frame = NULL;
+
+        mpp_buf_slot_get_prop(frame_slots, output, SLOT_FRAME_PTR, &frame);
+        if (frame)
+            mpp_dev_sched_client_set_pts(mpp->mHwSched, mpp_frame_get_pts(frame));
+    }
 
     /* send current register set to hardware */
     mpp_clock_start(dec->clocks[DEC_HW_START]);
@@ -829,70 +908,100 @@ static MPP_RET try_proc_dec_task(Mpp *mpp, DecTask *task)
     return MPP_OK;
 }
 
-void *mpp_dec_parser_thread(void *data)
+static void mpp_dec_parser_quit(Mpp *mpp, DecTask *task)
+{
+    MppDecImpl *dec = (MppDecImpl *)mpp->mDec;
+    MppBufSlots packet_slots = dec->packet_slots;
+    HalDecTask *task_dec = &task->info.dec;
+
+    mpp_clock_pause(dec->clocks[DEC_PRS_TOTAL]);
+
+    mpp_dbg(MPP_DBG_INFO, "mpp_dec_parser_thread is going to exit\n");
+    if (task->hnd && task_dec->valid) {
+        mpp_buf_slot_set_flag(packet_slots, task_dec->input, SLOT_CODEC_READY);
+        mpp_buf_slot_set_flag(packet_slots, task_dec->input, SLOT_HAL_INPUT);
+        mpp_buf_slot_clr_flag(packet_slots, task_dec->input, SLOT_HAL_INPUT);
+    }
+    mpp_buffer_group_clear(mpp->mPacketGroup);
+    mpp_dbg(MPP_DBG_INFO, "mpp_dec_parser_thread exited\n");
+}
+
+/*
+ * One loop of parser thread. The parser task is kept in MppDecImpl so the
+ * loop can also run as a job on the shared worker pool.
+ */
+static MppThreadStep mpp_dec_parser_step(void *data)
 {
     Mpp *mpp = (Mpp*)data;
     MppDecImpl *dec = (MppDecImpl *)mpp->mDec;
     MppThread *parser = dec->thread_parser;
-    MppBufSlots packet_slots = dec->packet_slots;
+    DecTask *task = (DecTask *)dec->parser_task;
 
-    DecTask task;
-    HalDecTask  *task_dec = &task.info.dec;
+    // pooled job may run on different worker thread on each step
+    mpp_dev_sched_bind(mpp->mHwSched);
 
-    dec_task_init(&task);
+    if (dec->parser_wait_start) {
+        mpp_clock_pause(dec->clocks[DEC_PRS_WAIT]);
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_CODEC_WAIT],
+                        mpp_time() - dec->parser_wait_start);
+        dec->parser_wait_start = 0;
+    }
 
-    mpp_clock_start(dec->clocks[DEC_PRS_TOTAL]);
+    {
+        AutoMutex autolock(parser->mutex());
+        if (MPP_THREAD_RUNNING != parser->get_status())
+            goto PARSER_QUIT;
 
-    while (1) {
-        {
-            AutoMutex autolock(parser->mutex());
-            if (MPP_THREAD_RUNNING != parser->get_status())
-                break;
+        /*
+         * parser thread need to wait at cases below:
+         * 1. no task slot for output
+         * 2. no packet for parsing
+         * 3. info change on progress
+         * 3. no buffer on analyzing output task
+         */
+        if (check_task_wait(dec, task)) {
+            RK_S64 start = mpp_time();
 
-            /*
-             * parser thread need to wait at cases below:
-             * 1. no task slot for output
-             * 2. no packet for parsing
-             * 3. info change on progress
-             * 3. no buffer on analyzing output task
-             */
-            if (check_task_wait(dec, &task)) {
-                mpp_clock_start(dec->clocks[DEC_PRS_WAIT]);
-                parser->wait();
-                mpp_clock_pause(dec->clocks[DEC_PRS_WAIT]);
+            mpp_clock_start(dec->clocks[DEC_PRS_WAIT]);
+
+            // the job is triggered by signal and check the condition again
+            if (parser->pooled()) {
+                dec->parser_wait_start = start;
+                return THREAD_STEP_WAIT;
             }
-        }
 
-        if (dec->reset_flag) {
-            reset_parser_thread(mpp, &task);
+            parser->wait();
+            mpp_clock_pause(dec->clocks[DEC_PRS_WAIT]);
 
-            AutoMutex autolock(parser->mutex(THREAD_CONTROL));
-            dec->reset_flag = 0;
-            sem_post(&dec->parser_reset);
-            continue;
+            mpp_hist_record(mpp->mLatency[MPP_LATENCY_CODEC_WAIT],
+                            mpp_time() - start);
         }
-
-        // NOTE: ignore return value here is to fast response to reset.
-        // Otherwise we can loop all dec task until it is failed.
-        mpp_clock_start(dec->clocks[DEC_PRS_PROC]);
-        try_proc_dec_task(mpp, &task);
-        mpp_clock_pause(dec->clocks[DEC_PRS_PROC]);
     }
 
-    mpp_clock_pause(dec->clocks[DEC_PRS_TOTAL]);
+    if (dec->reset_flag) {
+        reset_parser_thread(mpp, task);
 
-    mpp_dbg(MPP_DBG_INFO, "mpp_dec_parser_thread is going to exit\n");
-    if (task.hnd && task_dec->valid) {
-        mpp_buf_slot_set_flag(packet_slots, task_dec->input, SLOT_CODEC_READY);
-        mpp_buf_slot_set_flag(packet_slots, task_dec->input, SLOT_HAL_INPUT);
-        mpp_buf_slot_clr_flag(packet_slots, task_dec->input, SLOT_HAL_INPUT);
+        AutoMutex autolock(parser->mutex(THREAD_CONTROL));
+        dec->reset_flag = 0;
+        sem_post(&dec->parser_reset);
+        return THREAD_STEP_AGAIN;
     }
-    mpp_buffer_group_clear(mpp->mPacketGroup);
-    mpp_dbg(MPP_DBG_INFO, "mpp_dec_parser_thread exited\n");
-    return NULL;
+
+    // NOTE: ignore return value here is to fast response to reset.
+    // Otherwise we can loop all dec task until it is failed.
+    mpp_clock_start(dec->clocks[DEC_PRS_PROC]);
+    try_proc_dec_task(mpp, task);
+    mpp_clock_pause(dec->clocks[DEC_PRS_PROC]);
+
+    return THREAD_STEP_AGAIN;
+
+PARSER_QUIT:
+    mpp_dec_parser_quit(mpp, task);
+    return THREAD_STEP_DONE;
 }
 
-void *mpp_dec_hal_thread(void *data)
+/* One loop of hal thread, refer to mpp_dec_parser_step */
+static MppThreadStep mpp_dec_hal_step(void *data)
 {
     Mpp *mpp = (Mpp*)data;
     MppDecImpl *dec = (MppDecImpl *)mpp->mDec;
@@ -905,128 +1014,155 @@ void *mpp_dec_hal_thread(void *data)
     HalTaskInfo task_info;
     HalDecTask  *task_dec = &task_info.dec;
 
-    mpp_clock_start(dec->clocks[DEC_HAL_TOTAL]);
+    mpp_dev_sched_bind(mpp->mHwSched);
 
-    while (1) {
-        /* hal thread wait for dxva interface intput first */
-        {
-            AutoMutex work_lock(hal->mutex());
-            if (MPP_THREAD_RUNNING != hal->get_status())
-                break;
+    if (dec->hal_wait_start) {
+        mpp_clock_pause(dec->clocks[DEC_HAL_WAIT]);
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_HAL_WAIT],
+                        mpp_time() - dec->hal_wait_start);
+        dec->hal_wait_start = 0;
+    }
 
-            if (hal_task_get_hnd(tasks, TASK_PROCESSING, &task)) {
-                // process all task then do reset process
-                if (dec->hal_reset_post != dec->hal_reset_done) {
-                    dec_dbg_reset("reset: hal reset start\n");
-                    reset_hal_thread(mpp);
-                    dec_dbg_reset("reset: hal reset done\n");
-                    dec->hal_reset_done++;
-                    sem_post(&dec->hal_reset);
-                    continue;
-                }
-
-                mpp_dec_notify(dec, MPP_DEC_NOTIFY_TASK_ALL_DONE);
-                mpp_clock_start(dec->clocks[DEC_HAL_WAIT]);
-                hal->wait();
-                mpp_clock_pause(dec->clocks[DEC_HAL_WAIT]);
-                continue;
+    /* hal thread wait for dxva interface intput first */
+    {
+        AutoMutex work_lock(hal->mutex());
+        if (MPP_THREAD_RUNNING != hal->get_status())
+            goto HAL_QUIT;
+
+        if (hal_task_get_hnd(tasks, TASK_PROCESSING, &task)) {
+            // process all task then do reset process
+            if (dec->hal_reset_post != dec->hal_reset_done) {
+                dec_dbg_reset("reset: hal reset start\n");
+                reset_hal_thread(mpp);
+                dec_dbg_reset("reset: hal reset done\n");
+                dec->hal_reset_done++;
+                sem_post(&dec->hal_reset);
+                return THREAD_STEP_AGAIN;
             }
-        }
 
-        if (task) {
-            RK_U32 notify_flag = MPP_DEC_NOTIFY_TASK_HND_VALID;
+            mpp_dec_notify(dec, MPP_DEC_NOTIFY_TASK_ALL_DONE);
 
-            mpp_clock_start(dec->clocks[DEC_HAL_PROC]);
-            mpp->mTaskGetCount++;
+            RK_S64 start = mpp_time();
 
-            hal_task_hnd_get_info(task, &task_info);
+            mpp_clock_start(dec->clocks[DEC_HAL_WAIT]);
 
-            /*
-             * check info change flag
-             * if this is a frame with that flag, only output an empty
-             * MppFrame without any image data for info change.
-             */
-            if (task_dec->flags.info_change) {
-                mpp_dec_flush(dec);
-                mpp_dec_push_display(mpp, task_dec->flags);
-                mpp_dec_put_frame(mpp, task_dec->output, task_dec->flags);
-
-                hal_task_hnd_set_status(task, TASK_IDLE);
-                task = NULL;
-                mpp_dec_notify(dec, notify_flag);
-                mpp_clock_pause(dec->clocks[DEC_HAL_PROC]);
-                continue;
-            }
-            /*
-             * check eos task
-             * if this task is invalid while eos flag is set, we will
-             * flush display queue then push the eos frame to info that
-             * all frames have decoded.
-             */
-            if (task_dec->flags.eos &&
-                (!task_dec->valid || task_dec->output < 0)) {
-                mpp_dec_push_display(mpp, task_dec->flags);
-                /*
-                 * Use -1 as invalid buffer slot index.
-                 * Reason: the last task maybe is a empty task with eos flag
-                 * only but this task may go through vproc process also. We need
-                 * create a buffer slot index for it.
-                 */
-                mpp_dec_put_frame(mpp, -1, task_dec->flags);
-
-                hal_task_hnd_set_status(task, TASK_IDLE);
-                task = NULL;
-                mpp_dec_notify(dec, notify_flag);
-                mpp_clock_pause(dec->clocks[DEC_HAL_PROC]);
-                continue;
+            if (hal->pooled()) {
+                dec->hal_wait_start = start;
+                return THREAD_STEP_WAIT;
             }
 
-            mpp_clock_start(dec->clocks[DEC_HW_WAIT]);
-            mpp_hal_hw_wait(dec->hal, &task_info);
-            mpp_clock_pause(dec->clocks[DEC_HW_WAIT]);
+            hal->wait();
+            mpp_clock_pause(dec->clocks[DEC_HAL_WAIT]);
 
-            /*
-             * when hardware decoding is done:
-             * 1. clear decoding flag (mark buffer is ready)
-             * 2. use get_display to get a new frame with buffer
-             * 3. add frame to output list
-             * repeat 2 and 3 until not frame can be output
-             */
-            mpp_buf_slot_clr_flag(packet_slots, task_dec->input,
-                                  SLOT_HAL_INPUT);
+            mpp_hist_record(mpp->mLatency[MPP_LATENCY_HAL_WAIT],
+                            mpp_time() - start);
+            return THREAD_STEP_AGAIN;
+        }
+    }
 
-            hal_task_hnd_set_status(task, (dec->parser_fast_mode) ?
-                                    (TASK_IDLE) : (TASK_PROC_DONE));
+    if (task) {
+        RK_U32 notify_flag = MPP_DEC_NOTIFY_TASK_HND_VALID;
 
-            if (dec->parser_fast_mode)
-                notify_flag |= MPP_DEC_NOTIFY_TASK_HND_VALID;
-            else
-                notify_flag |= MPP_DEC_NOTIFY_TASK_PREV_DONE;
+        mpp_clock_start(dec->clocks[DEC_HAL_PROC]);
+        mpp->mTaskGetCount++;
 
-            task = NULL;
+        hal_task_hnd_get_info(task, &task_info);
 
-            if (task_dec->output >= 0)
-                mpp_buf_slot_clr_flag(frame_slots, task_dec->output, SLOT_HAL_OUTPUT);
+        /*
+         * check info change flag
+         * if this is a frame with that flag, only output an empty
+         * MppFrame without any image data for info change.
+         */
+        if (task_dec->flags.info_change) {
+            mpp_dec_flush(dec);
+            mpp_dec_push_display(mpp, task_dec->flags);
+            mpp_dec_put_frame(mpp, task_dec->output, task_dec->flags);
 
-            for (RK_U32 i = 0; i < MPP_ARRAY_ELEMS(task_dec->refer); i++) {
-                RK_S32 index = task_dec->refer[i];
-                if (index >= 0)
-                    mpp_buf_slot_clr_flag(frame_slots, index, SLOT_HAL_INPUT);
-            }
-            if (task_dec->flags.eos)
-                mpp_dec_flush(dec);
+            hal_task_hnd_set_status(task, TASK_IDLE);
+            task = NULL;
+            mpp_dec_notify(dec, notify_flag);
+            mpp_clock_pause(dec->clocks[DEC_HAL_PROC]);
+            return THREAD_STEP_AGAIN;
+        }
+        /*
+         * check eos task
+         * if this task is invalid while eos flag is set, we will
+         * flush display queue then push the eos frame to info that
+         * all frames have decoded.
+         */
+        if (task_dec->flags.eos &&
+            (!task_dec->valid || task_dec->output < 0)) {
             mpp_dec_push_display(mpp, task_dec->flags);
+            /*
+             * Use -1 as invalid buffer slot index.
+             * Reason: the last task maybe is a empty task with eos flag
+             * only but this task may go through vproc process also. We need
+             * create a buffer slot index for it.
+             */
+            mpp_dec_put_frame(mpp, -1, task_dec->flags);
 
+            hal_task_hnd_set_status(task, TASK_IDLE);
+            task = NULL;
             mpp_dec_notify(dec, notify_flag);
             mpp_clock_pause(dec->clocks[DEC_HAL_PROC]);
+            return THREAD_STEP_AGAIN;
         }
+
+        mpp_clock_start(dec->clocks[DEC_HW_WAIT]);
+        // hardware wait blocks the worker on worker pool
+        mpp_worker_block_enter();
+        mpp_hal_hw_wait(dec->hal, &task_info);
+        mpp_worker_block_leave();
+        mpp_clock_pause(dec->clocks[DEC_HW_WAIT]);
+
+        if (task_dec->hw_start_time)
+            mpp_hist_record(mpp->mLatency[MPP_LATENCY_HW],
+                            mpp_time() - task_dec->hw_start_time);
+
+        /*
+         * when hardware decoding is done:
+         * 1. clear decoding flag (mark buffer is ready)
+         * 2. use get_display to get a new frame with buffer
+         * 3. add frame to output list
+         * repeat 2 and 3 until not frame can be output
+         */
+        mpp_buf_slot_clr_flag(packet_slots, task_dec->input,
+                              SLOT_HAL_INPUT);
+
+        hal_task_hnd_set_status(task, (dec->parser_fast_mode) ?
+                                (TASK_IDLE) : (TASK_PROC_DONE));
+
+        if (dec->parser_fast_mode)
+            notify_flag |= MPP_DEC_NOTIFY_TASK_HND_VALID;
+        else
+            notify_flag |= MPP_DEC_NOTIFY_TASK_PREV_DONE;
+
+        task = NULL;
+
+        if (task_dec->output >= 0)
+            mpp_buf_slot_clr_flag(frame_slots, task_dec->output, SLOT_HAL_OUTPUT);
+
+        for (RK_U32 i = 0; i < MPP_ARRAY_ELEMS(task_dec->refer); i++) {
+            RK_S32 index = task_dec->refer[i];
+            if (index >= 0)
+                mpp_buf_slot_clr_flag(frame_slots, index, SLOT_HAL_INPUT);
+        }
+        if (task_dec->flags.eos)
+            mpp_dec_flush(dec);
+        mpp_dec_push_display(mpp, task_dec->flags);
+
+        mpp_dec_notify(dec, notify_flag);
+        mpp_clock_pause(dec->clocks[DEC_HAL_PROC]);
     }
 
+    return THREAD_STEP_AGAIN;
+
+HAL_QUIT:
     mpp_clock_pause(dec->clocks[DEC_HAL_TOTAL]);
 
     mpp_assert(mpp->mTaskPutCount == mpp->mTaskGetCount);
     mpp_dbg(MPP_DBG_INFO, "mpp_dec_hal_thread exited\n");
-    return NULL;
+    return THREAD_STEP_DONE;
 }
 
 static MPP_RET dec_release_task_in_port(MppPort port)
@@ -1061,24 +1197,132 @@ static MPP_RET dec_release_task_in_port(MppPort port)
     return ret;
 }
 
-void *mpp_dec_advanced_thread(void *data)
+/*
+ * Decode one packet to the frame with buffer provided by user.
+ * Return the frame to be sent to output port.
+ */
+static MppFrame dec_advanced_decode(Mpp *mpp, DecTask *task, MppPacket packet,
+                                    MppFrame frame)
 {
-    Mpp *mpp = (Mpp*)data;
     MppDecImpl *dec = (MppDecImpl *)mpp->mDec;
     MppBufSlots frame_slots = dec->frame_slots;
     MppBufSlots packet_slots = dec->packet_slots;
+    HalDecTask *task_dec = &task->info.dec;
+    MPP_RET ret = MPP_OK;
+
+    if (mpp_packet_get_buffer(packet)) {
+        /*
+         * if there is available buffer in the input packet do decoding
+         */
+        MppBuffer input_buffer = mpp_packet_get_buffer(packet);
+        MppBuffer output_buffer = mpp_frame_get_buffer(frame);
+
+        mpp_parser_prepare(dec->parser, packet, task_dec);
+
+        /*
+         * We may find eos in prepare step and there will be no anymore vaild task generated.
+         * So here we try push eos task to hal, hal will push all frame to display then
+         * push a eos frame to tell all frame decoded
+         */
+        if (task_dec->flags.eos && !task_dec->valid) {
+            mpp_frame_set_eos(frame, 1);
+            goto DEC_OUT;
+        }
+
+        /*
+         *  look for a unused packet slot index
+         */
+        if (task_dec->input < 0) {
+            mpp_buf_slot_get_unused(packet_slots, &task_dec->input);
+        }
+        mpp_buf_slot_set_prop(packet_slots, task_dec->input, SLOT_BUFFER, input_buffer);
+        mpp_buf_slot_set_flag(packet_slots, task_dec->input, SLOT_CODEC_READY);
+        mpp_buf_slot_set_flag(packet_slots, task_dec->input, SLOT_HAL_INPUT);
+
+        ret = mpp_parser_parse(dec->parser, task_dec);
+        if (ret != MPP_OK) {
+            mpp_err_f("something wrong with mpp_parser_parse!\n");
+            mpp_frame_set_errinfo(frame, 1); /* 0 - OK; 1 - error */
+            mpp_buf_slot_clr_flag(packet_slots, task_dec->input,  SLOT_HAL_INPUT);
+            goto DEC_OUT;
+        }
+
+        if (mpp_buf_slot_is_changed(frame_slots)) {
+            size_t slot_size = mpp_buf_slot_get_size(frame_slots);
+            size_t buffer_size = mpp_buffer_get_size(output_buffer);
+
+            if (slot_size == buffer_size) {
+                mpp_buf_slot_ready(frame_slots);
+            }
+
+            if (slot_size > buffer_size) {
+                mpp_err_f("required buffer size %d is larger than input buffer size %d\n",
+                          slot_size, buffer_size);
+                mpp_assert(slot_size <= buffer_size);
+            }
+        }
+
+        mpp_buf_slot_set_prop(frame_slots, task_dec->output, SLOT_BUFFER, output_buffer);
+
+        // register genertation
+        mpp_hal_reg_gen(dec->hal, &task->info);
+        mpp_dev_sched_client_set_pts(mpp->mHwSched, mpp_packet_get_pts(packet));
+        mpp_hal_hw_start(dec->hal, &task->info);
+        mpp_hal_hw_wait(dec->hal, &task->info);
+
+        MppFrame tmp = NULL;
+        mpp_buf_slot_get_prop(frame_slots, task_dec->output, SLOT_FRAME_PTR, &tmp);
+        mpp_frame_set_width(frame, mpp_frame_get_width(tmp));
+        mpp_frame_set_height(frame, mpp_frame_get_height(tmp));
+        mpp_frame_set_hor_stride(frame, mpp_frame_get_hor_stride(tmp));
+        mpp_frame_set_ver_stride(frame, mpp_frame_get_ver_stride(tmp));
+        mpp_frame_set_pts(frame, mpp_frame_get_pts(tmp));
+        mpp_frame_set_fmt(frame, mpp_frame_get_fmt(tmp));
+        mpp_frame_set_errinfo(frame, mpp_frame_get_errinfo(tmp));
+
+        mpp_buf_slot_clr_flag(packet_slots, task_dec->input,  SLOT_HAL_INPUT);
+        mpp_buf_slot_clr_flag(frame_slots, task_dec->output, SLOT_HAL_OUTPUT);
+    } else {
+        /*
+         * else init a empty frame for output
+         */
+        mpp_log_f("line(%d): Error! Get no buffer from input packet\n", __LINE__);
+        mpp_frame_init(&frame);
+        mpp_frame_set_errinfo(frame, 1);
+    }
+
+DEC_OUT:
+    hal_task_info_init(&task->info, MPP_CTX_DEC);
+
+    return frame;
+}
+
+/*
+ * Advanced mode decoding thread
+ *
+ * All the input tasks ready on input port are taken in one batch. The
+ * packets are decoded in order and the input tasks are returned with one
+ * enqueue. Then the frames are sent to output port in batch too. So user who
+ * queues multiple tasks, for example by batch decoding api, will only be
+ * waken up once for each batch.
+ */
+void *mpp_dec_advanced_thread(void *data)
+{
+    Mpp *mpp = (Mpp*)data;
+    MppDecImpl *dec = (MppDecImpl *)mpp->mDec;
     MppThread *thd_dec  = dec->thread_parser;
     DecTask task;   /* decoder task */
-    DecTask *pTask = &task;
-    dec_task_init(pTask);
-    HalDecTask  *task_dec = &pTask->info.dec;
+    dec_task_init(&task);
 
     MppPort input  = mpp_task_queue_get_port(mpp->mInputTaskQueue,  MPP_PORT_OUTPUT);
     MppPort output = mpp_task_queue_get_port(mpp->mOutputTaskQueue, MPP_PORT_INPUT);
-    MppTask mpp_task = NULL;
-    MPP_RET ret = MPP_OK;
-    MppFrame frame = NULL;
-    MppPacket packet = NULL;
+    MppTask tasks[MPP_TASK_COUNT_MAX];
+    MppFrame frames[MPP_TASK_COUNT_MAX];
+    RK_S32 task_count;
+    RK_S32 frame_count;
+    RK_S32 i;
+
+    mpp_dev_sched_bind(mpp->mHwSched);
 
     while (1) {
         {
@@ -1090,140 +1334,57 @@ void *mpp_dec_advanced_thread(void *data)
                 thd_dec->wait();
         }
 
-        // 1. check task in
-        dec_dbg_detail("mpp_pkt_in_rdy %d\n", task.status.mpp_pkt_in_rdy);
-        if (!task.status.mpp_pkt_in_rdy) {
-            ret = mpp_port_poll(input, MPP_POLL_NON_BLOCK);
-            if (ret) {
-                task.wait.dec_pkt_in = 1;
-                continue;
-            }
-
-            dec_dbg_detail("poll ready\n");
-
-            task.status.mpp_pkt_in_rdy = 1;
-            task.wait.dec_pkt_in = 0;
-
-            ret = mpp_port_dequeue(input, &mpp_task);
-            mpp_assert(ret == MPP_OK);
-        }
-        dec_dbg_detail("task in ready\n");
-
-        mpp_assert(mpp_task);
-
-        mpp_task_meta_get_packet(mpp_task, KEY_INPUT_PACKET, &packet);
-        mpp_task_meta_get_frame (mpp_task, KEY_OUTPUT_FRAME,  &frame);
-
-        if (NULL == packet) {
-            mpp_port_enqueue(input, mpp_task);
-            task.status.mpp_pkt_in_rdy = 0;
+        // 1. take all ready input tasks
+        task_count = 0;
+        if (mpp_port_dequeue_n(input, tasks, MPP_TASK_COUNT_MAX, &task_count)) {
+            task.wait.dec_pkt_in = 1;
             continue;
         }
 
-        if (mpp_packet_get_buffer(packet)) {
-            /*
-             * if there is available buffer in the input packet do decoding
-             */
-            MppBuffer input_buffer = mpp_packet_get_buffer(packet);
-            MppBuffer output_buffer = mpp_frame_get_buffer(frame);
-
-            mpp_parser_prepare(dec->parser, packet, task_dec);
-
-            /*
-             * We may find eos in prepare step and there will be no anymore vaild task generated.
-             * So here we try push eos task to hal, hal will push all frame to display then
-             * push a eos frame to tell all frame decoded
-             */
-            if (task_dec->flags.eos && !task_dec->valid) {
-                mpp_frame_set_eos(frame, 1);
-                goto DEC_OUT;
-            }
-
-            /*
-             *  look for a unused packet slot index
-             */
-            if (task_dec->input < 0) {
-                mpp_buf_slot_get_unused(packet_slots, &task_dec->input);
-            }
-            mpp_buf_slot_set_prop(packet_slots, task_dec->input, SLOT_BUFFER, input_buffer);
-            mpp_buf_slot_set_flag(packet_slots, task_dec->input, SLOT_CODEC_READY);
-            mpp_buf_slot_set_flag(packet_slots, task_dec->input, SLOT_HAL_INPUT);
-
-            ret = mpp_parser_parse(dec->parser, task_dec);
-            if (ret != MPP_OK) {
-                mpp_err_f("something wrong with mpp_parser_parse!\n");
-                mpp_frame_set_errinfo(frame, 1); /* 0 - OK; 1 - error */
-                mpp_buf_slot_clr_flag(packet_slots, task_dec->input,  SLOT_HAL_INPUT);
-                goto DEC_OUT;
-            }
+        dec_dbg_detail("task in ready count %d\n", task_count);
+        task.wait.dec_pkt_in = 0;
 
-            if (mpp_buf_slot_is_changed(frame_slots)) {
-                size_t slot_size = mpp_buf_slot_get_size(frame_slots);
-                size_t buffer_size = mpp_buffer_get_size(output_buffer);
+        // 2. decode the packets in order
+        frame_count = 0;
+        for (i = 0; i < task_count; i++) {
+            MppPacket packet = NULL;
+            MppFrame frame = NULL;
 
-                if (slot_size == buffer_size) {
-                    mpp_buf_slot_ready(frame_slots);
-                }
+            mpp_task_meta_get_packet(tasks[i], KEY_INPUT_PACKET, &packet);
+            mpp_task_meta_get_frame (tasks[i], KEY_OUTPUT_FRAME,  &frame);
 
-                if (slot_size > buffer_size) {
-                    mpp_err_f("required buffer size %d is larger than input buffer size %d\n",
-                              slot_size, buffer_size);
-                    mpp_assert(slot_size <= buffer_size);
-                }
-            }
-
-            mpp_buf_slot_set_prop(frame_slots, task_dec->output, SLOT_BUFFER, output_buffer);
-
-            // register genertation
-            mpp_hal_reg_gen(dec->hal, &pTask->info);
-            mpp_hal_hw_start(dec->hal, &pTask->info);
-            mpp_hal_hw_wait(dec->hal, &pTask->info);
+            // task without packet has no output
+            if (NULL == packet)
+                continue;
 
-            MppFrame tmp = NULL;
-            mpp_buf_slot_get_prop(frame_slots, task_dec->output, SLOT_FRAME_PTR, &tmp);
-            mpp_frame_set_width(frame, mpp_frame_get_width(tmp));
-            mpp_frame_set_height(frame, mpp_frame_get_height(tmp));
-            mpp_frame_set_hor_stride(frame, mpp_frame_get_hor_stride(tmp));
-            mpp_frame_set_ver_stride(frame, mpp_frame_get_ver_stride(tmp));
-            mpp_frame_set_pts(frame, mpp_frame_get_pts(tmp));
-            mpp_frame_set_fmt(frame, mpp_frame_get_fmt(tmp));
-            mpp_frame_set_errinfo(frame, mpp_frame_get_errinfo(tmp));
+            frames[frame_count++] = dec_advanced_decode(mpp, &task, packet, frame);
 
-            mpp_buf_slot_clr_flag(packet_slots, task_dec->input,  SLOT_HAL_INPUT);
-            mpp_buf_slot_clr_flag(frame_slots, task_dec->output, SLOT_HAL_OUTPUT);
-        } else {
             /*
-             * else init a empty frame for output
+             * clear output packet then final user will release the mpp_frame
+             * they had input
              */
-            mpp_log_f("line(%d): Error! Get no buffer from input packet\n", __LINE__);
-            mpp_frame_init(&frame);
-            mpp_frame_set_errinfo(frame, 1);
+            mpp_task_meta_set_packet(tasks[i], KEY_INPUT_PACKET, packet);
         }
 
-        /*
-         * first clear output packet
-         * then enqueue task back to input port
-         * final user will release the mpp_frame they had input
-         */
-    DEC_OUT:
-        mpp_task_meta_set_packet(mpp_task, KEY_INPUT_PACKET, packet);
-        mpp_port_enqueue(input, mpp_task);
-        mpp_task = NULL;
+        // 3. return all input tasks to user
+        mpp_port_enqueue_n(input, tasks, task_count);
 
-        // send finished task to output port
-        mpp_port_poll(output, MPP_POLL_BLOCK);
-        mpp_port_dequeue(output, &mpp_task);
-        mpp_task_meta_set_frame(mpp_task, KEY_OUTPUT_FRAME, frame);
+        // 4. send finished frames to output port
+        i = 0;
+        while (i < frame_count) {
+            RK_S32 count = 0;
+            RK_S32 j;
 
-        // setup output task here
-        mpp_port_enqueue(output, mpp_task);
-        mpp_task = NULL;
-        packet = NULL;
-        frame = NULL;
+            mpp_port_poll(output, MPP_POLL_BLOCK);
+            if (mpp_port_dequeue_n(output, tasks, frame_count - i, &count))
+                continue;
 
-        hal_task_info_init(&pTask->info, MPP_CTX_DEC);
+            for (j = 0; j < count; j++)
+                mpp_task_meta_set_frame(tasks[j], KEY_OUTPUT_FRAME, frames[i + j]);
 
-        task.status.mpp_pkt_in_rdy = 0;
+            mpp_port_enqueue_n(output, tasks, count);
+            i += count;
+        }
     }
 
     // clear remain task in output port
@@ -1442,9 +1603,20 @@ MPP_RET mpp_dec_start(MppDec ctx)
     dec_dbg_func("%p in\n", dec);
 
     if (dec->coding != MPP_VIDEO_CodingMJPEG) {
-        dec->thread_parser = new MppThread(mpp_dec_parser_thread,
+        dec->parser_task = mpp_calloc(DecTask, 1);
+        if (NULL == dec->parser_task) {
+            mpp_err_f("failed to malloc parser task\n");
+            return MPP_ERR_MALLOC;
+        }
+
+        dec_task_init((DecTask *)dec->parser_task);
+        mpp_clock_start(dec->clocks[DEC_PRS_TOTAL]);
+        mpp_clock_start(dec->clocks[DEC_HAL_TOTAL]);
+
+        /* parser and hal run on worker pool when env mpp_worker_pool is set */
+        dec->thread_parser = new MppThread(mpp_dec_parser_step,
                                            dec->mpp, "mpp_dec_parser");
-        dec->thread_hal = new MppThread(mpp_dec_hal_thread,
+        dec->thread_hal = new MppThread(mpp_dec_hal_step,
                                         dec->mpp, "mpp_dec_hal");
 
         dec->thread_parser->start();
@@ -1466,6 +1638,8 @@ MPP_RET mpp_dec_stop(MppDec ctx)
 
     dec_dbg_func("%p in\n", dec);
 
+    dec->stop_flag = 1;
+
     if (dec->thread_parser)
         dec->thread_parser->stop();
 
@@ -1481,6 +1655,8 @@ MPP_RET mpp_dec_stop(MppDec ctx)
         dec->thread_hal = NULL;
     }
 
+    MPP_FREE(dec->parser_task);
+
     dec_dbg_func("%p out\n", dec);
     return ret;
 }
@@ -1579,7 +1755,20 @@ MPP_RET mpp_dec_control(MppDec ctx, MpiCmd cmd, void *param)
 
     } break;
     case MPP_DEC_SET_INFO_CHANGE_READY: {
+        Mpp *mpp = (Mpp *)dec->mpp;
+
         ret = mpp_buf_slot_ready(dec->frame_slots);
+
+        /* prepare internal frame buffer with new size before decoding */
+        if (mpp && mpp->mFrameGroup && !mpp->mExternalFrameGroup) {
+            size_t size = mpp_buf_slot_get_size(dec->frame_slots);
+            RK_U32 count = 0;
+
+            mpp_slots_get_prop(dec->frame_slots, SLOTS_COUNT, &count);
+            if (size && count)
+                mpp_buffer_group_prewarm((MppBufferGroupImpl *)mpp->mFrameGroup,
+                                         size, count);
+        }
     } break;
     case MPP_DEC_GET_VPUMEM_USED_COUNT: {
         RK_S32 *p = (RK_S32 *)param;
@@ -192,6 +192,7 @@ void *mpp_enc_control_thread(void *data)
     MppBuffer mv_info = NULL;
 
     memset(&task, 0, sizeof(task));
+    mpp_dev_sched_bind(mpp->mHwSched);
 
     while (1) {
         {
@@ -304,6 +305,7 @@ void *mpp_enc_control_thread(void *data)
                 goto TASK_END;
             }
             enc_dbg_detail("mpp_hal_hw_start hal %p task %p\n", hal, task_info);
+            mpp_dev_sched_client_set_pts(mpp->mHwSched, mpp_frame_get_pts(frame));
             ret = mpp_hal_hw_start(hal, task_info);
             if (ret) {
                 mpp_err("mpp %p hal_hw_start failed return %d", mpp, ret);
@@ -23,7 +23,9 @@
 #include "mpp_log.h"
 #include "mpp_mem.h"
 #include "mpp_info.h"
+#include "mpp_time.h"
 #include "mpp_common.h"
+#include "mpp_worker.h"
 
 #include "mpp_packet_impl.h"
 
@@ -73,10 +75,12 @@ typedef struct MppEncImpl_t {
     RK_S32              rc_cfg_updated;
     RcApiBrief          rc_brief;
     RcCtx               rc_ctx;
-    EncRcTask           rc_task;
 
     MppThread           *thread_enc;
+    void                *thread_ctx;
     void                *mpp;
+    /* frames in flight, larger than 1 for pipeline mode */
+    RK_S32              task_count;
 
     // internal status and protection
     Mutex               lock;
@@ -172,10 +176,44 @@ typedef struct EncTask_t {
     RK_S32          seq_idx;
     EncTaskStatus   status;
     EncTaskWait     wait;
-    EncFrmStatus    frm;
-    HalTaskInfo     info;
 } EncTask;
 
+/*
+ * Per frame encoding context
+ * Serial mode uses one. Pipeline mode uses two so that next frame can be
+ * prepared while the previous one is still in hardware.
+ */
+typedef struct EncFrmTask_t {
+    MppTask         task_in;
+    MppTask         task_out;
+    MppFrame        frame;
+    MppPacket       packet;
+
+    /* input enqueue time and hardware start time for latency statistics */
+    RK_S64          in_time;
+    RK_S64          hw_start_time;
+
+    EncRcTask       rc_task;
+    HalTaskInfo     info;
+} EncFrmTask;
+
+#define MPP_ENC_MAX_TASK_COUNT      2
+
+/*
+ * Encoder thread context kept across the steps on worker pool. The thread
+ * loop loads it on entry and saves it back on leaving for next step.
+ */
+typedef struct EncThreadCtx_t {
+    EncTask         task;
+    EncFrmTask      frm_tasks[MPP_ENC_MAX_TASK_COUNT];
+    /* curr - frame on preparing, prev - frame on hardware in pipeline mode */
+    EncFrmTask      *curr;
+    EncFrmTask      *prev;
+    RK_U32          pipeline;
+    /* wait start time for statistics */
+    RK_S64          wait_start;
+} EncThreadCtx;
+
 static RK_U8 uuid_version[16] = {
     0x3d, 0x07, 0x6d, 0x45, 0x73, 0x0f, 0x41, 0xa8,
     0xb1, 0xc4, 0x25, 0xd7, 0x97, 0x6b, 0xf1, 0xac,
@@ -771,41 +809,188 @@ static void set_rc_cfg(RcCfg *cfg, MppEncCfgSet *cfg_set)
     }
 }
 
-void *mpp_enc_thread(void *data)
+/*
+ * Waiting for the hardware blocks the worker when the encoder runs on the
+ * worker pool, so let the pool start a spare worker meanwhile.
+ */
+static MPP_RET mpp_enc_hw_wait(MppEncHal hal, HalEncTask *task)
+{
+    MPP_RET ret;
+
+    mpp_worker_block_enter();
+    ret = mpp_enc_hal_wait(hal, task);
+    mpp_worker_block_leave();
+
+    return ret;
+}
+
+static void enc_frm_task_done(EncFrmTask *ft)
+{
+    HalEncTask *hal_task = &ft->info.enc;
+    MppMeta meta = NULL;
+
+    /* setup output packet and meta data */
+    mpp_packet_set_length(ft->packet, hal_task->length);
+
+    meta = mpp_packet_get_meta(ft->packet);
+    if (hal_task->mv_info)
+        mpp_meta_set_buffer(meta, KEY_MOTION_INFO, hal_task->mv_info);
+
+    mpp_meta_set_s32(meta, KEY_OUTPUT_INTRA, ft->rc_task.frm.is_intra);
+}
+
+static void enc_frm_task_return(Mpp *mpp, EncFrmTask *ft, MppPort input,
+                                MppPort output)
+{
+    EncFrmStatus *frm = &ft->rc_task.frm;
+
+    /*
+     * First return output packet.
+     * Then enqueue task back to input port.
+     * Final user will release the mpp_frame they had input.
+     */
+    if (NULL == ft->packet)
+        mpp_packet_new(&ft->packet);
+
+    if (ft->frame && mpp_frame_get_eos(ft->frame))
+        mpp_packet_set_eos(ft->packet);
+    else
+        mpp_packet_clr_eos(ft->packet);
+
+    enc_dbg_detail("task %d enqueue packet pts %lld\n", frm->seq_idx,
+                   mpp_packet_get_pts(ft->packet));
+
+    mpp_task_meta_set_packet(ft->task_out, KEY_OUTPUT_PACKET, ft->packet);
+    mpp_port_enqueue(output, ft->task_out);
+
+    if (ft->frame && ft->in_time)
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_IN_OUT],
+                        mpp_time() - ft->in_time);
+
+    enc_dbg_detail("task %d enqueue frame pts %lld\n", frm->seq_idx,
+                   mpp_frame_get_pts(ft->frame));
+
+    mpp_task_meta_set_frame(ft->task_in, KEY_INPUT_FRAME, ft->frame);
+    mpp_port_enqueue(input, ft->task_in);
+
+    ft->task_in = NULL;
+    ft->task_out = NULL;
+    ft->packet = NULL;
+    ft->frame = NULL;
+    ft->in_time = 0;
+}
+
+/*
+ * Finish the frame on hardware in pipeline mode.
+ * The next frame has passed rc_frm_start so rate control feedback of this
+ * frame takes effect one frame later. rc_frm_end is still called in order.
+ */
+static void enc_frm_task_finish(MppEncImpl *enc, EncFrmTask *ft,
+                                MppPort input, MppPort output)
+{
+    HalEncTask *hal_task = &ft->info.enc;
+    EncRcTask *rc_task = &ft->rc_task;
+    EncFrmStatus *frm = &rc_task->frm;
+    MppEncHal hal = enc->enc_hal;
+    Mpp *mpp = (Mpp *)enc->mpp;
+    MPP_RET ret = MPP_OK;
+
+    enc_dbg_detail("task %d hal wait\n", frm->seq_idx);
+    RUN_ENC_HAL_FUNC(mpp_enc_hw_wait, hal, hal_task, mpp, ret);
+    mpp_hist_record(mpp->mLatency[MPP_LATENCY_HW], mpp_time() - ft->hw_start_time);
+
+    enc_dbg_detail("task %d rc hal end\n", frm->seq_idx);
+    RUN_ENC_RC_FUNC(rc_hal_end, enc->rc_ctx, rc_task, mpp, ret);
+
+    enc_dbg_detail("task %d hal ret task\n", frm->seq_idx);
+    RUN_ENC_HAL_FUNC(mpp_enc_hal_ret_task, hal, hal_task, mpp, ret);
+
+    enc_dbg_detail("task %d rc frame end\n", frm->seq_idx);
+    RUN_ENC_RC_FUNC(rc_frm_end, enc->rc_ctx, rc_task, mpp, ret);
+
+TASK_DONE:
+    frm->reencode = 0;
+    frm->reencode_times = 0;
+
+    enc_frm_task_done(ft);
+    enc_frm_task_return(mpp, ft, input, output);
+}
+
+/*
+ * Encoder thread loop
+ *
+ * With its own thread the loop runs until the thread is stopped. On worker
+ * pool it runs one loop for each step so other jobs can run in between and
+ * it returns on waiting instead of blocking the worker.
+ */
+static MppThreadStep mpp_enc_thread(void *data)
 {
     Mpp *mpp = (Mpp*)data;
     MppEncImpl *enc = (MppEncImpl *)mpp->mEnc;
+    EncThreadCtx *ctx = (EncThreadCtx *)enc->thread_ctx;
     EncImpl impl = enc->impl;
     MppEncHal hal = enc->enc_hal;
     MppThread *thd_enc  = enc->thread_enc;
     MppEncCfgSet *cfg = &enc->cfg;
     MppEncRcCfg *rc_cfg = &cfg->rc;
     MppEncPrepCfg *prep_cfg = &cfg->prep;
-    EncRcTask *rc_task = &enc->rc_task;
+    MppEncRefFrmUsrCfg *frm_cfg = &enc->frm_cfg;
+    EncTask task = ctx->task;
+    EncFrmTask *frm_tasks = ctx->frm_tasks;
+    EncFrmTask *curr = ctx->curr;
+    EncFrmTask *prev = ctx->prev;
+    EncRcTask *rc_task = &curr->rc_task;
     EncCpbStatus *cpb = &rc_task->cpb;
     EncFrmStatus *frm = &rc_task->frm;
-    MppEncRefFrmUsrCfg *frm_cfg = &enc->frm_cfg;
-    EncTask task;
-    HalTaskInfo *task_info = &task.info;
-    HalEncTask *hal_task = &task_info->enc;
+    HalEncTask *hal_task = &curr->info.enc;
     MppPort input  = mpp_task_queue_get_port(mpp->mInputTaskQueue,  MPP_PORT_OUTPUT);
     MppPort output = mpp_task_queue_get_port(mpp->mOutputTaskQueue, MPP_PORT_INPUT);
-    MppTask task_in = NULL;
-    MppTask task_out = NULL;
+    RK_U32 pipeline = ctx->pipeline;
     MPP_RET ret = MPP_OK;
     MppFrame frame = NULL;
     MppPacket packet = NULL;
+    RK_S64 time_start = 0;
+    RK_S64 time_end = 0;
+    MppThreadStep step = THREAD_STEP_AGAIN;
+    RK_U32 loops = 0;
+
+    mpp_dev_sched_bind(mpp->mHwSched);
 
-    memset(&task, 0, sizeof(task));
+    if (ctx->wait_start) {
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_CODEC_WAIT],
+                        mpp_time() - ctx->wait_start);
+        ctx->wait_start = 0;
+    }
 
     while (1) {
+        if (thd_enc->pooled() && loops++)
+            goto ENC_STEP_DONE;
+
         {
             AutoMutex autolock(thd_enc->mutex());
             if (MPP_THREAD_RUNNING != thd_enc->get_status())
                 break;
 
-            if (check_enc_task_wait(enc, &task))
+            if (check_enc_task_wait(enc, &task)) {
+                RK_S64 start = mpp_time();
+
+                // the job is triggered by signal and check the condition again
+                if (thd_enc->pooled()) {
+                    ctx->wait_start = start;
+                    step = THREAD_STEP_WAIT;
+                    goto ENC_STEP_DONE;
+                }
+
                 thd_enc->wait();
+                mpp_hist_record(mpp->mLatency[MPP_LATENCY_CODEC_WAIT],
+                                mpp_time() - start);
+            }
+        }
+
+        // 0. finish the frame on hardware before control and reset
+        if (prev && (enc->cmd_send != enc->cmd_recv || enc->reset_flag)) {
+            enc_frm_task_finish(enc, prev, input, output);
+            prev = NULL;
         }
 
         // 1. process user control
@@ -857,12 +1042,23 @@ void *mpp_enc_thread(void *data)
             enc->rc_cfg_length = 0;
             update_rc_cfg_log(enc, "%s:", brief->name);
             enc->rc_cfg_pos = enc->rc_cfg_length;
+
+            /* one frame delayed rc feedback is only verified on default rc */
+            pipeline = (enc->task_count > 1) && brief->name &&
+                       !strcmp(brief->name, "default");
         }
 
         // 4. check input task
         if (!task.status.task_in_rdy) {
             ret = mpp_port_poll(input, MPP_POLL_NON_BLOCK);
             if (ret) {
+                // no more input then finish the frame on hardware first
+                if (prev) {
+                    enc_frm_task_finish(enc, prev, input, output);
+                    prev = NULL;
+                    continue;
+                }
+
                 task.wait.enc_frm_in = 1;
                 continue;
             }
@@ -876,6 +1072,12 @@ void *mpp_enc_thread(void *data)
         if (!task.status.task_out_rdy) {
             ret = mpp_port_poll(output, MPP_POLL_NON_BLOCK);
             if (ret) {
+                if (prev) {
+                    enc_frm_task_finish(enc, prev, input, output);
+                    prev = NULL;
+                    continue;
+                }
+
                 task.wait.enc_pkt_out = 1;
                 continue;
             }
@@ -886,18 +1088,23 @@ void *mpp_enc_thread(void *data)
         }
 
         // get tasks from both input and output
-        ret = mpp_port_dequeue(input, &task_in);
-        mpp_assert(task_in);
+        ret = mpp_port_dequeue(input, &curr->task_in);
+        mpp_assert(curr->task_in);
+
+        ret = mpp_port_dequeue(output, &curr->task_out);
+        mpp_assert(curr->task_out);
 
-        ret = mpp_port_dequeue(output, &task_out);
-        mpp_assert(task_out);
+        curr->in_time = ((MppTaskImpl *)curr->task_in)->enqueue_time;
+        time_start = mpp_time();
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_INPUT_WAIT],
+                        time_start - curr->in_time);
 
         /*
          * frame will be return to input.
          * packet will be sent to output.
          */
-        mpp_task_meta_get_frame (task_in, KEY_INPUT_FRAME,  &frame);
-        mpp_task_meta_get_packet(task_in, KEY_OUTPUT_PACKET, &packet);
+        mpp_task_meta_get_frame (curr->task_in, KEY_INPUT_FRAME,  &frame);
+        mpp_task_meta_get_packet(curr->task_in, KEY_OUTPUT_PACKET, &packet);
 
         enc_dbg_detail("task dequeue done frm %p pkt %p\n", frame, packet);
 
@@ -1016,7 +1223,7 @@ void *mpp_enc_thread(void *data)
         hal_task->packet = packet;
         hal_task->output = mpp_packet_get_buffer(packet);
         hal_task->length = mpp_packet_get_length(packet);
-        mpp_task_meta_get_buffer(task_in, KEY_MOTION_INFO, &hal_task->mv_info);
+        mpp_task_meta_get_buffer(curr->task_in, KEY_MOTION_INFO, &hal_task->mv_info);
 
         /* 14. check frm_meta data force key in input frame and start one frame */
         enc_dbg_detail("task %d enc start\n", frm->seq_idx);
@@ -1138,14 +1345,52 @@ void *mpp_enc_thread(void *data)
         enc_dbg_detail("task %d rc hal start\n", frm->seq_idx);
         RUN_ENC_RC_FUNC(rc_hal_start, enc->rc_ctx, rc_task, mpp, ret);
 
+        time_end = mpp_time();
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_PARSE], time_end - time_start);
+        time_start = time_end;
+
         enc_dbg_detail("task %d hal generate reg\n", frm->seq_idx);
         RUN_ENC_HAL_FUNC(mpp_enc_hal_gen_regs, hal, hal_task, mpp, ret);
 
+        curr->hw_start_time = mpp_time();
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_GEN_REGS],
+                        curr->hw_start_time - time_start);
+
         enc_dbg_detail("task %d hal start\n", frm->seq_idx);
+        mpp_dev_sched_client_set_pts(mpp->mHwSched, mpp_frame_get_pts(frame));
         RUN_ENC_HAL_FUNC(mpp_enc_hal_start, hal, hal_task, mpp, ret);
 
+        /*
+         * 18. pipeline mode: finish previous frame while current frame is on
+         * hardware then switch to the other context for next frame.
+         * Reencode is not available in this mode.
+         */
+        if (pipeline) {
+            if (prev)
+                enc_frm_task_finish(enc, prev, input, output);
+
+            curr->frame = frame;
+            curr->packet = packet;
+            prev = curr;
+            curr = (curr == &frm_tasks[0]) ? &frm_tasks[1] : &frm_tasks[0];
+
+            rc_task = &curr->rc_task;
+            cpb = &rc_task->cpb;
+            frm = &rc_task->frm;
+            hal_task = &curr->info.enc;
+            packet = NULL;
+            frame = NULL;
+
+            task.status.val = 0;
+            enc->hdr_status.val = 0;
+            enc->hdr_status.ready = 1;
+            continue;
+        }
+
         enc_dbg_detail("task %d hal wait\n", frm->seq_idx);
-        RUN_ENC_HAL_FUNC(mpp_enc_hal_wait,  hal, hal_task, mpp, ret);
+        RUN_ENC_HAL_FUNC(mpp_enc_hw_wait, hal, hal_task, mpp, ret);
+        mpp_hist_record(mpp->mLatency[MPP_LATENCY_HW],
+                        mpp_time() - curr->hw_start_time);
 
         enc_dbg_detail("task %d rc hal end\n", frm->seq_idx);
         RUN_ENC_RC_FUNC(rc_hal_end, enc->rc_ctx, rc_task, mpp, ret);
@@ -1165,50 +1410,27 @@ void *mpp_enc_thread(void *data)
             hal_task->length -= hal_task->hw_length;
             hal_task->hw_length = 0;
             frm->reencode_times++;
+            time_start = mpp_time();
             goto TASK_REENCODE;
         } else {
             frm->reencode = 0;
             frm->reencode_times = 0;
         }
     TASK_DONE:
-        /* setup output packet and meta data */
-        mpp_packet_set_length(packet, hal_task->length);
-
-        {
-            MppMeta meta = mpp_packet_get_meta(packet);
-
-            if (hal_task->mv_info)
-                mpp_meta_set_buffer(meta, KEY_MOTION_INFO, hal_task->mv_info);
-
-            mpp_meta_set_s32(meta, KEY_OUTPUT_INTRA, frm->is_intra);
-        }
+        curr->packet = packet;
+        enc_frm_task_done(curr);
 
     TASK_RETURN:
-        /*
-         * First return output packet.
-         * Then enqueue task back to input port.
-         * Final user will release the mpp_frame they had input.
-         */
-        if (NULL == packet)
-            mpp_packet_new(&packet);
-
-        if (frame && mpp_frame_get_eos(frame))
-            mpp_packet_set_eos(packet);
-        else
-            mpp_packet_clr_eos(packet);
-
-        enc_dbg_detail("task %d enqueue packet pts %lld\n", frm->seq_idx, mpp_packet_get_pts(packet));
-
-        mpp_task_meta_set_packet(task_out, KEY_OUTPUT_PACKET, packet);
-        mpp_port_enqueue(output, task_out);
-
-        enc_dbg_detail("task %d enqueue frame pts %lld\n", frm->seq_idx, mpp_frame_get_pts(frame));
+        // keep output order when there is frame on hardware
+        if (prev) {
+            enc_frm_task_finish(enc, prev, input, output);
+            prev = NULL;
+        }
 
-        mpp_task_meta_set_frame(task_in, KEY_INPUT_FRAME, frame);
-        mpp_port_enqueue(input, task_in);
+        curr->frame = frame;
+        curr->packet = packet;
+        enc_frm_task_return(mpp, curr, input, output);
 
-        task_in = NULL;
-        task_out = NULL;
         packet = NULL;
         frame = NULL;
 
@@ -1217,11 +1439,22 @@ void *mpp_enc_thread(void *data)
         enc->hdr_status.ready = 1;
     }
 
+    if (prev)
+        enc_frm_task_finish(enc, prev, input, output);
+
     // clear remain task in output port
     release_task_in_port(input);
     release_task_in_port(mpp->mOutputPort);
 
-    return NULL;
+    return THREAD_STEP_DONE;
+
+ENC_STEP_DONE:
+    ctx->task = task;
+    ctx->curr = curr;
+    ctx->prev = prev;
+    ctx->pipeline = pipeline;
+
+    return step;
 }
 
 MPP_RET mpp_enc_init_v2(MppEnc *enc, MppEncInitCfg *cfg)
@@ -1262,6 +1495,7 @@ MPP_RET mpp_enc_init_v2(MppEnc *enc, MppEncInitCfg *cfg)
     enc_hal_cfg.cfg = &p->cfg;
     enc_hal_cfg.work_mode = HAL_MODE_LIBVPU;
     enc_hal_cfg.device_id = DEV_VEPU;
+    enc_hal_cfg.task_count = MPP_CLIP3(1, MPP_ENC_MAX_TASK_COUNT, cfg->task_count);
 
     ctrl_cfg.coding = coding;
     ctrl_cfg.dev_id = DEV_VEPU;
@@ -1288,6 +1522,7 @@ MPP_RET mpp_enc_init_v2(MppEnc *enc, MppEncInitCfg *cfg)
     p->coding   = coding;
     p->impl     = impl;
     p->enc_hal  = enc_hal;
+    p->task_count = enc_hal_cfg.task_count;
     p->mpp      = cfg->mpp;
     p->sei_mode = MPP_ENC_SEI_MODE_ONE_SEQ;
     p->version_info = get_mpp_version();
@@ -1374,9 +1609,20 @@ MPP_RET mpp_enc_deinit_v2(MppEnc ctx)
 MPP_RET mpp_enc_start_v2(MppEnc ctx)
 {
     MppEncImpl *enc = (MppEncImpl *)ctx;
+    EncThreadCtx *thd_ctx = NULL;
 
     enc_dbg_func("%p in\n", enc);
 
+    thd_ctx = mpp_calloc(EncThreadCtx, 1);
+    if (NULL == thd_ctx) {
+        mpp_err_f("failed to malloc thread context\n");
+        return MPP_ERR_MALLOC;
+    }
+
+    thd_ctx->curr = &thd_ctx->frm_tasks[0];
+    enc->thread_ctx = thd_ctx;
+
+    /* runs on worker pool when env mpp_worker_pool is set */
     enc->thread_enc = new MppThread(mpp_enc_thread,
                                     enc->mpp, "mpp_enc");
     enc->thread_enc->start();
@@ -1399,6 +1645,8 @@ MPP_RET mpp_enc_stop_v2(MppEnc ctx)
         enc->thread_enc = NULL;
     }
 
+    MPP_FREE(enc->thread_ctx);
+
     enc_dbg_func("%p out\n", enc);
     return ret;
 
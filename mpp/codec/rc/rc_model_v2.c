@@ -1052,12 +1052,21 @@ MPP_RET rc_model_v2_end(void *ctx, EncRcTask *task)
     RcModelV2Ctx *p = (RcModelV2Ctx *)ctx;
     EncRcTaskInfo *cfg = (EncRcTaskInfo *)&task->info;
     EncFrmStatus *frm = &task->frm;
+    RK_U32 frame_type = p->frame_type;
 
     rc_dbg_func("enter ctx %p cfg %p\n", ctx, cfg);
 
     if (p->usr_cfg.mode == RC_FIXQP)
         goto DONE;
 
+    /*
+     * In encoder pipeline mode next frame may have been started.
+     * Update the model with the frame type of this task.
+     */
+    p->frame_type = (frm->is_intra) ? (INTRA_FRAME) : (INTER_P_FRAME);
+    if (frm->ref_mode == REF_TO_PREV_INTRA)
+        p->frame_type = INTER_VI_FRAME;
+
     if (!(task->force.force_flag & ENC_RC_FORCE_QP)) {
         if (check_re_enc(p, cfg)) {
             if (p->usr_cfg.mode == RC_CBR) {
@@ -1083,6 +1092,7 @@ MPP_RET rc_model_v2_end(void *ctx, EncRcTask *task)
 
     p->pre_target_bits = cfg->bit_target;
     p->pre_real_bits = cfg->bit_real;
+    p->frame_type = frame_type;
 
 DONE:
     rc_dbg_func("leave %p\n", ctx);
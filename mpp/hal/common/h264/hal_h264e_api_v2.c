@@ -80,6 +80,11 @@ static MPP_RET hal_h264e_init(void *hal, MppEncHalCfg *cfg)
         return ret;
 
     ret = api->init(hw_ctx, cfg);
+
+    /* only the hal with multiple register sets can run tasks in parallel */
+    if (!(api->flag & MPP_ENC_HAL_FLAG_MULTI_TASK))
+        cfg->task_count = 1;
+
     return ret;
 }
 
@@ -121,7 +126,7 @@ const MppEncHalApi hal_api_h264e_v2 = {
     .name       = "hal_h264e",
     .coding     = MPP_VIDEO_CodingAVC,
     .ctx_size   = sizeof(HalH264eCtx),
-    .flag       = 0,
+    .flag       = MPP_ENC_HAL_FLAG_MULTI_TASK,
     .init       = hal_h264e_init,
     .deinit     = hal_h264e_deinit,
     .get_task   = hal_h264e_get_task,
@@ -233,6 +233,7 @@ MPP_RET hal_task_info_init(HalTaskInfo *task, MppCtxType type)
         p->input_packet = NULL;
         p->output = -1;
         p->input = -1;
+        p->hw_start_time = 0;
         memset(&task->dec.syntax, 0, sizeof(task->dec.syntax));
         memset(task->dec.refer, -1, sizeof(task->dec.refer));
     } else {
@@ -91,6 +91,9 @@ typedef struct HalDecTask_t {
 
     // current task reference slot index, -1 for unused
     RK_S32          refer[MAX_DEC_REF_NUM];
+
+    // hardware start time for latency statistics
+    RK_S64          hw_start_time;
 } HalDecTask;
 
 #endif /* __HAL_DEC_TASK__ */
@@ -28,8 +28,17 @@ typedef struct MppEncHalCfg_t {
     // output for enc_impl
     HalWorkMode     work_mode;
     MppDeviceId     device_id;
+
+    /*
+     * input  - task count required by encoder
+     * output - task count hal can process in parallel, default 1
+     */
+    RK_S32          task_count;
 } MppEncHalCfg;
 
+/* hal can have multiple tasks in flight, refer to MppEncHalCfg task_count */
+#define MPP_ENC_HAL_FLAG_MULTI_TASK     (0x00000001)
+
 typedef struct MppEncHalApi_t {
     char            *name;
     MppCodingType   coding;
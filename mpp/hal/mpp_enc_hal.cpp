@@ -16,8 +16,10 @@
 
 #define  MODULE_TAG "mpp_enc_hal"
 
+#include "mpp_env.h"
 #include "mpp_mem.h"
 #include "mpp_log.h"
+#include "mpp_time.h"
 #include "mpp_common.h"
 
 #include "mpp.h"
@@ -44,6 +46,11 @@ static const MppEncHalApi *hw_enc_apis[] = {
 #endif
 };
 
+#define MPP_ENC_HAL_DBG_TIMING          (0x00000001)
+
+#define enc_hal_dbg(flag, fmt, ...)     _mpp_dbg(mpp_enc_hal_debug, flag, fmt, ## __VA_ARGS__)
+#define enc_hal_dbg_timing(fmt, ...)    enc_hal_dbg(MPP_ENC_HAL_DBG_TIMING, fmt, ## __VA_ARGS__)
+
 typedef struct MppEncHalImpl_t {
     MppCodingType       coding;
 
@@ -52,8 +59,13 @@ typedef struct MppEncHalImpl_t {
 
     HalTaskGroup        tasks;
     RK_S32              task_count;
+
+    /* cpu cost of register generation */
+    MppClock            clk_gen_regs;
 } MppEncHalImpl;
 
+static RK_U32 mpp_enc_hal_debug = 0;
+
 MPP_RET mpp_enc_hal_init(MppEncHal *ctx, MppEncHalCfg *cfg)
 {
     if (NULL == ctx || NULL == cfg) {
@@ -68,25 +80,41 @@ MPP_RET mpp_enc_hal_init(MppEncHal *ctx, MppEncHalCfg *cfg)
         return MPP_ERR_MALLOC;
     }
 
+    RK_S32 task_count = cfg->task_count;
     RK_U32 i;
+
+    mpp_env_get_u32("mpp_enc_hal_debug", &mpp_enc_hal_debug, 0);
+
     for (i = 0; i < MPP_ARRAY_ELEMS(hw_enc_apis); i++) {
         if (cfg->coding == hw_enc_apis[i]->coding) {
+            const MppEncHalApi *api = hw_enc_apis[i];
+
             p->coding       = cfg->coding;
-            p->api          = hw_enc_apis[i];
+            p->api          = api;
             p->ctx          = mpp_calloc_size(void, p->api->ctx_size);
 
             MPP_RET ret = p->api->init(p->ctx, cfg);
             if (ret) {
-                mpp_err_f("hal %s init failed ret %d\n", hw_enc_apis[i]->name, ret);
+                mpp_err_f("hal %s init failed ret %d\n", api->name, ret);
                 break;
             }
 
+            /* hal without multiple task support runs one task at a time */
+            if (!(api->flag & MPP_ENC_HAL_FLAG_MULTI_TASK))
+                cfg->task_count = 1;
+            else
+                cfg->task_count = MPP_CLIP3(1, MPP_MAX(task_count, 1), cfg->task_count);
+
             ret = hal_task_group_init(&p->tasks, p->task_count);
             if (ret) {
                 mpp_err_f("hal_task_group_init failed ret %d\n", ret);
                 break;
             }
 
+            p->clk_gen_regs = mpp_clock_get("gen_regs");
+            mpp_clock_enable(p->clk_gen_regs,
+                             (mpp_enc_hal_debug & MPP_ENC_HAL_DBG_TIMING) ? 1 : 0);
+
             *ctx = p;
             return MPP_OK;
         }
@@ -107,6 +135,13 @@ MPP_RET mpp_enc_hal_deinit(MppEncHal ctx)
     }
 
     MppEncHalImpl *p = (MppEncHalImpl*)ctx;
+    RK_S64 count = mpp_clock_get_count(p->clk_gen_regs);
+
+    if (count)
+        mpp_log("%s gen_regs %lld frames avg %lld us\n", p->api->name, count,
+                mpp_clock_get_sum(p->clk_gen_regs) / count);
+
+    mpp_clock_put(p->clk_gen_regs);
     p->api->deinit(p->ctx);
     mpp_free(p->ctx);
     if (p->tasks)
@@ -131,7 +166,27 @@ MPP_RET mpp_enc_hal_deinit(MppEncHal ctx)
     }
 
 MPP_ENC_HAL_TASK_FUNC(get_task)
-MPP_ENC_HAL_TASK_FUNC(gen_regs)
 MPP_ENC_HAL_TASK_FUNC(start)
 MPP_ENC_HAL_TASK_FUNC(wait)
 MPP_ENC_HAL_TASK_FUNC(ret_task)
+
+MPP_RET mpp_enc_hal_gen_regs(void *hal, HalEncTask *task)
+{
+    if (NULL == hal || NULL == task) {
+        mpp_err_f("found NULL input ctx %p task %p\n", hal, task);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    MppEncHalImpl *p = (MppEncHalImpl*)hal;
+    if (!p->api || !p->api->gen_regs)
+        return MPP_OK;
+
+    mpp_clock_start(p->clk_gen_regs);
+    MPP_RET ret = p->api->gen_regs(p->ctx, task);
+    RK_S64 time = mpp_clock_pause(p->clk_gen_regs);
+
+    enc_hal_dbg_timing("frame %lld gen_regs %lld us\n",
+                       mpp_clock_get_count(p->clk_gen_regs), time);
+
+    return ret;
+}
@@ -309,46 +309,104 @@ RK_S32 vepu541_get_roi_buf_size(RK_S32 w, RK_S32 h)
     return buf_size;
 }
 
-MPP_RET vepu541_set_roi(void *buf, MppEncROICfg *roi, RK_S32 w, RK_S32 h)
+typedef struct Vepu541RoiRect_t {
+    RK_S32          x0;
+    RK_S32          y0;
+    RK_S32          x1;
+    RK_S32          y1;
+} Vepu541RoiRect;
+
+static RK_U16 vepu541_roi_value(MppEncROIRegion *region)
 {
-    MppEncROIRegion *region = roi->regions;
-    Vepu541RoiCfg *ptr = (Vepu541RoiCfg *)buf;
-    RK_S32 mb_w = MPP_ALIGN(w, 16) / 16;
-    RK_S32 mb_h = MPP_ALIGN(h, 16) / 16;
-    RK_S32 stride_h = MPP_ALIGN(mb_w, 4);
-    RK_S32 stride_v = MPP_ALIGN(mb_h, 4);
     Vepu541RoiCfg cfg;
-    MPP_RET ret = MPP_NOK;
-    RK_S32 i;
-
-    if (NULL == buf || NULL == roi) {
-        mpp_err_f("invalid buf %p roi %p\n", buf, roi);
-        goto DONE;
-    }
+    RK_U16 val;
 
-    cfg.force_intra = 0;
+    cfg.force_intra = region ? region->intra : 0;
     cfg.reserved    = 0;
-    cfg.qp_area_idx = 0;
+    cfg.qp_area_idx = region ? region->qp_area_idx : 0;
+    // NOTE: When roi is enabled the qp_area_en should be one.
     cfg.qp_area_en  = 1;
-    cfg.qp_adj      = 0;
-    cfg.qp_adj_mode = 0;
+    cfg.qp_adj      = region ? region->quality : 0;
+    cfg.qp_adj_mode = region ? region->abs_qp_en : 0;
 
-    /* step 1. reset all the config */
-    for (i = 0; i < stride_h * stride_v; i++, ptr++)
-        memcpy(ptr, &cfg, sizeof(cfg));
+    memcpy(&val, &cfg, sizeof(val));
+    return val;
+}
 
-    if (w <= 0 || h <= 0) {
-        mpp_err_f("invalid size [%d:%d]\n", w, h);
-        goto DONE;
+/* roi config is 16bit so four configs are filled in one 64bit store */
+static void vepu541_roi_fill(RK_U16 *dst, RK_U16 val, RK_S32 count)
+{
+    RK_U64 val64 = val * 0x0001000100010001ULL;
+
+    for (; count > 0 && ((intptr_t)dst & 7); count--)
+        *dst++ = val;
+
+    for (; count >= 4; count -= 4, dst += 4)
+        memcpy(dst, &val64, sizeof(val64));
+
+    for (; count > 0; count--)
+        *dst++ = val;
+}
+
+static void vepu541_roi_fill_rect(RK_U16 *buf, RK_S32 stride, Vepu541RoiRect *rect,
+                                  RK_U16 val)
+{
+    RK_U16 *dst = buf + rect->y0 * stride + rect->x0;
+    RK_S32 y;
+
+    for (y = rect->y0; y < rect->y1; y++, dst += stride)
+        vepu541_roi_fill(dst, val, rect->x1 - rect->x0);
+}
+
+static void vepu541_roi_get_rect(MppEncROIRegion *region, RK_S32 mb_w, RK_S32 mb_h,
+                                 Vepu541RoiRect *rect)
+{
+    rect->x0 = MPP_MIN((region->x + 15) / 16, mb_w);
+    rect->y0 = MPP_MIN((region->y + 15) / 16, mb_h);
+    rect->x1 = MPP_MIN(rect->x0 + (region->w + 15) / 16, mb_w);
+    rect->y1 = MPP_MIN(rect->y0 + (region->h + 15) / 16, mb_h);
+}
+
+static RK_S32 vepu541_roi_intersect(Vepu541RoiRect *dst, Vepu541RoiRect *a,
+                                    Vepu541RoiRect *b)
+{
+    dst->x0 = MPP_MAX(a->x0, b->x0);
+    dst->y0 = MPP_MAX(a->y0, b->y0);
+    dst->x1 = MPP_MIN(a->x1, b->x1);
+    dst->y1 = MPP_MIN(a->y1, b->y1);
+
+    return dst->x0 < dst->x1 && dst->y0 < dst->y1;
+}
+
+static MPP_RET vepu541_roi_check(MppEncROICfg *roi, MppEncROIQpMap *map,
+                                 RK_S32 w, RK_S32 h)
+{
+    MppEncROIRegion *region = NULL;
+    MPP_RET ret = MPP_OK;
+    RK_S32 i;
+
+    if (map) {
+        RK_S32 mb_w = MPP_ALIGN(w, 16) / 16;
+        RK_S32 mb_h = MPP_ALIGN(h, 16) / 16;
+
+        if (NULL == map->qp || map->width < mb_w || map->height < mb_h ||
+            map->stride < map->width) {
+            mpp_err_f("invalid qp map %p [%d:%d:%d] vs [%d:%d]\n", map->qp,
+                      map->width, map->height, map->stride, mb_w, mb_h);
+            return MPP_NOK;
+        }
     }
 
-    if (roi->number > VEPU541_MAX_ROI_NUM) {
-        mpp_err_f("invalid region number %d\n", buf, roi->number);
-        goto DONE;
+    if (NULL == roi || !roi->number)
+        return MPP_OK;
+
+    if (roi->number > VEPU541_MAX_ROI_NUM || NULL == roi->regions) {
+        mpp_err_f("invalid region number %d regions %p\n", roi->number, roi->regions);
+        return MPP_NOK;
     }
 
     /* check region config */
-    ret = MPP_OK;
+    region = roi->regions;
     for (i = 0; i < (RK_S32)roi->number; i++, region++) {
         if (region->x + region->w > w || region->y + region->h > h)
             ret = MPP_NOK;
@@ -369,47 +427,159 @@ MPP_RET vepu541_set_roi(void *buf, MppEncROICfg *roi, RK_S32 w, RK_S32 h)
                       region->intra, region->qp_area_idx);
             mpp_err_f("abs qp mode %d value %d\n",
                       region->abs_qp_en, region->quality);
-            goto DONE;
+            break;
         }
     }
 
-    region = roi->regions;
-    /* step 2. setup region for top to bottom */
-    for (i = 0; i < (RK_S32)roi->number; i++, region++) {
-        RK_S32 roi_width  = (region->w + 15) / 16;
-        RK_S32 roi_height = (region->h + 15) / 16;
-        RK_S32 pos_x_init = (region->x + 15) / 16;
-        RK_S32 pos_y_init = (region->y + 15) / 16;
-        RK_S32 pos_x_end  = pos_x_init + roi_width;
-        RK_S32 pos_y_end  = pos_y_init + roi_height;
-        RK_S32 x, y;
-
-        mpp_assert(pos_x_init >= 0 && pos_x_init < mb_w);
-        mpp_assert(pos_x_end  >= 0 && pos_x_end <= mb_w);
-        mpp_assert(pos_y_init >= 0 && pos_y_init < mb_h);
-        mpp_assert(pos_y_end  >= 0 && pos_y_end <= mb_h);
-
-        cfg.force_intra = region->intra;
-        cfg.reserved    = 0;
-        cfg.qp_area_idx = region->qp_area_idx;
-        // NOTE: When roi is enabled the qp_area_en should be one.
-        cfg.qp_area_en  = 1; // region->area_map_en;
-        cfg.qp_adj      = region->quality;
-        cfg.qp_adj_mode = region->abs_qp_en;
-
-        ptr = (Vepu541RoiCfg *)buf;
-        ptr += pos_y_init * stride_h + pos_x_init;
-        for (y = 0; y < roi_height; y++) {
-            Vepu541RoiCfg *dst = ptr;
-
-            for (x = 0; x < roi_width; x++, dst++)
-                memcpy(dst, &cfg, sizeof(cfg));
-
-            ptr += stride_h;
+    return ret;
+}
+
+static void vepu541_roi_set_qp_map(RK_U16 *buf, MppEncROIQpMap *map, RK_S32 mb_w,
+                                   RK_S32 mb_h, RK_S32 stride_h, RK_S32 stride_v)
+{
+    RK_S32 qp_min = map->abs_qp_en ? 0 : -51;
+    RK_U16 val = vepu541_roi_value(NULL);
+    Vepu541RoiCfg cfg;
+    RK_S32 x, y;
+
+    memcpy(&cfg, &val, sizeof(cfg));
+    cfg.qp_adj_mode = map->abs_qp_en;
+
+    for (y = 0; y < mb_h; y++) {
+        RK_S8 *qp = map->qp + y * map->stride;
+        RK_U16 *dst = buf + y * stride_h;
+
+        for (x = 0; x < mb_w; x++) {
+            cfg.qp_adj = MPP_CLIP3(qp_min, 51, qp[x]);
+            memcpy(&dst[x], &cfg, sizeof(cfg));
         }
+
+        vepu541_roi_fill(dst + mb_w, val, stride_h - mb_w);
     }
 
-DONE:
+    vepu541_roi_fill(buf + mb_h * stride_h, val, (stride_v - mb_h) * stride_h);
+}
+
+MPP_RET vepu541_set_roi(void *buf, MppEncROICfg *roi, RK_S32 w, RK_S32 h)
+{
+    Vepu541RoiCache cache;
+
+    if (NULL == buf || NULL == roi) {
+        mpp_err_f("invalid buf %p roi %p\n", buf, roi);
+        return MPP_NOK;
+    }
+
+    memset(&cache, 0, sizeof(cache));
+
+    return vepu541_update_roi(&cache, buf, roi, NULL, w, h);
+}
+
+MPP_RET vepu541_update_roi(Vepu541RoiCache *cache, void *buf, MppEncROICfg *roi,
+                           MppEncROIQpMap *map, RK_S32 w, RK_S32 h)
+{
+    RK_U16 *base = (RK_U16 *)buf;
+    RK_S32 mb_w = MPP_ALIGN(w, 16) / 16;
+    RK_S32 mb_h = MPP_ALIGN(h, 16) / 16;
+    RK_S32 stride_h = MPP_ALIGN(mb_w, 4);
+    RK_S32 stride_v = MPP_ALIGN(mb_h, 4);
+    RK_U16 def_val = vepu541_roi_value(NULL);
+    RK_U32 number = 0;
+    MPP_RET ret = MPP_OK;
+    RK_S32 i, j;
+
+    if (NULL == cache || NULL == buf) {
+        mpp_err_f("invalid cache %p buf %p\n", cache, buf);
+        return MPP_NOK;
+    }
+
+    cache->changed = 0;
+
+    if (w <= 0 || h <= 0) {
+        mpp_err_f("invalid size [%d:%d]\n", w, h);
+        return MPP_NOK;
+    }
+
+    ret = vepu541_roi_check(roi, map, w, h);
+    if (ret) {
+        /* invalid config falls back to default config on all blocks */
+        roi = NULL;
+        map = NULL;
+        cache->buf = NULL;
+    }
+
+    number = roi ? roi->number : 0;
+
+    if (map || cache->full || cache->buf != buf || cache->w != w || cache->h != h) {
+        /* step 1. reset all the config or setup qp map */
+        if (map)
+            vepu541_roi_set_qp_map(base, map, mb_w, mb_h, stride_h, stride_v);
+        else
+            vepu541_roi_fill(base, def_val, stride_h * stride_v);
+
+        /* step 2. setup region for top to bottom */
+        for (i = 0; i < (RK_S32)number; i++) {
+            MppEncROIRegion *region = &roi->regions[i];
+            Vepu541RoiRect rect;
+
+            vepu541_roi_get_rect(region, mb_w, mb_h, &rect);
+            vepu541_roi_fill_rect(base, stride_h, &rect, vepu541_roi_value(region));
+        }
+
+        cache->changed = 1;
+    } else {
+        Vepu541RoiRect dirty[VEPU541_MAX_ROI_NUM * 2];
+        RK_S32 dirty_cnt = 0;
+        RK_S32 count = MPP_MAX(number, cache->number);
+
+        /* collect the old and new area of changed regions */
+        for (i = 0; i < count; i++) {
+            MppEncROIRegion *prev = (i < (RK_S32)cache->number) ? &cache->regions[i] : NULL;
+            MppEncROIRegion *curr = (i < (RK_S32)number) ? &roi->regions[i] : NULL;
+
+            if (prev && curr && !memcmp(prev, curr, sizeof(*curr)))
+                continue;
+
+            if (prev)
+                vepu541_roi_get_rect(prev, mb_w, mb_h, &dirty[dirty_cnt++]);
+
+            if (curr) {
+                Vepu541RoiRect *rect = &dirty[dirty_cnt];
+
+                vepu541_roi_get_rect(curr, mb_w, mb_h, rect);
+                /* same position with only qp change */
+                if (!prev || memcmp(rect, rect - 1, sizeof(*rect)))
+                    dirty_cnt++;
+            }
+        }
+
+        /* rebuild the dirty area from default config and all regions */
+        for (i = 0; i < dirty_cnt; i++) {
+            Vepu541RoiRect *rect = &dirty[i];
+
+            vepu541_roi_fill_rect(base, stride_h, rect, def_val);
+
+            for (j = 0; j < (RK_S32)number; j++) {
+                MppEncROIRegion *region = &roi->regions[j];
+                Vepu541RoiRect area;
+                Vepu541RoiRect clip;
+
+                vepu541_roi_get_rect(region, mb_w, mb_h, &area);
+                if (vepu541_roi_intersect(&clip, &area, rect))
+                    vepu541_roi_fill_rect(base, stride_h, &clip, vepu541_roi_value(region));
+            }
+        }
+
+        cache->changed = dirty_cnt > 0;
+    }
+
+    cache->buf = buf;
+    cache->w = w;
+    cache->h = h;
+    cache->full = map ? 1 : 0;
+    cache->number = number;
+    if (number)
+        memcpy(cache->regions, roi->regions, sizeof(roi->regions[0]) * number);
+
     return ret;
 }
 
@@ -95,6 +95,24 @@ typedef struct Vepu541RoiCfg_t {
     RK_U16 qp_adj_mode  : 1;
 } Vepu541RoiCfg;
 
+/*
+ * Vepu541RoiCache
+ *
+ * Record of the last roi config written to a roi buffer. With the record
+ * only the blocks covered by the changed regions are rewritten on update.
+ */
+typedef struct Vepu541RoiCache_t {
+    void                *buf;
+    RK_S32              w;
+    RK_S32              h;
+    /* last update used qp map and the whole buffer need to be rebuilt */
+    RK_U32              full;
+    RK_U32              number;
+    MppEncROIRegion     regions[VEPU541_MAX_ROI_NUM];
+    /* set when the buffer is modified by last update */
+    RK_U32              changed;
+} Vepu541RoiCache;
+
 typedef struct Vepu541OsdPos_t {
     /* X coordinate/16 of OSD region's left-top point. */
     RK_U32  osd_lt_x                : 8;
@@ -144,9 +162,16 @@ MPP_RET vepu541_set_fmt(VepuFmtCfg *cfg, MppFrameFormat format);
  *
  * vepu541_set_roi
  * Setup roi config buffeer for image with mb count mb_w * mb_h
+ *
+ * vepu541_update_roi
+ * Update roi config buffer from the last config recorded in cache. The qp
+ * map is optional and ROI regions are applied on top of it. Zero cache is
+ * a valid cache which causes a full setup.
  */
 RK_S32  vepu541_get_roi_buf_size(RK_S32 w, RK_S32 h);
 MPP_RET vepu541_set_roi(void *buf, MppEncROICfg *roi, RK_S32 w, RK_S32 h);
+MPP_RET vepu541_update_roi(Vepu541RoiCache *cache, void *buf, MppEncROICfg *roi,
+                           MppEncROIQpMap *map, RK_S32 w, RK_S32 h);
 
 MPP_RET vepu541_set_osd(Vepu541OsdCfg *cfg);
 
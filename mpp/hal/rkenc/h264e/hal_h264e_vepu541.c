@@ -39,6 +39,9 @@
 #include "hal_h264e_vepu541_reg_l2.h"
 #include "vepu541_common.h"
 
+/* register read back is kept for each task in flight on pipeline mode */
+#define H264E_VEPU541_TASK_MAX      2
+
 typedef struct HalH264eVepu541Ctx_t {
     MppEncCfgSet            *cfg;
 
@@ -67,11 +70,13 @@ typedef struct HalH264eVepu541Ctx_t {
     /* syntax for output to enc_impl */
     EncRcTaskInfo           hal_rc_cfg;
 
-    /* roi */
+    /* roi buffer for each task in flight */
     MppEncROICfg            *roi_data;
+    MppEncROIQpMap          *roi_map;
     MppBufferGroup          roi_grp;
-    MppBuffer               roi_buf;
-    RK_S32                  roi_buf_size;
+    MppBuffer               roi_buf[H264E_VEPU541_TASK_MAX];
+    RK_S32                  roi_buf_size[H264E_VEPU541_TASK_MAX];
+    Vepu541RoiCache         roi_cache[H264E_VEPU541_TASK_MAX];
 
     /* osd */
     Vepu541OsdCfg           osd_cfg;
@@ -79,7 +84,20 @@ typedef struct HalH264eVepu541Ctx_t {
     /* register */
     Vepu541H264eRegSet      regs_set;
     Vepu541H264eRegL2Set    regs_l2_set;
-    Vepu541H264eRegRet      regs_ret;
+    Vepu541H264eRegRet      regs_ret[H264E_VEPU541_TASK_MAX];
+
+    /*
+     * tasks in flight
+     * task_start   - regs_ret index of next started task
+     * task_wait    - regs_ret index of next waited task
+     * task_cnt     - tasks started and not waited
+     * regs_done    - read back of the last waited task for ret_task
+     */
+    RK_S32                  task_count;
+    RK_S32                  task_start;
+    RK_S32                  task_wait;
+    RK_S32                  task_cnt;
+    Vepu541H264eRegRet      *regs_done;
 } HalH264eVepu541Ctx;
 
 static RK_U32 h264e_klut_weight_i[24] = {
@@ -106,6 +124,7 @@ static RK_U32 dump_l2_reg = 0;
 static MPP_RET hal_h264e_vepu541_deinit(void *hal)
 {
     HalH264eVepu541Ctx *p = (HalH264eVepu541Ctx *)hal;
+    RK_S32 i;
 
     hal_h264e_dbg_func("enter %p\n", p);
 
@@ -114,9 +133,11 @@ static MPP_RET hal_h264e_vepu541_deinit(void *hal)
         p->dev_ctx = NULL;
     }
 
-    if (p->roi_buf) {
-        mpp_buffer_put(p->roi_buf);
-        p->roi_buf = NULL;
+    for (i = 0; i < H264E_VEPU541_TASK_MAX; i++) {
+        if (p->roi_buf[i]) {
+            mpp_buffer_put(p->roi_buf[i]);
+            p->roi_buf[i] = NULL;
+        }
     }
 
     if (p->roi_grp) {
@@ -148,6 +169,9 @@ static MPP_RET hal_h264e_vepu541_init(void *hal, MppEncHalCfg *cfg)
     hal_h264e_dbg_func("enter %p\n", p);
 
     p->cfg = cfg->cfg;
+    p->task_count = MPP_CLIP3(1, H264E_VEPU541_TASK_MAX, cfg->task_count);
+    p->regs_done = &p->regs_ret[0];
+    cfg->task_count = p->task_count;
 
     ret = mpp_device_init(&p->dev_ctx, &dev_cfg);
     if (ret) {
@@ -272,6 +296,7 @@ static MPP_RET hal_h264e_vepu541_get_task(void *hal, HalEncTask *task)
         MppMeta meta = mpp_frame_get_meta(task->frame);
 
         mpp_meta_get_ptr(meta, KEY_ROI_DATA, (void **)&ctx->roi_data);
+        mpp_meta_get_ptr(meta, KEY_ROI_QP_MAP, (void **)&ctx->roi_map);
         mpp_meta_get_ptr(meta, KEY_OSD_DATA, (void **)&ctx->osd_cfg.osd_data);
     }
     hal_h264e_dbg_func("leave %p\n", hal);
@@ -827,45 +852,58 @@ static void setup_vepu541_io_buf(Vepu541H264eRegSet *regs, RegExtraInfo *info,
     hal_h264e_dbg_func("leave\n");
 }
 
+static void hal_h264e_vepu541_poll(HalH264eVepu541Ctx *ctx)
+{
+    MppDevReqV1 req;
+
+    memset(&req, 0, sizeof(req));
+    req.cmd = MPP_CMD_POLL_HW_FINISH;
+    mpp_device_add_request(ctx->dev_ctx, &req);
+    mpp_device_send_request(ctx->dev_ctx);
+}
+
 static void setup_vepu541_roi(Vepu541H264eRegSet *regs, HalH264eVepu541Ctx *ctx)
 {
     MppEncROICfg *roi = ctx->roi_data;
+    MppEncROIQpMap *map = ctx->roi_map;
     RK_U32 w = ctx->sps->pic_width_in_mbs * 16;
     RK_U32 h = ctx->sps->pic_height_in_mbs * 16;
 
     hal_h264e_dbg_func("enter\n");
 
-    /* roi setup */
-    if (roi && roi->number && roi->regions) {
+    /*
+     * roi setup
+     * Each task in flight has its own roi buffer and cache so the buffer of
+     * the task running on hardware is never touched. The task of this slot
+     * has been waited before the slot is reused.
+     */
+    if ((roi && roi->number && roi->regions) || map) {
+        RK_S32 idx = ctx->task_start;
         RK_S32 roi_buf_size = vepu541_get_roi_buf_size(w, h);
 
-        if (!ctx->roi_buf || roi_buf_size != ctx->roi_buf_size) {
-            if (NULL == ctx->roi_grp)
-                mpp_buffer_group_get_internal(&ctx->roi_grp, MPP_BUFFER_TYPE_ION);
-            else if (roi_buf_size != ctx->roi_buf_size) {
-                if (ctx->roi_buf) {
-                    mpp_buffer_put(ctx->roi_buf);
-                    ctx->roi_buf = NULL;
-                }
-                mpp_buffer_group_clear(ctx->roi_grp);
-            }
+        if (NULL == ctx->roi_grp)
+            mpp_buffer_group_get_internal(&ctx->roi_grp, MPP_BUFFER_TYPE_ION);
 
-            mpp_assert(ctx->roi_grp);
+        mpp_assert(ctx->roi_grp);
 
-            if (NULL == ctx->roi_buf)
-                mpp_buffer_get(ctx->roi_grp, &ctx->roi_buf, roi_buf_size);
+        if (ctx->roi_buf[idx] && roi_buf_size != ctx->roi_buf_size[idx]) {
+            mpp_buffer_put(ctx->roi_buf[idx]);
+            ctx->roi_buf[idx] = NULL;
+        }
 
-            ctx->roi_buf_size = roi_buf_size;
+        if (NULL == ctx->roi_buf[idx]) {
+            mpp_buffer_get(ctx->roi_grp, &ctx->roi_buf[idx], roi_buf_size);
+            ctx->roi_buf_size[idx] = roi_buf_size;
         }
 
-        mpp_assert(ctx->roi_buf);
-        RK_S32 fd = mpp_buffer_get_fd(ctx->roi_buf);
-        void *buf = mpp_buffer_get_ptr(ctx->roi_buf);
+        mpp_assert(ctx->roi_buf[idx]);
+        RK_S32 fd = mpp_buffer_get_fd(ctx->roi_buf[idx]);
+        void *buf = mpp_buffer_get_ptr(ctx->roi_buf[idx]);
 
         regs->reg013.roi_enc = 1;
         regs->reg073.roi_addr = fd;
 
-        vepu541_set_roi(buf, roi, w, h);
+        vepu541_update_roi(&ctx->roi_cache[idx], buf, roi, map, w, h);
     } else {
         regs->reg013.roi_enc = 0;
         regs->reg073.roi_addr = 0;
@@ -1314,6 +1352,7 @@ static MPP_RET hal_h264e_vepu541_start(void *hal, HalEncTask *task)
 {
     MPP_RET ret = MPP_OK;
     HalH264eVepu541Ctx *ctx = (HalH264eVepu541Ctx *)hal;
+    Vepu541H264eRegRet *regs_ret = &ctx->regs_ret[ctx->task_start];
     MppDevReqV1 req;
 
     memset(&req, 0, sizeof(req));
@@ -1344,20 +1383,23 @@ static MPP_RET hal_h264e_vepu541_start(void *hal, HalEncTask *task)
     req.flag = 0;
     req.cmd = MPP_CMD_SET_REG_READ;
     req.size = sizeof(RK_U32);
-    req.data = &ctx->regs_ret.hw_status;
+    req.data = &regs_ret->hw_status;
     req.offset = VEPU541_REG_BASE_HW_STATUS;
     mpp_device_add_request(ctx->dev_ctx, &req);
 
     memset(&req, 0, sizeof(req));
     req.flag = 0;
     req.cmd = MPP_CMD_SET_REG_READ;
-    req.size = sizeof(ctx->regs_ret) - 4;
-    req.data = &ctx->regs_ret.st_bsl;
+    req.size = sizeof(*regs_ret) - 4;
+    req.data = &regs_ret->st_bsl;
     req.offset = VEPU541_REG_BASE_STATISTICS;
     mpp_device_add_request(ctx->dev_ctx, &req);
     /* send request to hardware */
     mpp_device_send_request(ctx->dev_ctx);
 
+    ctx->task_start = (ctx->task_start + 1) % ctx->task_count;
+    ctx->task_cnt++;
+
     hal_h264e_dbg_func("leave %p\n", hal);
 
     return ret;
@@ -1366,7 +1408,7 @@ static MPP_RET hal_h264e_vepu541_start(void *hal, HalEncTask *task)
 static MPP_RET hal_h264e_vepu541_status_check(void *hal)
 {
     HalH264eVepu541Ctx *ctx = (HalH264eVepu541Ctx *)hal;
-    Vepu541H264eRegRet *regs_ret = &ctx->regs_ret;
+    Vepu541H264eRegRet *regs_ret = ctx->regs_done;
 
     if (regs_ret->hw_status.lkt_done_sta)
         hal_h264e_dbg_detail("lkt_done finish");
@@ -1401,18 +1443,19 @@ static MPP_RET hal_h264e_vepu541_status_check(void *hal)
 static MPP_RET hal_h264e_vepu541_wait(void *hal, HalEncTask *task)
 {
     HalH264eVepu541Ctx *ctx = (HalH264eVepu541Ctx *)hal;
-    MppDevReqV1 req;
 
     hal_h264e_dbg_func("enter %p\n", hal);
 
-    memset(&req, 0, sizeof(req));
-    req.cmd = MPP_CMD_POLL_HW_FINISH;
-    mpp_device_add_request(ctx->dev_ctx, &req);
-    mpp_device_send_request(ctx->dev_ctx);
+    hal_h264e_vepu541_poll(ctx);
+
+    /* tasks finish in start order */
+    ctx->regs_done = &ctx->regs_ret[ctx->task_wait];
+    ctx->task_wait = (ctx->task_wait + 1) % ctx->task_count;
+    ctx->task_cnt--;
 
     hal_h264e_vepu541_status_check(hal);
 
-    task->hw_length += ctx->regs_ret.st_bsl.bs_lgth;
+    task->hw_length += ctx->regs_done->st_bsl.bs_lgth;
 
     hal_h264e_dbg_func("leave %p\n", hal);
 
@@ -1422,6 +1465,7 @@ static MPP_RET hal_h264e_vepu541_wait(void *hal, HalEncTask *task)
 static MPP_RET hal_h264e_vepu541_ret_task(void *hal, HalEncTask *task)
 {
     HalH264eVepu541Ctx *ctx = (HalH264eVepu541Ctx *)hal;
+    Vepu541H264eRegRet *regs_ret = ctx->regs_done;
     EncRcTaskInfo *rc_info = &task->rc_task->info;
     RK_U32 mb_w = ctx->sps->pic_width_in_mbs;
     RK_U32 mb_h = ctx->sps->pic_height_in_mbs;
@@ -1434,11 +1478,11 @@ static MPP_RET hal_h264e_vepu541_ret_task(void *hal, HalEncTask *task)
 
     // setup bit length for rate control
     rc_info->bit_real = task->hw_length * 8;
-    rc_info->quality_real = ctx->regs_ret.st_sse_qp.qp_sum / mbs;
-    rc_info->madi = (!ctx->regs_ret.st_mb_num) ? 0 :
-                    ctx->regs_ret.st_madi /  ctx->regs_ret.st_mb_num;
-    rc_info->madp = (!ctx->regs_ret.st_ctu_num) ? 0 :
-                    ctx->regs_ret.st_madi / ctx->regs_ret.st_ctu_num;
+    rc_info->quality_real = regs_ret->st_sse_qp.qp_sum / mbs;
+    rc_info->madi = (!regs_ret->st_mb_num) ? 0 :
+                    regs_ret->st_madi /  regs_ret->st_mb_num;
+    rc_info->madp = (!regs_ret->st_ctu_num) ? 0 :
+                    regs_ret->st_madi / regs_ret->st_ctu_num;
 
     ctx->hal_rc_cfg.bit_real = rc_info->bit_real;
     ctx->hal_rc_cfg.quality_real = rc_info->quality_real;
@@ -1455,7 +1499,7 @@ const MppEncHalApi hal_h264e_vepu541 = {
     .name       = "hal_h264e_vepu541",
     .coding     = MPP_VIDEO_CodingAVC,
     .ctx_size   = sizeof(HalH264eVepu541Ctx),
-    .flag       = 0,
+    .flag       = MPP_ENC_HAL_FLAG_MULTI_TASK,
     .init       = hal_h264e_vepu541_init,
     .deinit     = hal_h264e_vepu541_deinit,
     .get_task   = hal_h264e_vepu541_get_task,
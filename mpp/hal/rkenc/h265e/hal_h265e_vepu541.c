@@ -85,7 +85,9 @@ typedef struct H265eV541HalContext_t {
     RK_U32              frame_cnt;
     Vepu541OsdCfg       osd_cfg;
     MppEncROICfg        *roi_data;
+    MppEncROIQpMap      *roi_map;
     void                *roi_buf;
+    Vepu541RoiCache     roi_cache;
     MppEncCfgSet        *set;
     MppEncCfgSet        *cfg;
 
@@ -276,6 +278,7 @@ static MPP_RET h265e_rkv_allocate_buffers(H265eV541HalContext *ctx, H265eSyntax_
 
         vepu541_h265_free_buffers(ctx);
         MPP_FREE(ctx->roi_buf);
+        memset(&ctx->roi_cache, 0, sizeof(ctx->roi_cache));
         hal_bufs_deinit(ctx->dpb_bufs);
         hal_bufs_init(&ctx->dpb_bufs);
         fbc_header_len = MPP_ALIGN(((mb_wd64 * mb_h64) << 6), SZ_8K);
@@ -532,21 +535,24 @@ static MPP_RET
 vepu541_h265_set_roi_regs(H265eV541HalContext *ctx, H265eV541RegSet *regs)
 {
     MppEncROICfg *cfg = (MppEncROICfg*)ctx->roi_data;
+    MppEncROIQpMap *map = ctx->roi_map;
     h265e_v541_buffers *bufs = (h265e_v541_buffers *)ctx->buffers;
     RK_U32 h =  ctx->cfg->prep.height;
     RK_U32 w = ctx->cfg->prep.width;
     RK_U8 *roi_base;
 
-    if (!cfg) {
+    if (!cfg && !map) {
         return MPP_OK;
     }
 
-    if (cfg->number && cfg->regions) {
+    if ((cfg && cfg->number && cfg->regions) || map) {
         regs->enc_pic.roi_en = 1;
         regs->roi_addr_hevc = mpp_buffer_get_fd(bufs->hw_roi_buf[0]);
         roi_base = (RK_U8 *)mpp_buffer_get_ptr(bufs->hw_roi_buf[0]);
-        vepu541_set_roi(ctx->roi_buf, cfg, w, h);
-        vepu541_h265_set_roi(roi_base, ctx->roi_buf, w, h);
+        vepu541_update_roi(&ctx->roi_cache, ctx->roi_buf, cfg, map, w, h);
+        /* ctu order buffer is kept when raster roi config is not changed */
+        if (ctx->roi_cache.changed)
+            vepu541_h265_set_roi(roi_base, ctx->roi_buf, w, h);
     }
     return MPP_OK;
 }
@@ -1380,6 +1386,7 @@ MPP_RET hal_h265e_v541_get_task(void *hal, HalEncTask *task)
     if (!frm_status->reencode && mpp_frame_has_meta(task->frame)) {
         MppMeta meta = mpp_frame_get_meta(frame);
         mpp_meta_get_ptr(meta, KEY_ROI_DATA, (void **)&ctx->roi_data);
+        mpp_meta_get_ptr(meta, KEY_ROI_QP_MAP, (void **)&ctx->roi_map);
         mpp_meta_get_ptr(meta, KEY_OSD_DATA, (void **)&ctx->osd_cfg.osd_data);
     }
 
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_DEVICE_MOCK_H__
+#define __MPP_DEVICE_MOCK_H__
+
+#include "mpp_device.h"
+#include "mpp_device_msg.h"
+
+/*
+ * Software mock of the mpp_device backend
+ *
+ * When env mpp_device_mock is set mpp_device does not open any kernel device
+ * and all register transactions are handled in user space:
+ *
+ * mpp_device_mock_latency      - hardware latency in us from send to finish
+ * mpp_device_mock_status_reg   - register index written on finish
+ * mpp_device_mock_status_val   - register value written on finish
+ * mpp_device_mock_hw_id        - hardware id returned on init
+ * mpp_device_mock_replay       - register record file to replay on finish
+ *
+ * On finish the read back registers are the written registers, then replay
+ * record if any, then the status register.
+ */
+typedef void* MppDevMock;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+MPP_RET mpp_dev_mock_init(MppDevMock *ctx, MppDevCfg *cfg);
+MPP_RET mpp_dev_mock_deinit(MppDevMock ctx);
+
+/* same semantic as mpp_device_add_request / send_request on mpp_service */
+MPP_RET mpp_dev_mock_add_request(MppDevMock ctx, MppDevReqV1 *req);
+MPP_RET mpp_dev_mock_send_request(MppDevMock ctx);
+/* wait the first sent task to finish and fill its read back registers */
+MPP_RET mpp_dev_mock_poll(MppDevMock ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPP_DEVICE_MOCK_H__ */
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_DEVICE_RECORD_H__
+#define __MPP_DEVICE_RECORD_H__
+
+#include "rk_type.h"
+#include "mpp_err.h"
+
+/*
+ * Register trace captured on mpp_device boundary
+ *
+ * When env mpp_device_record is set with a file path all the register
+ * transaction on both hardware and mock device are saved to the file.
+ * Each device context writes its own file named <path>.<pid>.<index>.
+ * Each record is a MppDevRecordHdr followed by size bytes of data:
+ *
+ * WRITE    - register set written to hardware, offset is register offset
+ * READ     - register set read back from hardware after finish
+ * EXTRA    - RegPatchInfo array of address offset patches
+ * REG_ID   - extra register set sent by id, offset is the id
+ *
+ * The READ records of a task are written after the poll of that task. With
+ * pipelined tasks they come after the writes of the next task, still in the
+ * order the tasks are sent. Trace recorded on board can be replayed by mock
+ * device and two traces can be compared with mpp_reg_diff tool.
+ */
+#define MPP_DEV_RECORD_MAGIC    (0x4D445243)    /* MDRC */
+
+typedef void* MppDevRecord;
+
+typedef enum MppDevRecordType_e {
+    MPP_DEV_RECORD_WRITE,
+    MPP_DEV_RECORD_READ,
+    MPP_DEV_RECORD_EXTRA,
+    MPP_DEV_RECORD_REG_ID,
+    MPP_DEV_RECORD_BUTT,
+} MppDevRecordType;
+
+typedef struct MppDevRecordHdr_t {
+    RK_U32          magic;
+    RK_U32          type;
+    RK_U32          offset;
+    RK_U32          size;
+} MppDevRecordHdr;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+MPP_RET mpp_dev_record_open(MppDevRecord *ctx, const char *path, RK_U32 write);
+MPP_RET mpp_dev_record_close(MppDevRecord ctx);
+MPP_RET mpp_dev_record_write(MppDevRecord ctx, MppDevRecordType type,
+                             void *data, RK_U32 size, RK_U32 offset);
+/*
+ * read next record of the type and rewind on the end of file
+ * size is the buffer size on input and the read size on output
+ */
+MPP_RET mpp_dev_record_read(MppDevRecord ctx, MppDevRecordType type,
+                            void *data, RK_U32 *size, RK_U32 *offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPP_DEVICE_RECORD_H__ */
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_DEVICE_SCHED_H__
+#define __MPP_DEVICE_SCHED_H__
+
+#include "rk_type.h"
+#include "mpp_err.h"
+#include "rk_mpi_stat.h"
+
+/*
+ * Process wide hardware scheduler in front of mpp_device
+ *
+ * One scheduler is shared by all the mpp_device contexts opening the same
+ * device. Each device context has one session in the scheduler. A hardware
+ * job starts on register write and ends on poll done. Before the job is sent
+ * to kernel the session waits for a free slot in the scheduler and the next
+ * session to run is selected by:
+ *
+ * 1. realtime priority first
+ * 2. earliest deadline first for the job close to its deadline
+ * 3. least weighted virtual hardware time
+ *
+ * The scheduling attributes are from client which is owned by mpp context.
+ * The codec threads bind the client to itself and the device context used in
+ * these threads will take the attributes and account statistics to it.
+ *
+ * env mpp_dev_sched_depth:
+ * job count sent to kernel at the same time, default 0 disables the
+ * scheduler. Set it to 2 to keep hardware busy with one job in queue.
+ *
+ * env mpp_dev_sched_debug:
+ * bit 0 - show session statistics on close
+ * bit 1 - dispatch trace
+ */
+typedef void* MppDevSched;
+typedef void* MppDevSchedClient;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* client for mpp context */
+MPP_RET mpp_dev_sched_client_init(MppDevSchedClient *client);
+MPP_RET mpp_dev_sched_client_deinit(MppDevSchedClient client);
+MPP_RET mpp_dev_sched_client_set_cfg(MppDevSchedClient client, MppHwSchedCfg *cfg);
+MPP_RET mpp_dev_sched_client_get_stat(MppDevSchedClient client, MppHwSchedStat *stat);
+/* deadline hint for the next job of the client */
+void mpp_dev_sched_client_set_pts(MppDevSchedClient client, RK_S64 pts);
+/* bind client to the calling thread, NULL for unbind */
+void mpp_dev_sched_bind(MppDevSchedClient client);
+
+/* session for device context, NULL session is returned when disabled */
+MPP_RET mpp_dev_sched_open(MppDevSched *sched, const char *name);
+MPP_RET mpp_dev_sched_close(MppDevSched sched);
+/* wait for slot before sending job and release the slot after job done */
+MPP_RET mpp_dev_sched_acquire(MppDevSched sched);
+MPP_RET mpp_dev_sched_release(MppDevSched sched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPP_DEVICE_SCHED_H__ */
@@ -19,6 +19,7 @@
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -26,10 +27,14 @@
 #include "mpp_log.h"
 #include "mpp_mem.h"
 #include "mpp_time.h"
+#include "mpp_atomic.h"
 #include "mpp_common.h"
 
 #include "mpp_device.h"
 #include "mpp_device_msg.h"
+#include "mpp_device_mock.h"
+#include "mpp_device_record.h"
+#include "mpp_device_sched.h"
 #include "mpp_platform.h"
 
 #include "vpu.h"
@@ -65,6 +70,13 @@ typedef struct mppReqV1_t {
 } MppReqV1;
 
 #define MAX_TIME_RECORD                     4
+/* tasks sent and not polled yet with read back to record */
+#define MAX_RECORD_TASK                     4
+
+typedef struct MppDevRecordTask_t {
+    RK_S32 read_cnt;
+    MppDevReqV1 reads[MAX_REQ_NUM];
+} MppDevRecordTask;
 
 typedef struct MppDevCtxImpl_t {
     MppCtxType type;
@@ -89,6 +101,25 @@ typedef struct MppDevCtxImpl_t {
 
     RK_S32 req_cnt;
     MppReqV1 reqs[MAX_REQ_NUM];
+
+    /* software mock backend replacing the kernel device */
+    MppDevMock mock;
+
+    /*
+     * register trace and the read back requests to record after poll
+     * record_tasks is a fifo of the read back of each sent task. The task
+     * at record_wr collects the reads of the requests not sent yet.
+     */
+    MppDevRecord record;
+    MppDevRecordTask record_tasks[MAX_RECORD_TASK];
+    RK_S32 record_rd;
+    RK_S32 record_wr;
+    RK_U32 poll;
+
+    /* session in process wide scheduler and the job start / end pending */
+    MppDevSched sched;
+    RK_U32 sched_send;
+    RK_U32 sched_poll;
 } MppDevCtxImpl;
 
 #define MPP_DEVICE_DBG_FUNC                 (0x00000001)
@@ -115,6 +146,108 @@ typedef struct MppDevCtxImpl_t {
 #endif
 
 static RK_U32 mpp_device_debug = 0;
+/* context index in process for record file name */
+static RK_S32 mpp_device_ctx_idx = 0;
+
+static void mpp_device_record_req(MppDevCtxImpl *p, MppDevReqV1 *req)
+{
+    if (NULL == p->record)
+        return ;
+
+    switch (req->cmd) {
+    case MPP_CMD_SET_REG_WRITE : {
+        mpp_dev_record_write(p->record, MPP_DEV_RECORD_WRITE,
+                             req->data, req->size, req->offset);
+    } break;
+    case MPP_CMD_SET_REG_ADDR_OFFSET : {
+        mpp_dev_record_write(p->record, MPP_DEV_RECORD_EXTRA,
+                             req->data, req->size, req->offset);
+    } break;
+    case MPP_CMD_SET_REG_READ : {
+        MppDevRecordTask *task = &p->record_tasks[p->record_wr % MAX_RECORD_TASK];
+
+        if (task->read_cnt < MAX_REQ_NUM)
+            task->reads[task->read_cnt++] = *req;
+    } break;
+    case MPP_CMD_POLL_HW_FINISH : {
+        p->poll = 1;
+    } break;
+    default : {
+    } break;
+    }
+}
+
+static void mpp_device_record_task(MppDevCtxImpl *p)
+{
+    MppDevRecordTask *task = &p->record_tasks[p->record_rd % MAX_RECORD_TASK];
+    RK_S32 i;
+
+    for (i = 0; i < task->read_cnt; i++) {
+        MppDevReqV1 *req = &task->reads[i];
+
+        mpp_dev_record_write(p->record, MPP_DEV_RECORD_READ,
+                             req->data, req->size, req->offset);
+    }
+
+    task->read_cnt = 0;
+    p->record_rd++;
+}
+
+/*
+ * Called after each send. The reads of the sent requests are queued as one
+ * task and a poll records the reads of the oldest task only, as the read
+ * back registers of the later tasks are not valid before their own poll.
+ */
+static void mpp_device_record_poll(MppDevCtxImpl *p)
+{
+    if (NULL == p->record)
+        return ;
+
+    if (p->record_tasks[p->record_wr % MAX_RECORD_TASK].read_cnt) {
+        /* too many tasks in flight, keep the order and record the oldest */
+        if (p->record_wr - p->record_rd >= MAX_RECORD_TASK - 1) {
+            mpp_err_f("ctx %p too many tasks in flight to record\n", p);
+            mpp_device_record_task(p);
+        }
+
+        p->record_wr++;
+    }
+
+    if (p->poll && p->record_rd < p->record_wr)
+        mpp_device_record_task(p);
+
+    p->poll = 0;
+}
+
+/* register write starts a hardware job and poll finish ends it */
+static void mpp_device_sched_req(MppDevCtxImpl *p, MppDevReqV1 *req)
+{
+    if (req->cmd == MPP_CMD_SET_REG_WRITE)
+        p->sched_send = 1;
+    else if (req->cmd == MPP_CMD_POLL_HW_FINISH)
+        p->sched_poll = 1;
+}
+
+/* return 1 when a slot is taken for the job started by this send */
+static RK_U32 mpp_device_sched_start(MppDevCtxImpl *p)
+{
+    if (p->sched_send) {
+        mpp_dev_sched_acquire(p->sched);
+        p->sched_send = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+/* failed send gives back the slot it has taken */
+static void mpp_device_sched_done(MppDevCtxImpl *p, RK_U32 start, MPP_RET ret)
+{
+    if (p->sched_poll || (start && ret))
+        mpp_dev_sched_release(p->sched);
+
+    p->sched_poll = 0;
+}
 
 static RK_U32 mpp_probe_hw_support(RK_S32 dev)
 {
@@ -241,6 +374,8 @@ MPP_RET mpp_device_init(MppDevCtx *ctx, MppDevCfg *cfg)
 {
     RK_S32 dev = -1;
     const char *name = NULL;
+    const char *record = NULL;
+    RK_U32 mock = 0;
     MppDevCtxImpl *p;
 
     if (NULL == ctx || NULL == cfg) {
@@ -254,6 +389,7 @@ MPP_RET mpp_device_init(MppDevCtx *ctx, MppDevCfg *cfg)
     *ctx = NULL;
 
     mpp_env_get_u32("mpp_device_debug", &mpp_device_debug, 0);
+    mpp_env_get_u32("mpp_device_mock", &mock, 0);
 
     p = mpp_calloc(MppDevCtxImpl, 1);
     if (NULL == p) {
@@ -267,6 +403,28 @@ MPP_RET mpp_device_init(MppDevCtx *ctx, MppDevCfg *cfg)
     p->pp_enable = cfg->pp_enable;
     p->ioctl_version = mpp_get_ioctl_version();
 
+    mpp_env_get_str("mpp_device_record", &record, NULL);
+    if (record) {
+        char path[256];
+
+        /* one file per context to avoid truncating each other */
+        snprintf(path, sizeof(path), "%s.%d.%d", record, getpid(),
+                 MPP_FETCH_ADD(&mpp_device_ctx_idx, 1));
+        mpp_dev_record_open(&p->record, path, 1);
+    }
+
+    if (mock) {
+        /* mock accepts mpp_service requests without opening any device */
+        p->ioctl_version = IOCTL_MPP_SERVICE_V1;
+        p->vpu_fd = -1;
+        *ctx = p;
+
+        /* all mock contexts share one simulated hardware */
+        mpp_dev_sched_open(&p->sched, "mock");
+
+        return mpp_dev_mock_init(&p->mock, cfg);
+    }
+
     if (p->platform)
         name = mpp_get_platform_dev_name(p->type, p->coding, p->platform);
     else
@@ -294,6 +452,9 @@ MPP_RET mpp_device_init(MppDevCtx *ctx, MppDevCfg *cfg)
     } else
         mpp_err_f("failed to find device for coding %d type %d\n", p->coding, p->type);
 
+    if (dev > 0)
+        mpp_dev_sched_open(&p->sched, name);
+
     *ctx = p;
     p->vpu_fd = dev;
     if (p->ioctl_version > 0)
@@ -318,11 +479,15 @@ MPP_RET mpp_device_deinit(MppDevCtx ctx)
 
     p = (MppDevCtxImpl *)ctx;
 
-    if (p->vpu_fd > 0) {
+    if (p->mock) {
+        mpp_dev_mock_deinit(p->mock);
+    } else if (p->vpu_fd > 0) {
         close(p->vpu_fd);
     } else {
         mpp_err_f("invalid negtive file handle,\n");
     }
+    mpp_dev_sched_close(p->sched);
+    mpp_dev_record_close(p->record);
     mpp_free(p);
 
     mpp_dev_dbg_func("leave %p\n", ctx);
@@ -340,6 +505,13 @@ MPP_RET mpp_device_add_request(MppDevCtx ctx, MppDevReqV1 *req)
         return MPP_ERR_NULL_PTR;
     }
 
+    mpp_device_record_req(p, req);
+
+    if (p->mock) {
+        mpp_device_sched_req(p, req);
+        return mpp_dev_mock_add_request(p->mock, req);
+    }
+
     if (p->ioctl_version <= 0) {
         mpp_err_f("ctx %p can't add request without /dev/mpp_service\n", ctx);
         return MPP_ERR_PERM;
@@ -350,6 +522,8 @@ MPP_RET mpp_device_add_request(MppDevCtx ctx, MppDevReqV1 *req)
         return MPP_ERR_VALUE;
     }
 
+    mpp_device_sched_req(p, req);
+
     if (!p->req_cnt)
         memset(p->reqs, 0, sizeof(p->reqs));
 
@@ -381,6 +555,15 @@ MPP_RET mpp_device_send_request(MppDevCtx ctx)
         return MPP_ERR_NULL_PTR;
     }
 
+    if (p->mock) {
+        RK_U32 start = mpp_device_sched_start(p);
+        MPP_RET ret = mpp_dev_mock_send_request(p->mock);
+
+        mpp_device_record_poll(p);
+        mpp_device_sched_done(p, start, ret);
+        return ret;
+    }
+
     if (p->ioctl_version <= 0) {
         mpp_err_f("ctx %p can't add request without /dev/mpp_service\n", ctx);
         return MPP_ERR_PERM;
@@ -402,6 +585,7 @@ MPP_RET mpp_device_send_request(MppDevCtx ctx)
 
     mpp_dev_dbg_detail("enter %p cnt %d\n", ctx, p->req_cnt);
 
+    RK_U32 start = mpp_device_sched_start(p);
     MPP_RET ret = (RK_S32)ioctl(p->vpu_fd, MPP_IOC_CFG_V1, &p->reqs[0]);
     if (ret) {
         mpp_err_f("ioctl MPP_IOC_CFG_V1 failed ret %d errno %d %s\n",
@@ -409,6 +593,9 @@ MPP_RET mpp_device_send_request(MppDevCtx ctx)
         ret = errno;
     }
 
+    mpp_device_record_poll(p);
+    mpp_device_sched_done(p, start, ret);
+
     p->req_cnt = 0;
 
     mpp_dev_dbg_func("leave %p\n", ctx);
@@ -428,11 +615,31 @@ MPP_RET mpp_device_send_single_request(MppDevCtx ctx, MppDevReqV1 *req)
         return MPP_ERR_NULL_PTR;
     }
 
+    mpp_device_record_req(p, req);
+
+    if (p->mock) {
+        RK_U32 start;
+
+        mpp_device_sched_req(p, req);
+        start = mpp_device_sched_start(p);
+
+        ret = mpp_dev_mock_add_request(p->mock, req);
+        if (!ret)
+            ret = mpp_dev_mock_send_request(p->mock);
+
+        mpp_device_record_poll(p);
+        mpp_device_sched_done(p, start, ret);
+        return ret;
+    }
+
     if (p->ioctl_version <= 0) {
         mpp_err_f("ctx %p can't add request without /dev/mpp_service\n", ctx);
         return MPP_ERR_PERM;
     }
 
+    mpp_device_sched_req(p, req);
+    RK_U32 start = mpp_device_sched_start(p);
+
     ret = (RK_S32)ioctl(p->vpu_fd, MPP_IOC_CFG_V1, req);
     if (ret) {
         mpp_err_f("ioctl MPP_IOC_CFG_V1 failed ret %d errno %d %s\n",
@@ -440,6 +647,9 @@ MPP_RET mpp_device_send_single_request(MppDevCtx ctx, MppDevReqV1 *req)
         ret = errno;
     }
 
+    mpp_device_record_poll(p);
+    mpp_device_sched_done(p, start, ret);
+
     mpp_dev_dbg_func("leave %p\n", ctx);
     return ret;
 }
@@ -537,7 +747,14 @@ MPP_RET mpp_device_send_reg(MppDevCtx ctx, RK_U32 *regs, RK_U32 nregs)
 
         req.req     = regs;
         req.size    = nregs * sizeof(RK_U32);
+        mpp_dev_sched_acquire(p->sched);
         ret = (RK_S32)ioctl(p->vpu_fd, VPU_IOC_SET_REG, &req);
+        if (ret)
+            mpp_dev_sched_release(p->sched);
+
+        if (p->record)
+            mpp_dev_record_write(p->record, MPP_DEV_RECORD_WRITE,
+                                 regs, req.size, 0);
     }
 
     if (ret) {
@@ -577,6 +794,11 @@ MPP_RET mpp_device_wait_reg(MppDevCtx ctx, RK_U32 *regs, RK_U32 nregs)
         req.req     = regs;
         req.size    =  nregs * sizeof(RK_U32);
         ret = (RK_S32)ioctl(p->vpu_fd, VPU_IOC_GET_REG, &req);
+        mpp_dev_sched_release(p->sched);
+
+        if (p->record)
+            mpp_dev_record_write(p->record, MPP_DEV_RECORD_READ,
+                                 regs, req.size, 0);
     }
 
     if (mpp_device_debug & MPP_DEVICE_DBG_TIME) {
@@ -618,6 +840,13 @@ MPP_RET mpp_device_send_reg_with_id(MppDevCtx ctx, RK_S32 id, void *param,
 
     p = (MppDevCtxImpl *)ctx;
 
+    if (p->record)
+        mpp_dev_record_write(p->record, MPP_DEV_RECORD_REG_ID, param, size, id);
+
+    /* extra register set like scaling list has no effect on mock */
+    if (p->mock)
+        return MPP_OK;
+
     if (p->ioctl_version > 0) {
         mpp_err("not support now\n");
         return MPP_ERR_UNKNOW;
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_device_mock"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "mpp_env.h"
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_time.h"
+#include "mpp_common.h"
+
+#include "mpp_device_mock.h"
+#include "mpp_device_record.h"
+
+#define MOCK_REQ_MAX                        16
+#define MOCK_TASK_MAX                       4
+#define MOCK_STATUS_REG_NONE                (0xFFFFFFFF)
+
+#define MPP_DEV_MOCK_DBG_FUNC               (0x00000001)
+#define MPP_DEV_MOCK_DBG_TASK               (0x00000002)
+
+#define mock_dbg(flag, fmt, ...)            _mpp_dbg(mpp_dev_mock_debug, flag, fmt, ## __VA_ARGS__)
+#define mock_dbg_f(flag, fmt, ...)          _mpp_dbg_f(mpp_dev_mock_debug, flag, fmt, ## __VA_ARGS__)
+
+#define mock_dbg_func(fmt, ...)             mock_dbg_f(MPP_DEV_MOCK_DBG_FUNC, fmt, ## __VA_ARGS__)
+#define mock_dbg_task(fmt, ...)             mock_dbg(MPP_DEV_MOCK_DBG_TASK, fmt, ## __VA_ARGS__)
+
+typedef struct MppDevMockTask_t {
+    RK_S64          start;
+    RK_S32          read_cnt;
+    MppDevReqV1     reads[MOCK_REQ_MAX];
+} MppDevMockTask;
+
+typedef struct MppDevMockImpl_t {
+    RK_U32          latency;
+    RK_U32          status_reg;
+    RK_U32          status_val;
+
+    /* register file updated by all write requests */
+    RK_U32          *reg_file;
+    RK_U32          reg_size;
+
+    /* pending requests before send */
+    RK_S32          req_cnt;
+    MppDevReqV1     reqs[MOCK_REQ_MAX];
+
+    /* sent tasks waiting for poll in order */
+    MppDevMockTask  tasks[MOCK_TASK_MAX];
+    RK_S32          task_send;
+    RK_S32          task_poll;
+    RK_S32          task_cnt;
+    RK_S64          hw_idle;
+
+    MppDevRecord    replay;
+    RK_U32          *replay_buf;
+    RK_U32          replay_size;
+
+    RK_U32          frame_count;
+} MppDevMockImpl;
+
+static RK_U32 mpp_dev_mock_debug = 0;
+
+MPP_RET mpp_dev_mock_init(MppDevMock *ctx, MppDevCfg *cfg)
+{
+    MppDevMockImpl *p = NULL;
+    const char *path = NULL;
+
+    if (NULL == ctx || NULL == cfg) {
+        mpp_err_f("found NULL input ctx %p cfg %p\n", ctx, cfg);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    *ctx = NULL;
+
+    mpp_env_get_u32("mpp_dev_mock_debug", &mpp_dev_mock_debug, 0);
+
+    p = mpp_calloc(MppDevMockImpl, 1);
+    if (NULL == p) {
+        mpp_err_f("malloc failed\n");
+        return MPP_ERR_MALLOC;
+    }
+
+    mpp_env_get_u32("mpp_device_mock_latency", &p->latency, 0);
+    mpp_env_get_u32("mpp_device_mock_status_reg", &p->status_reg, MOCK_STATUS_REG_NONE);
+    mpp_env_get_u32("mpp_device_mock_status_val", &p->status_val, 0);
+    mpp_env_get_u32("mpp_device_mock_hw_id", &cfg->hw_id, 0);
+
+    mpp_env_get_str("mpp_device_mock_replay", &path, NULL);
+    if (path)
+        mpp_dev_record_open(&p->replay, path, 0);
+
+    mpp_log("mock device type %d coding %d latency %d us status reg %d val %08x\n",
+            cfg->type, cfg->coding, p->latency, p->status_reg, p->status_val);
+
+    *ctx = p;
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_mock_deinit(MppDevMock ctx)
+{
+    MppDevMockImpl *p = (MppDevMockImpl *)ctx;
+
+    if (NULL == p) {
+        mpp_err_f("found NULL input ctx %p\n", ctx);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (p->task_cnt)
+        mpp_log_f("%d task not polled\n", p->task_cnt);
+
+    mpp_dev_record_close(p->replay);
+    MPP_FREE(p->replay_buf);
+    MPP_FREE(p->reg_file);
+    mpp_free(p);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_mock_add_request(MppDevMock ctx, MppDevReqV1 *req)
+{
+    MppDevMockImpl *p = (MppDevMockImpl *)ctx;
+
+    if (NULL == p || NULL == req) {
+        mpp_err_f("found NULL input ctx %p req %p\n", ctx, req);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (p->req_cnt >= MOCK_REQ_MAX) {
+        mpp_err_f("ctx %p request count %d overfow\n", ctx, p->req_cnt);
+        return MPP_ERR_VALUE;
+    }
+
+    p->reqs[p->req_cnt++] = *req;
+    return MPP_OK;
+}
+
+static MPP_RET mpp_dev_mock_write(MppDevMockImpl *p, MppDevReqV1 *req)
+{
+    RK_U32 end = req->offset + req->size;
+
+    if (NULL == req->data)
+        return MPP_ERR_NULL_PTR;
+
+    if (end > p->reg_size) {
+        RK_U32 *reg_file = mpp_realloc(p->reg_file, RK_U32, MPP_ALIGN(end, 4) / 4);
+
+        if (NULL == reg_file) {
+            mpp_err_f("failed to grow register file to %d\n", end);
+            return MPP_ERR_MALLOC;
+        }
+
+        memset((RK_U8 *)reg_file + p->reg_size, 0, MPP_ALIGN(end, 4) - p->reg_size);
+        p->reg_file = reg_file;
+        p->reg_size = MPP_ALIGN(end, 4);
+    }
+
+    memcpy((RK_U8 *)p->reg_file + req->offset, req->data, req->size);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_mock_send_request(MppDevMock ctx)
+{
+    MppDevMockImpl *p = (MppDevMockImpl *)ctx;
+    MppDevMockTask *task = NULL;
+    RK_U32 poll = 0;
+    RK_S32 i;
+
+    if (NULL == p) {
+        mpp_err_f("found NULL input ctx %p\n", ctx);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    for (i = 0; i < p->req_cnt; i++) {
+        MppDevReqV1 *req = &p->reqs[i];
+
+        switch (req->cmd) {
+        case MPP_CMD_SET_REG_WRITE : {
+            mpp_dev_mock_write(p, req);
+        } /* fall through */
+        case MPP_CMD_SET_REG_READ : {
+            if (NULL == task) {
+                if (p->task_cnt >= MOCK_TASK_MAX) {
+                    mpp_err_f("ctx %p task count %d overflow\n", ctx, p->task_cnt);
+                    p->req_cnt = 0;
+                    return MPP_ERR_VALUE;
+                }
+
+                task = &p->tasks[p->task_send];
+                task->read_cnt = 0;
+            }
+
+            if (req->cmd == MPP_CMD_SET_REG_READ)
+                task->reads[task->read_cnt++] = *req;
+        } break;
+        case MPP_CMD_POLL_HW_FINISH : {
+            poll = 1;
+        } break;
+        default : {
+            /* address offset / session control does nothing on mock */
+        } break;
+        }
+    }
+
+    p->req_cnt = 0;
+
+    if (task) {
+        RK_S64 now = mpp_time();
+
+        /* one simulated hardware runs the tasks one by one */
+        task->start = MPP_MAX(now, p->hw_idle);
+        p->hw_idle = task->start + p->latency;
+        p->task_send = (p->task_send + 1) % MOCK_TASK_MAX;
+        p->task_cnt++;
+
+        mock_dbg_task("send task %d start %lld\n", p->frame_count + p->task_cnt - 1,
+                      task->start);
+    }
+
+    return (poll) ? mpp_dev_mock_poll(ctx) : MPP_OK;
+}
+
+MPP_RET mpp_dev_mock_poll(MppDevMock ctx)
+{
+    MppDevMockImpl *p = (MppDevMockImpl *)ctx;
+    MppDevMockTask *task = NULL;
+    RK_S64 wait;
+    RK_S32 i;
+
+    if (NULL == p) {
+        mpp_err_f("found NULL input ctx %p\n", ctx);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (!p->task_cnt) {
+        mpp_err_f("ctx %p poll without task\n", ctx);
+        return MPP_NOK;
+    }
+
+    task = &p->tasks[p->task_poll];
+    p->task_poll = (p->task_poll + 1) % MOCK_TASK_MAX;
+    p->task_cnt--;
+
+    wait = task->start + p->latency - mpp_time();
+    if (wait > 0)
+        usleep(wait);
+
+    if (p->replay && p->replay_size < p->reg_size) {
+        MPP_FREE(p->replay_buf);
+        p->replay_buf = mpp_malloc_size(RK_U32, p->reg_size);
+        p->replay_size = (p->replay_buf) ? p->reg_size : 0;
+    }
+
+    /* replay record overwrites the register file from its offset */
+    if (p->replay_buf) {
+        RK_U32 offset = 0;
+        RK_U32 size = p->replay_size;
+
+        if (!mpp_dev_record_read(p->replay, MPP_DEV_RECORD_READ,
+                                 p->replay_buf, &size, &offset) &&
+            offset < p->reg_size)
+            memcpy((RK_U8 *)p->reg_file + offset, p->replay_buf,
+                   MPP_MIN(size, p->reg_size - offset));
+    }
+
+    if (p->status_reg != MOCK_STATUS_REG_NONE && p->status_reg < p->reg_size / 4)
+        p->reg_file[p->status_reg] = p->status_val;
+
+    for (i = 0; i < task->read_cnt; i++) {
+        MppDevReqV1 *req = &task->reads[i];
+        RK_U32 size = req->size;
+
+        if (NULL == req->data || req->offset >= p->reg_size)
+            continue;
+
+        if (req->offset + size > p->reg_size)
+            size = p->reg_size - req->offset;
+
+        memcpy(req->data, (RK_U8 *)p->reg_file + req->offset, size);
+    }
+
+    mock_dbg_task("poll task %d done\n", p->frame_count);
+    p->frame_count++;
+
+    return MPP_OK;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_device_record"
+
+#include <stdio.h>
+
+#include "mpp_log.h"
+#include "mpp_mem.h"
+
+#include "mpp_device_record.h"
+
+typedef struct MppDevRecordImpl_t {
+    FILE            *fp;
+    RK_U32          write;
+} MppDevRecordImpl;
+
+MPP_RET mpp_dev_record_open(MppDevRecord *ctx, const char *path, RK_U32 write)
+{
+    MppDevRecordImpl *p = NULL;
+    FILE *fp = NULL;
+
+    if (NULL == ctx || NULL == path) {
+        mpp_err_f("found NULL input ctx %p path %p\n", ctx, path);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    *ctx = NULL;
+
+    fp = fopen(path, write ? "wb" : "rb");
+    if (NULL == fp) {
+        mpp_err_f("failed to open %s\n", path);
+        return MPP_ERR_OPEN_FILE;
+    }
+
+    p = mpp_calloc(MppDevRecordImpl, 1);
+    if (NULL == p) {
+        mpp_err_f("malloc failed\n");
+        fclose(fp);
+        return MPP_ERR_MALLOC;
+    }
+
+    p->fp = fp;
+    p->write = write;
+    *ctx = p;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_record_close(MppDevRecord ctx)
+{
+    MppDevRecordImpl *p = (MppDevRecordImpl *)ctx;
+
+    if (NULL == p)
+        return MPP_OK;
+
+    if (p->fp)
+        fclose(p->fp);
+
+    mpp_free(p);
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_record_write(MppDevRecord ctx, MppDevRecordType type,
+                             void *data, RK_U32 size, RK_U32 offset)
+{
+    MppDevRecordImpl *p = (MppDevRecordImpl *)ctx;
+    MppDevRecordHdr hdr;
+
+    if (NULL == p || NULL == data || !p->write)
+        return MPP_ERR_NULL_PTR;
+
+    hdr.magic = MPP_DEV_RECORD_MAGIC;
+    hdr.type = type;
+    hdr.offset = offset;
+    hdr.size = size;
+
+    if (fwrite(&hdr, sizeof(hdr), 1, p->fp) != 1 ||
+        fwrite(data, 1, size, p->fp) != size) {
+        mpp_err_f("failed to write record size %d\n", size);
+        return MPP_NOK;
+    }
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_record_read(MppDevRecord ctx, MppDevRecordType type,
+                            void *data, RK_U32 *size, RK_U32 *offset)
+{
+    MppDevRecordImpl *p = (MppDevRecordImpl *)ctx;
+    MppDevRecordHdr hdr;
+    RK_U32 rewind_cnt = 0;
+
+    if (NULL == p || NULL == data || NULL == size || p->write)
+        return MPP_ERR_NULL_PTR;
+
+    while (rewind_cnt < 2) {
+        if (fread(&hdr, sizeof(hdr), 1, p->fp) != 1) {
+            /* loop the record for long test */
+            fseek(p->fp, 0, SEEK_SET);
+            rewind_cnt++;
+            continue;
+        }
+
+        if (hdr.magic != MPP_DEV_RECORD_MAGIC) {
+            mpp_err_f("invalid record magic %08x\n", hdr.magic);
+            return MPP_NOK;
+        }
+
+        if (hdr.type != (RK_U32)type) {
+            fseek(p->fp, hdr.size, SEEK_CUR);
+            continue;
+        }
+
+        if (hdr.size > *size) {
+            if (fread(data, 1, *size, p->fp) != *size)
+                return MPP_NOK;
+
+            fseek(p->fp, hdr.size - *size, SEEK_CUR);
+        } else {
+            if (fread(data, 1, hdr.size, p->fp) != hdr.size)
+                return MPP_NOK;
+
+            *size = hdr.size;
+        }
+
+        if (offset)
+            *offset = hdr.offset;
+
+        return MPP_OK;
+    }
+
+    return MPP_NOK;
+}
@@ -0,0 +1,611 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_dev_sched"
+
+#include <string.h>
+
+#include "mpp_env.h"
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_list.h"
+#include "mpp_time.h"
+#include "mpp_common.h"
+#include "mpp_thread.h"
+#include "mpp_worker.h"
+
+#include "mpp_device_sched.h"
+
+#define SCHED_DBG_STAT              (0x00000001)
+#define SCHED_DBG_TRACE             (0x00000002)
+
+#define sched_dbg(flag, fmt, ...)   _mpp_dbg(mpp_dev_sched_debug, flag, fmt, ## __VA_ARGS__)
+#define sched_dbg_trace(fmt, ...)   sched_dbg(SCHED_DBG_TRACE, fmt, ## __VA_ARGS__)
+
+#define SCHED_DEPTH_DEFAULT         0
+/* max job in flight of one session */
+#define SCHED_JOB_MAX               8
+/* virtual time is hardware time scaled by 1 << MPP_HW_PRIORITY_RT / weight */
+#define SCHED_VTIME_SHIFT           MPP_HW_PRIORITY_RT
+
+typedef struct MppDevSchedClientImpl_t {
+    const char      *check;
+    Mutex           *lock;
+
+    RK_S32          priority;
+    RK_S32          pts_scale;
+    RK_S64          budget;
+
+    /* pts to time mapping for deadline */
+    RK_S32          pts_valid;
+    RK_S64          pts_base;
+    RK_S64          pts_last;
+    RK_S64          time_base;
+    RK_S64          deadline;
+
+    MppHwSchedStat  stat;
+} MppDevSchedClientImpl;
+
+typedef struct MppDevSchedJob_t {
+    RK_S64          start;
+    RK_S64          deadline;
+} MppDevSchedJob;
+
+typedef struct MppDevSchedImpl_t    MppDevSchedImpl;
+
+typedef struct MppDevSchedSession_t {
+    struct list_head        list;
+    MppDevSchedImpl         *sched;
+    Condition               *cond;
+    MppDevSchedClientImpl   *client;
+
+    /* request waiting for dispatch */
+    RK_S32          waiting;
+    RK_S32          granted;
+    RK_S32          priority;
+    RK_S64          deadline;
+    RK_S64          request;
+
+    /* jobs in flight in send order */
+    MppDevSchedJob  jobs[SCHED_JOB_MAX];
+    RK_S32          job_rd;
+    RK_S32          inflight;
+
+    RK_S64          vtime;
+    RK_S64          cost_avg;
+
+    /* statistics of the session */
+    RK_S64          count;
+    RK_S64          hw_time;
+    RK_S64          wait_time;
+} MppDevSchedSession;
+
+struct MppDevSchedImpl_t {
+    struct list_head    list;
+    const char          *name;
+    RK_S32              ref;
+
+    Mutex               *lock;
+    struct list_head    sessions;
+    RK_S32              depth;
+    RK_S32              running;
+    /* system virtual time, the max virtual time of granted sessions */
+    RK_S64              vtime;
+};
+
+static const char *client_name = "mpp_dev_sched_client";
+static RK_U32 mpp_dev_sched_debug = 0;
+
+class MppDevSchedService
+{
+private:
+    MppDevSchedService();
+    ~MppDevSchedService() {};
+    MppDevSchedService(const MppDevSchedService &);
+    MppDevSchedService &operator=(const MppDevSchedService &);
+
+    Mutex               mLock;
+    struct list_head    mList;
+    RK_U32              mDepth;
+    pthread_key_t       mKey;
+
+public:
+    static MppDevSchedService *get_instance() {
+        static MppDevSchedService instance;
+        return &instance;
+    }
+
+    MppDevSchedImpl *get(const char *name);
+    void put(MppDevSchedImpl *sched);
+
+    MppDevSchedClientImpl *get_client() {
+        return (MppDevSchedClientImpl *)pthread_getspecific(mKey);
+    }
+    void set_client(MppDevSchedClientImpl *client) {
+        pthread_setspecific(mKey, client);
+    }
+    RK_U32 get_depth() { return mDepth; };
+};
+
+MppDevSchedService::MppDevSchedService()
+    : mDepth(SCHED_DEPTH_DEFAULT)
+{
+    INIT_LIST_HEAD(&mList);
+    pthread_key_create(&mKey, NULL);
+
+    mpp_env_get_u32("mpp_dev_sched_debug", &mpp_dev_sched_debug, 0);
+    mpp_env_get_u32("mpp_dev_sched_depth", &mDepth, SCHED_DEPTH_DEFAULT);
+}
+
+MppDevSchedImpl *MppDevSchedService::get(const char *name)
+{
+    AutoMutex auto_lock(&mLock);
+    MppDevSchedImpl *pos, *n;
+
+    list_for_each_entry_safe(pos, n, &mList, MppDevSchedImpl, list) {
+        if (!strcmp(pos->name, name)) {
+            pos->ref++;
+            return pos;
+        }
+    }
+
+    MppDevSchedImpl *p = mpp_calloc(MppDevSchedImpl, 1);
+    if (NULL == p) {
+        mpp_err_f("failed to create scheduler for %s\n", name);
+        return NULL;
+    }
+
+    INIT_LIST_HEAD(&p->list);
+    INIT_LIST_HEAD(&p->sessions);
+    p->name = name;
+    p->ref = 1;
+    p->lock = new Mutex();
+    p->depth = mDepth;
+    list_add_tail(&p->list, &mList);
+
+    return p;
+}
+
+void MppDevSchedService::put(MppDevSchedImpl *p)
+{
+    AutoMutex auto_lock(&mLock);
+
+    if (--p->ref)
+        return ;
+
+    mpp_assert(list_empty(&p->sessions));
+    list_del_init(&p->list);
+    delete p->lock;
+    mpp_free(p);
+}
+
+static MPP_RET check_is_sched_client(void *client)
+{
+    if (client && ((MppDevSchedClientImpl *)client)->check == client_name)
+        return MPP_OK;
+
+    mpp_err_f("pointer %p failed on check\n", client);
+    mpp_abort();
+    return MPP_NOK;
+}
+
+/*
+ * Job close to its deadline is urgent. The window is twice of the average
+ * hardware time of the session. Job already missed its deadline does not
+ * preempt others any more so a stream always late can not starve the others.
+ */
+static RK_S32 sched_is_urgent(MppDevSchedSession *s, RK_S64 now)
+{
+    return s->deadline && s->deadline >= now &&
+           s->deadline - now <= s->cost_avg * 2;
+}
+
+static RK_S32 sched_is_better(MppDevSchedSession *a, MppDevSchedSession *b,
+                              RK_S64 now)
+{
+    RK_S32 rt_a = (a->priority >= MPP_HW_PRIORITY_RT);
+    RK_S32 rt_b = (b->priority >= MPP_HW_PRIORITY_RT);
+    RK_S32 urgent_a;
+    RK_S32 urgent_b;
+
+    if (rt_a != rt_b)
+        return rt_a;
+
+    urgent_a = sched_is_urgent(a, now);
+    urgent_b = sched_is_urgent(b, now);
+
+    if (urgent_a != urgent_b)
+        return urgent_a;
+
+    if (urgent_a && a->deadline != b->deadline)
+        return a->deadline < b->deadline;
+
+    if (a->vtime != b->vtime)
+        return a->vtime < b->vtime;
+
+    return a->request < b->request;
+}
+
+/*
+ * When all slots are taken only the session already holding slots can be
+ * selected if every holder is waiting. Otherwise a session sending its next
+ * job before waiting the previous one will never be waken up.
+ */
+static MppDevSchedSession *sched_pick(MppDevSchedImpl *p, RK_S64 now)
+{
+    MppDevSchedSession *best = NULL;
+    MppDevSchedSession *pos, *n;
+    RK_S32 holder_only = 0;
+
+    if (p->running >= p->depth) {
+        list_for_each_entry_safe(pos, n, &p->sessions, MppDevSchedSession, list) {
+            if (pos->inflight && !pos->waiting)
+                return NULL;
+        }
+        holder_only = 1;
+    }
+
+    list_for_each_entry_safe(pos, n, &p->sessions, MppDevSchedSession, list) {
+        if (!pos->waiting)
+            continue;
+
+        if (holder_only && !pos->inflight)
+            continue;
+
+        if (NULL == best || sched_is_better(pos, best, now))
+            best = pos;
+    }
+
+    return best;
+}
+
+static void sched_dispatch(MppDevSchedImpl *p)
+{
+    RK_S64 now = mpp_time();
+    MppDevSchedSession *s;
+
+    while ((s = sched_pick(p, now))) {
+        MppDevSchedJob *job;
+
+        /* hal sending job without poll leaks its slot so drop the oldest */
+        if (s->inflight >= SCHED_JOB_MAX) {
+            mpp_err_f("%s session %p drop job not polled\n", p->name, s);
+            s->job_rd = (s->job_rd + 1) % SCHED_JOB_MAX;
+            s->inflight--;
+            p->running--;
+        }
+
+        job = &s->jobs[(s->job_rd + s->inflight) % SCHED_JOB_MAX];
+
+        job->start = now;
+        job->deadline = s->deadline;
+
+        s->waiting = 0;
+        s->granted = 1;
+        s->inflight++;
+        p->running++;
+        p->vtime = MPP_MAX(p->vtime, s->vtime);
+
+        sched_dbg_trace("%s grant %p prio %d vtime %lld deadline %lld running %d\n",
+                        p->name, s, s->priority, s->vtime, s->deadline,
+                        p->running);
+
+        s->cond->signal();
+    }
+}
+
+MPP_RET mpp_dev_sched_client_init(MppDevSchedClient *client)
+{
+    MppDevSchedClientImpl *p;
+
+    if (NULL == client) {
+        mpp_err_f("invalid NULL input\n");
+        return MPP_ERR_NULL_PTR;
+    }
+
+    p = mpp_calloc(MppDevSchedClientImpl, 1);
+    if (NULL == p) {
+        mpp_err_f("malloc failed\n");
+        *client = NULL;
+        return MPP_ERR_MALLOC;
+    }
+
+    p->check = client_name;
+    p->lock = new Mutex();
+    p->priority = MPP_HW_PRIORITY_DEFAULT;
+    p->pts_scale = 1;
+
+    *client = p;
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_sched_client_deinit(MppDevSchedClient client)
+{
+    MppDevSchedClientImpl *p = (MppDevSchedClientImpl *)client;
+
+    if (NULL == p || check_is_sched_client(p)) {
+        mpp_err_f("invalid client %p\n", client);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    delete p->lock;
+    p->check = NULL;
+    mpp_free(p);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_sched_client_set_cfg(MppDevSchedClient client, MppHwSchedCfg *cfg)
+{
+    MppDevSchedClientImpl *p = (MppDevSchedClientImpl *)client;
+
+    if (NULL == p || check_is_sched_client(p) || NULL == cfg) {
+        mpp_err_f("invalid client %p cfg %p\n", client, cfg);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (cfg->priority < MPP_HW_PRIORITY_MIN || cfg->priority > MPP_HW_PRIORITY_RT ||
+        cfg->pts_scale < 0 || cfg->deadline < 0) {
+        mpp_err_f("invalid priority %d pts scale %d deadline %lld\n",
+                  cfg->priority, cfg->pts_scale, cfg->deadline);
+        return MPP_ERR_VALUE;
+    }
+
+    AutoMutex auto_lock(p->lock);
+
+    p->priority = cfg->priority;
+    p->pts_scale = (cfg->pts_scale) ? (cfg->pts_scale) : (1);
+    p->budget = cfg->deadline;
+    p->pts_valid = 0;
+    p->deadline = 0;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_sched_client_get_stat(MppDevSchedClient client, MppHwSchedStat *stat)
+{
+    MppDevSchedClientImpl *p = (MppDevSchedClientImpl *)client;
+
+    if (NULL == p || check_is_sched_client(p) || NULL == stat) {
+        mpp_err_f("invalid client %p stat %p\n", client, stat);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    AutoMutex auto_lock(p->lock);
+
+    memcpy(stat, &p->stat, sizeof(*stat));
+
+    return MPP_OK;
+}
+
+void mpp_dev_sched_client_set_pts(MppDevSchedClient client, RK_S64 pts)
+{
+    MppDevSchedClientImpl *p = (MppDevSchedClientImpl *)client;
+    RK_S64 now;
+
+    if (NULL == p || !p->budget)
+        return ;
+
+    AutoMutex auto_lock(p->lock);
+
+    now = mpp_time();
+
+    /* remap on first pts, pts going back (seek / loop) or long pause */
+    if (!p->pts_valid || pts < p->pts_last ||
+        p->time_base + (pts - p->pts_base) * p->pts_scale + p->budget < now - p->budget) {
+        p->pts_base = pts;
+        p->time_base = now;
+        p->pts_valid = 1;
+    }
+
+    p->pts_last = pts;
+    p->deadline = p->time_base + (pts - p->pts_base) * p->pts_scale + p->budget;
+}
+
+void mpp_dev_sched_bind(MppDevSchedClient client)
+{
+    MppDevSchedService::get_instance()->set_client((MppDevSchedClientImpl *)client);
+}
+
+MPP_RET mpp_dev_sched_open(MppDevSched *sched, const char *name)
+{
+    MppDevSchedService *srv = MppDevSchedService::get_instance();
+    MppDevSchedSession *s;
+    MppDevSchedImpl *p;
+
+    if (NULL == sched || NULL == name) {
+        mpp_err_f("invalid input sched %p name %p\n", sched, name);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    *sched = NULL;
+
+    if (!srv->get_depth())
+        return MPP_OK;
+
+    s = mpp_calloc(MppDevSchedSession, 1);
+    if (NULL == s) {
+        mpp_err_f("malloc failed\n");
+        return MPP_ERR_MALLOC;
+    }
+
+    p = srv->get(name);
+    if (NULL == p) {
+        mpp_free(s);
+        return MPP_NOK;
+    }
+
+    INIT_LIST_HEAD(&s->list);
+    s->sched = p;
+    s->cond = new Condition();
+    s->priority = MPP_HW_PRIORITY_DEFAULT;
+
+    {
+        AutoMutex auto_lock(p->lock);
+
+        /* new session starts from current virtual time without credit */
+        s->vtime = p->vtime;
+        list_add_tail(&s->list, &p->sessions);
+    }
+
+    *sched = s;
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_sched_close(MppDevSched sched)
+{
+    MppDevSchedSession *s = (MppDevSchedSession *)sched;
+    MppDevSchedImpl *p;
+
+    if (NULL == s)
+        return MPP_OK;
+
+    p = s->sched;
+
+    {
+        AutoMutex auto_lock(p->lock);
+
+        /* job not polled before close is dropped with its slot */
+        p->running -= s->inflight;
+        s->inflight = 0;
+        list_del_init(&s->list);
+        sched_dispatch(p);
+    }
+
+    if (mpp_dev_sched_debug & SCHED_DBG_STAT)
+        mpp_log("%s session %p prio %d count %lld hw %lld us wait %lld us\n",
+                p->name, s, s->priority, s->count, s->hw_time, s->wait_time);
+
+    MppDevSchedService::get_instance()->put(p);
+    delete s->cond;
+    mpp_free(s);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_sched_acquire(MppDevSched sched)
+{
+    MppDevSchedSession *s = (MppDevSchedSession *)sched;
+    MppDevSchedClientImpl *client;
+    MppDevSchedImpl *p;
+    RK_S32 priority = MPP_HW_PRIORITY_DEFAULT;
+    RK_S64 deadline = 0;
+    RK_S64 wait;
+
+    if (NULL == s)
+        return MPP_OK;
+
+    p = s->sched;
+    client = MppDevSchedService::get_instance()->get_client();
+
+    /* deadline is used by one job only */
+    if (client) {
+        AutoMutex auto_lock(client->lock);
+
+        priority = client->priority;
+        deadline = client->deadline;
+        client->deadline = 0;
+    }
+
+    AutoMutex auto_lock(p->lock);
+
+    s->client = client;
+    s->priority = priority;
+    s->deadline = deadline;
+    s->request = mpp_time();
+    s->waiting = 1;
+    s->granted = 0;
+
+    /* idle session can not save credit for later burst */
+    if (!s->inflight)
+        s->vtime = MPP_MAX(s->vtime, p->vtime);
+
+    sched_dispatch(p);
+
+    /*
+     * The slot is released by the poll of other context. On worker pool the
+     * poll needs a worker so let the pool run spare worker on waiting.
+     */
+    if (!s->granted) {
+        mpp_worker_block_enter();
+        while (!s->granted)
+            s->cond->wait(p->lock);
+        mpp_worker_block_leave();
+    }
+
+    s->granted = 0;
+    wait = s->jobs[(s->job_rd + s->inflight - 1) % SCHED_JOB_MAX].start - s->request;
+    s->wait_time += wait;
+
+    if (client) {
+        AutoMutex auto_client(client->lock);
+
+        client->stat.wait_time += wait;
+        client->stat.wait_max = MPP_MAX(client->stat.wait_max, wait);
+    }
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_dev_sched_release(MppDevSched sched)
+{
+    MppDevSchedSession *s = (MppDevSchedSession *)sched;
+    MppDevSchedImpl *p;
+    MppDevSchedJob *job;
+    RK_S64 now;
+    RK_S64 cost;
+
+    if (NULL == s)
+        return MPP_OK;
+
+    p = s->sched;
+    now = mpp_time();
+
+    AutoMutex auto_lock(p->lock);
+
+    if (!s->inflight) {
+        mpp_err_f("%s session %p release without job\n", p->name, s);
+        return MPP_NOK;
+    }
+
+    job = &s->jobs[s->job_rd];
+    s->job_rd = (s->job_rd + 1) % SCHED_JOB_MAX;
+    s->inflight--;
+    p->running--;
+
+    cost = now - job->start;
+    s->vtime += (cost << SCHED_VTIME_SHIFT) >> s->priority;
+    s->cost_avg = (s->cost_avg) ? ((s->cost_avg * 7 + cost) / 8) : (cost);
+    s->count++;
+    s->hw_time += cost;
+
+    if (s->client) {
+        MppDevSchedClientImpl *client = s->client;
+        AutoMutex auto_client(client->lock);
+
+        client->stat.count++;
+        client->stat.hw_time += cost;
+        if (job->deadline && now > job->deadline)
+            client->stat.deadline_miss++;
+    }
+
+    sched_dbg_trace("%s done %p cost %lld vtime %lld running %d\n",
+                    p->name, s, cost, s->vtime, p->running);
+
+    sched_dispatch(p);
+
+    return MPP_OK;
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_dev_sched_test"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "mpp_env.h"
+#include "mpp_log.h"
+#include "mpp_time.h"
+#include "mpp_thread.h"
+#include "mpp_common.h"
+
+#include "mpp_device.h"
+#include "mpp_device_sched.h"
+
+/* mock hardware latency for each job */
+#define TEST_HW_LATENCY         2000
+#define TEST_DURATION           400000
+#define TEST_REG_COUNT          16
+
+typedef struct SchedTestCtx_t {
+    RK_S32          priority;
+    /* interval between jobs in us, zero for back to back */
+    RK_S32          interval;
+    volatile RK_S32 *start;
+    MppHwSchedStat  stat;
+    MPP_RET         ret;
+} SchedTestCtx;
+
+static void *sched_test_worker(void *arg)
+{
+    SchedTestCtx *ctx = (SchedTestCtx *)arg;
+    MppDevSchedClient client = NULL;
+    MppDevCtx dev = NULL;
+    MppDevCfg dev_cfg;
+    MppHwSchedCfg cfg;
+    RK_U32 regs[TEST_REG_COUNT];
+    RK_S64 end;
+
+    ctx->ret = MPP_NOK;
+
+    memset(&dev_cfg, 0, sizeof(dev_cfg));
+    dev_cfg.type = MPP_CTX_DEC;
+    dev_cfg.coding = MPP_VIDEO_CodingAVC;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.priority = ctx->priority;
+
+    memset(regs, 0, sizeof(regs));
+
+    if (mpp_dev_sched_client_init(&client) ||
+        mpp_dev_sched_client_set_cfg(client, &cfg) ||
+        mpp_device_init(&dev, &dev_cfg)) {
+        mpp_err("worker prio %d init failed\n", ctx->priority);
+        goto DONE;
+    }
+
+    mpp_dev_sched_bind(client);
+
+    while (!*ctx->start)
+        usleep(100);
+
+    end = mpp_time() + TEST_DURATION;
+    while (mpp_time() < end) {
+        if (mpp_device_send_reg(dev, regs, TEST_REG_COUNT) ||
+            mpp_device_wait_reg(dev, regs, TEST_REG_COUNT)) {
+            mpp_err("worker prio %d job failed\n", ctx->priority);
+            goto DONE;
+        }
+
+        if (ctx->interval)
+            usleep(ctx->interval);
+    }
+
+    mpp_dev_sched_client_get_stat(client, &ctx->stat);
+    ctx->ret = MPP_OK;
+
+DONE:
+    mpp_dev_sched_bind(NULL);
+    if (dev)
+        mpp_device_deinit(dev);
+    if (client)
+        mpp_dev_sched_client_deinit(client);
+
+    return NULL;
+}
+
+static MPP_RET sched_test_run(SchedTestCtx *ctxs, RK_S32 count)
+{
+    pthread_t thds[8];
+    volatile RK_S32 start = 0;
+    RK_S32 i;
+
+    for (i = 0; i < count; i++) {
+        ctxs[i].start = &start;
+        pthread_create(&thds[i], NULL, sched_test_worker, &ctxs[i]);
+    }
+
+    /* let all workers open device before start */
+    usleep(20000);
+    start = 1;
+
+    for (i = 0; i < count; i++)
+        pthread_join(thds[i], NULL);
+
+    for (i = 0; i < count; i++) {
+        MppHwSchedStat *stat = &ctxs[i].stat;
+
+        if (ctxs[i].ret)
+            return MPP_NOK;
+
+        mpp_log("prio %d count %4lld hw %6lld us wait %7lld us max %5lld us\n",
+                ctxs[i].priority, stat->count, stat->hw_time,
+                stat->wait_time, stat->wait_max);
+    }
+
+    return MPP_OK;
+}
+
+/* hardware time share is in proportion to 1 << priority */
+static MPP_RET sched_test_wfq(void)
+{
+    SchedTestCtx ctxs[3];
+    RK_S64 low;
+    RK_S64 high;
+
+    memset(ctxs, 0, sizeof(ctxs));
+    ctxs[0].priority = MPP_HW_PRIORITY_DEFAULT;
+    ctxs[1].priority = MPP_HW_PRIORITY_DEFAULT;
+    ctxs[2].priority = MPP_HW_PRIORITY_DEFAULT + 1;
+
+    mpp_log("weighted fair queuing test start\n");
+
+    if (sched_test_run(ctxs, MPP_ARRAY_ELEMS(ctxs)))
+        return MPP_NOK;
+
+    low = ctxs[0].stat.hw_time + ctxs[1].stat.hw_time;
+    high = ctxs[2].stat.hw_time;
+
+    /* double weight session should get the share of two normal sessions */
+    if (high * 10 < low * 7 || high * 10 > low * 13) {
+        mpp_err("hardware time share %lld vs %lld is not fair\n", high, low);
+        return MPP_NOK;
+    }
+
+    return MPP_OK;
+}
+
+/* realtime session is served before bulk sessions */
+static MPP_RET sched_test_rt(void)
+{
+    SchedTestCtx ctxs[3];
+    MppHwSchedStat *bulk;
+    MppHwSchedStat *rt;
+
+    memset(ctxs, 0, sizeof(ctxs));
+    ctxs[0].priority = MPP_HW_PRIORITY_MIN;
+    ctxs[1].priority = MPP_HW_PRIORITY_DEFAULT;
+    ctxs[2].priority = MPP_HW_PRIORITY_RT;
+    ctxs[2].interval = TEST_HW_LATENCY * 4;
+
+    mpp_log("realtime priority test start\n");
+
+    if (sched_test_run(ctxs, MPP_ARRAY_ELEMS(ctxs)))
+        return MPP_NOK;
+
+    bulk = &ctxs[1].stat;
+    rt = &ctxs[2].stat;
+
+    /*
+     * realtime job only waits the running job while bulk job waits the
+     * others in queue. Compare the average as the max is easily affected
+     * by os scheduling.
+     */
+    if (!rt->count || !bulk->count ||
+        rt->wait_time / rt->count * 2 > bulk->wait_time / bulk->count) {
+        mpp_err("realtime job waits %lld us vs bulk job %lld us\n",
+                rt->count ? rt->wait_time / rt->count : 0,
+                bulk->count ? bulk->wait_time / bulk->count : 0);
+        return MPP_NOK;
+    }
+
+    return MPP_OK;
+}
+
+int main()
+{
+    MPP_RET ret = MPP_NOK;
+
+    mpp_log("mpp dev sched test start\n");
+
+    /* all workers share one simulated hardware running one job at a time */
+    mpp_env_set_u32("mpp_device_mock", 1);
+    mpp_env_set_u32("mpp_device_mock_latency", TEST_HW_LATENCY);
+    mpp_env_set_u32("mpp_dev_sched_depth", 1);
+
+    if (sched_test_wfq())
+        goto DONE;
+
+    if (sched_test_rt())
+        goto DONE;
+
+    ret = MPP_OK;
+DONE:
+    mpp_log("mpp dev sched test %s\n", ret ? "failed" : "success");
+    return ret;
+}
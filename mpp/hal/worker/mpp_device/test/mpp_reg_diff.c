@@ -0,0 +1,709 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_reg_diff"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_common.h"
+
+#include "mpp_device_patch.h"
+#include "mpp_device_record.h"
+
+/*
+ * Compare two register traces recorded by env mpp_device_record
+ *
+ * usage: mpp_reg_diff trace_a trace_b [-l layout.h] [-s struct] [-o offset]
+ *
+ * When a register layout header like hal_h264e_vepu541_reg.h is given the
+ * WRITE records at the offset are decoded field by field with the register
+ * struct. Otherwise the difference is shown by register word.
+ */
+#define MAX_NAME_LEN        64
+#define MAX_LAYOUT_NUM      32
+
+typedef struct RegField_t {
+    RK_U32          word;
+    RK_U32          lsb;
+    RK_U32          width;
+    char            name[MAX_NAME_LEN];
+} RegField;
+
+typedef struct RegLayout_t {
+    char            name[MAX_NAME_LEN];
+    RK_U32          words;
+    RK_U32          valid;
+    RK_S32          count;
+    RK_S32          size;
+    RegField        *fields;
+} RegLayout;
+
+typedef struct RegRecord_t {
+    MppDevRecordHdr hdr;
+    RK_U32          *data;
+} RegRecord;
+
+typedef struct RegTrace_t {
+    RK_S32          count;
+    RK_S32          size;
+    RegRecord       *records;
+    /* start record index of each frame */
+    RK_S32          frame_count;
+    RK_S32          *frames;
+} RegTrace;
+
+typedef struct RegDiffCtx_t {
+    const char      *path[2];
+    const char      *layout_path;
+    const char      *struct_name;
+    RK_U32          offset;
+
+    RegLayout       layouts[MAX_LAYOUT_NUM];
+    RK_S32          layout_count;
+    RegLayout       *layout;
+
+    RegTrace        trace[2];
+} RegDiffCtx;
+
+static const char *record_type_str[] = {
+    "write",
+    "read",
+    "extra",
+    "reg_id",
+};
+
+static RegField *layout_add_field(RegLayout *layout)
+{
+    if (layout->count >= layout->size) {
+        RK_S32 size = (layout->size) ? layout->size * 2 : 256;
+        RegField *fields = mpp_realloc(layout->fields, RegField, size);
+
+        if (NULL == fields)
+            return NULL;
+
+        layout->fields = fields;
+        layout->size = size;
+    }
+
+    return &layout->fields[layout->count++];
+}
+
+/* full field name is prefix idx . name and truncated to MAX_NAME_LEN */
+static void field_set_name(RegField *f, const char *prefix, const char *idx,
+                           const char *name)
+{
+    char buf[MAX_NAME_LEN * 3];
+    size_t len;
+
+    snprintf(buf, sizeof(buf), "%s%s%s%s", prefix, idx, (*prefix && *name) ? "." : "", name);
+    len = MPP_MIN(strlen(buf), MAX_NAME_LEN - 1);
+    memmove(f->name, buf, len);
+    f->name[len] = '\0';
+}
+
+static RegLayout *layout_find(RegDiffCtx *ctx, const char *name)
+{
+    RK_S32 i;
+
+    for (i = 0; i < ctx->layout_count; i++) {
+        if (ctx->layouts[i].valid && !strcmp(ctx->layouts[i].name, name))
+            return &ctx->layouts[i];
+    }
+
+    return NULL;
+}
+
+static char *str_trim(char *str)
+{
+    char *end;
+
+    while (isspace((unsigned char)*str))
+        str++;
+
+    end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+
+    return str;
+}
+
+/* remove comment and preprocessor line */
+static void strip_comment(char *buf)
+{
+    char *src = buf;
+    char *dst = buf;
+    RK_U32 line_start = 1;
+
+    while (*src) {
+        if (src[0] == '/' && src[1] == '*') {
+            char *end = strstr(src + 2, "*/");
+
+            src = (end) ? end + 2 : src + strlen(src);
+            continue;
+        }
+
+        if ((src[0] == '/' && src[1] == '/') || (line_start && src[0] == '#')) {
+            while (*src && *src != '\n')
+                src++;
+            continue;
+        }
+
+        if (*src == '\n')
+            line_start = 1;
+        else if (!isspace((unsigned char)*src))
+            line_start = 0;
+
+        *dst++ = *src++;
+    }
+
+    *dst = '\0';
+}
+
+/*
+ * parse declaration "TYPE name", "TYPE name[N]" or "TYPE name : N"
+ * return the count of words or bits
+ */
+static RK_S32 parse_decl(char *stmt, char **type, char **name, RK_S32 *array, RK_S32 *bits)
+{
+    char *p = str_trim(stmt);
+    char *sep;
+
+    *array = 0;
+    *bits = 0;
+
+    sep = strchr(p, ':');
+    if (sep) {
+        *sep = '\0';
+        *bits = strtol(sep + 1, NULL, 0);
+    }
+
+    sep = strchr(p, '[');
+    if (sep) {
+        *sep = '\0';
+        *array = strtol(sep + 1, NULL, 0);
+        if (*array <= 0)
+            return -1;
+    }
+
+    p = str_trim(p);
+    sep = p + strlen(p);
+    while (sep > p && !isspace((unsigned char)sep[-1]))
+        sep--;
+
+    if (sep == p)
+        return -1;
+
+    *name = sep;
+    sep[-1] = '\0';
+    *type = str_trim(p);
+
+    return 0;
+}
+
+static RK_U32 is_word_type(const char *type)
+{
+    return !strcmp(type, "RK_U32") || !strcmp(type, "RK_S32") ||
+           !strcmp(type, "unsigned int") || !strcmp(type, "int");
+}
+
+static MPP_RET layout_parse(RegDiffCtx *ctx, char *buf)
+{
+    RegLayout *layout = NULL;
+    RK_S32 depth = 0;
+    RK_S32 skip = 0;
+    RK_U32 closing = 0;
+    /* register group of bit fields */
+    RK_S32 group_start = 0;
+    RK_U32 group_bits = 0;
+    char *stmt = buf;
+    char *p;
+
+    strip_comment(buf);
+
+    for (p = buf; *p; p++) {
+        char c = *p;
+
+        if (c != '{' && c != '}' && c != ';')
+            continue;
+
+        *p = '\0';
+        stmt = str_trim(stmt);
+
+        if (c == '{') {
+            if (depth == 0 && !strncmp(stmt, "typedef struct", 14) &&
+                ctx->layout_count < MAX_LAYOUT_NUM) {
+                layout = &ctx->layouts[ctx->layout_count++];
+                memset(layout, 0, sizeof(*layout));
+                layout->valid = 1;
+                skip = 0;
+            } else if (depth == 1 && layout && !skip && !strcmp(stmt, "struct")) {
+                group_start = layout->count;
+                group_bits = 0;
+            } else if (depth <= 1) {
+                /* enum / union / extern "C" block is not register layout */
+                skip = 1;
+            }
+            depth++;
+        } else if (c == '}') {
+            depth--;
+            closing = 1;
+        } else if (closing) {
+            /* name after closing brace */
+            closing = 0;
+
+            if (depth == 0 && layout) {
+                snprintf(layout->name, sizeof(layout->name), "%s", stmt);
+                layout = NULL;
+                skip = 0;
+            } else if (depth == 0) {
+                skip = 0;
+            } else if (depth == 1 && layout && !skip) {
+                RK_S32 i;
+
+                for (i = group_start; i < layout->count; i++)
+                    field_set_name(&layout->fields[i], stmt, "", layout->fields[i].name);
+
+                layout->words += (group_bits + 31) / 32;
+            }
+        } else if (layout && !skip && *stmt) {
+            char *type = NULL;
+            char *name = NULL;
+            RK_S32 array = 0;
+            RK_S32 bits = 0;
+
+            if (parse_decl(stmt, &type, &name, &array, &bits)) {
+                layout->valid = 0;
+                skip = 1;
+            } else if (depth == 2) {
+                RK_S32 n = (array) ? array : 1;
+                RK_S32 i;
+
+                if (!bits)
+                    bits = 32;
+
+                for (i = 0; i < n; i++) {
+                    RegField *f = layout_add_field(layout);
+                    char idx[16] = "";
+
+                    if (NULL == f)
+                        return MPP_ERR_MALLOC;
+
+                    if (array)
+                        snprintf(idx, sizeof(idx), "[%d]", i);
+
+                    /* bit field does not cross word boundary */
+                    if ((group_bits & 31) + bits > 32)
+                        group_bits = MPP_ALIGN(group_bits, 32);
+
+                    f->word = layout->words + group_bits / 32;
+                    f->lsb = group_bits & 31;
+                    f->width = bits;
+                    field_set_name(f, name, idx, "");
+                    group_bits += bits;
+                }
+            } else if (depth == 1) {
+                RegLayout *sub = (is_word_type(type)) ? NULL : layout_find(ctx, type);
+                RK_S32 n = (array) ? array : 1;
+                RK_S32 i, j;
+
+                if (!is_word_type(type) && NULL == sub) {
+                    mpp_log("%s: unknown type %s stop at word %d\n",
+                            layout->name[0] ? layout->name : "layout", type,
+                            layout->words);
+                    skip = 1;
+                    continue;
+                }
+
+                for (i = 0; i < n; i++) {
+                    RK_S32 cnt = (sub) ? sub->count : 1;
+
+                    for (j = 0; j < cnt; j++) {
+                        RegField *f = layout_add_field(layout);
+                        char idx[16] = "";
+
+                        if (NULL == f)
+                            return MPP_ERR_MALLOC;
+
+                        if (array)
+                            snprintf(idx, sizeof(idx), "[%d]", i);
+
+                        if (sub) {
+                            *f = sub->fields[j];
+                            f->word += layout->words;
+                            field_set_name(f, name, idx, sub->fields[j].name);
+                        } else {
+                            f->word = layout->words;
+                            f->lsb = 0;
+                            f->width = 32;
+                            field_set_name(f, name, idx, "");
+                        }
+                    }
+
+                    layout->words += (sub) ? sub->words : 1;
+                }
+            }
+        }
+
+        stmt = p + 1;
+    }
+
+    return MPP_OK;
+}
+
+static MPP_RET layout_load(RegDiffCtx *ctx)
+{
+    FILE *fp = fopen(ctx->layout_path, "rb");
+    MPP_RET ret = MPP_NOK;
+    char *buf = NULL;
+    long size;
+    RK_S32 i;
+
+    if (NULL == fp) {
+        mpp_err("failed to open layout %s\n", ctx->layout_path);
+        return MPP_ERR_OPEN_FILE;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    buf = mpp_malloc_size(char, size + 1);
+    if (buf && fread(buf, 1, size, fp) == (size_t)size) {
+        buf[size] = '\0';
+        ret = layout_parse(ctx, buf);
+    }
+
+    MPP_FREE(buf);
+    fclose(fp);
+
+    if (ret)
+        return ret;
+
+    /* default select the largest struct as register set */
+    for (i = 0; i < ctx->layout_count; i++) {
+        RegLayout *layout = &ctx->layouts[i];
+
+        if (!layout->count)
+            continue;
+
+        if (ctx->struct_name) {
+            if (!strcmp(layout->name, ctx->struct_name)) {
+                ctx->layout = layout;
+                break;
+            }
+        } else if (NULL == ctx->layout || layout->words > ctx->layout->words) {
+            ctx->layout = layout;
+        }
+    }
+
+    if (NULL == ctx->layout) {
+        mpp_err("failed to find layout %s in %s\n",
+                ctx->struct_name ? ctx->struct_name : "struct", ctx->layout_path);
+        return MPP_NOK;
+    }
+
+    mpp_log("layout %s %d words %d fields\n", ctx->layout->name,
+            ctx->layout->words, ctx->layout->count);
+
+    return MPP_OK;
+}
+
+/* check the register set is written in current frame already */
+static RK_U32 frame_has_write(RegTrace *trace, MppDevRecordHdr *hdr)
+{
+    RK_S32 i = (trace->frame_count) ? trace->frames[trace->frame_count - 1] : 0;
+
+    for (; i < trace->count; i++) {
+        MppDevRecordHdr *prev = &trace->records[i].hdr;
+
+        if (prev->type == hdr->type && prev->offset == hdr->offset)
+            return 1;
+    }
+
+    return 0;
+}
+
+static MPP_RET trace_load(RegTrace *trace, const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    RK_U32 last_read = 1;
+    MppDevRecordHdr hdr;
+
+    if (NULL == fp) {
+        mpp_err("failed to open trace %s\n", path);
+        return MPP_ERR_OPEN_FILE;
+    }
+
+    memset(trace, 0, sizeof(*trace));
+
+    while (fread(&hdr, sizeof(hdr), 1, fp) == 1) {
+        RegRecord *rec;
+
+        if (hdr.magic != MPP_DEV_RECORD_MAGIC || hdr.type >= MPP_DEV_RECORD_BUTT) {
+            mpp_err("invalid record magic %08x type %d in %s\n",
+                    hdr.magic, hdr.type, path);
+            break;
+        }
+
+        if (trace->count >= trace->size) {
+            RK_S32 size = (trace->size) ? trace->size * 2 : 1024;
+
+            trace->records = mpp_realloc(trace->records, RegRecord, size);
+            trace->frames = mpp_realloc(trace->frames, RK_S32, size);
+            if (NULL == trace->records || NULL == trace->frames)
+                break;
+
+            trace->size = size;
+        }
+
+        rec = &trace->records[trace->count];
+        rec->hdr = hdr;
+        rec->data = mpp_calloc(RK_U32, (hdr.size + 3) / 4);
+        if (NULL == rec->data || fread(rec->data, 1, hdr.size, fp) != hdr.size) {
+            MPP_FREE(rec->data);
+            break;
+        }
+
+        /*
+         * The first write after read back starts a new frame. With pipelined
+         * tasks the next frame is written before the read back of current
+         * frame, so a register set written again also starts a new frame.
+         */
+        if (hdr.type == MPP_DEV_RECORD_WRITE && !last_read &&
+            frame_has_write(trace, &hdr))
+            trace->frames[trace->frame_count++] = trace->count;
+        else if (hdr.type != MPP_DEV_RECORD_READ && last_read)
+            trace->frames[trace->frame_count++] = trace->count;
+
+        last_read = (hdr.type == MPP_DEV_RECORD_READ);
+        trace->count++;
+    }
+
+    fclose(fp);
+
+    mpp_log("trace %s %d records %d frames\n", path, trace->count, trace->frame_count);
+    return MPP_OK;
+}
+
+static void trace_unload(RegTrace *trace)
+{
+    RK_S32 i;
+
+    for (i = 0; i < trace->count; i++)
+        MPP_FREE(trace->records[i].data);
+
+    MPP_FREE(trace->records);
+    MPP_FREE(trace->frames);
+}
+
+static RK_S32 frame_end(RegTrace *trace, RK_S32 frame)
+{
+    return (frame + 1 < trace->frame_count) ? trace->frames[frame + 1] : trace->count;
+}
+
+static RK_U32 field_value(RK_U32 val, RegField *f)
+{
+    return (f->width >= 32) ? val : ((val >> f->lsb) & ((1u << f->width) - 1));
+}
+
+static RK_S32 diff_word(RegDiffCtx *ctx, RK_S32 frame, RegRecord *rec,
+                        RK_U32 word, RK_U32 a, RK_U32 b)
+{
+    RegLayout *layout = ctx->layout;
+    RK_U32 type = rec->hdr.type;
+    RK_U32 reg = word + rec->hdr.offset / 4;
+    RK_S32 found = 0;
+
+    if (type == MPP_DEV_RECORD_EXTRA) {
+        RK_U32 idx = word * 4 / sizeof(RegPatchInfo);
+
+        mpp_log("frame %4d extra patch[%d] %s %08x -> %08x\n", frame, idx,
+                (word & 1) ? "offset " : "reg_idx", a, b);
+        return 1;
+    }
+
+    if (type == MPP_DEV_RECORD_WRITE && layout && rec->hdr.offset == ctx->offset &&
+        word < layout->words) {
+        RK_S32 i;
+
+        for (i = 0; i < layout->count; i++) {
+            RegField *f = &layout->fields[i];
+            RK_U32 va, vb;
+
+            if (f->word != word)
+                continue;
+
+            va = field_value(a, f);
+            vb = field_value(b, f);
+            if (va != vb) {
+                mpp_log("frame %4d reg %04x %-40s %8x -> %8x\n", frame, reg * 4,
+                        f->name, va, vb);
+                found++;
+            }
+        }
+
+        if (found)
+            return found;
+    }
+
+    mpp_log("frame %4d %-6s %x reg %04x %08x -> %08x\n", frame,
+            record_type_str[type], rec->hdr.offset, reg * 4, a, b);
+    return 1;
+}
+
+static RK_S32 diff_frame(RegDiffCtx *ctx, RK_S32 frame)
+{
+    RegTrace *ta = &ctx->trace[0];
+    RegTrace *tb = &ctx->trace[1];
+    RK_S32 ia = ta->frames[frame];
+    RK_S32 ib = tb->frames[frame];
+    RK_S32 ea = frame_end(ta, frame);
+    RK_S32 eb = frame_end(tb, frame);
+    RK_S32 diff = 0;
+
+    /* read back records are hardware output only compare the programming */
+    while (ia < ea && ib < eb) {
+        RegRecord *ra = &ta->records[ia];
+        RegRecord *rb = &tb->records[ib];
+        RK_U32 words;
+        RK_U32 i;
+
+        if (ra->hdr.type == MPP_DEV_RECORD_READ) {
+            ia++;
+            continue;
+        }
+
+        if (rb->hdr.type == MPP_DEV_RECORD_READ) {
+            ib++;
+            continue;
+        }
+
+        if (ra->hdr.type != rb->hdr.type || ra->hdr.offset != rb->hdr.offset) {
+            mpp_log("frame %4d record mismatch %s %x -> %s %x\n", frame,
+                    record_type_str[ra->hdr.type], ra->hdr.offset,
+                    record_type_str[rb->hdr.type], rb->hdr.offset);
+            return diff + 1;
+        }
+
+        if (ra->hdr.size != rb->hdr.size) {
+            mpp_log("frame %4d %s %x size %d -> %d\n", frame,
+                    record_type_str[ra->hdr.type], ra->hdr.offset,
+                    ra->hdr.size, rb->hdr.size);
+            diff++;
+        }
+
+        words = MPP_MIN(ra->hdr.size, rb->hdr.size) / 4;
+        for (i = 0; i < words; i++) {
+            if (ra->data[i] != rb->data[i])
+                diff += diff_word(ctx, frame, ra, i, ra->data[i], rb->data[i]);
+        }
+
+        ia++;
+        ib++;
+    }
+
+    for (; ia < ea; ia++) {
+        if (ta->records[ia].hdr.type != MPP_DEV_RECORD_READ) {
+            mpp_log("frame %4d extra record in %s\n", frame, ctx->path[0]);
+            return diff + 1;
+        }
+    }
+
+    for (; ib < eb; ib++) {
+        if (tb->records[ib].hdr.type != MPP_DEV_RECORD_READ) {
+            mpp_log("frame %4d extra record in %s\n", frame, ctx->path[1]);
+            return diff + 1;
+        }
+    }
+
+    return diff;
+}
+
+static void show_usage(void)
+{
+    mpp_log("usage: mpp_reg_diff trace_a trace_b [-l layout.h] [-s struct] [-o offset]\n");
+    mpp_log("  -l  register struct header for field decoding\n");
+    mpp_log("  -s  register struct name, default the largest struct in header\n");
+    mpp_log("  -o  register offset of the struct in write records, default 0\n");
+}
+
+int main(int argc, char **argv)
+{
+    RegDiffCtx ctx;
+    RK_S32 path_cnt = 0;
+    RK_S32 frame_diff = 0;
+    RK_S32 frames;
+    RK_S32 i;
+    MPP_RET ret = MPP_NOK;
+
+    memset(&ctx, 0, sizeof(ctx));
+
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && i + 1 < argc) {
+            switch (argv[i][1]) {
+            case 'l' : ctx.layout_path = argv[++i]; break;
+            case 's' : ctx.struct_name = argv[++i]; break;
+            case 'o' : ctx.offset = strtoul(argv[++i], NULL, 0); break;
+            default : {
+                show_usage();
+                return -1;
+            } break;
+            }
+        } else if (path_cnt < 2) {
+            ctx.path[path_cnt++] = argv[i];
+        }
+    }
+
+    if (path_cnt < 2) {
+        show_usage();
+        return -1;
+    }
+
+    if (ctx.layout_path && layout_load(&ctx))
+        goto DONE;
+
+    if (trace_load(&ctx.trace[0], ctx.path[0]) ||
+        trace_load(&ctx.trace[1], ctx.path[1]))
+        goto DONE;
+
+    frames = MPP_MIN(ctx.trace[0].frame_count, ctx.trace[1].frame_count);
+    for (i = 0; i < frames; i++) {
+        if (diff_frame(&ctx, i))
+            frame_diff++;
+    }
+
+    if (ctx.trace[0].frame_count != ctx.trace[1].frame_count)
+        mpp_log("frame count mismatch %d -> %d\n",
+                ctx.trace[0].frame_count, ctx.trace[1].frame_count);
+
+    mpp_log("%d frames compared %d frames differ\n", frames, frame_diff);
+
+    if (!frame_diff && ctx.trace[0].frame_count == ctx.trace[1].frame_count)
+        ret = MPP_OK;
+
+DONE:
+    trace_unload(&ctx.trace[0]);
+    trace_unload(&ctx.trace[1]);
+    for (i = 0; i < ctx.layout_count; i++)
+        MPP_FREE(ctx.layouts[i].fields);
+
+    return ret;
+}
@@ -17,8 +17,11 @@
 #ifndef __MPP_H__
 #define __MPP_H__
 
+#include "mpp_hist.h"
+#include "mpp_ring.h"
 #include "mpp_queue.h"
 #include "mpp_task_impl.h"
+#include "mpp_device_sched.h"
 
 #include "mpp_dec.h"
 #include "mpp_enc.h"
@@ -29,6 +32,15 @@
 #define MPP_DBG_FRAME                       (0x00000004)
 #define MPP_DBG_BUFFER                      (0x00000008)
 
+/*
+ * fifo size between user and decoder
+ * packet fifo is limited to 4 packets by put_packet and the eos / extra data
+ * packets can exceed the limit. Frame fifo is limited by display queue check
+ * in decoder except the frames flushed out at once on eos / info change.
+ */
+#define MPP_PACKET_RING_SIZE                (16)
+#define MPP_FRAME_RING_SIZE                 (64)
+
 /*
  * mpp notify event flags
  * When event happens mpp will signal deocder / encoder with different flag.
@@ -107,6 +119,10 @@ public:
     MPP_RET poll(MppPortType type, MppPollType timeout);
     MPP_RET dequeue(MppPortType type, MppTask *task);
     MPP_RET enqueue(MppPortType type, MppTask task);
+    MPP_RET dequeue_n(MppPortType type, MppTask *tasks, RK_S32 max, RK_S32 *count);
+    MPP_RET enqueue_n(MppPortType type, MppTask *tasks, RK_S32 count);
+    MPP_RET decode_batch(MppPacket *packets, MppFrame *frames,
+                         MPP_RET *results, RK_S32 count);
 
     MPP_RET reset();
     MPP_RET control(MpiCmd cmd, MppParam param);
@@ -114,8 +130,12 @@ public:
     MPP_RET notify(RK_U32 flag);
     MPP_RET notify(MppBufferGroup group);
 
-    mpp_list        *mPackets;
-    mpp_list        *mFrames;
+    /* lock-free fifo of MppPacket / MppFrame */
+    MppRing         mPackets;
+    MppRing         mFrames;
+    /* serialize put_packet with the packet flush in reset */
+    Mutex           mPacketLock;
+    /* unbounded list of MppPacket for pts, it is never dropped */
     mpp_list        *mTimeStamps;
     /* counters for debug */
     RK_U32          mPacketPutCount;
@@ -147,6 +167,26 @@ public:
     MppPollType     mInputTimeout;
     MppPollType     mOutputTimeout;
 
+    /*
+     * Output eventfd created on MPP_GET_OUTPUT_EVENT_FD
+     * It is readable while output frame / packet is ready to get.
+     * Decoder updates it with mFrames lock. Encoder attaches it to output port.
+     */
+    RK_S32          mOutputEventFd;
+
+    /*
+     * Always-on latency histograms in us, refer to MppLatencyType
+     * Most histograms are only recorded by one codec thread. Decoder in_out
+     * is recorded by parser, hal and vproc thread with atomic record.
+     */
+    MppHist         mLatency[MPP_LATENCY_BUTT];
+
+    /*
+     * Hardware scheduling client bound by codec threads. The hardware jobs
+     * of this context are scheduled by its priority / deadline.
+     */
+    MppDevSchedClient mHwSched;
+
     MppTask         mInputTask;
 
     MppDec          mDec;
@@ -170,6 +210,12 @@ private:
     RK_U32          mParserNeedSplit;
     RK_U32          mParserInternalPts;     /* for MPEG2/MPEG4 */
     RK_U32          mImmediateOut;
+    /* reference input packet data without copy */
+    RK_U32          mPacketZeroCopy;
+    RK_U32          mEncPipeline;
+    /* task queue depth before init, zero for default */
+    RK_S32          mInputTaskCount;
+    RK_S32          mOutputTaskCount;
     /* backup extra packet for seek */
     MppPacket       mExtraPacket;
 
@@ -177,6 +223,8 @@ private:
     MppDump         mDump;
 
     MPP_RET control_mpp(MpiCmd cmd, MppParam param);
+    MPP_RET get_output_eventfd(RK_S32 *fd);
+    MPP_RET get_latency_stat(MppLatencyStat *stat);
     MPP_RET control_osal(MpiCmd cmd, MppParam param);
     MPP_RET control_codec(MpiCmd cmd, MppParam param);
     MPP_RET control_dec(MpiCmd cmd, MppParam param);
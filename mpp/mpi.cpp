@@ -27,6 +27,7 @@
 #include "mpp_info.h"
 #include "mpp_common.h"
 #include "mpp_env.h"
+#include "mpp_lock_prof.h"
 
 RK_U32 mpi_debug = 0;
 
@@ -305,9 +306,9 @@ static MPP_RET mpi_poll(MppCtx ctx, MppPortType type, MppPollType timeout)
         if (ret)
             break;;
 
+        /* MPP_POLL_BUTT is kept valid for mpi poll */
         if (type >= MPP_PORT_BUTT ||
-            timeout < MPP_POLL_BUTT ||
-            timeout > MPP_POLL_MAX) {
+            (timeout != MPP_POLL_BUTT && mpp_poll_type_check(timeout))) {
             mpp_err_f("invalid input type %d timeout %d\n", type, timeout);
             ret = MPP_ERR_UNKNOW;
             break;
@@ -368,6 +369,78 @@ static MPP_RET mpi_enqueue(MppCtx ctx, MppPortType type, MppTask task)
     return ret;
 }
 
+static MPP_RET mpi_dequeue_n(MppCtx ctx, MppPortType type, MppTask *tasks,
+                             RK_S32 max, RK_S32 *count)
+{
+    MPP_RET ret = MPP_NOK;
+    MpiImpl *p = (MpiImpl *)ctx;
+
+    mpi_dbg_func("enter ctx %p type %d tasks %p max %d\n", ctx, type, tasks, max);
+    do {
+        ret = check_mpp_ctx(p);
+        if (ret)
+            break;;
+
+        if (type >= MPP_PORT_BUTT || NULL == tasks || max <= 0 || NULL == count) {
+            mpp_err_f("invalid input type %d tasks %p max %d count %p\n",
+                      type, tasks, max, count);
+            ret = MPP_ERR_UNKNOW;
+            break;
+        }
+
+        ret = p->ctx->dequeue_n(type, tasks, max, count);
+    } while (0);
+
+    mpi_dbg_func("leave ret %d\n", ret);
+    return ret;
+}
+
+static MPP_RET mpi_enqueue_n(MppCtx ctx, MppPortType type, MppTask *tasks,
+                             RK_S32 count)
+{
+    MPP_RET ret = MPP_NOK;
+    MpiImpl *p = (MpiImpl *)ctx;
+
+    mpi_dbg_func("enter ctx %p type %d tasks %p count %d\n", ctx, type, tasks, count);
+    do {
+        ret = check_mpp_ctx(p);
+        if (ret)
+            break;;
+
+        if (type >= MPP_PORT_BUTT || NULL == tasks || count <= 0) {
+            mpp_err_f("invalid input type %d tasks %p count %d\n",
+                      type, tasks, count);
+            ret = MPP_ERR_UNKNOW;
+            break;
+        }
+
+        ret = p->ctx->enqueue_n(type, tasks, count);
+    } while (0);
+
+    mpi_dbg_func("leave ret %d\n", ret);
+    return ret;
+}
+
+static MPP_RET mpi_decode_batch(MppCtx ctx, MppPacket *packets, MppFrame *frames,
+                                MPP_RET *results, RK_S32 count)
+{
+    MPP_RET ret = MPP_NOK;
+    MpiImpl *p = (MpiImpl *)ctx;
+
+    mpi_dbg_func("enter ctx %p packets %p frames %p count %d\n", ctx,
+                 packets, frames, count);
+    do {
+        ret = check_mpp_ctx(p);
+        if (ret)
+            break;;
+
+        ret = p->ctx->decode_batch(packets, frames, results, count);
+    } while (0);
+
+    mpi_dbg_func("leave ret %d\n", ret);
+    return ret;
+}
+
 static MPP_RET mpi_reset(MppCtx ctx)
 {
     MPP_RET ret = MPP_NOK;
@@ -421,6 +494,9 @@ static MppApi mpp_api = {
     mpi_enqueue,
     mpi_reset,
     mpi_control,
+    mpi_dequeue_n,
+    mpi_enqueue_n,
+    mpi_decode_batch,
     {0},
 };
 
@@ -511,6 +587,8 @@ MPP_RET mpp_destroy(MppCtx ctx)
             delete p->ctx;
 
         mpp_free(p);
+
+        mpp_lock_prof_dump();
     } while (0);
 
     mpi_dbg_func("leave ret %d\n", ret);
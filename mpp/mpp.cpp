@@ -17,6 +17,7 @@
 #define  MODULE_TAG "mpp"
 
 #include <errno.h>
+#include <string.h>
 
 #include "rk_mpi.h"
 
@@ -25,6 +26,7 @@
 #include "mpp_env.h"
 #include "mpp_time.h"
 #include "mpp_impl.h"
+#include "mpp_eventfd.h"
 
 #include "mpp.h"
 #include "mpp_hal.h"
@@ -37,6 +39,8 @@
 #define MPP_TEST_FRAME_SIZE     SZ_1M
 #define MPP_TEST_PACKET_SIZE    SZ_512K
 
+static const char *latency_name[MPP_LATENCY_BUTT] = MPP_LATENCY_NAMES;
+
 static void mpp_notify_by_buffer_group(void *arg, void *group)
 {
     Mpp *mpp = (Mpp *)arg;
@@ -50,10 +54,20 @@ static void *list_wraper_packet(void *arg)
     return NULL;
 }
 
-static void *list_wraper_frame(void *arg)
+static void mpp_ring_flush_packet(MppRing ring)
 {
-    mpp_frame_deinit((MppFrame *)arg);
-    return NULL;
+    MppPacket pkt = NULL;
+
+    while (!mpp_ring_get(ring, &pkt, 0))
+        mpp_packet_deinit(&pkt);
+}
+
+static void mpp_ring_flush_frame(MppRing ring)
+{
+    MppFrame frm = NULL;
+
+    while (!mpp_ring_get(ring, &frm, 0))
+        mpp_frame_deinit(&frm);
 }
 
 Mpp::Mpp()
@@ -75,6 +89,8 @@ Mpp::Mpp()
       mOutputTaskQueue(NULL),
       mInputTimeout(MPP_POLL_BUTT),
       mOutputTimeout(MPP_POLL_BUTT),
+      mOutputEventFd(-1),
+      mHwSched(NULL),
       mInputTask(NULL),
       mDec(NULL),
       mEnc(NULL),
@@ -88,11 +104,17 @@ Mpp::Mpp()
       mParserNeedSplit(0),
       mParserInternalPts(0),
       mImmediateOut(0),
+      mPacketZeroCopy(0),
+      mEncPipeline(0),
+      mInputTaskCount(0),
+      mOutputTaskCount(0),
       mExtraPacket(NULL),
       mDump(NULL)
 {
     mpp_env_get_u32("mpp_debug", &mpp_debug, 0);
     mpp_dump_init(&mDump);
+    memset(mLatency, 0, sizeof(mLatency));
+    mpp_dev_sched_client_init(&mHwSched);
 }
 
 MPP_RET Mpp::init(MppCtxType type, MppCodingType coding)
@@ -110,10 +132,13 @@ MPP_RET Mpp::init(MppCtxType type, MppCodingType coding)
     mpp_task_queue_init(&mInputTaskQueue, this, "input");
     mpp_task_queue_init(&mOutputTaskQueue, this, "output");
 
+    for (RK_S32 i = 0; i < MPP_LATENCY_BUTT; i++)
+        mLatency[i] = mpp_hist_get(latency_name[i]);
+
     switch (mType) {
     case MPP_CTX_DEC : {
-        mPackets    = new mpp_list(list_wraper_packet);
-        mFrames     = new mpp_list(list_wraper_frame);
+        mpp_ring_init(&mPackets, MPP_PACKET_RING_SIZE);
+        mpp_ring_init(&mFrames, MPP_FRAME_RING_SIZE);
         mTimeStamps = new mpp_list(list_wraper_packet);
 
         if (mInputTimeout == MPP_POLL_BUTT)
@@ -122,17 +147,20 @@ MPP_RET Mpp::init(MppCtxType type, MppCodingType coding)
         if (mOutputTimeout == MPP_POLL_BUTT)
             mOutputTimeout = MPP_POLL_NON_BLOCK;
 
+        RK_S32 task_count = 1;
+
         if (mCoding != MPP_VIDEO_CodingMJPEG) {
             mpp_buffer_group_get_internal(&mPacketGroup, MPP_BUFFER_TYPE_ION);
             mpp_buffer_group_limit_config(mPacketGroup, 0, 3);
 
-            mpp_task_queue_setup(mInputTaskQueue, 4);
-            mpp_task_queue_setup(mOutputTaskQueue, 4);
-        } else {
-            mpp_task_queue_setup(mInputTaskQueue, 1);
-            mpp_task_queue_setup(mOutputTaskQueue, 1);
+            task_count = 4;
         }
 
+        mpp_task_queue_setup(mInputTaskQueue,
+                             (mInputTaskCount) ? (mInputTaskCount) : (task_count));
+        mpp_task_queue_setup(mOutputTaskQueue,
+                             (mOutputTaskCount) ? (mOutputTaskCount) : (task_count));
+
         mInputPort  = mpp_task_queue_get_port(mInputTaskQueue,  MPP_PORT_INPUT);
         mOutputPort = mpp_task_queue_get_port(mOutputTaskQueue, MPP_PORT_OUTPUT);
 
@@ -151,8 +179,8 @@ MPP_RET Mpp::init(MppCtxType type, MppCodingType coding)
         mInitDone = 1;
     } break;
     case MPP_CTX_ENC : {
-        mFrames     = new mpp_list(NULL);
-        mPackets    = new mpp_list(list_wraper_packet);
+        mpp_ring_init(&mFrames, MPP_FRAME_RING_SIZE);
+        mpp_ring_init(&mPackets, MPP_PACKET_RING_SIZE);
 
         if (mInputTimeout == MPP_POLL_BUTT)
             mInputTimeout = MPP_POLL_BLOCK;
@@ -163,8 +191,17 @@ MPP_RET Mpp::init(MppCtxType type, MppCodingType coding)
         mpp_buffer_group_get_internal(&mPacketGroup, MPP_BUFFER_TYPE_ION);
         mpp_buffer_group_get_internal(&mFrameGroup, MPP_BUFFER_TYPE_ION);
 
-        mpp_task_queue_setup(mInputTaskQueue, 1);
-        mpp_task_queue_setup(mOutputTaskQueue, 1);
+        /* pipeline mode needs two tasks for the frames in flight */
+        RK_S32 task_count = (mEncPipeline) ? 2 : 1;
+
+        /*
+         * deeper queue only buffers more tasks for user and encoder thread
+         * still works on task_count tasks at the same time
+         */
+        mpp_task_queue_setup(mInputTaskQueue,
+                             MPP_MAX(task_count, mInputTaskCount));
+        mpp_task_queue_setup(mOutputTaskQueue,
+                             MPP_MAX(task_count, mOutputTaskCount));
 
         mInputPort  = mpp_task_queue_get_port(mInputTaskQueue,  MPP_PORT_INPUT);
         mOutputPort = mpp_task_queue_get_port(mOutputTaskQueue, MPP_PORT_OUTPUT);
@@ -172,6 +209,7 @@ MPP_RET Mpp::init(MppCtxType type, MppCodingType coding)
         MppEncInitCfg cfg = {
             coding,
             this,
+            task_count,
         };
 
         /* H.264 and H.265 check encoder path version */
@@ -252,17 +290,37 @@ void Mpp::clear()
     mInputPort = NULL;
     mOutputPort = NULL;
 
+    for (RK_S32 i = 0; i < MPP_LATENCY_BUTT; i++) {
+        if (mLatency[i]) {
+            mpp_hist_put(mLatency[i]);
+            mLatency[i] = NULL;
+        }
+    }
+
+    if (mOutputEventFd >= 0) {
+        mpp_eventfd_put(mOutputEventFd);
+        mOutputEventFd = -1;
+    }
+
+    /* all device sessions using the client are closed on codec deinit */
+    if (mHwSched) {
+        mpp_dev_sched_client_deinit(mHwSched);
+        mHwSched = NULL;
+    }
+
     if (mExtraPacket) {
         mpp_packet_deinit(&mExtraPacket);
         mExtraPacket = NULL;
     }
 
     if (mPackets) {
-        delete mPackets;
+        mpp_ring_flush_packet(mPackets);
+        mpp_ring_deinit(mPackets);
         mPackets = NULL;
     }
     if (mFrames) {
-        delete mFrames;
+        mpp_ring_flush_frame(mFrames);
+        mpp_ring_deinit(mFrames);
         mFrames = NULL;
     }
     if (mTimeStamps) {
@@ -286,20 +344,32 @@ MPP_RET Mpp::put_packet(MppPacket packet)
     if (!mInitDone)
         return MPP_ERR_INIT;
 
-    AutoMutex autoLock(mPackets->mutex());
+    AutoMutex autoLock(&mPacketLock);
+    RK_S64 in_time = mpp_time();
+
     if (mExtraPacket) {
-        mPackets->add_at_tail(&mExtraPacket, sizeof(mExtraPacket));
+        ((MppPacketImpl *)mExtraPacket)->in_time = in_time;
+        if (mpp_ring_put(mPackets, mExtraPacket))
+            return MPP_ERR_BUFFER_FULL;
+
         mExtraPacket = NULL;
         mPacketPutCount++;
     }
 
     RK_U32 eos = mpp_packet_get_eos(packet);
-    if (mPackets->list_size() < 4 || eos) {
+    if (mpp_ring_size(mPackets) < 4 || eos) {
         MppPacket pkt;
-        if (MPP_OK != mpp_packet_copy_init(&pkt, packet))
+        MPP_RET ret = (mPacketZeroCopy) ?
+                      mpp_packet_ref_init(&pkt, packet) :
+                      mpp_packet_copy_init(&pkt, packet);
+        if (MPP_OK != ret)
             return MPP_NOK;
 
-        mPackets->add_at_tail(&pkt, sizeof(pkt));
+        ((MppPacketImpl *)pkt)->in_time = in_time;
+        if (mpp_ring_put(mPackets, pkt)) {
+            mpp_packet_deinit(&pkt);
+            return MPP_ERR_BUFFER_FULL;
+        }
         mPacketPutCount++;
         // dump input packet
         mpp_ops_dec_put_pkt(mDump, packet);
@@ -319,45 +389,50 @@ MPP_RET Mpp::get_frame(MppFrame *frame)
     if (!mInitDone)
         return MPP_ERR_INIT;
 
-    AutoMutex autoFrameLock(mFrames->mutex());
     MppFrame first = NULL;
+    RK_S64 timeout = 0;
+    MPP_RET ret;
 
-    if (0 == mFrames->list_size()) {
-        if (mOutputTimeout) {
-            if (mOutputTimeout < 0) {
-                /* block wait */
-                mFrames->wait();
-            } else {
-                RK_S32 ret = mFrames->wait(mOutputTimeout);
-                if (ret) {
-                    if (ret == ETIMEDOUT)
-                        return MPP_ERR_TIMEOUT;
-                    else
-                        return MPP_NOK;
-                }
-            }
-        } else {
-            /* NOTE: in non-block mode the sleep is to avoid user's dead loop */
-            msleep(1);
-        }
+    if (mOutputTimeout)
+        timeout = (mOutputTimeout < 0) ? -1 : mpp_poll_timeout_us(mOutputTimeout);
+
+    ret = mpp_ring_get(mFrames, &first, timeout);
+    if (ret == MPP_ERR_TIMEOUT)
+        return MPP_ERR_TIMEOUT;
+
+    if (ret && !mOutputTimeout && mOutputEventFd < 0) {
+        /*
+         * NOTE: in non-block mode the sleep is to avoid user's dead loop
+         * User waiting on output eventfd does not need it.
+         */
+        msleep(1);
+        ret = mpp_ring_get(mFrames, &first, 0);
     }
 
-    if (mFrames->list_size()) {
-        mFrames->del_at_head(&first, sizeof(frame));
+    if (!ret) {
         mFrameGetCount++;
         notify(MPP_OUTPUT_DEQUEUE);
 
         if (mMultiFrame) {
             MppFrame prev = first;
             MppFrame next = NULL;
-            while (mFrames->list_size()) {
-                mFrames->del_at_head(&next, sizeof(frame));
+            while (!mpp_ring_get(mFrames, &next, 0)) {
                 mFrameGetCount++;
                 notify(MPP_OUTPUT_DEQUEUE);
                 mpp_frame_set_next(prev, next);
                 prev = next;
             }
         }
+
+        /*
+         * Decoder writes eventfd on each frame. Clear it on empty and check
+         * again for the frame put between empty check and eventfd read.
+         */
+        if (mOutputEventFd >= 0 && mpp_ring_is_empty(mFrames)) {
+            mpp_eventfd_read(mOutputEventFd, NULL, 0);
+            if (!mpp_ring_is_empty(mFrames))
+                mpp_eventfd_write(mOutputEventFd, 1);
+        }
     } else {
         // NOTE: Add signal here is not efficient
         // This is for fix bug of stucking on decoder parser thread
@@ -365,8 +440,7 @@ MPP_RET Mpp::get_frame(MppFrame *frame)
         // There is no way to wake up parser thread to continue decoding.
         // The put_packet only signal sem on may be it better to use sem on info
         // change too.
-        AutoMutex autoPacketLock(mPackets->mutex());
-        if (mPackets->list_size())
+        if (!mpp_ring_is_empty(mPackets))
             notify(MPP_INPUT_ENQUEUE);
     }
 
@@ -589,6 +663,176 @@ MPP_RET Mpp::enqueue(MppPortType type, MppTask task)
     return ret;
 }
 
+MPP_RET Mpp::dequeue_n(MppPortType type, MppTask *tasks, RK_S32 max, RK_S32 *count)
+{
+    if (!mInitDone)
+        return MPP_ERR_INIT;
+
+    MPP_RET ret = MPP_NOK;
+    MppTaskQueue port = NULL;
+    RK_U32 notify_flag = 0;
+
+    switch (type) {
+    case MPP_PORT_INPUT : {
+        port = mInputPort;
+        notify_flag = MPP_INPUT_DEQUEUE;
+    } break;
+    case MPP_PORT_OUTPUT : {
+        port = mOutputPort;
+        notify_flag = MPP_OUTPUT_DEQUEUE;
+    } break;
+    default : {
+    } break;
+    }
+
+    if (port) {
+        ret = mpp_port_dequeue_n(port, tasks, max, count);
+        if (MPP_OK == ret)
+            notify(notify_flag);
+    }
+
+    return ret;
+}
+
+MPP_RET Mpp::enqueue_n(MppPortType type, MppTask *tasks, RK_S32 count)
+{
+    if (!mInitDone)
+        return MPP_ERR_INIT;
+
+    MPP_RET ret = MPP_NOK;
+    MppTaskQueue port = NULL;
+    RK_U32 notify_flag = 0;
+
+    switch (type) {
+    case MPP_PORT_INPUT : {
+        port = mInputPort;
+        notify_flag = MPP_INPUT_ENQUEUE;
+    } break;
+    case MPP_PORT_OUTPUT : {
+        port = mOutputPort;
+        notify_flag = MPP_OUTPUT_ENQUEUE;
+    } break;
+    default : {
+    } break;
+    }
+
+    if (port) {
+        ret = mpp_port_enqueue_n(port, tasks, count);
+        // wait up thread once for the whole batch
+        if (MPP_OK == ret)
+            notify(notify_flag);
+    }
+
+    return ret;
+}
+
+MPP_RET Mpp::decode_batch(MppPacket *packets, MppFrame *frames,
+                          MPP_RET *results, RK_S32 count)
+{
+    if (!mInitDone)
+        return MPP_ERR_INIT;
+
+    if (mType != MPP_CTX_DEC || mCoding != MPP_VIDEO_CodingMJPEG) {
+        mpp_err_f("batch decode only support mjpeg decoder\n");
+        return MPP_ERR_VALUE;
+    }
+
+    if (NULL == packets || NULL == frames || NULL == results || count <= 0) {
+        mpp_err_f("invalid input packets %p frames %p results %p count %d\n",
+                  packets, frames, results, count);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    RK_S32 i;
+
+    for (i = 0; i < count; i++) {
+        if (NULL == packets[i] || NULL == frames[i]) {
+            mpp_err_f("invalid packet %p frame %p at %d\n",
+                      packets[i], frames[i], i);
+            return MPP_ERR_NULL_PTR;
+        }
+        results[i] = MPP_NOK;
+    }
+
+    MppTask tasks[MPP_TASK_COUNT_MAX];
+    MPP_RET ret = MPP_OK;
+    RK_S32 total = count;
+    RK_S32 sent = 0;
+    RK_S32 done = 0;
+
+    /*
+     * Send as many packets as the input port can hold in one enqueue then
+     * collect the frames in one dequeue. The output order is the same as the
+     * input order. On send failure the tasks in flight are still collected.
+     */
+    while (done < total) {
+        RK_S32 n = 0;
+
+        if (sent < total) {
+            // nothing in flight so wait for idle input task
+            if (done == sent)
+                poll(MPP_PORT_INPUT, MPP_POLL_BLOCK);
+
+            if (!dequeue_n(MPP_PORT_INPUT, tasks,
+                           MPP_MIN(total - sent, MPP_TASK_COUNT_MAX), &n)) {
+                for (i = 0; i < n; i++) {
+                    mpp_task_meta_set_packet(tasks[i], KEY_INPUT_PACKET, packets[sent + i]);
+                    mpp_task_meta_set_frame (tasks[i], KEY_OUTPUT_FRAME, frames[sent + i]);
+                }
+
+                if (enqueue_n(MPP_PORT_INPUT, tasks, n)) {
+                    mpp_err_f("enqueue %d packets at %d failed\n", n, sent);
+
+                    // clear the meta and return the tasks to input port
+                    for (i = 0; i < n; i++) {
+                        MppPacket packet = NULL;
+                        MppFrame frame = NULL;
+
+                        mpp_task_meta_get_packet(tasks[i], KEY_INPUT_PACKET, &packet);
+                        mpp_task_meta_get_frame (tasks[i], KEY_OUTPUT_FRAME, &frame);
+                    }
+                    mpp_port_cancel_n(mInputPort, tasks, n);
+
+                    ret = MPP_NOK;
+                    total = sent;
+                    continue;
+                }
+
+                sent += n;
+            }
+        }
+
+        if (done == sent)
+            continue;
+
+        poll(MPP_PORT_OUTPUT, MPP_POLL_BLOCK);
+        if (dequeue_n(MPP_PORT_OUTPUT, tasks,
+                      MPP_MIN(sent - done, MPP_TASK_COUNT_MAX), &n))
+            continue;
+
+        for (i = 0; i < n; i++) {
+            MppFrame frame = NULL;
+
+            mpp_task_meta_get_frame(tasks[i], KEY_OUTPUT_FRAME, &frame);
+
+            if (frame && frame != frames[done]) {
+                // decoder returns a new error frame when packet has no buffer
+                mpp_frame_deinit(&frame);
+                mpp_frame_set_errinfo(frames[done], 1);
+                frame = frames[done];
+            }
+
+            results[done] = (frame && !mpp_frame_get_errinfo(frame)) ?
+                            MPP_OK : MPP_NOK;
+            done++;
+        }
+
+        enqueue_n(MPP_PORT_OUTPUT, tasks, n);
+    }
+
+    return ret;
+}
+
 MPP_RET Mpp::control(MpiCmd cmd, MppParam param)
 {
     MPP_RET ret = MPP_NOK;
@@ -615,6 +859,19 @@ MPP_RET Mpp::control(MpiCmd cmd, MppParam param)
             ret = control_dec(cmd, param);
         } break;
         case CMD_CTX_ID_ENC : {
+            /* pipeline mode is set before init when there is no encoder */
+            if (cmd == MPP_ENC_SET_TASK_PIPELINE) {
+                if (mInitDone || NULL == param) {
+                    mpp_err("pipeline mode should be set before init\n");
+                    ret = MPP_NOK;
+                    break;
+                }
+
+                mEncPipeline = *((RK_U32 *)param);
+                ret = MPP_OK;
+                break;
+            }
+
             mpp_assert(mType == MPP_CTX_ENC);
             mpp_assert(cmd > MPP_ENC_CMD_BASE);
             mpp_assert(cmd < MPP_ENC_CMD_END);
@@ -658,10 +915,10 @@ MPP_RET Mpp::reset()
          * To avoid this case happen we need to save it on reset beginning
          * then restore it on reset end.
          */
-        mPackets->lock();
-        while (mPackets->list_size()) {
-            MppPacket pkt = NULL;
-            mPackets->del_at_head(&pkt, sizeof(pkt));
+        MppPacket pkt = NULL;
+
+        mPacketLock.lock();
+        while (!mpp_ring_get(mPackets, &pkt, 0)) {
             mPacketGetCount++;
 
             RK_U32 flags = mpp_packet_get_flag(pkt);
@@ -674,18 +931,15 @@ MPP_RET Mpp::reset()
                 mpp_packet_deinit(&pkt);
             }
         }
-        mPackets->flush();
-        mPackets->unlock();
+        mPacketLock.unlock();
 
         mpp_dec_reset(mDec);
 
-        mFrames->lock();
-        mFrames->flush();
-        mFrames->unlock();
+        mpp_ring_flush_frame(mFrames);
+        if (mOutputEventFd >= 0)
+            mpp_eventfd_read(mOutputEventFd, NULL, 0);
     } else {
-        mFrames->lock();
-        mFrames->flush();
-        mFrames->unlock();
+        mpp_ring_flush_frame(mFrames);
 
         if (mEncVersion) {
             mpp_enc_reset_v2(mEnc);
@@ -693,9 +947,56 @@ MPP_RET Mpp::reset()
             mpp_enc_reset(mEnc);
         }
 
-        mPackets->lock();
-        mPackets->flush();
-        mPackets->unlock();
+        mpp_ring_flush_packet(mPackets);
+    }
+
+    return MPP_OK;
+}
+
+MPP_RET Mpp::get_output_eventfd(RK_S32 *fd)
+{
+    if (mOutputEventFd < 0) {
+        RK_S32 eventfd = mpp_eventfd_get(0);
+
+        if (eventfd < 0) {
+            mpp_err_f("failed to create output eventfd ret %d\n", eventfd);
+            return MPP_NOK;
+        }
+
+        if (mType == MPP_CTX_DEC) {
+            mOutputEventFd = eventfd;
+
+            /* decoder may put frame before the eventfd is visible */
+            if (!mpp_ring_is_empty(mFrames))
+                mpp_eventfd_write(eventfd, 1);
+        } else {
+            mOutputEventFd = eventfd;
+            mpp_port_set_eventfd(mOutputPort, eventfd);
+        }
+    }
+
+    *fd = mOutputEventFd;
+    return MPP_OK;
+}
+
+MPP_RET Mpp::get_latency_stat(MppLatencyStat *stat)
+{
+    for (RK_S32 i = 0; i < MPP_LATENCY_BUTT; i++) {
+        MppLatencyInfo *info = &stat->info[i];
+        MppHist hist = mLatency[i];
+
+        memset(info, 0, sizeof(*info));
+        if (NULL == hist)
+            continue;
+
+        info->count = mpp_hist_get_count(hist);
+        info->sum   = mpp_hist_get_sum(hist);
+        info->min   = mpp_hist_get_min(hist);
+        info->max   = mpp_hist_get_max(hist);
+        info->p50   = mpp_hist_get_percentile(hist, 500);
+        info->p90   = mpp_hist_get_percentile(hist, 900);
+        info->p99   = mpp_hist_get_percentile(hist, 990);
+        info->p999  = mpp_hist_get_percentile(hist, 999);
     }
 
     return MPP_OK;
@@ -712,8 +1013,8 @@ MPP_RET Mpp::control_mpp(MpiCmd cmd, MppParam param)
     case MPP_SET_OUTPUT_BLOCK_TIMEOUT : {
         MppPollType block = (param) ? *((MppPollType *)param) : MPP_POLL_NON_BLOCK;
 
-        if (block <= MPP_POLL_BUTT || block > MPP_POLL_MAX) {
-            mpp_err("invalid output timeout type %d should be in range [%d, %d]\n",
+        if (mpp_poll_type_check(block)) {
+            mpp_err("invalid output timeout type %d should be in range [%d, %d] or MPP_POLL_US\n",
                     block, MPP_POLL_BUTT, MPP_POLL_MAX);
             ret = MPP_ERR_VALUE;
             break;
@@ -730,8 +1031,8 @@ MPP_RET Mpp::control_mpp(MpiCmd cmd, MppParam param)
     case MPP_SET_OUTPUT_TIMEOUT: {
         MppPollType timeout = (param) ? *((MppPollType *)param) : MPP_POLL_NON_BLOCK;
 
-        if (timeout <= MPP_POLL_BUTT || timeout > MPP_POLL_MAX) {
-            mpp_err("invalid output timeout type %d should be in range [%d, %d]\n",
+        if (mpp_poll_type_check(timeout)) {
+            mpp_err("invalid output timeout type %d should be in range [%d, %d] or MPP_POLL_US\n",
                     timeout, MPP_POLL_BUTT, MPP_POLL_MAX);
             ret = MPP_ERR_VALUE;
             break;
@@ -742,6 +1043,81 @@ MPP_RET Mpp::control_mpp(MpiCmd cmd, MppParam param)
         else
             mOutputTimeout = timeout;
     } break;
+    case MPP_SET_INPUT_TASK_COUNT:
+    case MPP_SET_OUTPUT_TASK_COUNT: {
+        RK_S32 count = (param) ? *((RK_S32 *)param) : 0;
+
+        if (mInitDone) {
+            mpp_err("task count should be set before init\n");
+            ret = MPP_NOK;
+            break;
+        }
+
+        if (count < 0 || count > MPP_TASK_COUNT_MAX) {
+            mpp_err("invalid task count %d should be in range [0, %d]\n",
+                    count, MPP_TASK_COUNT_MAX);
+            ret = MPP_ERR_VALUE;
+            break;
+        }
+
+        if (cmd == MPP_SET_INPUT_TASK_COUNT)
+            mInputTaskCount = count;
+        else
+            mOutputTaskCount = count;
+    } break;
+    case MPP_GET_OUTPUT_EVENT_FD: {
+        if (!mInitDone) {
+            mpp_err("output eventfd is only available after init\n");
+            ret = MPP_ERR_INIT;
+            break;
+        }
+        if (NULL == param) {
+            ret = MPP_ERR_NULL_PTR;
+            break;
+        }
+
+        ret = get_output_eventfd((RK_S32 *)param);
+    } break;
+    case MPP_GET_LATENCY_STAT: {
+        if (!mInitDone) {
+            ret = MPP_ERR_INIT;
+            break;
+        }
+        if (NULL == param) {
+            ret = MPP_ERR_NULL_PTR;
+            break;
+        }
+
+        ret = get_latency_stat((MppLatencyStat *)param);
+    } break;
+    case MPP_RESET_LATENCY_STAT: {
+        if (!mInitDone) {
+            ret = MPP_ERR_INIT;
+            break;
+        }
+
+        /* NOTE: samples recorded during reset may be lost */
+        for (RK_S32 i = 0; i < MPP_LATENCY_BUTT; i++) {
+            if (mLatency[i])
+                mpp_hist_reset(mLatency[i]);
+        }
+    } break;
+    case MPP_SET_HW_SCHED_CFG: {
+        if (NULL == mHwSched || NULL == param) {
+            ret = MPP_ERR_NULL_PTR;
+            break;
+        }
+
+        ret = mpp_dev_sched_client_set_cfg(mHwSched, (MppHwSchedCfg *)param);
+    } break;
+    case MPP_GET_HW_SCHED_STAT: {
+        if (NULL == mHwSched || NULL == param) {
+            ret = MPP_ERR_NULL_PTR;
+            break;
+        }
+
+        ret = mpp_dev_sched_client_get_stat(mHwSched, (MppHwSchedStat *)param);
+    } break;
 
     default : {
         ret = MPP_NOK;
@@ -826,9 +1202,13 @@ MPP_RET Mpp::control_dec(MpiCmd cmd, MppParam param)
         mParserFastMode = flag;
         ret = MPP_OK;
     } break;
+    case MPP_DEC_SET_PACKET_ZERO_COPY: {
+        RK_U32 flag = *((RK_U32 *)param);
+        mPacketZeroCopy = flag;
+        ret = MPP_OK;
+    } break;
     case MPP_DEC_GET_STREAM_COUNT: {
-        AutoMutex autoLock(mPackets->mutex());
-        *((RK_S32 *)param) = mPackets->list_size();
+        *((RK_S32 *)param) = mpp_ring_size(mPackets);
         ret = MPP_OK;
     } break;
     case MPP_DEC_SET_IMMEDIATE_OUT: {
@@ -18,7 +18,11 @@
 #define MODULE_TAG "mpp_impl"
 
 #include <time.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/syscall.h>
 
@@ -27,7 +31,9 @@
 #include "mpp_env.h"
 #include "mpp_log.h"
 #include "mpp_mem.h"
+#include "mpp_ring.h"
 #include "mpp_time.h"
+#include "mpp_atomic.h"
 #include "mpp_thread.h"
 #include "mpp_common.h"
 
@@ -36,8 +42,16 @@
 #define MAX_FILE_NAME_LEN   512
 #define MAX_DUMP_WIDTH      960
 #define MAX_DUMP_HEIGHT     540
+#define MAX_OPS_LOG_LEN     128
 
-#define ops_log(fp, fmt, ...)   _ops_log(fp, fmt, ## __VA_ARGS__)
+/*
+ * Dump file is written in large block by writer thread. Block buffer is
+ * page aligned so it can be used on O_DIRECT file.
+ */
+#define DUMP_BLOCK_SIZE     SZ_1M
+#define DUMP_BLOCK_ALIGN    4096
+#define DUMP_QUEUE_SIZE     32
+#define DUMP_FRAME_MAX      4
 
 typedef enum MppOpsType_e {
     MPP_DEC_OPS_BASE        = 0,
@@ -45,6 +59,45 @@ typedef enum MppOpsType_e {
     MPP_DEC_SE
 } MppOpsType;
 
+typedef struct MppDumpFile_t {
+    RK_S32                  fd;
+    RK_U32                  direct;
+    RK_U8                   *buf;
+    RK_U32                  pos;
+} MppDumpFile;
+
+typedef enum MppDumpItemType_e {
+    DUMP_ITEM_PKT,
+    DUMP_ITEM_FRM,
+    DUMP_ITEM_OPS,
+    DUMP_ITEM_BUTT,
+} MppDumpItemType;
+
+/*
+ * Dump job passed to writer thread. The data is either in a referenced
+ * MppBuffer which will not be reused by its owner before release or in a
+ * copy owned by the item.
+ */
+typedef struct MppDumpItem_t {
+    MppDumpItemType         type;
+    MppDumpFile             *file;
+
+    MppBuffer               buffer;
+    RK_U8                   *copy;
+    RK_U8                   *data;
+    RK_U32                  size;
+
+    /* frame info for resample on writer thread */
+    RK_U32                  fmt;
+    RK_U32                  width;
+    RK_U32                  height;
+    RK_U32                  hor_stride;
+    RK_U32                  ver_stride;
+    RK_S64                  pts;
+
+    char                    log[MAX_OPS_LOG_LEN];
+} MppDumpItem;
+
 /* dump data */
 typedef struct MppDumpImpl_t {
     Mutex                   *lock;
@@ -56,9 +109,9 @@ typedef struct MppDumpImpl_t {
     MppCtxType              type;
     MppCodingType           coding;
 
-    FILE                    *fp_in;    // file for MppPacket
-    FILE                    *fp_out;    // file for MppFrame
-    FILE                    *fp_ops;    // file for decoder / encoder extra info
+    MppDumpFile             *fp_in;     // file for MppPacket
+    MppDumpFile             *fp_out;    // file for MppFrame
+    MppDumpFile             *fp_ops;    // file for decoder / encoder extra info
 
     RK_U8                   *fp_buf;    // for resample frame
     RK_U32                  pkt_offset;
@@ -67,6 +120,19 @@ typedef struct MppDumpImpl_t {
     RK_U32                  dump_size;
 
     RK_U32                  idx;
+
+    /* writer thread and its job queue */
+    MppThread               *thd;
+    MppRing                 queue;
+    RK_U32                  direct;
+    RK_U32                  frm_step;
+    RK_U32                  frm_max;
+    RK_U32                  frm_idx;
+    RK_S32                  frm_pending;
+
+    RK_S32                  done[DUMP_ITEM_BUTT];
+    RK_S32                  drop[DUMP_ITEM_BUTT];
+    RK_S32                  skip;
 } MppDumpImpl;
 
 typedef struct MppOpsInfo_t {
@@ -114,10 +180,17 @@ static const char enc_frm_path[] = "/data/mpp_enc_in.bin";
 static const char enc_ops_path[] = "/data/mpp_enc_ops.bin";
 static const char enc_pkt_path[] = "/data/mpp_enc_out.bin";
 
-static FILE *try_env_file(const char *env, const char *path, pid_t tid)
+/* writer thread quit on this item */
+static MppDumpItem dump_item_quit;
+
+static MppDumpFile *try_env_file(const char *env, const char *path, pid_t tid,
+                                 RK_U32 direct)
 {
     const char *fname = NULL;
-    FILE *fp = NULL;
+    MppDumpFile *file = NULL;
+    RK_S32 flags = O_WRONLY | O_CREAT | O_TRUNC;
+    RK_S32 fd = -1;
+    void *buf = NULL;
     char name[MAX_FILE_NAME_LEN];
 
     mpp_env_get_str(env, &fname, path);
@@ -126,10 +199,93 @@ static FILE *try_env_file(const char *env, const char *path, pid_t tid)
         fname = name;
     }
 
-    fp = fopen(fname, "w+b");
-    mpp_log("open %s %p for dump\n", fname, fp);
+    /* not all file system supports O_DIRECT, fallback to normal write */
+    if (direct)
+        fd = open(fname, flags | O_DIRECT, 0644);
+    if (fd < 0) {
+        direct = 0;
+        fd = open(fname, flags, 0644);
+    }
+
+    mpp_log("open %s fd %d direct %d for dump\n", fname, fd, direct);
+
+    if (fd < 0)
+        return NULL;
+
+    file = mpp_calloc(MppDumpFile, 1);
+    if (file && posix_memalign(&buf, DUMP_BLOCK_ALIGN, DUMP_BLOCK_SIZE)) {
+        MPP_FREE(file);
+        buf = NULL;
+    }
+
+    if (NULL == file) {
+        mpp_err("failed to alloc dump buffer for %s\n", fname);
+        close(fd);
+        return NULL;
+    }
+
+    file->fd = fd;
+    file->direct = direct;
+    file->buf = (RK_U8 *)buf;
+
+    return file;
+}
+
+static void dump_file_flush(MppDumpFile *file, RK_U32 size)
+{
+    RK_U8 *buf = file->buf;
+
+    while (size) {
+        ssize_t len = write(file->fd, buf, size);
+
+        if (len <= 0) {
+            mpp_err_f("fd %d write %d failed ret %d\n", file->fd, size, (RK_S32)len);
+            break;
+        }
+
+        buf += len;
+        size -= len;
+    }
+
+    file->pos = 0;
+}
+
+static void dump_file_write(MppDumpFile *file, const void *data, RK_U32 size)
+{
+    const RK_U8 *src = (const RK_U8 *)data;
+
+    while (size) {
+        RK_U32 len = MPP_MIN(size, DUMP_BLOCK_SIZE - file->pos);
+
+        memcpy(file->buf + file->pos, src, len);
+        file->pos += len;
+        src += len;
+        size -= len;
+
+        if (file->pos == DUMP_BLOCK_SIZE)
+            dump_file_flush(file, DUMP_BLOCK_SIZE);
+    }
+}
+
+static void dump_file_close(MppDumpFile **file)
+{
+    MppDumpFile *p = *file;
+
+    if (NULL == p)
+        return ;
+
+    if (p->pos) {
+        /* last partial block is not aligned for O_DIRECT */
+        if (p->direct)
+            fcntl(p->fd, F_SETFL, fcntl(p->fd, F_GETFL) & ~O_DIRECT);
+
+        dump_file_flush(p, p->pos);
+    }
 
-    return fp;
+    close(p->fd);
+    free(p->buf);
+    mpp_free(p);
+    *file = NULL;
 }
 
 static RK_U8 fetch_data(RK_U32 fmt, RK_U8 *line, RK_U32 num)
@@ -150,15 +306,15 @@ static RK_U8 fetch_data(RK_U32 fmt, RK_U8 *line, RK_U32 num)
     return RK_U8(value);
 }
 
-static void dump_frame(FILE *fp, MppFrame frame, RK_U8 *tmp, RK_U32 w, RK_U32 h)
+static void dump_frame(MppDumpFile *fp, MppDumpItem *item, RK_U8 *tmp, RK_U32 w, RK_U32 h)
 {
     RK_U32 i = 0, j = 0;
-    RK_U32 fmt = mpp_frame_get_fmt(frame);
-    RK_U32 width = mpp_frame_get_width(frame);
-    RK_U32 height = mpp_frame_get_height(frame);
-    RK_U32 hor_stride = mpp_frame_get_hor_stride(frame);
-    RK_U32 ver_stride = mpp_frame_get_ver_stride(frame);
-    RK_U8 *p_buf = (RK_U8 *) mpp_buffer_get_ptr(mpp_frame_get_buffer(frame));
+    RK_U32 fmt = item->fmt;
+    RK_U32 width = item->width;
+    RK_U32 height = item->height;
+    RK_U32 hor_stride = item->hor_stride;
+    RK_U32 ver_stride = item->ver_stride;
+    RK_U8 *p_buf = item->data;
 
     RK_U8 *psrc = p_buf;
     RK_U8 *pdes = tmp;
@@ -209,30 +365,194 @@ static void dump_frame(FILE *fp, MppFrame frame, RK_U8 *tmp, RK_U32 w, RK_U32 h)
         width = hor_stride;
         height = ver_stride;
     }
-    mpp_log("dump_yuv: [%d:%d] pts %lld\n", width, height, mpp_frame_get_pts(frame));
-    fwrite(tmp, 1, width * height * 3 / 2, fp);
-    fflush(fp);
+    mpp_log("dump_yuv: [%d:%d] pts %lld\n", width, height, item->pts);
+    dump_file_write(fp, tmp, width * height * 3 / 2);
+}
+
+static void dump_item_free(MppDumpImpl *p, MppDumpItem *item)
+{
+    if (item->type == DUMP_ITEM_FRM)
+        MPP_FETCH_SUB(&p->frm_pending, 1);
+
+    if (item->buffer)
+        mpp_buffer_put(item->buffer);
+
+    MPP_FREE(item->copy);
+    mpp_free(item);
+}
+
+/* queue is full means writer can not catch up, drop instead of blocking */
+static MPP_RET dump_item_put(MppDumpImpl *p, MppDumpItem *item)
+{
+    if (mpp_ring_put(p->queue, item)) {
+        MppDumpItemType type = item->type;
+
+        dump_item_free(p, item);
+        MPP_FETCH_ADD(&p->drop[type], 1);
+        return MPP_NOK;
+    }
+
+    return MPP_OK;
+}
+
+/*
+ * Packet data may be reused by caller after the call returns, even the
+ * encoder output buffer can be provided by user. Compressed data is small so
+ * it is always copied.
+ */
+static MPP_RET dump_item_packet(MppDumpImpl *p, MppDumpFile *file, MppPacket pkt)
+{
+    RK_U32 length = mpp_packet_get_length(pkt);
+    MppDumpItem *item = NULL;
+
+    if (!length)
+        return MPP_OK;
+
+    item = mpp_calloc(MppDumpItem, 1);
+    if (item)
+        item->copy = mpp_malloc(RK_U8, length);
+
+    if (NULL == item || NULL == item->copy) {
+        MPP_FREE(item);
+        MPP_FETCH_ADD(&p->drop[DUMP_ITEM_PKT], 1);
+        return MPP_NOK;
+    }
+
+    memcpy(item->copy, mpp_packet_get_pos(pkt), length);
+
+    item->type = DUMP_ITEM_PKT;
+    item->file = file;
+    item->data = item->copy;
+    item->size = length;
+
+    return dump_item_put(p, item);
 }
 
-void _ops_log(FILE *fp, const char *fmt, ...)
+/*
+ * Decoder output frame buffer is not reused by decoder while referenced.
+ * Encoder input frame buffer is owned by user and will be refilled after
+ * encoding so it is copied.
+ */
+static MPP_RET dump_item_frame(MppDumpImpl *p, MppDumpFile *file,
+                               MppFrame frame, RK_U32 use_ref)
+{
+    MppBuffer buf = mpp_frame_get_buffer(frame);
+    RK_U32 hor_stride = mpp_frame_get_hor_stride(frame);
+    RK_U32 ver_stride = mpp_frame_get_ver_stride(frame);
+    RK_U32 size = hor_stride * ver_stride * 3 / 2;
+    MppDumpItem *item = NULL;
+
+    if (size > mpp_buffer_get_size(buf)) {
+        mpp_err("frame buffer size %d is too small for dump\n",
+                (RK_S32)mpp_buffer_get_size(buf));
+        return MPP_NOK;
+    }
+
+    if (p->frm_step > 1 && (p->frm_idx++ % p->frm_step)) {
+        p->skip++;
+        return MPP_OK;
+    }
+
+    /* limit the buffers held by writer */
+    if (MPP_FETCH_ADD(&p->frm_pending, 1) >= (RK_S32)p->frm_max) {
+        MPP_FETCH_SUB(&p->frm_pending, 1);
+        MPP_FETCH_ADD(&p->drop[DUMP_ITEM_FRM], 1);
+        return MPP_NOK;
+    }
+
+    item = mpp_calloc(MppDumpItem, 1);
+    if (NULL == item) {
+        MPP_FETCH_SUB(&p->frm_pending, 1);
+        MPP_FETCH_ADD(&p->drop[DUMP_ITEM_FRM], 1);
+        return MPP_NOK;
+    }
+
+    item->type = DUMP_ITEM_FRM;
+    item->file = file;
+    item->fmt = mpp_frame_get_fmt(frame);
+    item->width = mpp_frame_get_width(frame);
+    item->height = mpp_frame_get_height(frame);
+    item->hor_stride = hor_stride;
+    item->ver_stride = ver_stride;
+    item->pts = mpp_frame_get_pts(frame);
+    item->size = size;
+
+    if (use_ref) {
+        mpp_buffer_inc_ref(buf);
+        item->buffer = buf;
+        item->data = (RK_U8 *)mpp_buffer_get_ptr(buf);
+    } else {
+        item->copy = mpp_malloc(RK_U8, size);
+        if (NULL == item->copy) {
+            dump_item_free(p, item);
+            MPP_FETCH_ADD(&p->drop[DUMP_ITEM_FRM], 1);
+            return MPP_NOK;
+        }
+
+        memcpy(item->copy, mpp_buffer_get_ptr(buf), size);
+        item->data = item->copy;
+    }
+
+    return dump_item_put(p, item);
+}
+
+static void ops_log(MppDumpImpl *p, const char *fmt, ...)
 {
     struct tm tm_buf;
     struct tm* ptm;
     struct timespec tp;
-    char logs[64];
+    MppDumpItem *item = mpp_calloc(MppDumpItem, 1);
     size_t len = 0;
     va_list args;
+
+    if (NULL == item) {
+        MPP_FETCH_ADD(&p->drop[DUMP_ITEM_OPS], 1);
+        return ;
+    }
+
     va_start(args, fmt);
 
     clock_gettime(CLOCK_REALTIME_COARSE, &tp);
     ptm = localtime_r(&tp.tv_sec, &tm_buf);
-    len = strftime(logs, sizeof(logs), "%m-%d %H:%M:%S", ptm);
-    mpp_assert(len < sizeof(logs));
-    fprintf(fp, "%s.%03ld,", logs, tp.tv_nsec / 1000000);
-    vfprintf(fp, fmt, args);
-    fflush(fp);
+    len = strftime(item->log, sizeof(item->log), "%m-%d %H:%M:%S", ptm);
+    mpp_assert(len < sizeof(item->log));
+    len += snprintf(item->log + len, sizeof(item->log) - len, ".%03ld,",
+                    tp.tv_nsec / 1000000);
+    len += vsnprintf(item->log + len, sizeof(item->log) - len, fmt, args);
 
     va_end(args);
+
+    item->type = DUMP_ITEM_OPS;
+    item->file = p->fp_ops;
+    item->data = (RK_U8 *)item->log;
+    item->size = MPP_MIN(len, sizeof(item->log) - 1);
+
+    dump_item_put(p, item);
+}
+
+static void *dump_writer_thread(void *data)
+{
+    MppDumpImpl *p = (MppDumpImpl *)data;
+
+    while (1) {
+        MppDumpItem *item = NULL;
+
+        if (mpp_ring_get(p->queue, (void **)&item, -1))
+            continue;
+
+        if (item == &dump_item_quit)
+            break;
+
+        if (item->type == DUMP_ITEM_FRM)
+            dump_frame(item->file, item, p->fp_buf, p->dump_width, p->dump_height);
+        else
+            dump_file_write(item->file, item->data, item->size);
+
+        p->done[item->type]++;
+        dump_item_free(p, item);
+    }
+
+    return NULL;
 }
 
 MPP_RET mpp_dump_init(MppDump *info)
@@ -243,17 +563,39 @@ MPP_RET mpp_dump_init(MppDump *info)
     }
 
     MppDumpImpl *p = mpp_calloc(MppDumpImpl, 1);
+    RK_U32 queue_size = DUMP_QUEUE_SIZE;
 
     mpp_env_get_u32("mpp_dump_width", &p->dump_width, MAX_DUMP_WIDTH);
     mpp_env_get_u32("mpp_dump_height", &p->dump_height, MAX_DUMP_HEIGHT);
     p->dump_size = p->dump_width * p->dump_height * 3 / 2;
 
+    /*
+     * mpp_dump_queue    - dump job count pending on writer thread
+     * mpp_dump_frm_max  - frame count pending on writer thread
+     * mpp_dump_frm_step - dump one frame in every N frames
+     * mpp_dump_direct   - write dump file with O_DIRECT
+     */
+    mpp_env_get_u32("mpp_dump_queue", &queue_size, DUMP_QUEUE_SIZE);
+    mpp_env_get_u32("mpp_dump_frm_max", &p->frm_max, DUMP_FRAME_MAX);
+    mpp_env_get_u32("mpp_dump_frm_step", &p->frm_step, 1);
+    mpp_env_get_u32("mpp_dump_direct", &p->direct, 0);
+
+    if (mpp_ring_init(&p->queue, MPP_MAX(queue_size, 2))) {
+        mpp_err_f("failed to init dump queue\n");
+        mpp_free(p);
+        *info = NULL;
+        return MPP_NOK;
+    }
+
     p->lock = new Mutex();
     p->debug = mpp_debug;
     p->tid = syscall(SYS_gettid);
     p->log_version = 0;
     p->time_base = mpp_time();
 
+    p->thd = new MppThread(dump_writer_thread, p, "mpp_dump");
+    p->thd->start();
+
     *info = p;
 
     return MPP_OK;
@@ -264,15 +606,38 @@ MPP_RET mpp_dump_deinit(MppDump *info)
     if (info && *info) {
         MppDumpImpl *p = (MppDumpImpl *)*info;
 
-        MPP_FCLOSE(p->fp_in);
-        MPP_FCLOSE(p->fp_out);
-        MPP_FCLOSE(p->fp_ops);
+        if (p->thd) {
+            /* writer drains the queue so the quit item will be accepted */
+            while (mpp_ring_put(p->queue, &dump_item_quit))
+                msleep(1);
+
+            p->thd->stop();
+            delete p->thd;
+            p->thd = NULL;
+        }
+
+        if (p->queue) {
+            mpp_ring_deinit(p->queue);
+            p->queue = NULL;
+        }
+
+        mpp_log("dump done pkt %d frm %d ops %d drop pkt %d frm %d ops %d skip frm %d\n",
+                p->done[DUMP_ITEM_PKT], p->done[DUMP_ITEM_FRM], p->done[DUMP_ITEM_OPS],
+                p->drop[DUMP_ITEM_PKT], p->drop[DUMP_ITEM_FRM], p->drop[DUMP_ITEM_OPS],
+                p->skip);
+
+        dump_file_close(&p->fp_in);
+        dump_file_close(&p->fp_out);
+        dump_file_close(&p->fp_ops);
         MPP_FREE(p->fp_buf);
 
         if (p->lock) {
             delete p->lock;
             p->lock = NULL;
         }
+
+        mpp_free(p);
+        *info = NULL;
     }
 
     return MPP_OK;
@@ -291,30 +656,30 @@ MPP_RET mpp_ops_init(MppDump info, MppCtxType type, MppCodingType coding)
 
     if (type == MPP_CTX_DEC) {
         if (p->debug & MPP_DBG_DUMP_IN)
-            p->fp_in = try_env_file("mpp_dump_in", dec_pkt_path, p->tid);
+            p->fp_in = try_env_file("mpp_dump_in", dec_pkt_path, p->tid, p->direct);
 
         if (p->debug & MPP_DBG_DUMP_OUT) {
-            p->fp_out = try_env_file("mpp_dump_out", dec_frm_path, p->tid);
+            p->fp_out = try_env_file("mpp_dump_out", dec_frm_path, p->tid, p->direct);
             p->fp_buf = mpp_malloc(RK_U8, p->dump_size);
         }
 
         if (p->debug & MPP_DBG_DUMP_CFG)
-            p->fp_ops = try_env_file("mpp_dump_ops", dec_ops_path, p->tid);
+            p->fp_ops = try_env_file("mpp_dump_ops", dec_ops_path, p->tid, p->direct);
     } else {
         if (p->debug & MPP_DBG_DUMP_IN) {
-            p->fp_in = try_env_file("mpp_dump_in", enc_frm_path, p->tid);
+            p->fp_in = try_env_file("mpp_dump_in", enc_frm_path, p->tid, p->direct);
             p->fp_buf = mpp_malloc(RK_U8, p->dump_size);
         }
 
         if (p->debug & MPP_DBG_DUMP_OUT)
-            p->fp_out = try_env_file("mpp_dump_out", enc_pkt_path, p->tid);
+            p->fp_out = try_env_file("mpp_dump_out", enc_pkt_path, p->tid, p->direct);
 
         if (p->debug & MPP_DBG_DUMP_CFG)
-            p->fp_ops = try_env_file("mpp_dump_ops", enc_ops_path, p->tid);
+            p->fp_ops = try_env_file("mpp_dump_ops", enc_ops_path, p->tid, p->direct);
     }
 
     if (p->fp_ops)
-        ops_log(p->fp_ops, "%d,%s,%d,%d\n", p->idx++, "init", type, coding);
+        ops_log(p, "%d,%s,%d,%d\n", p->idx++, "init", type, coding);
 
     return MPP_OK;
 }
@@ -328,13 +693,11 @@ MPP_RET mpp_ops_dec_put_pkt(MppDump info, MppPacket pkt)
     RK_U32 length = mpp_packet_get_length(pkt);
     AutoMutex auto_lock(p->lock);
 
-    if (p->fp_in) {
-        fwrite(mpp_packet_get_data(pkt), 1, length, p->fp_in);
-        fflush(p->fp_in);
-    }
+    if (p->fp_in)
+        dump_item_packet(p, p->fp_in, pkt);
 
     if (p->fp_ops) {
-        ops_log(p->fp_ops, "%d,%s,%d,%d\n", p->idx++, "pkt", p->pkt_offset, length);
+        ops_log(p, "%d,%s,%d,%d\n", p->idx++, "pkt", p->pkt_offset, length);
 
         p->pkt_offset += length;
     }
@@ -357,7 +720,7 @@ MPP_RET mpp_ops_dec_get_frm(MppDump info, MppFrame frame)
     RK_U32 discard = mpp_frame_get_discard(frame);
 
     if (p->fp_ops) {
-        ops_log(p->fp_ops, "%d,%s,%d,%d,%d,%d,%lld\n", p->idx, "frm", fd,
+        ops_log(p, "%d,%s,%d,%d,%d,%d,%lld\n", p->idx, "frm", fd,
                 info_change, error, discard, mpp_frame_get_pts(frame));
     }
 
@@ -366,7 +729,7 @@ MPP_RET mpp_ops_dec_get_frm(MppDump info, MppFrame frame)
         return MPP_NOK;
     }
 
-    dump_frame(p->fp_out, frame, p->fp_buf, p->dump_width, p->dump_height);
+    dump_item_frame(p, p->fp_out, frame, 1);
 
     if (p->debug & MPP_DBG_DUMP_LOG) {
         RK_S64 pts = mpp_frame_get_pts(frame);
@@ -382,12 +745,15 @@ MPP_RET mpp_ops_dec_get_frm(MppDump info, MppFrame frame)
 MPP_RET mpp_ops_enc_put_frm(MppDump info, MppFrame frame)
 {
     MppDumpImpl *p = (MppDumpImpl *)info;
-    if (NULL == p || NULL == frame || NULL == p->fp_out || NULL == p->fp_buf)
+    if (NULL == p || NULL == frame || NULL == p->fp_in || NULL == p->fp_buf)
+        return MPP_OK;
+
+    if (NULL == mpp_frame_get_buffer(frame))
         return MPP_OK;
 
     AutoMutex auto_lock(p->lock);
 
-    dump_frame(p->fp_out, frame, p->fp_buf, p->dump_width, p->dump_height);
+    dump_item_frame(p, p->fp_in, frame, 0);
 
     if (p->debug & MPP_DBG_DUMP_LOG) {
         RK_S64 pts = mpp_frame_get_pts(frame);
@@ -406,13 +772,10 @@ MPP_RET mpp_ops_enc_get_pkt(MppDump info, MppPacket pkt)
     if (NULL == p || NULL == pkt)
         return MPP_OK;
 
-    RK_U32 length = mpp_packet_get_length(pkt);
     AutoMutex auto_lock(p->lock);
 
-    if (p->fp_out) {
-        fwrite(mpp_packet_get_data(pkt), 1, length, p->fp_out);
-        fflush(p->fp_out);
-    }
+    if (p->fp_out)
+        dump_item_packet(p, p->fp_out, pkt);
 
     return MPP_OK;
 }
@@ -426,7 +789,7 @@ MPP_RET mpp_ops_ctrl(MppDump info, MpiCmd cmd)
     AutoMutex auto_lock(p->lock);
 
     if (p->fp_ops)
-        ops_log(p->fp_ops, "%d,%s,%d\n", p->idx, "ctrl", cmd);
+        ops_log(p, "%d,%s,%d\n", p->idx, "ctrl", cmd);
 
     return MPP_OK;
 }
@@ -440,7 +803,7 @@ MPP_RET mpp_ops_reset(MppDump info)
     AutoMutex auto_lock(p->lock);
 
     if (p->fp_ops)
-        ops_log(p->fp_ops, "%d,%s\n", p->idx, "rst");
+        ops_log(p, "%d,%s\n", p->idx, "rst");
 
     return MPP_OK;
 }
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2010 Rockchip Electronics S.LSI Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __VERSION_H__
+#define __VERSION_H__
+
+#define MPP_VERSION             "7514ed8 author: agent          2026-10-18 [user-025] fix: share MppThread setup and release worker on hw wait"
+#define MPP_VER_HIST_CNT        10
+#define MPP_VER_HIST_0          "7514ed8 author: agent          2026-10-18 [user-025] fix: share MppThread setup and release worker on hw wait  (HEAD -> master)"
+#define MPP_VER_HIST_1          "5895d89 author: agent          2026-10-18 [user-024] fix: drop the unverified NEON merge path "
+#define MPP_VER_HIST_2          "fcc122a author: agent          2026-10-18 [user-023] fix: drop dead area_map_en comment in vepu541_roi_value "
+#define MPP_VER_HIST_3          "91faaba author: agent          2026-10-18 [user-018] fix: block decoder on full frame ring instead of dropping "
+#define MPP_VER_HIST_4          "e13a995 author: agent          2026-10-18 [user-017] fix: release scheduler slot on failed send and make it opt-in "
+#define MPP_VER_HIST_5          "d0dc9a2 author: agent          2026-10-18 [user-016] fix: collect in-flight tasks when decode_batch send fails "
+#define MPP_VER_HIST_6          "68e5f5c author: agent          2026-10-18 [user-015] fix: release stale unused buffers without idle limit "
+#define MPP_VER_HIST_7          "d9de841 author: agent          2026-10-18 [user-013] fix: take dequeue_n and enqueue_n from MppApi reserved array "
+#define MPP_VER_HIST_8          "e3f5c4a author: agent          2026-10-18 [user-011] fix: init grown slot entries from the grow position "
+#define MPP_VER_HIST_9          "3f33fd2 author: agent          2026-10-18 [user-009] fix: share latency names and record vproc output latency"
+
+#endif /*__VERSION_H__*/
@@ -605,6 +605,23 @@ MPP_RET iep_control(IepCtx ctx, IepCmd cmd, void *param)
 
         ret = (MPP_RET)ops_ret;
     } break;
+    case IEP_CMD_RUN_ASYNC : {
+        check_msg_image(msg);
+
+        // NOTE: msg is copied by kernel so it can be reconfigured on return
+        int ops_ret = ioctl(impl->fd, IEP_SET_PARAMETER, msg);
+        if (ops_ret < 0)
+            mpp_err("pid %d ioctl IEP_SET_PARAMETER failure\n", impl->pid);
+
+        ret = (ops_ret < 0) ? MPP_NOK : MPP_OK;
+    } break;
+    case IEP_CMD_WAIT_ASYNC : {
+        int ops_ret = ioctl(impl->fd, IEP_GET_RESULT_SYNC, 0);
+        if (ops_ret)
+            mpp_err("pid %d get result failure\n", impl->pid);
+
+        ret = (MPP_RET)ops_ret;
+    } break;
     case IEP_CMD_QUERY_CAP : {
         if (param)
             *(IepHwCap **)param = &impl->cap;
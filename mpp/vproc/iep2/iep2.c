@@ -444,6 +444,17 @@ static MPP_RET iep2_control(IepCtx ictx, IepCmd cmd, void *iparam)
         iep2_wait(ctx);
         iep2_done(ctx);
         break;
+    case IEP_CMD_RUN_ASYNC:
+        if (0 > iep2_param_check(ctx))
+            return MPP_NOK;
+        if (0 > iep2_start(ctx))
+            return MPP_NOK;
+        break;
+    case IEP_CMD_WAIT_ASYNC:
+        // detection result is fed back to params for the next job
+        iep2_wait(ctx);
+        iep2_done(ctx);
+        break;
     default:
         ;
     }
@@ -44,6 +44,7 @@ typedef enum IepCmd_e {
     // hardware trigger command
     IEP_CMD_RUN_SYNC            = 0x1000,   // start sync mode process
     IEP_CMD_RUN_ASYNC,                      // start async mode process
+    IEP_CMD_WAIT_ASYNC,                     // wait the oldest async process done
 
     // hardware capability query command
     IEP_CMD_QUERY_CAP           = 0x8000,   // query iep capability
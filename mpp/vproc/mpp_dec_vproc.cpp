@@ -20,7 +20,11 @@
 
 #include "mpp_env.h"
 #include "mpp_mem.h"
+#include "mpp_hist.h"
+#include "mpp_time.h"
+#include "mpp_atomic.h"
 #include "mpp_common.h"
+#include "mpp_eventfd.h"
 
 #include "mpp_dec_impl.h"
 
@@ -42,6 +46,7 @@
 #define VPROC_DBG_FUNCTION      (0x00000001)
 #define VPROC_DBG_STATUS        (0x00000002)
 #define VPROC_DBG_RESET         (0x00000004)
+#define VPROC_DBG_PERF          (0x00000008)
 
 #define vproc_dbg_func(fmt, ...)  \
     vproc_dbg_f(VPROC_DBG_FUNCTION, fmt, ## __VA_ARGS__);
@@ -52,6 +57,42 @@
 
 RK_U32 vproc_debug = 0;
 
+#define VPROC_JOB_MAX           4
+#define VPROC_JOB_OUT_MAX       2
+#define VPROC_JOB_SRC_MAX       3
+
+typedef enum VprocStage_e {
+    VPROC_STAGE_BUF,            // wait for destination buffer
+    VPROC_STAGE_HW,             // hardware submit to done
+    VPROC_STAGE_TOTAL,          // task dequeue to frame output
+    VPROC_STAGE_BUTT,
+} VprocStage;
+
+static const char *vproc_stage_name[VPROC_STAGE_BUTT] = {
+    "vproc_buf",
+    "vproc_hw",
+    "vproc_total",
+};
+
+/*
+ * Deinterlace job submitted to iep. Job without destination buffer is eos or
+ * info change frame which is passed through in order with other jobs.
+ */
+typedef struct VprocJob_t {
+    MppFrame            frame;
+    RK_U32              hw;
+
+    // reference of source buffer is hold until hardware done
+    MppBuffer           src[VPROC_JOB_SRC_MAX];
+    RK_S32              src_cnt;
+    MppBuffer           dst[VPROC_JOB_OUT_MAX];
+    RK_S64              pts[VPROC_JOB_OUT_MAX];
+    RK_S32              dst_cnt;
+
+    RK_S64              start;
+    RK_S64              submit;
+} VprocJob;
+
 typedef struct MppDecVprocCtxImpl_t {
     Mpp                 *mpp;
     HalTaskGroup        task_group;
@@ -70,11 +111,26 @@ typedef struct MppDecVprocCtxImpl_t {
     MppFrame            prev_frm;
     RK_S32              curr_idx;
     MppFrame            curr_frm;
+
+    /*
+     * Submit thread configures and starts iep job then output thread waits
+     * job done and outputs frames. Job index is protected by output thread
+     * lock and job_depth is the max number of jobs in flight.
+     */
+    MppThread           *thd_out;
+    VprocJob            jobs[VPROC_JOB_MAX];
+    RK_U32              job_wr;
+    RK_U32              job_rd;
+    RK_U32              job_depth;
+
+    // output buffers prefetched for next job
+    MppBuffer           spare[VPROC_JOB_OUT_MAX];
+
+    MppHist             stage[VPROC_STAGE_BUTT];
 } MppDecVprocCtxImpl;
 
 static void dec_vproc_put_frame(Mpp *mpp, MppFrame frame, MppBuffer buf, RK_S64 pts)
 {
-    mpp_list *list = mpp->mFrames;
     MppFrame out = NULL;
     MppFrameImpl *impl = NULL;
 
@@ -86,15 +142,14 @@ static void dec_vproc_put_frame(Mpp *mpp, MppFrame frame, MppBuffer buf, RK_S64
     if (buf)
         impl->buffer = buf;
 
-    list->lock();
-    list->add_at_tail(&out, sizeof(out));
+    if (buf && impl->in_time)
+        mpp_hist_record_atomic(mpp->mLatency[MPP_LATENCY_IN_OUT],
+                               mpp_time() - impl->in_time);
 
     if (mpp_debug & MPP_DBG_PTS)
         mpp_log("output frame pts %lld\n", mpp_frame_get_pts(out));
 
-    mpp->mFramePutCount++;
-    list->signal();
-    list->unlock();
+    mpp_dec_put_output((MppDecImpl *)mpp->mDec, out);
 }
 
 static void dec_vproc_clr_prev(MppDecVprocCtxImpl *ctx)
@@ -143,9 +198,27 @@ static void dec_vproc_set_img(MppDecVprocCtxImpl *ctx, IepImg *img, RK_S32 fd, I
         mpp_log_f("control %08x failed %d\n", cmd, ret);
 }
 
-static MppBuffer dec_vproc_get_buffer(MppBufferGroup group, size_t size)
+static MppBuffer dec_vproc_get_buffer(MppDecVprocCtxImpl *ctx, size_t size)
 {
+    MppBufferGroup group = ctx->mpp->mFrameGroup;
     MppBuffer buf = NULL;
+    RK_S64 start = mpp_time();
+    RK_S32 i;
+
+    // take the buffer prefetched while previous job is running
+    for (i = 0; i < VPROC_JOB_OUT_MAX; i++) {
+        if (NULL == ctx->spare[i])
+            continue;
+
+        buf = ctx->spare[i];
+        ctx->spare[i] = NULL;
+
+        if (mpp_buffer_get_size(buf) >= size)
+            return buf;
+
+        mpp_buffer_put(buf);
+        buf = NULL;
+    }
 
     do {
         mpp_buffer_get(group, &buf, size);
@@ -155,11 +228,64 @@ static MppBuffer dec_vproc_get_buffer(MppBufferGroup group, size_t size)
             break;
     } while (1);
 
+    mpp_hist_record(ctx->stage[VPROC_STAGE_BUF], mpp_time() - start);
+
     return buf;
 }
 
-// start deinterlace hardware
-static void dec_vproc_start_dei(MppDecVprocCtxImpl *ctx, RK_U32 mode)
+/*
+ * Get the output buffers of next job while hardware is running. Only prefetch
+ * when the group has more than the 3 unused buffers reserved in decoder
+ * dec_pic_unusd check so the spare buffers never starve the decoder.
+ */
+static void dec_vproc_prefetch_buffer(MppDecVprocCtxImpl *ctx, size_t size)
+{
+    MppBufferGroup group = ctx->mpp->mFrameGroup;
+    RK_S32 i;
+
+    for (i = 0; i < VPROC_JOB_OUT_MAX; i++) {
+        if (ctx->spare[i])
+            continue;
+
+        if (mpp_buffer_group_unused(group) <= 3)
+            break;
+
+        mpp_buffer_get(group, &ctx->spare[i], size);
+    }
+}
+
+static void dec_vproc_clr_spare(MppDecVprocCtxImpl *ctx)
+{
+    RK_S32 i;
+
+    for (i = 0; i < VPROC_JOB_OUT_MAX; i++) {
+        if (ctx->spare[i]) {
+            mpp_buffer_put(ctx->spare[i]);
+            ctx->spare[i] = NULL;
+        }
+    }
+}
+
+static void dec_vproc_job_add_src(VprocJob *job, MppFrame frm)
+{
+    MppBuffer buf = mpp_frame_get_buffer(frm);
+
+    // keep source alive after the field is released by submit thread
+    if (buf) {
+        mpp_buffer_inc_ref(buf);
+        job->src[job->src_cnt++] = buf;
+    }
+}
+
+static void dec_vproc_job_add_dst(VprocJob *job, MppBuffer buf, RK_S64 pts)
+{
+    job->dst[job->dst_cnt] = buf;
+    job->pts[job->dst_cnt] = pts;
+    job->dst_cnt++;
+}
+
+// start deinterlace hardware without waiting
+static void dec_vproc_start_dei(MppDecVprocCtxImpl *ctx, VprocJob *job, RK_U32 mode)
 {
     MPP_RET ret;
 
@@ -175,18 +301,20 @@ static void dec_vproc_start_dei(MppDecVprocCtxImpl *ctx, RK_U32 mode)
             mpp_log_f("IEP_CMD_SET_DEI_CFG failed %d\n", ret);
     }
 
-    ret = ctx->com_ctx->ops->control(ctx->iep_ctx, IEP_CMD_RUN_SYNC, NULL);
+    job->submit = mpp_time();
+    ret = ctx->com_ctx->ops->control(ctx->iep_ctx, IEP_CMD_RUN_ASYNC, NULL);
     if (ret)
-        mpp_log_f("IEP_CMD_RUN_SYNC failed %d\n", ret);
+        mpp_log_f("IEP_CMD_RUN_ASYNC failed %d\n", ret);
+    else
+        job->hw = 1;
 }
 
-static void dec_vproc_set_dei_v1(MppDecVprocCtxImpl *ctx, MppFrame frm)
+static void dec_vproc_set_dei_v1(MppDecVprocCtxImpl *ctx, VprocJob *job)
 {
     MPP_RET ret = MPP_OK;
     IepImg img;
 
-    Mpp *mpp = ctx->mpp;
-    MppBufferGroup group = mpp->mFrameGroup;
+    MppFrame frm = job->frame;
     RK_U32 mode = mpp_frame_get_mode(frm);
     MppBuffer buf = mpp_frame_get_buffer(frm);
     MppBuffer dst0 = NULL;
@@ -219,9 +347,10 @@ static void dec_vproc_set_dei_v1(MppDecVprocCtxImpl *ctx, MppFrame frm)
         buf = mpp_frame_get_buffer(ctx->prev_frm);
         fd = mpp_buffer_get_fd(buf);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_SRC);
+        dec_vproc_job_add_src(job, ctx->prev_frm);
 
         // setup dst 0
-        dst0 = dec_vproc_get_buffer(group, buf_size);
+        dst0 = dec_vproc_get_buffer(ctx, buf_size);
         mpp_assert(dst0);
         fd = mpp_buffer_get_fd(dst0);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_DST);
@@ -229,9 +358,10 @@ static void dec_vproc_set_dei_v1(MppDecVprocCtxImpl *ctx, MppFrame frm)
         buf = mpp_frame_get_buffer(frm);
         fd = mpp_buffer_get_fd(buf);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_DEI_SRC1);
+        dec_vproc_job_add_src(job, frm);
 
         // setup dst 1
-        dst1 = dec_vproc_get_buffer(group, buf_size);
+        dst1 = dec_vproc_get_buffer(ctx, buf_size);
         mpp_assert(dst1);
         fd = mpp_buffer_get_fd(dst1);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_DEI_DST1);
@@ -241,26 +371,27 @@ static void dec_vproc_set_dei_v1(MppDecVprocCtxImpl *ctx, MppFrame frm)
         mode = mode | MPP_FRAME_FLAG_IEP_DEI_I4O2;
         mpp_frame_set_mode(frm, mode);
 
-        // start hardware
-        dec_vproc_start_dei(ctx, mode);
-
-        // NOTE: we need to process pts here
+        // NOTE: output is sorted by pts on job done
         if (mode & MPP_FRAME_FLAG_TOP_FIRST) {
-            dec_vproc_put_frame(mpp, frm, dst0, first_pts);
-            dec_vproc_put_frame(mpp, frm, dst1, curr_pts);
+            dec_vproc_job_add_dst(job, dst0, first_pts);
+            dec_vproc_job_add_dst(job, dst1, curr_pts);
         } else {
-            dec_vproc_put_frame(mpp, frm, dst1, first_pts);
-            dec_vproc_put_frame(mpp, frm, dst0, curr_pts);
+            dec_vproc_job_add_dst(job, dst1, first_pts);
+            dec_vproc_job_add_dst(job, dst0, curr_pts);
         }
+
+        // start hardware
+        dec_vproc_start_dei(ctx, job, mode);
     } else {
         // 2 in 1 out case
         vproc_dbg_status("2 field in and 1 frame out\n");
         buf = mpp_frame_get_buffer(frm);
         fd = mpp_buffer_get_fd(buf);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_SRC);
+        dec_vproc_job_add_src(job, frm);
 
         // setup dst 0
-        dst0 = dec_vproc_get_buffer(group, buf_size);
+        dst0 = dec_vproc_get_buffer(ctx, buf_size);
         mpp_assert(dst0);
         fd = mpp_buffer_get_fd(dst0);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_DST);
@@ -269,18 +400,20 @@ static void dec_vproc_set_dei_v1(MppDecVprocCtxImpl *ctx, MppFrame frm)
         mode = mode | MPP_FRAME_FLAG_IEP_DEI_I2O1;
         mpp_frame_set_mode(frm, mode);
 
+        dec_vproc_job_add_dst(job, dst0, -1);
+
         // start hardware
-        dec_vproc_start_dei(ctx, mode);
-        dec_vproc_put_frame(mpp, frm, dst0, -1);
+        dec_vproc_start_dei(ctx, job, mode);
     }
+
+    dec_vproc_prefetch_buffer(ctx, buf_size);
 }
 
-static void dec_vproc_set_dei_v2(MppDecVprocCtxImpl *ctx, MppFrame frm)
+static void dec_vproc_set_dei_v2(MppDecVprocCtxImpl *ctx, VprocJob *job)
 {
     IepImg img;
 
-    Mpp *mpp = ctx->mpp;
-    MppBufferGroup group = mpp->mFrameGroup;
+    MppFrame frm = job->frame;
     RK_U32 mode = mpp_frame_get_mode(frm);
     MppBuffer buf = mpp_frame_get_buffer(frm);
     MppBuffer dst0 = NULL;
@@ -305,23 +438,26 @@ static void dec_vproc_set_dei_v2(MppDecVprocCtxImpl *ctx, MppFrame frm)
         buf = mpp_frame_get_buffer(ctx->curr_frm);
         fd = mpp_buffer_get_fd(buf);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_SRC);
+        dec_vproc_job_add_src(job, ctx->curr_frm);
 
         buf = mpp_frame_get_buffer(frm);
         fd = mpp_buffer_get_fd(buf);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_DEI_SRC1);
+        dec_vproc_job_add_src(job, frm);
 
         buf = mpp_frame_get_buffer(ctx->prev_frm);
         fd = mpp_buffer_get_fd(buf);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_DEI_SRC2);
+        dec_vproc_job_add_src(job, ctx->prev_frm);
 
         // setup dst 0
-        dst0 = dec_vproc_get_buffer(group, buf_size);
+        dst0 = dec_vproc_get_buffer(ctx, buf_size);
         mpp_assert(dst0);
         fd = mpp_buffer_get_fd(dst0);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_DST);
 
         // setup dst 1
-        dst1 = dec_vproc_get_buffer(group, buf_size);
+        dst1 = dec_vproc_get_buffer(ctx, buf_size);
         mpp_assert(dst1);
         fd = mpp_buffer_get_fd(dst1);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_DEI_DST1);
@@ -347,12 +483,12 @@ static void dec_vproc_set_dei_v2(MppDecVprocCtxImpl *ctx, MppFrame frm)
         mode = mode | MPP_FRAME_FLAG_IEP_DEI_I4O2;
         mpp_frame_set_mode(frm, mode);
 
-        // start hardware
-        dec_vproc_start_dei(ctx, mode);
-
         // NOTE: we need to process pts here
-        dec_vproc_put_frame(mpp, frm, dst0, first_pts);
-        dec_vproc_put_frame(mpp, frm, dst1, curr_pts);
+        dec_vproc_job_add_dst(job, dst0, first_pts);
+        dec_vproc_job_add_dst(job, dst1, curr_pts);
+
+        // start hardware
+        dec_vproc_start_dei(ctx, job, mode);
     } else {
         struct iep2_api_params params;
 
@@ -361,9 +497,10 @@ static void dec_vproc_set_dei_v2(MppDecVprocCtxImpl *ctx, MppFrame frm)
         buf = mpp_frame_get_buffer(frm);
         fd = mpp_buffer_get_fd(buf);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_SRC);
+        dec_vproc_job_add_src(job, frm);
 
         // setup dst 0
-        dst0 = dec_vproc_get_buffer(group, buf_size);
+        dst0 = dec_vproc_get_buffer(ctx, buf_size);
         mpp_assert(dst0);
         fd = mpp_buffer_get_fd(dst0);
         dec_vproc_set_img(ctx, &img, fd, IEP_CMD_SET_DST);
@@ -373,10 +510,144 @@ static void dec_vproc_set_dei_v2(MppDecVprocCtxImpl *ctx, MppFrame frm)
         params.param.mode.out_mode = IEP2_OUT_MODE_LINE;
         ops->control(ctx->iep_ctx, IEP_CMD_SET_DEI_CFG, &params);
 
+        dec_vproc_job_add_dst(job, dst0, -1);
+
         // start hardware
-        dec_vproc_start_dei(ctx, mode);
-        dec_vproc_put_frame(mpp, frm, dst0, -1);
+        dec_vproc_start_dei(ctx, job, mode);
     }
+
+    dec_vproc_prefetch_buffer(ctx, buf_size);
+}
+
+static RK_U32 dec_vproc_job_avail(MppDecVprocCtxImpl *ctx)
+{
+    AutoMutex autolock(ctx->thd_out->mutex());
+
+    return (ctx->job_wr - ctx->job_rd) < ctx->job_depth;
+}
+
+static RK_U32 dec_vproc_job_idle(MppDecVprocCtxImpl *ctx)
+{
+    AutoMutex autolock(ctx->thd_out->mutex());
+
+    return ctx->job_wr == ctx->job_rd;
+}
+
+static VprocJob *dec_vproc_job_get(MppDecVprocCtxImpl *ctx, MppFrame frm, RK_S64 start)
+{
+    VprocJob *job = &ctx->jobs[ctx->job_wr % VPROC_JOB_MAX];
+
+    memset(job, 0, sizeof(*job));
+    mpp_frame_init(&job->frame);
+    mpp_frame_copy(job->frame, frm);
+    job->start = start;
+
+    return job;
+}
+
+static void dec_vproc_job_put(MppDecVprocCtxImpl *ctx)
+{
+    MppThread *thd = ctx->thd_out;
+
+    thd->lock();
+    ctx->job_wr++;
+    thd->signal();
+    thd->unlock();
+}
+
+static void dec_vproc_job_done(MppDecVprocCtxImpl *ctx, VprocJob *job)
+{
+    Mpp *mpp = ctx->mpp;
+    MppDecImpl *dec = (MppDecImpl *)mpp->mDec;
+    RK_S32 i;
+    RK_S32 j;
+
+    if (job->hw) {
+        MPP_RET ret = ctx->com_ctx->ops->control(ctx->iep_ctx, IEP_CMD_WAIT_ASYNC, NULL);
+        if (ret)
+            mpp_log_f("IEP_CMD_WAIT_ASYNC failed %d\n", ret);
+
+        mpp_hist_record(ctx->stage[VPROC_STAGE_HW], mpp_time() - job->submit);
+    }
+
+    for (i = 0; i < job->src_cnt; i++)
+        mpp_buffer_put(job->src[i]);
+
+    if (!job->dst_cnt) {
+        // pass through eos or info change frame
+        dec_vproc_put_frame(mpp, job->frame, NULL, -1);
+    } else if (dec->reset_flag) {
+        vproc_dbg_reset("drop %d frame on reset\n", job->dst_cnt);
+        for (i = 0; i < job->dst_cnt; i++)
+            mpp_buffer_put(job->dst[i]);
+    } else {
+        // output in pts order, -1 pts means using source frame pts
+        for (i = 1; i < job->dst_cnt; i++) {
+            MppBuffer buf = job->dst[i];
+            RK_S64 pts = job->pts[i];
+
+            for (j = i - 1; j >= 0 && job->pts[j] > pts; j--) {
+                job->dst[j + 1] = job->dst[j];
+                job->pts[j + 1] = job->pts[j];
+            }
+            job->dst[j + 1] = buf;
+            job->pts[j + 1] = pts;
+        }
+
+        for (i = 0; i < job->dst_cnt; i++)
+            dec_vproc_put_frame(mpp, job->frame, job->dst[i], job->pts[i]);
+
+        mpp_hist_record(ctx->stage[VPROC_STAGE_TOTAL], mpp_time() - job->start);
+    }
+
+    // buffer in the frame copy is not referenced by job
+    ((MppFrameImpl *)job->frame)->buffer = NULL;
+    mpp_frame_deinit(&job->frame);
+}
+
+/*
+ * Output thread waits the submitted jobs in order and puts the result frames
+ * to mpp. It drains all the jobs before exit on stop.
+ */
+static void *dec_vproc_out_thread(void *data)
+{
+    MppDecVprocCtxImpl *ctx = (MppDecVprocCtxImpl *)data;
+    MppThread *thd = ctx->thd_out;
+
+    mpp_dbg(MPP_DBG_INFO, "mpp_dec_vproc_out_thread started\n");
+
+    while (1) {
+        VprocJob *job = NULL;
+
+        {
+            AutoMutex autolock(thd->mutex());
+
+            if (ctx->job_rd == ctx->job_wr) {
+                if (MPP_THREAD_RUNNING != thd->get_status())
+                    break;
+
+                thd->wait();
+                continue;
+            }
+
+            job = &ctx->jobs[ctx->job_rd % VPROC_JOB_MAX];
+        }
+
+        dec_vproc_job_done(ctx, job);
+
+        thd->lock();
+        ctx->job_rd++;
+        thd->unlock();
+
+        // wake up submit thread waiting for free job or reset
+        ctx->thd->lock();
+        ctx->thd->signal();
+        ctx->thd->unlock();
+    }
+
+    mpp_dbg(MPP_DBG_INFO, "mpp_dec_vproc_out_thread exited\n");
+
+    return NULL;
 }
 
 static void *dec_vproc_thread(void *data)
@@ -403,12 +674,20 @@ static void *dec_vproc_thread(void *data)
             if (MPP_THREAD_RUNNING != thd->get_status())
                 break;
 
+            // all jobs are in flight wait output thread to finish one
+            if (!dec_vproc_job_avail(ctx)) {
+                thd->wait();
+                continue;
+            }
+
             if (hal_task_get_hnd(tasks, TASK_PROCESSING, &task)) {
                 {
                     AutoMutex autolock_reset(thd->mutex(THREAD_CONTROL));
-                    if (ctx->reset) {
+                    // reset after all submitted jobs are done
+                    if (ctx->reset && dec_vproc_job_idle(ctx)) {
                         vproc_dbg_reset("reset start\n");
                         dec_vproc_clr_prev(ctx);
+                        dec_vproc_clr_spare(ctx);
 
                         ctx->reset = 0;
                         sem_post(&ctx->reset_sem);
@@ -433,6 +712,7 @@ static void *dec_vproc_thread(void *data)
             RK_S32 index = task_vproc->input;
             RK_U32 eos = task_vproc->flags.eos;
             RK_U32 change = task_vproc->flags.info_change;
+            RK_S64 start = mpp_time();
             MppFrame frm = NULL;
 
             if (eos && index < 0) {
@@ -440,7 +720,8 @@ static void *dec_vproc_thread(void *data)
 
                 mpp_frame_init(&frm);
                 mpp_frame_set_eos(frm, eos);
-                dec_vproc_put_frame(mpp, frm, NULL, -1);
+                dec_vproc_job_get(ctx, frm, start);
+                dec_vproc_job_put(ctx);
                 dec_vproc_clr_prev(ctx);
                 mpp_frame_deinit(&frm);
 
@@ -452,8 +733,10 @@ static void *dec_vproc_thread(void *data)
 
             if (change) {
                 vproc_dbg_status("info change\n");
-                dec_vproc_put_frame(mpp, frm, NULL, -1);
+                dec_vproc_job_get(ctx, frm, start);
+                dec_vproc_job_put(ctx);
                 dec_vproc_clr_prev(ctx);
+                dec_vproc_clr_spare(ctx);
 
                 hal_task_hnd_set_status(task, TASK_IDLE);
                 continue;
@@ -464,11 +747,15 @@ static void *dec_vproc_thread(void *data)
             mpp_assert(tmp == index);
 
             if (!dec->reset_flag && ctx->iep_ctx) {
+                VprocJob *job = dec_vproc_job_get(ctx, frm, start);
+
                 if (ctx->com_ctx->ver == 1) {
-                    dec_vproc_set_dei_v1(ctx, frm);
+                    dec_vproc_set_dei_v1(ctx, job);
                 } else {
-                    dec_vproc_set_dei_v2(ctx, frm);
+                    dec_vproc_set_dei_v2(ctx, job);
                 }
+
+                dec_vproc_job_put(ctx);
             }
 
             dec_vproc_clr_prev(ctx);
@@ -522,11 +809,13 @@ MPP_RET dec_vproc_init(MppDecVprocCtx *ctx, MppDecVprocCfg *cfg)
     p->mpp = (Mpp *)cfg->mpp;
     p->slots = ((MppDecImpl *)p->mpp->mDec)->frame_slots;
     p->thd = new MppThread(dec_vproc_thread, p, "mpp_dec_vproc");
+    p->thd_out = new MppThread(dec_vproc_out_thread, p, "mpp_dec_vproc_out");
     sem_init(&p->reset_sem, 0, 0);
     ret = hal_task_group_init(&p->task_group, 4);
     if (ret) {
         mpp_err_f("create task group failed\n");
         delete p->thd;
+        delete p->thd_out;
         MPP_FREE(p);
         return MPP_ERR_MALLOC;
     }
@@ -537,6 +826,7 @@ MPP_RET dec_vproc_init(MppDecVprocCtx *ctx, MppDecVprocCfg *cfg)
     if (!p->com_ctx) {
         mpp_err("failed to require context\n");
         delete p->thd;
+        delete p->thd_out;
 
         if (p->task_group) {
             hal_task_group_deinit(p->task_group);
@@ -550,13 +840,18 @@ MPP_RET dec_vproc_init(MppDecVprocCtx *ctx, MppDecVprocCfg *cfg)
 
     ret = p->com_ctx->ops->init(&p->com_ctx->priv);
     p->iep_ctx = p->com_ctx->priv;
-    if (!p->thd || ret) {
+    if (!p->thd || !p->thd_out || ret) {
         mpp_err("failed to create context\n");
         if (p->thd) {
             delete p->thd;
             p->thd = NULL;
         }
 
+        if (p->thd_out) {
+            delete p->thd_out;
+            p->thd_out = NULL;
+        }
+
         if (p->iep_ctx)
             p->com_ctx->ops->deinit(p->iep_ctx);
 
@@ -586,6 +881,18 @@ MPP_RET dec_vproc_init(MppDecVprocCtx *ctx, MppDecVprocCfg *cfg)
         p->prev_frm = NULL;
         p->curr_idx = -1;
         p->curr_frm = NULL;
+
+        /*
+         * iep2 detection result of one job is the input of next job so
+         * iep2 only overlaps job setup and output with hardware running.
+         */
+        mpp_env_get_u32("vproc_job_depth", &p->job_depth, 2);
+        p->job_depth = MPP_CLIP3(1, VPROC_JOB_MAX, p->job_depth);
+        if (p->com_ctx->ver == 2)
+            p->job_depth = 1;
+
+        for (RK_S32 i = 0; i < VPROC_STAGE_BUTT; i++)
+            p->stage[i] = mpp_hist_get(vproc_stage_name[i]);
     }
 
     *ctx = p;
@@ -609,6 +916,33 @@ MPP_RET dec_vproc_deinit(MppDecVprocCtx ctx)
         p->thd = NULL;
     }
 
+    // stop output thread after submit thread to drain the jobs in flight
+    if (p->thd_out) {
+        p->thd_out->stop();
+        delete p->thd_out;
+        p->thd_out = NULL;
+    }
+
+    dec_vproc_clr_spare(p);
+
+    for (RK_S32 i = 0; i < VPROC_STAGE_BUTT; i++) {
+        MppHist hist = p->stage[i];
+
+        if (NULL == hist)
+            continue;
+
+        if ((vproc_debug & VPROC_DBG_PERF) && mpp_hist_get_count(hist))
+            mpp_log("%-12s count %6lld avg %6lld p50 %6lld p99 %6lld max %6lld us\n",
+                    mpp_hist_get_name(hist), mpp_hist_get_count(hist),
+                    mpp_hist_get_sum(hist) / mpp_hist_get_count(hist),
+                    mpp_hist_get_percentile(hist, 500),
+                    mpp_hist_get_percentile(hist, 990),
+                    mpp_hist_get_max(hist));
+
+        mpp_hist_put(hist);
+        p->stage[i] = NULL;
+    }
+
     if (p->iep_ctx)
         p->com_ctx->ops->deinit(p->iep_ctx);
 
@@ -639,9 +973,10 @@ MPP_RET dec_vproc_start(MppDecVprocCtx ctx)
 
     MppDecVprocCtxImpl *p = (MppDecVprocCtxImpl *)ctx;
 
-    if (p->thd)
+    if (p->thd && p->thd_out) {
+        p->thd_out->start();
         p->thd->start();
-    else
+    } else
         mpp_err("failed to start dec vproc thread\n");
 
     vproc_dbg_func("out\n");
@@ -658,9 +993,10 @@ MPP_RET dec_vproc_stop(MppDecVprocCtx ctx)
 
     MppDecVprocCtxImpl *p = (MppDecVprocCtxImpl *)ctx;
 
-    if (p->thd)
+    if (p->thd && p->thd_out) {
         p->thd->stop();
-    else
+        p->thd_out->stop();
+    } else
         mpp_err("failed to stop dec vproc thread\n");
 
     vproc_dbg_func("out\n");
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_memfd"
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "os_mem.h"
+#include "allocator_memfd.h"
+
+#include "mpp_env.h"
+#include "mpp_mem.h"
+#include "mpp_log.h"
+#include "mpp_common.h"
+
+/*
+ * memfd allocator
+ *
+ * Anonymous shmem file from memfd_create is used as a fd-based buffer on
+ * the platform without ion / drm device. The fd can be passed to other
+ * process by unix socket and mapped by MAP_SHARED so the frame can be shared
+ * across process without copy. It is also used for import of foreign fd
+ * which can be mapped by mmap, for example memfd / shm / dma-buf from other
+ * process.
+ *
+ * env allocator_memfd_debug:
+ * bit 0 - function trace
+ * bit 4 - try huge page backing for large buffer
+ */
+static RK_U32 memfd_debug = 0;
+
+#define MEMFD_FUNCTION              (0x00000001)
+#define MEMFD_HUGEPAGE              (0x00000010)
+
+#define memfd_dbg(flag, fmt, ...)   _mpp_dbg_f(memfd_debug, flag, fmt, ## __VA_ARGS__)
+#define memfd_dbg_func(fmt, ...)    memfd_dbg(MEMFD_FUNCTION, fmt, ## __VA_ARGS__)
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC                 0x0001U
+#endif
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB                 0x0004U
+#endif
+
+/* only buffer larger than one huge page will try huge page backing */
+#define MEMFD_HUGEPAGE_SIZE         SZ_2M
+
+typedef struct {
+    size_t  alignment;
+    RK_U32  hugepage;
+} allocator_ctx_memfd;
+
+static RK_S32 memfd_create_fd(const char *name, RK_U32 flags)
+{
+#if defined(__NR_memfd_create)
+    return syscall(__NR_memfd_create, name, flags);
+#else
+    (void)name;
+    (void)flags;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/*
+ * hugetlbfs requires the mapping length aligned to huge page size and
+ * st_blksize reports the page size of the backing file
+ */
+static size_t memfd_map_size(RK_S32 fd, size_t size)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) || st.st_blksize <= 0)
+        return size;
+
+    return MPP_ALIGN(size, (size_t)st.st_blksize);
+}
+
+static MPP_RET memfd_create_buf(MppBufferInfo *info, size_t size, RK_U32 flags)
+{
+    RK_S32 fd = memfd_create_fd("mpp_buf", MFD_CLOEXEC | flags);
+    void *ptr;
+
+    if (fd < 0)
+        return MPP_NOK;
+
+    size = memfd_map_size(fd, size);
+    if (ftruncate(fd, size)) {
+        close(fd);
+        return MPP_NOK;
+    }
+
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        close(fd);
+        return MPP_NOK;
+    }
+
+    info->fd = fd;
+    info->ptr = ptr;
+    info->hnd = NULL;
+
+    return MPP_OK;
+}
+
+RK_U32 allocator_memfd_is_valid(void)
+{
+    static RK_S32 valid = -1;
+
+    if (valid < 0) {
+        RK_S32 fd = memfd_create_fd("mpp_probe", MFD_CLOEXEC);
+
+        valid = (fd >= 0);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    return valid;
+}
+
+static MPP_RET allocator_memfd_open(void **ctx, MppAllocatorCfg *cfg)
+{
+    allocator_ctx_memfd *p = NULL;
+
+    if (NULL == ctx) {
+        mpp_err_f("does not accept NULL input\n");
+        return MPP_ERR_NULL_PTR;
+    }
+
+    *ctx = NULL;
+
+    mpp_env_get_u32("allocator_memfd_debug", &memfd_debug, 0);
+
+    if (!allocator_memfd_is_valid()) {
+        mpp_err_f("memfd_create is not supported\n");
+        return MPP_NOK;
+    }
+
+    p = mpp_malloc(allocator_ctx_memfd, 1);
+    if (NULL == p) {
+        mpp_err_f("failed to allocate context\n");
+        return MPP_ERR_MALLOC;
+    }
+
+    p->alignment = cfg->alignment;
+    p->hugepage = (memfd_debug & MEMFD_HUGEPAGE) ? 1 : 0;
+    *ctx = p;
+
+    return MPP_OK;
+}
+
+static MPP_RET allocator_memfd_alloc(void *ctx, MppBufferInfo *info)
+{
+    allocator_ctx_memfd *p = (allocator_ctx_memfd *)ctx;
+    size_t size;
+
+    if (NULL == p || NULL == info) {
+        mpp_err_f("found NULL context input\n");
+        return MPP_ERR_NULL_PTR;
+    }
+
+    size = MPP_ALIGN(info->size, p->alignment);
+
+    /* huge page pool may be empty so fallback to normal page on failure */
+    if (p->hugepage && size >= MEMFD_HUGEPAGE_SIZE &&
+        !memfd_create_buf(info, size, MFD_HUGETLB)) {
+        memfd_dbg_func("huge page size %d fd %d ptr %p\n",
+                       info->size, info->fd, info->ptr);
+        return MPP_OK;
+    }
+
+    if (memfd_create_buf(info, size, 0)) {
+        mpp_err_f("alloc size %d failed %s\n", info->size, strerror(errno));
+        info->fd = -1;
+        info->ptr = NULL;
+        return MPP_ERR_MALLOC;
+    }
+
+    memfd_dbg_func("size %d fd %d ptr %p\n", info->size, info->fd, info->ptr);
+
+    return MPP_OK;
+}
+
+static MPP_RET allocator_memfd_import(void *ctx, MppBufferInfo *info)
+{
+    RK_S32 fd;
+
+    if (NULL == ctx || NULL == info) {
+        mpp_err_f("found NULL context input\n");
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (info->fd < 0) {
+        mpp_err_f("invalid fd %d to import\n", info->fd);
+        return MPP_ERR_VALUE;
+    }
+
+    /* keep own reference so the caller can close its fd after import */
+    fd = fcntl(info->fd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0) {
+        mpp_err_f("dup fd %d failed %s\n", info->fd, strerror(errno));
+        return MPP_NOK;
+    }
+
+    memfd_dbg_func("import fd %d -> %d size %d\n", info->fd, fd, info->size);
+
+    info->fd = fd;
+    info->ptr = NULL;
+    info->hnd = NULL;
+
+    return MPP_OK;
+}
+
+static MPP_RET allocator_memfd_mmap(void *ctx, MppBufferInfo *info)
+{
+    void *ptr;
+
+    if (NULL == ctx || NULL == info) {
+        mpp_err_f("found NULL context input\n");
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (info->ptr)
+        return MPP_OK;
+
+    ptr = mmap(NULL, memfd_map_size(info->fd, info->size),
+               PROT_READ | PROT_WRITE, MAP_SHARED, info->fd, 0);
+    if (ptr == MAP_FAILED) {
+        mpp_err_f("mmap fd %d size %d failed %s\n", info->fd, info->size,
+                  strerror(errno));
+        return MPP_ERR_NULL_PTR;
+    }
+
+    info->ptr = ptr;
+
+    memfd_dbg_func("mmap fd %d to %p\n", info->fd, ptr);
+
+    return MPP_OK;
+}
+
+static MPP_RET allocator_memfd_free(void *ctx, MppBufferInfo *info)
+{
+    if (NULL == ctx || NULL == info) {
+        mpp_err_f("found NULL context input\n");
+        return MPP_ERR_NULL_PTR;
+    }
+
+    memfd_dbg_func("free fd %d ptr %p size %d\n", info->fd, info->ptr,
+                   info->size);
+
+    if (info->ptr) {
+        munmap(info->ptr, memfd_map_size(info->fd, info->size));
+        info->ptr = NULL;
+    }
+
+    if (info->fd >= 0) {
+        close(info->fd);
+        info->fd = -1;
+    }
+
+    return MPP_OK;
+}
+
+static MPP_RET allocator_memfd_close(void *ctx)
+{
+    if (ctx) {
+        mpp_free(ctx);
+        return MPP_OK;
+    }
+
+    mpp_err_f("found NULL context input\n");
+    return MPP_ERR_VALUE;
+}
+
+os_allocator allocator_memfd = {
+    .open = allocator_memfd_open,
+    .close = allocator_memfd_close,
+    .alloc = allocator_memfd_alloc,
+    .free = allocator_memfd_free,
+    .import = allocator_memfd_import,
+    .release = allocator_memfd_free,
+    .mmap = allocator_memfd_mmap,
+};
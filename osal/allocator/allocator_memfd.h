@@ -0,0 +1,35 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ALLOCATOR_MEMFD_H__
+#define __ALLOCATOR_MEMFD_H__
+
+#include "os_allocator.h"
+
+extern os_allocator allocator_memfd;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* return non-zero when kernel supports memfd_create */
+RK_U32 allocator_memfd_is_valid(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2015 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_ATOMIC_H__
+#define __MPP_ATOMIC_H__
+
+/*
+ * atomic operation wrapper for different compiler
+ * all the operation are full memory barrier
+ */
+#if defined(_MSC_VER)
+
+#include <windows.h>
+
+#define MPP_FETCH_ADD(ptr, value)       InterlockedExchangeAdd((volatile LONG *)(ptr), (value))
+#define MPP_FETCH_SUB(ptr, value)       InterlockedExchangeAdd((volatile LONG *)(ptr), -(value))
+#define MPP_ADD_FETCH(ptr, value)       (InterlockedExchangeAdd((volatile LONG *)(ptr), (value)) + (value))
+#define MPP_SUB_FETCH(ptr, value)       (InterlockedExchangeAdd((volatile LONG *)(ptr), -(value)) - (value))
+#define MPP_FETCH_OR(ptr, value)        InterlockedOr((volatile LONG *)(ptr), (value))
+#define MPP_FETCH_AND(ptr, value)       InterlockedAnd((volatile LONG *)(ptr), (value))
+#define MPP_BOOL_CAS(ptr, oldval, newval) \
+    (InterlockedCompareExchange((volatile LONG *)(ptr), (newval), (oldval)) == (LONG)(oldval))
+#define MPP_VAL_CAS(ptr, oldval, newval) \
+    InterlockedCompareExchange((volatile LONG *)(ptr), (newval), (oldval))
+#define MPP_SYNC()                      MemoryBarrier()
+
+#else
+
+#define MPP_FETCH_ADD(ptr, value)       __sync_fetch_and_add(ptr, value)
+#define MPP_FETCH_SUB(ptr, value)       __sync_fetch_and_sub(ptr, value)
+#define MPP_ADD_FETCH(ptr, value)       __sync_add_and_fetch(ptr, value)
+#define MPP_SUB_FETCH(ptr, value)       __sync_sub_and_fetch(ptr, value)
+#define MPP_FETCH_OR(ptr, value)        __sync_fetch_and_or(ptr, value)
+#define MPP_FETCH_AND(ptr, value)       __sync_fetch_and_and(ptr, value)
+#define MPP_BOOL_CAS(ptr, oldval, newval) \
+    __sync_bool_compare_and_swap(ptr, oldval, newval)
+#define MPP_VAL_CAS(ptr, oldval, newval) \
+    __sync_val_compare_and_swap(ptr, oldval, newval)
+#define MPP_SYNC()                      __sync_synchronize()
+
+#endif
+
+/* read current value with full barrier */
+#define MPP_ATOMIC_READ(ptr)            MPP_FETCH_ADD(ptr, 0)
+
+#endif /*__MPP_ATOMIC_H__*/
@@ -23,6 +23,7 @@
 extern "C" {
 #endif
 
+/* return eventfd on success or negative errno on failure */
 RK_S32 mpp_eventfd_get(RK_U32 init);
 RK_S32 mpp_eventfd_put(RK_S32 fd);
 
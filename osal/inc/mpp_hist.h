@@ -0,0 +1,76 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_HIST_H__
+#define __MPP_HIST_H__
+
+#include "rk_type.h"
+#include "mpp_err.h"
+
+/*
+ * MppHist is a log-linear histogram for always-on latency statistics
+ *
+ * Value below 16 has its own bucket. Each power of two above is split into
+ * 16 linear sub-buckets so the relative error is within 1/16 on the whole
+ * RK_U32 range. Recording is one bucket increment without lock and without
+ * memory allocation. It is designed for single writer. The reader can query
+ * while writer is running and the result may miss the samples in progress.
+ * Histogram recorded by several threads uses mpp_hist_record_atomic which
+ * updates the bucket and the sum / min / max with atomic operations.
+ *
+ * Histogram work flow:
+ *
+ * 1. mpp_hist_get
+ * 2. mpp_hist_record(value)
+ *    ... running ...
+ * 3. mpp_hist_get_count / mpp_hist_get_percentile
+ * 4. mpp_hist_put
+ */
+typedef void* MppHist;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+MppHist mpp_hist_get(const char *name);
+void mpp_hist_put(MppHist hist);
+void mpp_hist_reset(MppHist hist);
+
+void mpp_hist_record(MppHist hist, RK_S64 value);
+void mpp_hist_record_atomic(MppHist hist, RK_S64 value);
+
+/*
+ * Histogram query function:
+ * mpp_hist_get_count       - Return recorded sample count
+ * mpp_hist_get_sum         - Return recorded sample value sum
+ * mpp_hist_get_min         - Return minimum recorded value
+ * mpp_hist_get_max         - Return maximum recorded value
+ * mpp_hist_get_percentile  - Return the value at permille (0 ~ 1000) rank.
+ *                            The value is the upper bound of the bucket.
+ * mpp_hist_get_name        - Return histogram name
+ */
+RK_S64 mpp_hist_get_count(MppHist hist);
+RK_S64 mpp_hist_get_sum(MppHist hist);
+RK_S64 mpp_hist_get_min(MppHist hist);
+RK_S64 mpp_hist_get_max(MppHist hist);
+RK_S64 mpp_hist_get_percentile(MppHist hist, RK_U32 permille);
+const char *mpp_hist_get_name(MppHist hist);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__MPP_HIST_H__*/
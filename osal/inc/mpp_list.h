@@ -73,6 +73,7 @@ public:
 
     void wait();
     RK_S32 wait(RK_S64 timeout);
+    RK_S32 wait_us(RK_S64 timeout_us);
     void signal();
 
 private:
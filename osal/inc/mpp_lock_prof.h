@@ -0,0 +1,59 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_LOCK_PROF_H__
+#define __MPP_LOCK_PROF_H__
+
+#include "rk_type.h"
+
+/*
+ * Lock contention profiler
+ *
+ * The named Mutex registers a profile entry by name when the profiler is
+ * enabled. Mutexes with the same name share one entry, for example all the
+ * slot locks of all decoders in the process. On contention the wait time and
+ * the call site of the lock holder are recorded. Uncontended lock only costs
+ * one counter increment.
+ *
+ * env mpp_lock_prof:
+ * 0    - disabled, default
+ * N    - enabled and show top N contended locks on mpp_destroy
+ *
+ * When enabled the fast mutex is created as error check mutex so relock from
+ * the owner thread is reported instead of deadlock.
+ */
+typedef void* MppLockProf;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+RK_U32 mpp_lock_prof_enabled(void);
+/* return NULL when profiler is disabled or name is NULL */
+MppLockProf mpp_lock_prof_get(const char *name);
+
+RK_S64 mpp_lock_prof_now(void);
+void mpp_lock_prof_acquire(MppLockProf prof);
+/* wait is from start to now and holder is the lock call site of the owner */
+void mpp_lock_prof_contend(MppLockProf prof, RK_S64 start, void *holder);
+
+void mpp_lock_prof_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__MPP_LOCK_PROF_H__*/
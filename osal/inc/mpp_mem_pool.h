@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_MEM_POOL_H__
+#define __MPP_MEM_POOL_H__
+
+#include "rk_type.h"
+#include "mpp_err.h"
+
+/*
+ * Fixed size object pool for frequently created small objects
+ *
+ * Memory is allocated from mpp_mem by slab with multiple objects and never
+ * returned to mpp_mem until the pool is deinit. Freed objects are kept in a
+ * free list for next get. So on steady state the get / put does not touch
+ * heap at all. The object from mpp_mem_pool_get is zero initialized.
+ *
+ * env mpp_mem_pool_debug:
+ * bit 0 - show pool statistics on deinit
+ */
+typedef void* MppMemPool;
+
+typedef struct MppMemPoolInfo_t {
+    size_t      size;           /* object size */
+    RK_S32      slab_count;     /* slab allocated from mpp_mem */
+    RK_S32      total;          /* object count in all slabs */
+    RK_S32      used;           /* object count in use */
+    RK_S32      used_max;       /* max object count in use */
+    RK_S64      get_count;      /* total get operation count */
+} MppMemPoolInfo;
+
+#define mpp_mem_pool_init(size)         mpp_mem_pool_init_f(__FUNCTION__, size)
+#define mpp_mem_pool_deinit(pool)       mpp_mem_pool_deinit_f(__FUNCTION__, pool)
+#define mpp_mem_pool_get(pool)          mpp_mem_pool_get_f(__FUNCTION__, pool)
+#define mpp_mem_pool_put(pool, p)       mpp_mem_pool_put_f(__FUNCTION__, pool, p)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+MppMemPool mpp_mem_pool_init_f(const char *caller, size_t size);
+void mpp_mem_pool_deinit_f(const char *caller, MppMemPool pool);
+
+void *mpp_mem_pool_get_f(const char *caller, MppMemPool pool);
+void mpp_mem_pool_put_f(const char *caller, MppMemPool pool, void *p);
+
+MPP_RET mpp_mem_pool_info(MppMemPool pool, MppMemPoolInfo *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+/*
+ * Process wide pool holder for function local static usage.
+ * The pool is created on first use and destroyed on exit.
+ */
+class MppMemPoolHolder
+{
+public:
+    MppMemPoolHolder(const char *caller, size_t size)
+        : mPool(mpp_mem_pool_init_f(caller, size)) {};
+    ~MppMemPoolHolder() { if (mPool) mpp_mem_pool_deinit(mPool); };
+    MppMemPool get() { return mPool; };
+
+private:
+    MppMemPool  mPool;
+
+    MppMemPoolHolder(const MppMemPoolHolder &);
+    MppMemPoolHolder &operator=(const MppMemPoolHolder &);
+};
+#endif
+
+#endif /*__MPP_MEM_POOL_H__*/
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_RING_H__
+#define __MPP_RING_H__
+
+#include "rk_type.h"
+#include "mpp_err.h"
+
+/*
+ * Bounded lock-free pointer FIFO
+ *
+ * MppRing is a fixed size ring of pointers for hand-over of MppPacket /
+ * MppFrame between threads. Each cell has a sequence number so multiple
+ * producers and multiple consumers can work on it without lock and without
+ * memory allocation. Put fails when the ring is full and put_wait can block
+ * until there is space. Get can block as well and the sleeping side is waken
+ * up by futex on linux.
+ *
+ * The ring size is rounded up to power of two and at least two.
+ */
+typedef void* MppRing;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+MPP_RET mpp_ring_init(MppRing *ring, RK_S32 count);
+MPP_RET mpp_ring_deinit(MppRing ring);
+
+/* return MPP_ERR_BUFFER_FULL when ring is full */
+MPP_RET mpp_ring_put(MppRing ring, void *data);
+/*
+ * timeout in us
+ * 0    - non-block, the same as mpp_ring_put
+ * < 0  - block until there is space
+ * > 0  - return MPP_ERR_TIMEOUT when ring is still full after timeout
+ */
+MPP_RET mpp_ring_put_wait(MppRing ring, void *data, RK_S64 timeout);
+/*
+ * timeout in us
+ * 0    - non-block, return MPP_NOK when ring is empty
+ * < 0  - block until data is available
+ * > 0  - return MPP_ERR_TIMEOUT when no data after timeout
+ */
+MPP_RET mpp_ring_get(MppRing ring, void **data, RK_S64 timeout);
+
+/* data count in ring, the value may be outdated when returned */
+RK_S32 mpp_ring_size(MppRing ring);
+RK_S32 mpp_ring_is_empty(MppRing ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__MPP_RING_H__*/
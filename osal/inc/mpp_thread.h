@@ -50,12 +50,29 @@ int pthread_setname_np(pthread_t thread, const char *name);
 #define PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP PTHREAD_RECURSIVE_MUTEX_INITIALIZER
 #endif
 
+/*
+ * Condition timed wait uses monotonic clock so the timeout is not affected
+ * by wall clock step and has the precision of high resolution timer.
+ */
+#define MPP_COND_USE_MONOTONIC
+
 #endif
 
 #define THREAD_NAME_LEN 16
 
 typedef void *(*MppThreadFunc)(void *);
 
+/*
+ * Return value of step function. Refer to mpp_worker.h for detail.
+ */
+typedef enum MppThreadStep_e {
+    THREAD_STEP_AGAIN,
+    THREAD_STEP_WAIT,
+    THREAD_STEP_DONE,
+} MppThreadStep;
+
+typedef MppThreadStep (*MppThreadStepFunc)(void *);
+
 typedef enum {
     MPP_THREAD_UNINITED,
     MPP_THREAD_RUNNING,
@@ -70,6 +87,28 @@ typedef enum {
 class Mutex;
 class Condition;
 
+/*
+ * Mutex type
+ * MUTEX_RECURSIVE  - default type, the owner thread can lock it again
+ * MUTEX_FAST       - non-recursive mutex for hot path. On glibc it spins for
+ *                    a short while before sleep on contention. Relock from the
+ *                    owner thread deadlocks.
+ *
+ * The mutex with name is profiled when env mpp_lock_prof is set.
+ * Refer to mpp_lock_prof.h for detail.
+ */
+typedef enum MppMutexType_e {
+    MUTEX_RECURSIVE,
+    MUTEX_FAST,
+} MppMutexType;
+
+/* lock is always inlined so the profiler can find the call site of lock */
+#if defined(__GNUC__)
+#define MPP_LOCK_INLINE     inline __attribute__((always_inline))
+#else
+#define MPP_LOCK_INLINE     inline
+#endif
+
 /*
  * for shorter type name and function name
  */
@@ -77,6 +116,7 @@ class Mutex
 {
 public:
     Mutex();
+    Mutex(MppMutexType type, const char *name = NULL);
     ~Mutex();
 
     void lock();
@@ -86,8 +126,8 @@ public:
     class Autolock
     {
     public:
-        inline Autolock(Mutex& mutex) : mLock(mutex)  { mLock.lock(); }
-        inline Autolock(Mutex* mutex) : mLock(*mutex) { mLock.lock(); }
+        MPP_LOCK_INLINE Autolock(Mutex& mutex) : mLock(mutex)  { mLock.lock(); }
+        MPP_LOCK_INLINE Autolock(Mutex* mutex) : mLock(*mutex) { mLock.lock(); }
         inline ~Autolock() { mLock.unlock(); }
     private:
         Mutex& mLock;
@@ -97,12 +137,19 @@ private:
     friend class Condition;
 
     pthread_mutex_t mMutex;
+    /* profile entry and the lock call site of the owner when profiled */
+    void            *mProf;
+    void            *mOwner;
+
+    void lock_prof();
 
     Mutex(const Mutex &);
     Mutex &operator = (const Mutex&);
 };
 
 inline Mutex::Mutex()
+    : mProf(NULL),
+      mOwner(NULL)
 {
     pthread_mutexattr_t attr;
     pthread_mutexattr_init(&attr);
@@ -114,9 +161,12 @@ inline Mutex::~Mutex()
 {
     pthread_mutex_destroy(&mMutex);
 }
-inline void Mutex::lock()
+MPP_LOCK_INLINE void Mutex::lock()
 {
-    pthread_mutex_lock(&mMutex);
+    if (mProf)
+        lock_prof();
+    else
+        pthread_mutex_lock(&mMutex);
 }
 inline void Mutex::unlock()
 {
@@ -143,6 +193,7 @@ public:
     RK_S32 wait(Mutex* mutex);
     RK_S32 timedwait(Mutex& mutex, RK_S64 timeout);
     RK_S32 timedwait(Mutex* mutex, RK_S64 timeout);
+    RK_S32 timedwait_us(Mutex* mutex, RK_S64 timeout_us);
     RK_S32 signal();
 
 private:
@@ -151,7 +202,16 @@ private:
 
 inline Condition::Condition()
 {
+#ifdef MPP_COND_USE_MONOTONIC
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+#else
     pthread_cond_init(&mCond, NULL);
+#endif
 }
 inline Condition::~Condition()
 {
@@ -170,13 +230,21 @@ inline RK_S32 Condition::timedwait(Mutex& mutex, RK_S64 timeout)
     return timedwait(&mutex, timeout);
 }
 inline RK_S32 Condition::timedwait(Mutex* mutex, RK_S64 timeout)
+{
+    return timedwait_us(mutex, timeout * 1000);
+}
+inline RK_S32 Condition::timedwait_us(Mutex* mutex, RK_S64 timeout_us)
 {
     struct timespec ts;
 
-    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+#ifdef MPP_COND_USE_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    clock_gettime(CLOCK_REALTIME, &ts);
+#endif
 
-    ts.tv_sec += timeout / 1000;
-    ts.tv_nsec += (timeout % 1000) * 1000000;
+    ts.tv_sec += timeout_us / 1000000;
+    ts.tv_nsec += (timeout_us % 1000000) * 1000;
     /* Prevent the out of range at nanoseconds field */
     ts.tv_sec += ts.tv_nsec / 1000000000;
     ts.tv_nsec %= 1000000000;
@@ -217,11 +285,23 @@ typedef enum MppThreadSignal_e {
 #define THREAD_NORMAL       0
 #define THRE       0
 
+/*
+ * MppThread with thread function owns one thread which runs the function
+ * until it returns.
+ *
+ * MppThread with step function runs the step function repeatedly until it
+ * returns THREAD_STEP_DONE. Without the shared worker pool it owns one thread
+ * as the thread function mode. When the pool is enabled it becomes a job on
+ * the pool and signal on THREAD_WORK triggers the job. The step function
+ * should check pooled() and return THREAD_STEP_WAIT instead of wait on
+ * THREAD_WORK in this case.
+ */
 class MppThread
 {
 public:
     MppThread(MppThreadFunc func, void *ctx, const char *name = NULL);
-    ~MppThread() {};
+    MppThread(MppThreadStepFunc step, void *ctx, const char *name = NULL);
+    ~MppThread();
 
     MppThreadStatus get_status(MppThreadSignal id = THREAD_WORK);
     void set_status(MppThreadStatus status, MppThreadSignal id = THREAD_WORK);
@@ -229,6 +309,7 @@ public:
 
     void start();
     void stop();
+    RK_U32 pooled() { return mPooled; }
 
     void lock(MppThreadSignal id = THREAD_WORK) {
         mpp_assert(id < THREAD_SIGNAL_BUTT);
@@ -255,6 +336,8 @@ public:
     void signal(MppThreadSignal id = THREAD_WORK) {
         mpp_assert(id < THREAD_SIGNAL_BUTT);
         mMutexCond[id].signal();
+        if (mPooled && id == THREAD_WORK)
+            trigger();
     }
 
     Mutex *mutex(MppThreadSignal id = THREAD_WORK) {
@@ -268,8 +351,16 @@ private:
     MppThreadStatus mStatus[THREAD_SIGNAL_BUTT];
 
     MppThreadFunc   mFunction;
+    MppThreadStepFunc mStep;
     char            mName[THREAD_NAME_LEN];
     void            *mContext;
+    /* job on worker pool */
+    RK_U32          mPooled;
+    void            *mJob;
+
+    static void *step_loop(void *ctx);
+    void init(const char *name);
+    void trigger();
 
     MppThread();
     MppThread(const MppThread &);
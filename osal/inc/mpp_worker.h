@@ -0,0 +1,85 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MPP_WORKER_H__
+#define __MPP_WORKER_H__
+
+#include "rk_type.h"
+#include "mpp_err.h"
+#include "mpp_thread.h"
+
+/*
+ * Process wide worker pool
+ *
+ * A job is a step function with its context. The step function runs one
+ * piece of work and returns what to do next:
+ * THREAD_STEP_AGAIN    - queue the job again, other jobs may run in between
+ * THREAD_STEP_WAIT     - keep the job idle until it is triggered
+ * THREAD_STEP_DONE     - the job is finished and will not run again
+ *
+ * Trigger on a running job makes it run once more after the current step.
+ * So the step function can check its condition under the lock which the
+ * trigger caller also takes and then return THREAD_STEP_WAIT without losing
+ * any wakeup.
+ *
+ * Each worker has its own job queue. A triggered job goes to the queue of the
+ * worker which ran it last time and the idle worker steals jobs from the
+ * other queues.
+ *
+ * The step function should not block on the progress of other jobs. If it
+ * has to, for example waiting for hardware slot released by other context,
+ * the blocking part should be put between mpp_worker_block_enter and
+ * mpp_worker_block_leave. Then a spare worker is started to keep the number
+ * of running workers.
+ *
+ * MppThread created with step function runs on this pool when the pool is
+ * enabled. Refer to mpp_thread.h.
+ *
+ * env mpp_worker_pool:
+ * 0 - one thread for each MppThread (default), 1 - use the shared pool
+ *
+ * env mpp_worker_count:
+ * worker count, default is the cpu count in affinity mask
+ *
+ * env mpp_worker_affinity:
+ * cpu mask of the workers, for example 0xf0 for cpu 4 to 7, default all cpus
+ */
+typedef void* MppWorkerJob;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+RK_U32 mpp_worker_enabled(void);
+
+/* the job is idle after init and runs after the first trigger */
+MPP_RET mpp_worker_job_init(MppWorkerJob *job, MppThreadStepFunc func,
+                            void *ctx, const char *name);
+MPP_RET mpp_worker_job_deinit(MppWorkerJob job);
+/* trigger on finished job is ignored */
+void mpp_worker_job_trigger(MppWorkerJob job);
+/* wait until the step function returns THREAD_STEP_DONE */
+void mpp_worker_job_join(MppWorkerJob job);
+
+/* called from the step function, no effect on other threads */
+void mpp_worker_block_enter(void);
+void mpp_worker_block_leave(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__MPP_WORKER_H__*/
@@ -21,11 +21,15 @@
 #include "allocator_drm.h"
 #include "allocator_ext_dma.h"
 #include "allocator_ion.h"
+#include "allocator_memfd.h"
 #include "allocator_std.h"
 
 /*
  * Linux only support MPP_BUFFER_TYPE_NORMAL so far
  * we can support MPP_BUFFER_TYPE_V4L2 later
+ *
+ * When neither ion nor drm device is available the fd-based buffer type falls
+ * back to memfd so that the buffer still has a fd for sharing across process.
  */
 
 MPP_RET os_allocator_get(os_allocator *api, MppBufferType type)
@@ -40,6 +44,7 @@ MPP_RET os_allocator_get(os_allocator *api, MppBufferType type)
 #if HAVE_DRM
                (mpp_rt_allcator_is_valid(MPP_BUFFER_TYPE_DRM)) ? allocator_drm :
 #endif
+               (allocator_memfd_is_valid()) ? allocator_memfd :
                allocator_std;
     } break;
     case MPP_BUFFER_TYPE_EXT_DMA: {
@@ -52,6 +57,7 @@ MPP_RET os_allocator_get(os_allocator *api, MppBufferType type)
         * api =
 #endif
                (mpp_rt_allcator_is_valid(MPP_BUFFER_TYPE_ION)) ? allocator_ion :
+               (allocator_memfd_is_valid()) ? allocator_memfd :
                allocator_std;
     } break;
     default : {
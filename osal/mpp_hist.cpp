@@ -0,0 +1,278 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_hist"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_hist.h"
+#include "mpp_atomic.h"
+
+/* 16 sub-buckets for each power of two and value 0 ~ 15 in first 16 buckets */
+#define HIST_SUB_BITS           4
+#define HIST_SUB_COUNT          (1 << HIST_SUB_BITS)
+#define HIST_BUCKET_COUNT       ((32 - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+#define HIST_VALUE_MAX          (0xFFFFFFFFLL)
+
+typedef struct MppHistImpl_t {
+    const char  *check;
+    char        name[16];
+    RK_S64      count;
+    RK_S64      sum;
+    RK_S64      min;
+    RK_S64      max;
+    RK_U32      buckets[HIST_BUCKET_COUNT];
+} MppHistImpl;
+
+static const char *hist_name = "mpp_hist";
+
+static MPP_RET check_is_mpp_hist(void *hist)
+{
+    if (hist && ((MppHistImpl*)hist)->check == hist_name)
+        return MPP_OK;
+
+    mpp_err_f("pointer %p failed on check\n", hist);
+    mpp_abort();
+    return MPP_NOK;
+}
+
+static RK_S32 hist_clz32(RK_U32 val)
+{
+#if defined(__GNUC__)
+    return __builtin_clz(val);
+#else
+    RK_S32 n = 0;
+
+    while (!(val & 0x80000000)) {
+        val <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static RK_S32 hist_bucket_idx(RK_U32 val)
+{
+    RK_S32 msb;
+
+    if (val < HIST_SUB_COUNT)
+        return val;
+
+    msb = 31 - hist_clz32(val);
+
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB_COUNT +
+           ((val >> (msb - HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+}
+
+static RK_S64 hist_bucket_upper(RK_S32 idx)
+{
+    RK_S32 shift;
+    RK_S64 base;
+
+    if (idx < HIST_SUB_COUNT)
+        return idx;
+
+    shift = idx / HIST_SUB_COUNT - 1;
+    base = (RK_S64)(HIST_SUB_COUNT + idx % HIST_SUB_COUNT) << shift;
+
+    return base + (1LL << shift) - 1;
+}
+
+MppHist mpp_hist_get(const char *name)
+{
+    MppHistImpl *impl = mpp_calloc(MppHistImpl, 1);
+    if (impl) {
+        impl->check = hist_name;
+        snprintf(impl->name, sizeof(impl->name), "%s", name);
+        mpp_hist_reset(impl);
+    } else
+        mpp_err_f("malloc failed\n");
+
+    return impl;
+}
+
+void mpp_hist_put(MppHist hist)
+{
+    if (NULL == hist || check_is_mpp_hist(hist)) {
+        mpp_err_f("invalid hist %p\n", hist);
+        return ;
+    }
+
+    mpp_free(hist);
+}
+
+void mpp_hist_reset(MppHist hist)
+{
+    if (NULL == hist || check_is_mpp_hist(hist)) {
+        mpp_err_f("invalid hist %p\n", hist);
+        return ;
+    }
+
+    MppHistImpl *p = (MppHistImpl *)hist;
+
+    memset(p->buckets, 0, sizeof(p->buckets));
+    p->count = 0;
+    p->sum = 0;
+    p->min = HIST_VALUE_MAX;
+    p->max = 0;
+}
+
+/*
+ * NOTE: record is on hot path of codec threads. The NULL histogram is
+ * silently ignored and no check is done for speed.
+ */
+void mpp_hist_record(MppHist hist, RK_S64 value)
+{
+    MppHistImpl *p = (MppHistImpl *)hist;
+
+    if (NULL == p)
+        return ;
+
+    if (value < 0)
+        value = 0;
+    if (value > HIST_VALUE_MAX)
+        value = HIST_VALUE_MAX;
+
+    p->buckets[hist_bucket_idx((RK_U32)value)]++;
+    p->count++;
+    p->sum += value;
+    if (value < p->min)
+        p->min = value;
+    if (value > p->max)
+        p->max = value;
+}
+
+void mpp_hist_record_atomic(MppHist hist, RK_S64 value)
+{
+    MppHistImpl *p = (MppHistImpl *)hist;
+    RK_S64 old;
+
+    if (NULL == p)
+        return ;
+
+    if (value < 0)
+        value = 0;
+    if (value > HIST_VALUE_MAX)
+        value = HIST_VALUE_MAX;
+
+    MPP_FETCH_ADD(&p->buckets[hist_bucket_idx((RK_U32)value)], 1);
+    MPP_FETCH_ADD(&p->count, 1);
+    MPP_FETCH_ADD(&p->sum, value);
+
+    old = p->min;
+    while (value < old && !MPP_BOOL_CAS(&p->min, old, value))
+        old = p->min;
+
+    old = p->max;
+    while (value > old && !MPP_BOOL_CAS(&p->max, old, value))
+        old = p->max;
+}
+
+RK_S64 mpp_hist_get_count(MppHist hist)
+{
+    if (NULL == hist || check_is_mpp_hist(hist)) {
+        mpp_err_f("invalid hist %p\n", hist);
+        return 0;
+    }
+
+    return ((MppHistImpl *)hist)->count;
+}
+
+RK_S64 mpp_hist_get_sum(MppHist hist)
+{
+    if (NULL == hist || check_is_mpp_hist(hist)) {
+        mpp_err_f("invalid hist %p\n", hist);
+        return 0;
+    }
+
+    return ((MppHistImpl *)hist)->sum;
+}
+
+RK_S64 mpp_hist_get_min(MppHist hist)
+{
+    if (NULL == hist || check_is_mpp_hist(hist)) {
+        mpp_err_f("invalid hist %p\n", hist);
+        return 0;
+    }
+
+    MppHistImpl *p = (MppHistImpl *)hist;
+
+    return (p->count) ? p->min : 0;
+}
+
+RK_S64 mpp_hist_get_max(MppHist hist)
+{
+    if (NULL == hist || check_is_mpp_hist(hist)) {
+        mpp_err_f("invalid hist %p\n", hist);
+        return 0;
+    }
+
+    return ((MppHistImpl *)hist)->max;
+}
+
+RK_S64 mpp_hist_get_percentile(MppHist hist, RK_U32 permille)
+{
+    if (NULL == hist || check_is_mpp_hist(hist)) {
+        mpp_err_f("invalid hist %p\n", hist);
+        return 0;
+    }
+
+    MppHistImpl *p = (MppHistImpl *)hist;
+    RK_S64 total = 0;
+    RK_S64 rank;
+    RK_S64 acc = 0;
+    RK_S32 i;
+
+    /* use bucket sum as total for consistency with concurrent writer */
+    for (i = 0; i < HIST_BUCKET_COUNT; i++)
+        total += p->buckets[i];
+
+    if (!total)
+        return 0;
+
+    if (permille > 1000)
+        permille = 1000;
+
+    rank = (total * permille + 999) / 1000;
+    if (rank < 1)
+        rank = 1;
+
+    for (i = 0; i < HIST_BUCKET_COUNT; i++) {
+        acc += p->buckets[i];
+        if (acc >= rank)
+            break;
+    }
+
+    if (i >= HIST_BUCKET_COUNT)
+        return p->max;
+
+    /* bucket upper bound should not exceed the recorded maximum */
+    acc = hist_bucket_upper(i);
+    return (acc > p->max) ? p->max : acc;
+}
+
+const char *mpp_hist_get_name(MppHist hist)
+{
+    if (NULL == hist || check_is_mpp_hist(hist)) {
+        mpp_err_f("invalid hist %p\n", hist);
+        return NULL;
+    }
+
+    return ((MppHistImpl *)hist)->name;
+}
@@ -333,6 +333,11 @@ RK_S32 mpp_list::wait(RK_S64 timeout)
     return mCondition.timedwait(mMutex, timeout);
 }
 
+RK_S32 mpp_list::wait_us(RK_S64 timeout_us)
+{
+    return mCondition.timedwait_us(&mMutex, timeout_us);
+}
+
 void mpp_list::signal()
 {
     mCondition.signal();
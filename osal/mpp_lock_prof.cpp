@@ -0,0 +1,225 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_lock_prof"
+
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#endif
+
+#include "mpp_env.h"
+#include "mpp_log.h"
+#include "mpp_atomic.h"
+#include "mpp_common.h"
+#include "mpp_thread.h"
+#include "mpp_lock_prof.h"
+
+#define LOCK_PROF_MAX               64
+#define LOCK_PROF_SITE_MAX          4
+
+typedef struct MppLockSite_t {
+    void            *site;
+    RK_S64          count;
+    RK_S64          wait;
+} MppLockSite;
+
+typedef struct MppLockStat_t {
+    const char      *name;
+    RK_S64          acquire;
+    RK_S64          contend;
+    RK_S64          wait;
+    RK_S64          wait_max;
+    /* holder call sites with the most wait time caused */
+    MppLockSite     sites[LOCK_PROF_SITE_MAX];
+} MppLockStat;
+
+/*
+ * Profiler state is plain pthread mutex and static table so it does not
+ * depend on any Mutex object and can be used in static Mutex constructor.
+ */
+static pthread_mutex_t prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static MppLockStat prof_stats[LOCK_PROF_MAX];
+static RK_S32 prof_count = 0;
+static RK_S32 prof_top = -1;
+
+RK_U32 mpp_lock_prof_enabled(void)
+{
+    if (prof_top < 0) {
+        RK_U32 top = 0;
+
+        mpp_env_get_u32("mpp_lock_prof", &top, 0);
+        prof_top = top;
+    }
+
+    return prof_top > 0;
+}
+
+MppLockProf mpp_lock_prof_get(const char *name)
+{
+    MppLockStat *stat = NULL;
+    RK_S32 i;
+
+    if (NULL == name || !mpp_lock_prof_enabled())
+        return NULL;
+
+    pthread_mutex_lock(&prof_lock);
+
+    for (i = 0; i < prof_count; i++) {
+        if (!strcmp(prof_stats[i].name, name)) {
+            stat = &prof_stats[i];
+            break;
+        }
+    }
+
+    if (NULL == stat && prof_count < LOCK_PROF_MAX) {
+        stat = &prof_stats[prof_count++];
+        stat->name = name;
+    }
+
+    pthread_mutex_unlock(&prof_lock);
+
+    if (NULL == stat)
+        mpp_err_f("too many profiled locks, %s is not profiled\n", name);
+
+    return stat;
+}
+
+RK_S64 mpp_lock_prof_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (RK_S64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void mpp_lock_prof_acquire(MppLockProf prof)
+{
+    MppLockStat *stat = (MppLockStat *)prof;
+
+    MPP_FETCH_ADD(&stat->acquire, 1);
+}
+
+void mpp_lock_prof_contend(MppLockProf prof, RK_S64 start, void *holder)
+{
+    MppLockStat *stat = (MppLockStat *)prof;
+    RK_S64 wait = mpp_lock_prof_now() - start;
+    MppLockSite *min = NULL;
+    RK_S32 i;
+
+    MPP_FETCH_ADD(&stat->acquire, 1);
+
+    pthread_mutex_lock(&prof_lock);
+
+    stat->contend++;
+    stat->wait += wait;
+    stat->wait_max = MPP_MAX(stat->wait_max, wait);
+
+    /* keep the sites with most wait and replace the least one */
+    for (i = 0; i < LOCK_PROF_SITE_MAX; i++) {
+        MppLockSite *s = &stat->sites[i];
+
+        if (s->site == holder) {
+            min = s;
+            break;
+        }
+
+        if (NULL == min || s->wait < min->wait)
+            min = s;
+    }
+
+    if (min->site != holder) {
+        min->site = holder;
+        min->count = 0;
+        min->wait = 0;
+    }
+    min->count++;
+    min->wait += wait;
+
+    pthread_mutex_unlock(&prof_lock);
+}
+
+/*
+ * Static function has no dynamic symbol so show the offset in module then
+ * addr2line can be used on it.
+ */
+static void lock_prof_show_site(MppLockSite *s)
+{
+    const char *sym = NULL;
+    RK_S64 offset = 0;
+
+#if defined(__linux__)
+    Dl_info info;
+
+    if (dladdr(s->site, &info)) {
+        if (info.dli_sname) {
+            sym = info.dli_sname;
+            offset = (RK_U8 *)s->site - (RK_U8 *)info.dli_saddr;
+        } else if (info.dli_fname) {
+            const char *base = strrchr(info.dli_fname, '/');
+
+            sym = base ? base + 1 : info.dli_fname;
+            offset = (RK_U8 *)s->site - (RK_U8 *)info.dli_fbase;
+        }
+    }
+#endif
+
+    mpp_log("    holder %p %s+0x%llx count %lld wait %lld us\n",
+            s->site, sym ? sym : "??", offset, s->count, s->wait / 1000);
+}
+
+void mpp_lock_prof_dump(void)
+{
+    MppLockStat stats[LOCK_PROF_MAX];
+    RK_S32 count;
+    RK_S32 i;
+    RK_S32 j;
+
+    if (!mpp_lock_prof_enabled())
+        return ;
+
+    pthread_mutex_lock(&prof_lock);
+    count = prof_count;
+    memcpy(stats, prof_stats, sizeof(stats[0]) * count);
+    pthread_mutex_unlock(&prof_lock);
+
+    /* sort by total wait time */
+    for (i = 1; i < count; i++) {
+        MppLockStat tmp = stats[i];
+
+        for (j = i - 1; j >= 0 && stats[j].wait < tmp.wait; j--)
+            stats[j + 1] = stats[j];
+        stats[j + 1] = tmp;
+    }
+
+    mpp_log("lock contention top %d of %d locks:\n", MPP_MIN(prof_top, count), count);
+
+    for (i = 0; i < count && i < prof_top; i++) {
+        MppLockStat *stat = &stats[i];
+
+        mpp_log("%-16s acquire %9lld contend %8lld wait %8lld us avg %6lld ns max %6lld us\n",
+                stat->name, stat->acquire, stat->contend, stat->wait / 1000,
+                stat->contend ? stat->wait / stat->contend : 0,
+                stat->wait_max / 1000);
+
+        for (j = 0; j < LOCK_PROF_SITE_MAX; j++) {
+            if (stat->sites[j].site)
+                lock_prof_show_site(&stat->sites[j]);
+        }
+    }
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_mem_pool"
+
+#include <string.h>
+
+#include "mpp_env.h"
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_common.h"
+#include "mpp_thread.h"
+#include "mpp_mem_pool.h"
+
+#define MEM_POOL_DBG_INFO           (0x00000001)
+
+/* object count in one slab */
+#define MEM_POOL_SLAB_COUNT         32
+#define MEM_POOL_ALIGN              16
+
+/*
+ * Each object has a node head. The pool pointer in node is set while the
+ * object is in use and cleared when it is put back for double free check.
+ */
+typedef struct MppMemPoolNode_t {
+    struct MppMemPoolNode_t *next;
+    void                    *pool;
+} MppMemPoolNode;
+
+typedef struct MppMemPoolSlab_t {
+    struct MppMemPoolSlab_t *next;
+} MppMemPoolSlab;
+
+typedef struct MppMemPoolImpl_t {
+    const char      *check;
+    const char      *caller;
+    size_t          size;
+    size_t          node_size;
+    size_t          head_size;
+
+    Mutex           *lock;
+    MppMemPoolSlab  *slabs;
+    MppMemPoolNode  *unused;
+
+    RK_S32          slab_count;
+    RK_S32          total;
+    RK_S32          used;
+    RK_S32          used_max;
+    RK_S64          get_count;
+} MppMemPoolImpl;
+
+static const char *pool_name = "mpp_mem_pool";
+static RK_U32 mpp_mem_pool_debug = 0;
+
+static MPP_RET check_is_mpp_mem_pool(void *pool)
+{
+    if (pool && ((MppMemPoolImpl*)pool)->check == pool_name)
+        return MPP_OK;
+
+    mpp_err_f("pointer %p failed on check\n", pool);
+    mpp_abort();
+    return MPP_NOK;
+}
+
+static MPP_RET mem_pool_add_slab(MppMemPoolImpl *pool, const char *caller)
+{
+    size_t head = MPP_ALIGN(sizeof(MppMemPoolSlab), MEM_POOL_ALIGN);
+    MppMemPoolSlab *slab = mpp_malloc_size(MppMemPoolSlab,
+                                           head + pool->node_size * MEM_POOL_SLAB_COUNT);
+    RK_U8 *base;
+    RK_S32 i;
+
+    if (NULL == slab) {
+        mpp_err_f("pool %p size %d add slab failed at %s\n", pool,
+                  pool->size, caller);
+        return MPP_ERR_MALLOC;
+    }
+
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    /* link the nodes in address order for better locality */
+    base = (RK_U8 *)slab + head;
+    for (i = MEM_POOL_SLAB_COUNT - 1; i >= 0; i--) {
+        MppMemPoolNode *node = (MppMemPoolNode *)(base + pool->node_size * i);
+
+        node->pool = NULL;
+        node->next = pool->unused;
+        pool->unused = node;
+    }
+
+    pool->slab_count++;
+    pool->total += MEM_POOL_SLAB_COUNT;
+
+    return MPP_OK;
+}
+
+MppMemPool mpp_mem_pool_init_f(const char *caller, size_t size)
+{
+    MppMemPoolImpl *pool = mpp_calloc(MppMemPoolImpl, 1);
+
+    if (NULL == pool) {
+        mpp_err_f("malloc failed at %s\n", caller);
+        return NULL;
+    }
+
+    mpp_env_get_u32("mpp_mem_pool_debug", &mpp_mem_pool_debug, 0);
+
+    pool->check = pool_name;
+    pool->caller = caller;
+    pool->size = size;
+    pool->head_size = MPP_ALIGN(sizeof(MppMemPoolNode), MEM_POOL_ALIGN);
+    pool->node_size = pool->head_size + MPP_ALIGN(size, MEM_POOL_ALIGN);
+    pool->lock = new Mutex();
+
+    return pool;
+}
+
+void mpp_mem_pool_deinit_f(const char *caller, MppMemPool pool)
+{
+    if (NULL == pool || check_is_mpp_mem_pool(pool)) {
+        mpp_err_f("invalid pool %p at %s\n", pool, caller);
+        return ;
+    }
+
+    MppMemPoolImpl *impl = (MppMemPoolImpl *)pool;
+
+    if (mpp_mem_pool_debug & MEM_POOL_DBG_INFO)
+        mpp_log("pool %s size %d slab %d total %d used max %d get %lld\n",
+                impl->caller, impl->size, impl->slab_count, impl->total,
+                impl->used_max, impl->get_count);
+
+    if (impl->used)
+        mpp_err("pool %s size %d found %d object leaked at %s\n",
+                impl->caller, impl->size, impl->used, caller);
+
+    while (impl->slabs) {
+        MppMemPoolSlab *slab = impl->slabs;
+
+        impl->slabs = slab->next;
+        mpp_free(slab);
+    }
+
+    delete impl->lock;
+    impl->check = NULL;
+    mpp_free(impl);
+}
+
+void *mpp_mem_pool_get_f(const char *caller, MppMemPool pool)
+{
+    MppMemPoolImpl *impl = (MppMemPoolImpl *)pool;
+    MppMemPoolNode *node = NULL;
+
+    if (NULL == impl || check_is_mpp_mem_pool(impl)) {
+        mpp_err_f("invalid pool %p at %s\n", pool, caller);
+        return NULL;
+    }
+
+    {
+        AutoMutex auto_lock(impl->lock);
+
+        if (NULL == impl->unused && mem_pool_add_slab(impl, caller))
+            return NULL;
+
+        node = impl->unused;
+        impl->unused = node->next;
+        impl->used++;
+        impl->get_count++;
+        if (impl->used > impl->used_max)
+            impl->used_max = impl->used;
+    }
+
+    node->next = NULL;
+    node->pool = impl;
+
+    void *p = (RK_U8 *)node + impl->head_size;
+    memset(p, 0, impl->size);
+
+    return p;
+}
+
+void mpp_mem_pool_put_f(const char *caller, MppMemPool pool, void *p)
+{
+    MppMemPoolImpl *impl = (MppMemPoolImpl *)pool;
+    MppMemPoolNode *node;
+
+    if (NULL == impl || check_is_mpp_mem_pool(impl) || NULL == p) {
+        mpp_err_f("invalid pool %p object %p at %s\n", pool, p, caller);
+        return ;
+    }
+
+    node = (MppMemPoolNode *)((RK_U8 *)p - impl->head_size);
+    if (node->pool != impl) {
+        mpp_err_f("object %p is not from pool %s or double freed at %s\n",
+                  p, impl->caller, caller);
+        return ;
+    }
+
+    node->pool = NULL;
+
+    AutoMutex auto_lock(impl->lock);
+
+    node->next = impl->unused;
+    impl->unused = node;
+    impl->used--;
+}
+
+MPP_RET mpp_mem_pool_info(MppMemPool pool, MppMemPoolInfo *info)
+{
+    if (NULL == pool || check_is_mpp_mem_pool(pool) || NULL == info) {
+        mpp_err_f("invalid pool %p info %p\n", pool, info);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    MppMemPoolImpl *impl = (MppMemPoolImpl *)pool;
+    AutoMutex auto_lock(impl->lock);
+
+    info->size          = impl->size;
+    info->slab_count    = impl->slab_count;
+    info->total         = impl->total;
+    info->used          = impl->used;
+    info->used_max      = impl->used_max;
+    info->get_count     = impl->get_count;
+
+    return MPP_OK;
+}
@@ -277,6 +277,9 @@ MppPlatformService::MppPlatformService()
     if (!mpp_find_device(mpp_vpu_dev))
         vcodec_type &= ~(HAVE_VDPU1 | HAVE_VEPU1 | HAVE_VDPU2 | HAVE_VEPU2);
 __return:
+    /* force vcodec type for hal selection on host without vcodec device */
+    mpp_env_get_u32("mpp_vcodec_type", &vcodec_type, vcodec_type);
+
     mpp_dbg(MPP_DBG_PLATFORM, "vcodec type %08x\n", vcodec_type);
 }
 
@@ -0,0 +1,356 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_ring"
+
+#include <limits.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_time.h"
+#include "mpp_atomic.h"
+#include "mpp_common.h"
+#include "mpp_ring.h"
+
+#define RING_COUNT_MAX              (1 << 16)
+#define RING_CACHE_LINE             64
+
+/*
+ * Cell sequence tells the cell state to both sides:
+ * seq == pos           - empty and ready for the producer at pos
+ * seq == pos + 1       - filled and ready for the consumer at pos
+ * seq == pos + count   - consumed and ready for the producer of next round
+ */
+typedef struct MppRingCell_t {
+    volatile RK_U32 seq;
+    void            *data;
+} MppRingCell;
+
+typedef struct MppRingImpl_t {
+    const char      *check;
+    MppRingCell     *cells;
+    RK_U32          mask;
+
+    /* producer and consumer position on separated cache line */
+    RK_U8           pad0[RING_CACHE_LINE];
+    volatile RK_U32 wr;
+    RK_U8           pad1[RING_CACHE_LINE];
+    volatile RK_U32 rd;
+    RK_U8           pad2[RING_CACHE_LINE];
+
+    /* put counter as futex word and sleeping consumer count */
+    volatile RK_S32 event;
+    volatile RK_S32 waiters;
+    /* get counter as futex word and sleeping producer count */
+    volatile RK_S32 space;
+    volatile RK_S32 put_waiters;
+} MppRingImpl;
+
+static const char *ring_name = "mpp_ring";
+
+static MPP_RET check_is_mpp_ring(void *ring)
+{
+    if (ring && ((MppRingImpl *)ring)->check == ring_name)
+        return MPP_OK;
+
+    mpp_err_f("pointer %p failed on check\n", ring);
+    mpp_abort();
+    return MPP_NOK;
+}
+
+#if defined(__linux__)
+static void ring_wait(volatile RK_S32 *addr, RK_S32 val, RK_S64 timeout)
+{
+    struct timespec ts;
+    struct timespec *t = NULL;
+
+    if (timeout >= 0) {
+        ts.tv_sec = timeout / 1000000;
+        ts.tv_nsec = (timeout % 1000000) * 1000;
+        t = &ts;
+    }
+
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, t, NULL, 0);
+}
+
+static void ring_wake(volatile RK_S32 *addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+#else
+/* no futex then poll the ring by short sleep */
+static void ring_wait(volatile RK_S32 *addr, RK_S32 val, RK_S64 timeout)
+{
+    (void)addr;
+    (void)val;
+    (void)timeout;
+    msleep(1);
+}
+
+static void ring_wake(volatile RK_S32 *addr)
+{
+    (void)addr;
+}
+#endif
+
+static MPP_RET ring_try_get(MppRingImpl *p, void **data)
+{
+    RK_U32 pos = p->rd;
+
+    do {
+        MppRingCell *cell = &p->cells[pos & p->mask];
+        RK_S32 diff = (RK_S32)(cell->seq - (pos + 1));
+
+        if (diff == 0) {
+            if (MPP_BOOL_CAS(&p->rd, pos, pos + 1)) {
+                /* read data after seq check and release cell after read */
+                MPP_SYNC();
+                *data = cell->data;
+                MPP_SYNC();
+                cell->seq = pos + p->mask + 1;
+
+                /* wake up the producer waiting for space as put does for get */
+                MPP_FETCH_ADD(&p->space, 1);
+                if (MPP_ATOMIC_READ(&p->put_waiters))
+                    ring_wake(&p->space);
+                return MPP_OK;
+            }
+        } else if (diff < 0) {
+            return MPP_NOK;
+        }
+
+        pos = p->rd;
+    } while (1);
+
+    return MPP_NOK;
+}
+
+MPP_RET mpp_ring_init(MppRing *ring, RK_S32 count)
+{
+    MppRingImpl *p;
+    /* one cell ring can not tell filled cell from consumed cell */
+    RK_U32 size = 2;
+    RK_U32 i;
+
+    if (NULL == ring || count <= 0 || count > RING_COUNT_MAX) {
+        mpp_err_f("invalid ring %p count %d\n", ring, count);
+        return MPP_ERR_VALUE;
+    }
+
+    *ring = NULL;
+
+    while (size < (RK_U32)count)
+        size <<= 1;
+
+    p = mpp_calloc(MppRingImpl, 1);
+    if (p)
+        p->cells = mpp_calloc(MppRingCell, size);
+
+    if (NULL == p || NULL == p->cells) {
+        mpp_err_f("malloc ring with count %d failed\n", count);
+        MPP_FREE(p);
+        return MPP_ERR_MALLOC;
+    }
+
+    for (i = 0; i < size; i++)
+        p->cells[i].seq = i;
+
+    p->check = ring_name;
+    p->mask = size - 1;
+    *ring = p;
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_ring_deinit(MppRing ring)
+{
+    MppRingImpl *p = (MppRingImpl *)ring;
+
+    if (NULL == p || check_is_mpp_ring(p)) {
+        mpp_err_f("invalid ring %p\n", ring);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (p->wr != p->rd)
+        mpp_log_f("ring %p deinit with %d data left\n", p, p->wr - p->rd);
+
+    p->check = NULL;
+    mpp_free(p->cells);
+    mpp_free(p);
+
+    return MPP_OK;
+}
+
+static MPP_RET ring_try_put(MppRingImpl *p, void *data)
+{
+    RK_U32 pos = p->wr;
+
+    do {
+        MppRingCell *cell = &p->cells[pos & p->mask];
+        RK_S32 diff = (RK_S32)(cell->seq - pos);
+
+        if (diff == 0) {
+            if (MPP_BOOL_CAS(&p->wr, pos, pos + 1)) {
+                cell->data = data;
+                /* publish data before seq */
+                MPP_SYNC();
+                cell->seq = pos + 1;
+                break;
+            }
+        } else if (diff < 0) {
+            return MPP_ERR_BUFFER_FULL;
+        }
+
+        pos = p->wr;
+    } while (1);
+
+    /*
+     * Event update is a full barrier so either the consumer sees the new data
+     * on its check after registered as waiter or we see the waiter here.
+     */
+    MPP_FETCH_ADD(&p->event, 1);
+    if (MPP_ATOMIC_READ(&p->waiters))
+        ring_wake(&p->event);
+
+    return MPP_OK;
+}
+
+MPP_RET mpp_ring_put(MppRing ring, void *data)
+{
+    MppRingImpl *p = (MppRingImpl *)ring;
+
+    if (NULL == p || check_is_mpp_ring(p)) {
+        mpp_err_f("invalid ring %p\n", ring);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    return ring_try_put(p, data);
+}
+
+MPP_RET mpp_ring_put_wait(MppRing ring, void *data, RK_S64 timeout)
+{
+    MppRingImpl *p = (MppRingImpl *)ring;
+    RK_S64 end = 0;
+
+    if (NULL == p || check_is_mpp_ring(p)) {
+        mpp_err_f("invalid ring %p\n", ring);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (timeout > 0)
+        end = mpp_time() + timeout;
+
+    do {
+        RK_S64 wait = -1;
+        RK_S32 space;
+
+        if (!ring_try_put(p, data))
+            return MPP_OK;
+
+        if (!timeout)
+            return MPP_ERR_BUFFER_FULL;
+
+        if (timeout > 0) {
+            wait = end - mpp_time();
+            if (wait <= 0)
+                return MPP_ERR_TIMEOUT;
+        }
+
+        space = p->space;
+        MPP_FETCH_ADD(&p->put_waiters, 1);
+
+        if (!ring_try_put(p, data)) {
+            MPP_FETCH_SUB(&p->put_waiters, 1);
+            return MPP_OK;
+        }
+
+        ring_wait(&p->space, space, wait);
+        MPP_FETCH_SUB(&p->put_waiters, 1);
+    } while (1);
+
+    return MPP_NOK;
+}
+
+MPP_RET mpp_ring_get(MppRing ring, void **data, RK_S64 timeout)
+{
+    MppRingImpl *p = (MppRingImpl *)ring;
+    RK_S64 end = 0;
+
+    if (NULL == p || check_is_mpp_ring(p) || NULL == data) {
+        mpp_err_f("invalid ring %p data %p\n", ring, data);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    if (timeout > 0)
+        end = mpp_time() + timeout;
+
+    do {
+        RK_S64 wait = -1;
+        RK_S32 event;
+
+        if (!ring_try_get(p, data))
+            return MPP_OK;
+
+        if (!timeout)
+            return MPP_NOK;
+
+        if (timeout > 0) {
+            wait = end - mpp_time();
+            if (wait <= 0)
+                return MPP_ERR_TIMEOUT;
+        }
+
+        event = p->event;
+        MPP_FETCH_ADD(&p->waiters, 1);
+
+        if (!ring_try_get(p, data)) {
+            MPP_FETCH_SUB(&p->waiters, 1);
+            return MPP_OK;
+        }
+
+        ring_wait(&p->event, event, wait);
+        MPP_FETCH_SUB(&p->waiters, 1);
+    } while (1);
+
+    return MPP_NOK;
+}
+
+RK_S32 mpp_ring_size(MppRing ring)
+{
+    MppRingImpl *p = (MppRingImpl *)ring;
+    RK_S32 size;
+
+    if (NULL == p || check_is_mpp_ring(p)) {
+        mpp_err_f("invalid ring %p\n", ring);
+        return 0;
+    }
+
+    /* the producer may have taken the position without data filled */
+    size = (RK_S32)(p->wr - p->rd);
+
+    return MPP_CLIP3(0, (RK_S32)(p->mask + 1), size);
+}
+
+RK_S32 mpp_ring_is_empty(MppRing ring)
+{
+    return mpp_ring_size(ring) == 0;
+}
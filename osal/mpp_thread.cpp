@@ -16,11 +16,14 @@
 
 #define MODULE_TAG "mpp_thread"
 
+#include <errno.h>
 #include <string.h>
 
 #include "mpp_log.h"
 #include "mpp_common.h"
 #include "mpp_thread.h"
+#include "mpp_worker.h"
+#include "mpp_lock_prof.h"
 
 #define MPP_THREAD_DBG_FUNCTION     (0x00000001)
 
@@ -28,19 +31,121 @@ static RK_U32 thread_debug = 0;
 
 #define thread_dbg(flag, fmt, ...)  _mpp_dbg(thread_debug, flag, fmt, ## __VA_ARGS__)
 
-MppThread::MppThread(MppThreadFunc func, void *ctx, const char *name)
-    : mFunction(func),
-      mContext(ctx)
+Mutex::Mutex(MppMutexType type, const char *name)
+    : mProf(mpp_lock_prof_get(name)),
+      mOwner(NULL)
+{
+    pthread_mutexattr_t attr;
+    RK_S32 kind = PTHREAD_MUTEX_RECURSIVE;
+
+    if (type == MUTEX_FAST) {
+        if (mpp_lock_prof_enabled())
+            kind = PTHREAD_MUTEX_ERRORCHECK;
+        else
+#if defined(PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP)
+            kind = PTHREAD_MUTEX_ADAPTIVE_NP;
+#else
+            kind = PTHREAD_MUTEX_NORMAL;
+#endif
+    }
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, kind);
+    pthread_mutex_init(&mMutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+/*
+ * Out of line so the return address is the call site of lock as Mutex::lock
+ * is always inlined into the caller.
+ */
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void Mutex::lock_prof()
+{
+#if defined(__GNUC__)
+    void *site = __builtin_return_address(0);
+#else
+    void *site = NULL;
+#endif
+    RK_S32 ret = pthread_mutex_trylock(&mMutex);
+
+    if (ret == EBUSY) {
+        void *holder = mOwner;
+        RK_S64 start = mpp_lock_prof_now();
+
+        ret = pthread_mutex_lock(&mMutex);
+        if (!ret)
+            mpp_lock_prof_contend(mProf, start, holder);
+    } else if (!ret) {
+        mpp_lock_prof_acquire(mProf);
+    }
+
+    if (ret) {
+        mpp_err("lock %p from %p failed ret %d, owner %p relock?\n",
+                this, site, ret, mOwner);
+        mpp_abort();
+    }
+
+    mOwner = site;
+}
+
+void MppThread::init(const char *name)
 {
     mStatus[THREAD_WORK]    = MPP_THREAD_UNINITED;
     mStatus[THREAD_INPUT]   = MPP_THREAD_RUNNING;
     mStatus[THREAD_OUTPUT]  = MPP_THREAD_RUNNING;
     mStatus[THREAD_CONTROL] = MPP_THREAD_RUNNING;
 
-    if (name)
-        strncpy(mName, name, sizeof(mName));
-    else
-        snprintf(mName, sizeof(mName), "mpp_thread");
+    snprintf(mName, sizeof(mName), "%s", name ? name : "mpp_thread");
+}
+
+MppThread::MppThread(MppThreadFunc func, void *ctx, const char *name)
+    : mFunction(func),
+      mStep(NULL),
+      mContext(ctx),
+      mPooled(0),
+      mJob(NULL)
+{
+    init(name);
+}
+
+MppThread::MppThread(MppThreadStepFunc step, void *ctx, const char *name)
+    : mFunction(step_loop),
+      mStep(step),
+      mContext(ctx),
+      mPooled(0),
+      mJob(NULL)
+{
+    init(name);
+}
+
+/*
+ * The job is freed here instead of stop. Other threads may still signal the
+ * stopped thread before it is deleted.
+ */
+MppThread::~MppThread()
+{
+    if (mJob) {
+        mpp_worker_job_deinit(mJob);
+        mJob = NULL;
+    }
+}
+
+void *MppThread::step_loop(void *ctx)
+{
+    MppThread *thd = (MppThread *)ctx;
+
+    while (THREAD_STEP_DONE != thd->mStep(thd->mContext))
+        ;
+
+    return NULL;
+}
+
+void MppThread::trigger()
+{
+    mpp_worker_job_trigger(mJob);
 }
 
 MppThreadStatus MppThread::get_status(MppThreadSignal id)
@@ -63,24 +168,47 @@ void MppThread::dump_status()
 void MppThread::start()
 {
     pthread_attr_t attr;
+
+    if (MPP_THREAD_UNINITED != get_status())
+        return;
+
+    if (mStep && mpp_worker_enabled()) {
+        if (mJob) {
+            mpp_worker_job_deinit(mJob);
+            mJob = NULL;
+        }
+
+        if (mpp_worker_job_init(&mJob, mStep, mContext, mName)) {
+            mpp_err("thread %s failed to init worker job\n", mName);
+            return;
+        }
+
+        set_status(MPP_THREAD_RUNNING);
+        mPooled = 1;
+        mpp_worker_job_trigger(mJob);
+
+        thread_dbg(MPP_THREAD_DBG_FUNCTION, "thread %s %p context %p start on pool\n",
+                   mName, mStep, mContext);
+        return;
+    }
+
     pthread_attr_init(&attr);
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 
-    if (MPP_THREAD_UNINITED == get_status()) {
-        // NOTE: set status here first to avoid unexpected loop quit racing condition
-        set_status(MPP_THREAD_RUNNING);
-        if (0 == pthread_create(&mThread, &attr, mFunction, mContext)) {
+    // NOTE: set status here first to avoid unexpected loop quit racing condition
+    set_status(MPP_THREAD_RUNNING);
+    if (0 == pthread_create(&mThread, &attr, mFunction, (mStep) ? (void *)this : mContext)) {
 #ifndef ARMLINUX
-            RK_S32 ret = pthread_setname_np(mThread, mName);
-            if (ret)
-                mpp_err("thread %p setname %s failed\n", mFunction, mName);
+        RK_S32 ret = pthread_setname_np(mThread, mName);
+        if (ret)
+            mpp_err("thread %p setname %s failed\n", mFunction, mName);
 #endif
 
-            thread_dbg(MPP_THREAD_DBG_FUNCTION, "thread %s %p context %p create success\n",
-                       mName, mFunction, mContext);
-        } else
-            set_status(MPP_THREAD_UNINITED);
-    }
+        thread_dbg(MPP_THREAD_DBG_FUNCTION, "thread %s %p context %p create success\n",
+                   mName, mFunction, mContext);
+    } else
+        set_status(MPP_THREAD_UNINITED);
+
     pthread_attr_destroy(&attr);
 }
 
@@ -93,8 +221,14 @@ void MppThread::stop()
                    "MPP_THREAD_STOPPING status set mThread %p", this);
         signal();
         unlock();
-        void *dummy;
-        pthread_join(mThread, &dummy);
+
+        if (mPooled) {
+            mpp_worker_job_join(mJob);
+            mPooled = 0;
+        } else {
+            void *dummy;
+            pthread_join(mThread, &dummy);
+        }
         thread_dbg(MPP_THREAD_DBG_FUNCTION,
                    "thread %s %p context %p destroy success\n",
                    mName, mFunction, mContext);
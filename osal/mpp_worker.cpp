@@ -0,0 +1,489 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_worker"
+
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mpp_env.h"
+#include "mpp_mem.h"
+#include "mpp_log.h"
+#include "mpp_list.h"
+#include "mpp_atomic.h"
+#include "mpp_common.h"
+#include "mpp_worker.h"
+
+#define MPP_WORKER_DBG_FLOW         (0x00000001)
+#define MPP_WORKER_DBG_SPARE        (0x00000002)
+
+#define worker_dbg(flag, fmt, ...)  _mpp_dbg(mpp_worker_debug, flag, fmt, ## __VA_ARGS__)
+#define worker_dbg_flow(fmt, ...)   worker_dbg(MPP_WORKER_DBG_FLOW, fmt, ## __VA_ARGS__)
+#define worker_dbg_spare(fmt, ...)  worker_dbg(MPP_WORKER_DBG_SPARE, fmt, ## __VA_ARGS__)
+
+#define WORKER_QUEUE_MAX            32
+
+typedef enum MppWorkerJobState_e {
+    JOB_IDLE,
+    JOB_QUEUED,
+    JOB_RUNNING,
+    /* triggered when running, queue again after current step */
+    JOB_RUNNING_AGAIN,
+    JOB_DONE,
+} MppWorkerJobState;
+
+typedef struct MppWorkerJobImpl_t {
+    const char          *check;
+    struct list_head    list;
+
+    MppThreadStepFunc   func;
+    void                *ctx;
+    char                name[THREAD_NAME_LEN];
+
+    volatile RK_S32     state;
+    /* queue of the worker which runs the job last time */
+    RK_S32              queue;
+    sem_t               done;
+} MppWorkerJobImpl;
+
+typedef struct MppWorkerQueue_t {
+    Mutex               *lock;
+    struct list_head    jobs;
+} MppWorkerQueue;
+
+static const char *job_name = "mpp_worker_job";
+static RK_U32 mpp_worker_debug = 0;
+
+class MppWorkerPool
+{
+private:
+    MppWorkerPool();
+    ~MppWorkerPool() {};
+    MppWorkerPool(const MppWorkerPool &);
+    MppWorkerPool &operator=(const MppWorkerPool &);
+
+    static void *worker(void *arg);
+
+    void spawn();
+    void wake();
+    MppWorkerJobImpl *pop(RK_S32 home);
+    void run(MppWorkerJobImpl *job, RK_S32 home);
+
+    Mutex               mLock;
+    Condition           mCond;
+
+    RK_U32              mEnabled;
+    RK_U32              mAffinity;
+    RK_S32              mSize;
+    RK_S32              mStarted;
+
+    /* worker threads alive including spare ones */
+    RK_S32              mThreads;
+    RK_S32              mSpawned;
+    /* workers in blocking section and waiting for job */
+    RK_S32              mBlocked;
+    RK_S32              mIdle;
+    RK_S32              mJobCount;
+
+    volatile RK_S32     mQueued;
+    MppWorkerQueue      mQueues[WORKER_QUEUE_MAX];
+    /* non-NULL on worker thread */
+    pthread_key_t       mKey;
+
+public:
+    /*
+     * Workers are detached and sleep on the condition until process exit.
+     * The pool is never destroyed to avoid destroying the condition with
+     * waiters on exit.
+     */
+    static MppWorkerPool *get_instance() {
+        static MppWorkerPool *instance = new MppWorkerPool();
+        return instance;
+    }
+
+    RK_U32 enabled() { return mEnabled; }
+    RK_S32 add();
+    void push(MppWorkerJobImpl *job, RK_U32 wakeup);
+    void block(RK_U32 enter);
+};
+
+static RK_S32 get_cpu_count(RK_U32 mask)
+{
+    RK_S32 count = 0;
+
+    if (mask) {
+        while (mask) {
+            count += mask & 1;
+            mask >>= 1;
+        }
+        return count;
+    }
+
+#if defined(_SC_NPROCESSORS_ONLN)
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    return (count > 0) ? count : 4;
+}
+
+MppWorkerPool::MppWorkerPool()
+    : mEnabled(0),
+      mAffinity(0),
+      mSize(0),
+      mStarted(0),
+      mThreads(0),
+      mSpawned(0),
+      mBlocked(0),
+      mIdle(0),
+      mJobCount(0),
+      mQueued(0)
+{
+    RK_U32 count = 0;
+    RK_S32 i;
+
+    mpp_env_get_u32("mpp_worker_debug", &mpp_worker_debug, 0);
+    mpp_env_get_u32("mpp_worker_pool", &mEnabled, 0);
+    mpp_env_get_u32("mpp_worker_affinity", &mAffinity, 0);
+    mpp_env_get_u32("mpp_worker_count", &count, 0);
+
+    mSize = (count) ? (RK_S32)count : get_cpu_count(mAffinity);
+    mSize = mpp_clip(mSize, 1, WORKER_QUEUE_MAX);
+
+    for (i = 0; i < WORKER_QUEUE_MAX; i++) {
+        mQueues[i].lock = new Mutex(MUTEX_FAST, "mpp_worker_queue");
+        INIT_LIST_HEAD(&mQueues[i].jobs);
+    }
+
+    pthread_key_create(&mKey, NULL);
+}
+
+void *MppWorkerPool::worker(void *arg)
+{
+    MppWorkerPool *p = get_instance();
+    RK_S32 home = (RK_S32)(intptr_t)arg;
+    MppWorkerJobImpl *job;
+
+#ifndef ARMLINUX
+    {
+        char name[THREAD_NAME_LEN];
+
+        snprintf(name, sizeof(name), "mpp_worker%d", home);
+        pthread_setname_np(pthread_self(), name);
+    }
+#endif
+
+#if defined(__linux__)
+    if (p->mAffinity) {
+        cpu_set_t cpus;
+        RK_S32 i;
+
+        CPU_ZERO(&cpus);
+        for (i = 0; i < 32; i++) {
+            if (p->mAffinity & (1u << i))
+                CPU_SET(i, &cpus);
+        }
+
+        if (sched_setaffinity(0, sizeof(cpus), &cpus))
+            mpp_err("worker %d failed to set affinity %08x\n", home, p->mAffinity);
+    }
+#endif
+
+    pthread_setspecific(p->mKey, p);
+
+    while (1) {
+        job = p->pop(home);
+        if (job) {
+            p->run(job, home);
+            continue;
+        }
+
+        p->mLock.lock();
+        if (!MPP_ATOMIC_READ(&p->mQueued)) {
+            // spare worker quits when the blocked worker is back
+            if (p->mThreads - p->mBlocked > p->mSize) {
+                p->mThreads--;
+                worker_dbg_spare("worker %d quit threads %d blocked %d\n",
+                                 home, p->mThreads, p->mBlocked);
+                p->mLock.unlock();
+                break;
+            }
+
+            p->mIdle++;
+            p->mCond.wait(p->mLock);
+            p->mIdle--;
+        }
+        p->mLock.unlock();
+    }
+
+    return NULL;
+}
+
+/* called with mLock */
+void MppWorkerPool::spawn()
+{
+    RK_S32 home = mSpawned % mSize;
+    pthread_t thd;
+
+    if (pthread_create(&thd, NULL, worker, (void *)(intptr_t)home)) {
+        mpp_err("failed to create worker %d\n", mSpawned);
+        return;
+    }
+
+    pthread_detach(thd);
+    mSpawned++;
+    mThreads++;
+}
+
+void MppWorkerPool::wake()
+{
+    AutoMutex auto_lock(&mLock);
+
+    if (mIdle)
+        mCond.signal();
+    else if (mThreads - mBlocked < mSize)
+        spawn();
+}
+
+RK_S32 MppWorkerPool::add()
+{
+    AutoMutex auto_lock(&mLock);
+
+    if (!mStarted) {
+        RK_S32 i;
+
+        for (i = 0; i < mSize; i++)
+            spawn();
+
+        mStarted = 1;
+        mpp_log("worker pool start with %d workers affinity %08x\n",
+                mSize, mAffinity);
+    }
+
+    return mJobCount++ % mSize;
+}
+
+void MppWorkerPool::push(MppWorkerJobImpl *job, RK_U32 wakeup)
+{
+    MppWorkerQueue *q = &mQueues[job->queue];
+
+    {
+        AutoMutex auto_lock(q->lock);
+
+        list_add_tail(&job->list, &q->jobs);
+        MPP_FETCH_ADD(&mQueued, 1);
+    }
+
+    if (wakeup)
+        wake();
+}
+
+/* take job from home queue first then steal from others */
+MppWorkerJobImpl *MppWorkerPool::pop(RK_S32 home)
+{
+    RK_S32 i;
+
+    if (!MPP_ATOMIC_READ(&mQueued))
+        return NULL;
+
+    for (i = 0; i < mSize; i++) {
+        MppWorkerQueue *q = &mQueues[(home + i) % mSize];
+        AutoMutex auto_lock(q->lock);
+
+        if (!list_empty(&q->jobs)) {
+            MppWorkerJobImpl *job = list_entry(q->jobs.next, MppWorkerJobImpl, list);
+
+            list_del_init(&job->list);
+            MPP_FETCH_SUB(&mQueued, 1);
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+static void job_set_state(MppWorkerJobImpl *job, RK_S32 state)
+{
+    RK_S32 old;
+
+    do {
+        old = job->state;
+    } while (!MPP_BOOL_CAS(&job->state, old, state));
+}
+
+void MppWorkerPool::run(MppWorkerJobImpl *job, RK_S32 home)
+{
+    MppThreadStep ret;
+
+    mpp_assert(job->state == JOB_QUEUED);
+
+    job->queue = home;
+    job_set_state(job, JOB_RUNNING);
+
+    ret = job->func(job->ctx);
+
+    worker_dbg_flow("worker %d job %s step ret %d\n", home, job->name, ret);
+
+    switch (ret) {
+    case THREAD_STEP_DONE : {
+        job_set_state(job, JOB_DONE);
+        sem_post(&job->done);
+    } break;
+    case THREAD_STEP_WAIT : {
+        if (MPP_BOOL_CAS(&job->state, JOB_RUNNING, JOB_IDLE))
+            break;
+
+        // triggered on running
+        job_set_state(job, JOB_QUEUED);
+        push(job, 0);
+    } break;
+    default : {
+        // current worker will pick the job or other jobs on its queue
+        job_set_state(job, JOB_QUEUED);
+        push(job, 0);
+    } break;
+    }
+}
+
+void MppWorkerPool::block(RK_U32 enter)
+{
+    if (NULL == pthread_getspecific(mKey))
+        return;
+
+    AutoMutex auto_lock(&mLock);
+
+    if (enter) {
+        mBlocked++;
+        if (MPP_ATOMIC_READ(&mQueued) && !mIdle && mThreads - mBlocked < mSize) {
+            spawn();
+            worker_dbg_spare("spare worker start threads %d blocked %d\n",
+                             mThreads, mBlocked);
+        }
+    } else {
+        mBlocked--;
+    }
+}
+
+static MPP_RET check_is_worker_job(void *job)
+{
+    if (job && ((MppWorkerJobImpl *)job)->check == job_name)
+        return MPP_OK;
+
+    mpp_err_f("pointer %p failed on check\n", job);
+    mpp_abort();
+    return MPP_NOK;
+}
+
+RK_U32 mpp_worker_enabled(void)
+{
+    return MppWorkerPool::get_instance()->enabled();
+}
+
+MPP_RET mpp_worker_job_init(MppWorkerJob *job, MppThreadStepFunc func,
+                            void *ctx, const char *name)
+{
+    MppWorkerJobImpl *p;
+
+    if (NULL == job || NULL == func) {
+        mpp_err_f("invalid input job %p func %p\n", job, func);
+        return MPP_ERR_NULL_PTR;
+    }
+
+    *job = NULL;
+
+    p = mpp_calloc(MppWorkerJobImpl, 1);
+    if (NULL == p) {
+        mpp_err_f("malloc failed\n");
+        return MPP_ERR_MALLOC;
+    }
+
+    p->check = job_name;
+    INIT_LIST_HEAD(&p->list);
+    p->func = func;
+    p->ctx = ctx;
+    snprintf(p->name, sizeof(p->name), "%s", (name) ? (name) : "mpp_job");
+    p->state = JOB_IDLE;
+    sem_init(&p->done, 0, 0);
+    p->queue = MppWorkerPool::get_instance()->add();
+
+    *job = p;
+    return MPP_OK;
+}
+
+MPP_RET mpp_worker_job_deinit(MppWorkerJob job)
+{
+    MppWorkerJobImpl *p = (MppWorkerJobImpl *)job;
+
+    if (check_is_worker_job(job))
+        return MPP_NOK;
+
+    // job never started or finished can be removed
+    mpp_assert(p->state == JOB_IDLE || p->state == JOB_DONE);
+
+    sem_destroy(&p->done);
+    mpp_free(p);
+    return MPP_OK;
+}
+
+void mpp_worker_job_trigger(MppWorkerJob job)
+{
+    MppWorkerJobImpl *p = (MppWorkerJobImpl *)job;
+
+    if (check_is_worker_job(job))
+        return ;
+
+    do {
+        RK_S32 state = p->state;
+
+        switch (state) {
+        case JOB_IDLE : {
+            if (MPP_BOOL_CAS(&p->state, JOB_IDLE, JOB_QUEUED)) {
+                MppWorkerPool::get_instance()->push(p, 1);
+                return ;
+            }
+        } break;
+        case JOB_RUNNING : {
+            if (MPP_BOOL_CAS(&p->state, JOB_RUNNING, JOB_RUNNING_AGAIN))
+                return ;
+        } break;
+        default : {
+            return ;
+        } break;
+        }
+    } while (1);
+}
+
+void mpp_worker_job_join(MppWorkerJob job)
+{
+    MppWorkerJobImpl *p = (MppWorkerJobImpl *)job;
+
+    if (check_is_worker_job(job))
+        return ;
+
+    sem_wait(&p->done);
+    // keep it posted for join again
+    sem_post(&p->done);
+}
+
+void mpp_worker_block_enter(void)
+{
+    MppWorkerPool::get_instance()->block(1);
+}
+
+void mpp_worker_block_leave(void)
+{
+    MppWorkerPool::get_instance()->block(0);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_allocator_test"
+
+#include <string.h>
+
+#include "mpp_log.h"
+#include "mpp_common.h"
+#include "mpp_allocator.h"
+
+#define ALLOCATOR_TEST_SIZE     (1920 * 1088 * 3 / 2)
+
+/*
+ * Allocate a fd-based buffer then import its fd into another allocator as a
+ * foreign buffer. Both mapping should share the same memory. On the platform
+ * without ion / drm the buffer is from memfd allocator.
+ */
+int main()
+{
+    MPP_RET ret = MPP_NOK;
+    MppAllocator alloc_src = NULL;
+    MppAllocator alloc_dst = NULL;
+    MppAllocatorApi *api_src = NULL;
+    MppAllocatorApi *api_dst = NULL;
+    MppBufferInfo src;
+    MppBufferInfo dst;
+    RK_U8 *p;
+    RK_U32 i;
+
+    memset(&src, 0, sizeof(src));
+    memset(&dst, 0, sizeof(dst));
+    src.fd = -1;
+    dst.fd = -1;
+
+    mpp_log("mpp allocator test start\n");
+
+    if (mpp_allocator_get(&alloc_src, &api_src, MPP_BUFFER_TYPE_ION) ||
+        mpp_allocator_get(&alloc_dst, &api_dst, MPP_BUFFER_TYPE_ION)) {
+        mpp_err("mpp_allocator_get failed\n");
+        goto DONE;
+    }
+
+    src.type = MPP_BUFFER_TYPE_ION;
+    src.size = ALLOCATOR_TEST_SIZE;
+    if (api_src->alloc(alloc_src, &src) || api_src->mmap(alloc_src, &src)) {
+        mpp_err("alloc size %d failed\n", src.size);
+        goto DONE;
+    }
+
+    if (src.fd < 0 || NULL == src.ptr) {
+        mpp_err("alloc get invalid fd %d ptr %p\n", src.fd, src.ptr);
+        goto DONE;
+    }
+
+    p = (RK_U8 *)src.ptr;
+    for (i = 0; i < ALLOCATOR_TEST_SIZE; i++)
+        p[i] = (RK_U8)(i * 7);
+
+    dst.type = MPP_BUFFER_TYPE_ION;
+    dst.size = src.size;
+    dst.fd = src.fd;
+    if (api_dst->import(alloc_dst, &dst) || api_dst->mmap(alloc_dst, &dst)) {
+        mpp_err("import fd %d failed\n", src.fd);
+        goto DONE;
+    }
+
+    mpp_log("alloc fd %d ptr %p import fd %d ptr %p\n",
+            src.fd, src.ptr, dst.fd, dst.ptr);
+
+    if (dst.ptr == src.ptr || memcmp(dst.ptr, src.ptr, ALLOCATOR_TEST_SIZE)) {
+        mpp_err("imported buffer content mismatch\n");
+        goto DONE;
+    }
+
+    /* write on imported side should be seen by the allocated side */
+    memset(dst.ptr, 0x5a, SZ_4K);
+    if (p[0] != 0x5a || p[SZ_4K - 1] != 0x5a) {
+        mpp_err("imported buffer is not shared\n");
+        goto DONE;
+    }
+
+    ret = MPP_OK;
+DONE:
+    if (dst.fd >= 0)
+        api_dst->release(alloc_dst, &dst);
+    if (src.fd >= 0)
+        api_src->free(alloc_src, &src);
+    if (alloc_dst)
+        mpp_allocator_put(&alloc_dst);
+    if (alloc_src)
+        mpp_allocator_put(&alloc_src);
+
+    mpp_log("mpp allocator test %s\n", ret ? "failed" : "success");
+    return ret;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_hist_test"
+
+#include <pthread.h>
+
+#include "mpp_log.h"
+#include "mpp_hist.h"
+#include "mpp_time.h"
+#include "mpp_common.h"
+
+#define HIST_TEST_COUNT     100000
+#define HIST_TEST_THREADS   4
+
+static RK_U32 test_permille[] = {
+    0, 10, 500, 900, 990, 999, 1000,
+};
+
+static void *hist_test_writer(void *arg)
+{
+    MppHist hist = (MppHist)arg;
+    RK_U32 i;
+
+    for (i = 1; i <= HIST_TEST_COUNT; i++)
+        mpp_hist_record_atomic(hist, i);
+
+    return NULL;
+}
+
+/* several writers on one histogram should not lose any sample */
+static MPP_RET hist_test_atomic(MppHist hist)
+{
+    pthread_t thds[HIST_TEST_THREADS];
+    RK_S64 count = (RK_S64)HIST_TEST_COUNT * HIST_TEST_THREADS;
+    RK_S64 sum = (RK_S64)HIST_TEST_COUNT * (HIST_TEST_COUNT + 1) / 2 * HIST_TEST_THREADS;
+    RK_U32 i;
+
+    mpp_hist_reset(hist);
+
+    for (i = 0; i < HIST_TEST_THREADS; i++)
+        pthread_create(&thds[i], NULL, hist_test_writer, hist);
+
+    for (i = 0; i < HIST_TEST_THREADS; i++)
+        pthread_join(thds[i], NULL);
+
+    mpp_log("%d writers record count %lld sum %lld\n", HIST_TEST_THREADS,
+            mpp_hist_get_count(hist), mpp_hist_get_sum(hist));
+
+    if (mpp_hist_get_count(hist) != count ||
+        mpp_hist_get_sum(hist) != sum ||
+        mpp_hist_get_min(hist) != 1 ||
+        mpp_hist_get_max(hist) != HIST_TEST_COUNT ||
+        mpp_hist_get_percentile(hist, 1000) < HIST_TEST_COUNT) {
+        mpp_err("atomic record expect count %lld sum %lld\n", count, sum);
+        return MPP_NOK;
+    }
+
+    return MPP_OK;
+}
+
+int main()
+{
+    MppHist hist = NULL;
+    MPP_RET ret = MPP_NOK;
+    RK_S64 time_start;
+    RK_S64 time_end;
+    RK_U32 i;
+
+    mpp_log("mpp hist test start\n");
+
+    hist = mpp_hist_get("hist test");
+    if (NULL == hist) {
+        mpp_err("mpp_hist_get failed\n");
+        goto DONE;
+    }
+
+    /* uniform value 1 ~ HIST_TEST_COUNT: percentile p is p * count / 1000 */
+    time_start = mpp_time();
+    for (i = 1; i <= HIST_TEST_COUNT; i++)
+        mpp_hist_record(hist, i);
+    time_end = mpp_time();
+
+    mpp_log("record %d samples cost %lld us\n", HIST_TEST_COUNT,
+            time_end - time_start);
+
+    if (mpp_hist_get_count(hist) != HIST_TEST_COUNT ||
+        mpp_hist_get_min(hist) != 1 ||
+        mpp_hist_get_max(hist) != HIST_TEST_COUNT) {
+        mpp_err("count %lld min %lld max %lld mismatch\n",
+                mpp_hist_get_count(hist), mpp_hist_get_min(hist),
+                mpp_hist_get_max(hist));
+        goto DONE;
+    }
+
+    for (i = 0; i < MPP_ARRAY_ELEMS(test_permille); i++) {
+        RK_U32 permille = test_permille[i];
+        RK_S64 expect = (RK_S64)HIST_TEST_COUNT * permille / 1000;
+        RK_S64 value = mpp_hist_get_percentile(hist, permille);
+
+        if (expect < 1)
+            expect = 1;
+
+        mpp_log("p%-4d expect %6lld get %6lld\n", permille, expect, value);
+
+        /* bucket upper bound is within 1/16 above the real value */
+        if (value < expect || value > expect + expect / 16 + 1) {
+            mpp_err("p%d out of range\n", permille);
+            goto DONE;
+        }
+    }
+
+    mpp_hist_reset(hist);
+    if (mpp_hist_get_count(hist) || mpp_hist_get_percentile(hist, 500)) {
+        mpp_err("reset failed\n");
+        goto DONE;
+    }
+
+    /* small values have exact bucket */
+    for (i = 0; i < 16; i++)
+        mpp_hist_record(hist, 7);
+    mpp_hist_record(hist, -1);
+    mpp_hist_record(hist, 0x1FFFFFFFFLL);
+
+    if (mpp_hist_get_percentile(hist, 500) != 7 ||
+        mpp_hist_get_min(hist) != 0 ||
+        mpp_hist_get_max(hist) != 0xFFFFFFFFLL) {
+        mpp_err("clamp check failed\n");
+        goto DONE;
+    }
+
+    ret = hist_test_atomic(hist);
+DONE:
+    if (hist)
+        mpp_hist_put(hist);
+
+    mpp_log("mpp hist test %s\n", ret ? "failed" : "success");
+    return ret;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_lock_prof_test"
+
+#include "mpp_err.h"
+#include "mpp_env.h"
+#include "mpp_log.h"
+#include "mpp_time.h"
+#include "mpp_thread.h"
+#include "mpp_lock_prof.h"
+
+#define LOCK_TEST_LOOP          1000000
+#define LOCK_TEST_THREADS       4
+#define LOCK_TEST_HOLD_LOOP     200
+
+static void lock_test_bench(const char *name, Mutex *lock)
+{
+    RK_S64 start = mpp_time();
+    RK_S32 i;
+
+    for (i = 0; i < LOCK_TEST_LOOP; i++) {
+        lock->lock();
+        lock->unlock();
+    }
+
+    mpp_log("%-10s lock / unlock %d times cost %lld us\n", name,
+            LOCK_TEST_LOOP, mpp_time() - start);
+}
+
+static void *lock_test_worker(void *arg)
+{
+    Mutex *lock = (Mutex *)arg;
+    RK_S32 i;
+
+    for (i = 0; i < LOCK_TEST_HOLD_LOOP; i++) {
+        AutoMutex auto_lock(lock);
+
+        /* hold the lock across a sleep to make sure others wait */
+        usleep(100);
+    }
+
+    return NULL;
+}
+
+int main()
+{
+    pthread_t thds[LOCK_TEST_THREADS];
+    RK_S32 i;
+
+    mpp_log("mpp lock prof test start\n");
+
+    /* profiler setting is read once on first mutex creation */
+    mpp_env_set_u32("mpp_lock_prof", 4);
+
+    if (!mpp_lock_prof_enabled()) {
+        mpp_err("lock profiler is not enabled\n");
+        return MPP_NOK;
+    }
+
+    {
+        Mutex recursive;
+        Mutex fast(MUTEX_FAST);
+        Mutex profiled(MUTEX_FAST, "lock_test");
+
+        /* uncontended cost, fast mutex is error check type on profiling */
+        lock_test_bench("recursive", &recursive);
+        lock_test_bench("fast", &fast);
+        lock_test_bench("profiled", &profiled);
+
+        for (i = 0; i < LOCK_TEST_THREADS; i++)
+            pthread_create(&thds[i], NULL, lock_test_worker, &profiled);
+
+        for (i = 0; i < LOCK_TEST_THREADS; i++)
+            pthread_join(thds[i], NULL);
+
+        mpp_lock_prof_dump();
+    }
+
+    mpp_log("mpp lock prof test success\n");
+    return MPP_OK;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_mem_pool_test"
+
+#include <string.h>
+
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_time.h"
+#include "mpp_mem_pool.h"
+
+#define POOL_TEST_SIZE      200
+#define POOL_TEST_OBJ_CNT   40
+#define POOL_TEST_LOOP      100000
+
+int main()
+{
+    MppMemPool pool = NULL;
+    MppMemPoolInfo info;
+    void *objs[POOL_TEST_OBJ_CNT];
+    MPP_RET ret = MPP_NOK;
+    RK_S64 time_start;
+    RK_S64 time_end;
+    RK_S32 i;
+    RK_S32 j;
+
+    mpp_log("mpp mem pool test start\n");
+
+    pool = mpp_mem_pool_init(POOL_TEST_SIZE);
+    if (NULL == pool) {
+        mpp_err("mpp_mem_pool_init failed\n");
+        goto DONE;
+    }
+
+    /* get more objects than one slab and dirty them */
+    for (i = 0; i < POOL_TEST_OBJ_CNT; i++) {
+        objs[i] = mpp_mem_pool_get(pool);
+        if (NULL == objs[i]) {
+            mpp_err("get object %d failed\n", i);
+            goto DONE;
+        }
+        memset(objs[i], 0xff, POOL_TEST_SIZE);
+    }
+
+    mpp_mem_pool_info(pool, &info);
+    mpp_log("size %d slab %d total %d used %d\n", info.size,
+            info.slab_count, info.total, info.used);
+    if (info.used != POOL_TEST_OBJ_CNT || info.slab_count != 2) {
+        mpp_err("pool info mismatch after get\n");
+        goto DONE;
+    }
+
+    for (i = 0; i < POOL_TEST_OBJ_CNT; i++)
+        mpp_mem_pool_put(pool, objs[i]);
+
+    /* double put should be detected and ignored */
+    mpp_mem_pool_put(pool, objs[0]);
+
+    /* object should be reused and zero initialized without new slab */
+    for (i = 0; i < POOL_TEST_OBJ_CNT; i++) {
+        RK_U8 *p = (RK_U8 *)mpp_mem_pool_get(pool);
+
+        for (j = 0; j < POOL_TEST_SIZE; j++) {
+            if (p[j]) {
+                mpp_err("object %d not zero initialized\n", i);
+                goto DONE;
+            }
+        }
+        objs[i] = p;
+    }
+
+    mpp_mem_pool_info(pool, &info);
+    if (info.used != POOL_TEST_OBJ_CNT || info.slab_count != 2 ||
+        info.used_max != POOL_TEST_OBJ_CNT) {
+        mpp_err("pool info mismatch after reuse\n");
+        goto DONE;
+    }
+
+    for (i = 0; i < POOL_TEST_OBJ_CNT; i++)
+        mpp_mem_pool_put(pool, objs[i]);
+
+    /* compare with mpp_calloc / mpp_free on get / put loop */
+    time_start = mpp_time();
+    for (i = 0; i < POOL_TEST_LOOP; i++)
+        mpp_mem_pool_put(pool, mpp_mem_pool_get(pool));
+    time_end = mpp_time();
+    mpp_log("pool   get / put %d times cost %lld us\n", POOL_TEST_LOOP,
+            time_end - time_start);
+
+    time_start = mpp_time();
+    for (i = 0; i < POOL_TEST_LOOP; i++) {
+        void *p = mpp_calloc_size(void, POOL_TEST_SIZE);
+        mpp_free(p);
+    }
+    time_end = mpp_time();
+    mpp_log("malloc get / put %d times cost %lld us\n", POOL_TEST_LOOP,
+            time_end - time_start);
+
+    mpp_mem_pool_info(pool, &info);
+    if (info.used || info.slab_count != 2) {
+        mpp_err("pool info mismatch after loop\n");
+        goto DONE;
+    }
+
+    ret = MPP_OK;
+DONE:
+    if (pool)
+        mpp_mem_pool_deinit(pool);
+
+    mpp_log("mpp mem pool test %s\n", ret ? "failed" : "success");
+    return ret;
+}
@@ -0,0 +1,309 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_ring_test"
+
+#include <sched.h>
+#include <string.h>
+
+#include "mpp_log.h"
+#include "mpp_mem.h"
+#include "mpp_hist.h"
+#include "mpp_common.h"
+#include "mpp_list.h"
+#include "mpp_ring.h"
+#include "mpp_time.h"
+
+#define RING_TEST_COUNT         8
+#define RING_TEST_PRODUCER      3
+#define RING_TEST_ITEMS         20000
+#define RING_BENCH_ITEMS        200000
+
+/* item is index plus one so NULL is never put */
+#define ITEM_TO_PTR(idx)        ((void *)(intptr_t)((idx) + 1))
+#define PTR_TO_ITEM(ptr)        ((RK_S32)(intptr_t)(ptr) - 1)
+
+typedef struct RingBenchCtx_t {
+    MppRing         ring;
+    mpp_list        *list;
+    RK_S32          producer;
+    RK_S32          stride;
+    RK_S32          items;
+    /* wait on full ring instead of busy retry */
+    RK_S32          block;
+    RK_S64          *put_time;
+} RingBenchCtx;
+
+static void *ring_producer(void *arg)
+{
+    RingBenchCtx *ctx = (RingBenchCtx *)arg;
+    RK_S32 i;
+
+    for (i = 0; i < ctx->items; i++) {
+        RK_S32 idx = i * ctx->stride + ctx->producer;
+
+        if (ctx->put_time)
+            ctx->put_time[idx] = mpp_time();
+
+        if (ctx->block) {
+            if (mpp_ring_put_wait(ctx->ring, ITEM_TO_PTR(idx), 1000000)) {
+                mpp_err("put %d timeout\n", idx);
+                break;
+            }
+            continue;
+        }
+
+        while (mpp_ring_put(ctx->ring, ITEM_TO_PTR(idx)))
+            sched_yield();
+    }
+
+    return NULL;
+}
+
+static void *list_producer(void *arg)
+{
+    RingBenchCtx *ctx = (RingBenchCtx *)arg;
+    mpp_list *list = ctx->list;
+    RK_S32 i;
+
+    for (i = 0; i < ctx->items; i++) {
+        void *data = ITEM_TO_PTR(i);
+
+        /* same bound as the ring for fair comparison */
+        while (list->list_size() >= RING_TEST_COUNT)
+            sched_yield();
+
+        ctx->put_time[i] = mpp_time();
+
+        list->lock();
+        list->add_at_tail(&data, sizeof(data));
+        list->signal();
+        list->unlock();
+    }
+
+    return NULL;
+}
+
+static MPP_RET ring_test_basic(void)
+{
+    MppRing ring = NULL;
+    void *data = NULL;
+    MPP_RET ret = MPP_NOK;
+    RK_S64 start;
+    RK_S32 i;
+
+    /* count is rounded up to power of two */
+    if (mpp_ring_init(&ring, RING_TEST_COUNT - 3))
+        return MPP_NOK;
+
+    for (i = 0; i < RING_TEST_COUNT; i++) {
+        if (mpp_ring_put(ring, ITEM_TO_PTR(i))) {
+            mpp_err("put %d failed\n", i);
+            goto DONE;
+        }
+    }
+
+    if (mpp_ring_put(ring, ITEM_TO_PTR(i)) != MPP_ERR_BUFFER_FULL ||
+        mpp_ring_size(ring) != RING_TEST_COUNT) {
+        mpp_err("full ring check failed\n");
+        goto DONE;
+    }
+
+    start = mpp_time();
+    if (mpp_ring_put_wait(ring, ITEM_TO_PTR(i), 10000) != MPP_ERR_TIMEOUT ||
+        mpp_time() - start < 10000) {
+        mpp_err("full ring put timeout check failed\n");
+        goto DONE;
+    }
+
+    for (i = 0; i < RING_TEST_COUNT; i++) {
+        if (mpp_ring_get(ring, &data, 0) || PTR_TO_ITEM(data) != i) {
+            mpp_err("get %d failed with %p\n", i, data);
+            goto DONE;
+        }
+    }
+
+    if (!mpp_ring_is_empty(ring) || mpp_ring_get(ring, &data, 0) != MPP_NOK) {
+        mpp_err("empty ring check failed\n");
+        goto DONE;
+    }
+
+    start = mpp_time();
+    if (mpp_ring_get(ring, &data, 10000) != MPP_ERR_TIMEOUT ||
+        mpp_time() - start < 10000) {
+        mpp_err("timeout check failed\n");
+        goto DONE;
+    }
+
+    ret = MPP_OK;
+DONE:
+    mpp_ring_deinit(ring);
+    return ret;
+}
+
+/*
+ * multiple producers with blocking consumer should keep order per producer
+ * and the producers wait on the full ring
+ */
+static MPP_RET ring_test_mpsc(void)
+{
+    RingBenchCtx ctxs[RING_TEST_PRODUCER];
+    pthread_t thds[RING_TEST_PRODUCER];
+    RK_S32 next[RING_TEST_PRODUCER];
+    MppRing ring = NULL;
+    MPP_RET ret = MPP_OK;
+    RK_S32 i;
+
+    if (mpp_ring_init(&ring, RING_TEST_COUNT))
+        return MPP_NOK;
+
+    memset(ctxs, 0, sizeof(ctxs));
+    for (i = 0; i < RING_TEST_PRODUCER; i++) {
+        ctxs[i].ring = ring;
+        ctxs[i].producer = i;
+        ctxs[i].stride = RING_TEST_PRODUCER;
+        ctxs[i].items = RING_TEST_ITEMS;
+        ctxs[i].block = 1;
+        next[i] = i;
+        pthread_create(&thds[i], NULL, ring_producer, &ctxs[i]);
+    }
+
+    for (i = 0; i < RING_TEST_ITEMS * RING_TEST_PRODUCER; i++) {
+        void *data = NULL;
+        RK_S32 idx;
+
+        if (mpp_ring_get(ring, &data, 1000000)) {
+            mpp_err("get %d timeout\n", i);
+            ret = MPP_NOK;
+            break;
+        }
+
+        idx = PTR_TO_ITEM(data);
+        if (idx != next[idx % RING_TEST_PRODUCER]) {
+            mpp_err("get %d out of order expect %d\n", idx,
+                    next[idx % RING_TEST_PRODUCER]);
+            ret = MPP_NOK;
+            break;
+        }
+        next[idx % RING_TEST_PRODUCER] += RING_TEST_PRODUCER;
+    }
+
+    for (i = 0; i < RING_TEST_PRODUCER; i++)
+        pthread_join(thds[i], NULL);
+
+    mpp_ring_deinit(ring);
+    return ret;
+}
+
+static void ring_bench_show(const char *name, MppHist hist, RK_S64 cost)
+{
+    mpp_log("%-8s %7lld ops/s latency p50 %5lld p99 %5lld p999 %5lld max %6lld us\n",
+            name, (RK_S64)RING_BENCH_ITEMS * 1000000 / MPP_MAX(cost, 1),
+            mpp_hist_get_percentile(hist, 500),
+            mpp_hist_get_percentile(hist, 990),
+            mpp_hist_get_percentile(hist, 999),
+            mpp_hist_get_max(hist));
+}
+
+/* single producer and single consumer benchmark against mpp_list */
+static MPP_RET ring_test_bench(void)
+{
+    RingBenchCtx ctx;
+    pthread_t thd;
+    MppHist hist_ring = mpp_hist_get("ring");
+    MppHist hist_list = mpp_hist_get("list");
+    RK_S64 *put_time = mpp_calloc(RK_S64, RING_BENCH_ITEMS);
+    mpp_list *list = new mpp_list(NULL);
+    MPP_RET ret = MPP_NOK;
+    RK_S64 start;
+    RK_S32 i;
+
+    memset(&ctx, 0, sizeof(ctx));
+    if (NULL == put_time || mpp_ring_init(&ctx.ring, RING_TEST_COUNT))
+        goto DONE;
+
+    ctx.stride = 1;
+    ctx.items = RING_BENCH_ITEMS;
+    ctx.put_time = put_time;
+
+    start = mpp_time();
+    pthread_create(&thd, NULL, ring_producer, &ctx);
+    for (i = 0; i < ctx.items; i++) {
+        void *data = NULL;
+
+        if (mpp_ring_get(ctx.ring, &data, -1))
+            break;
+
+        mpp_hist_record(hist_ring, mpp_time() - put_time[PTR_TO_ITEM(data)]);
+    }
+    pthread_join(thd, NULL);
+    ring_bench_show("mpp_ring", hist_ring, mpp_time() - start);
+
+    ctx.list = list;
+
+    start = mpp_time();
+    pthread_create(&thd, NULL, list_producer, &ctx);
+    for (i = 0; i < ctx.items; i++) {
+        void *data = NULL;
+
+        list->lock();
+        while (!list->list_size())
+            list->wait();
+        list->del_at_head(&data, sizeof(data));
+        list->unlock();
+
+        mpp_hist_record(hist_list, mpp_time() - put_time[PTR_TO_ITEM(data)]);
+    }
+    pthread_join(thd, NULL);
+    ring_bench_show("mpp_list", hist_list, mpp_time() - start);
+
+    ret = MPP_OK;
+DONE:
+    if (ctx.ring)
+        mpp_ring_deinit(ctx.ring);
+    delete list;
+    MPP_FREE(put_time);
+    mpp_hist_put(hist_ring);
+    mpp_hist_put(hist_list);
+    return ret;
+}
+
+int main()
+{
+    MPP_RET ret = MPP_NOK;
+
+    mpp_log("mpp ring test start\n");
+
+    if (ring_test_basic()) {
+        mpp_err("basic test failed\n");
+        goto DONE;
+    }
+
+    if (ring_test_mpsc()) {
+        mpp_err("multiple producer test failed\n");
+        goto DONE;
+    }
+
+    if (ring_test_bench()) {
+        mpp_err("benchmark failed\n");
+        goto DONE;
+    }
+
+    ret = MPP_OK;
+DONE:
+    mpp_log("mpp ring test %s\n", ret ? "failed" : "success");
+    return ret;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2020 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpp_worker_test"
+
+#include <sched.h>
+#include <semaphore.h>
+
+#include "mpp_log.h"
+#include "mpp_env.h"
+#include "mpp_time.h"
+#include "mpp_atomic.h"
+#include "mpp_worker.h"
+
+#define WORKER_TEST_COUNT       2
+#define WORKER_TEST_THREADS     16
+#define WORKER_TEST_ITEMS       2000
+#define WORKER_TEST_BLOCKERS    2
+
+typedef struct ThreadTestCtx_t {
+    MppThread       *thd;
+    /* work item posted by producer and consumed by step function */
+    RK_S32          pending;
+    RK_S32          consumed;
+    /* step function of the same thread should never run concurrently */
+    volatile RK_S32 running;
+    RK_S32          overlap;
+} ThreadTestCtx;
+
+typedef struct BlockTestCtx_t {
+    sem_t           *sem;
+    RK_S32          blocker;
+    volatile RK_S32 done;
+} BlockTestCtx;
+
+static MppThreadStep thread_test_step(void *data)
+{
+    ThreadTestCtx *ctx = (ThreadTestCtx *)data;
+    MppThread *thd = ctx->thd;
+    MppThreadStep step = THREAD_STEP_AGAIN;
+
+    if (MPP_FETCH_ADD(&ctx->running, 1))
+        ctx->overlap++;
+
+    {
+        AutoMutex autolock(thd->mutex());
+
+        if (MPP_THREAD_RUNNING != thd->get_status()) {
+            step = THREAD_STEP_DONE;
+        } else if (!ctx->pending) {
+            if (thd->pooled())
+                step = THREAD_STEP_WAIT;
+            else
+                thd->wait();
+        } else {
+            ctx->pending--;
+            ctx->consumed++;
+        }
+    }
+
+    MPP_FETCH_SUB(&ctx->running, 1);
+
+    return step;
+}
+
+static MPP_RET test_thread(void)
+{
+    ThreadTestCtx ctxs[WORKER_TEST_THREADS];
+    RK_S64 time_start = mpp_time();
+    RK_S32 consumed = 0;
+    RK_S32 overlap = 0;
+    RK_S32 pooled = 0;
+    RK_S32 i, j;
+
+    for (i = 0; i < WORKER_TEST_THREADS; i++) {
+        ThreadTestCtx *ctx = &ctxs[i];
+
+        ctx->pending = 0;
+        ctx->consumed = 0;
+        ctx->running = 0;
+        ctx->overlap = 0;
+        ctx->thd = new MppThread(thread_test_step, ctx, "worker_test");
+        ctx->thd->start();
+        pooled += ctx->thd->pooled() ? 1 : 0;
+    }
+
+    for (j = 0; j < WORKER_TEST_ITEMS; j++) {
+        for (i = 0; i < WORKER_TEST_THREADS; i++) {
+            MppThread *thd = ctxs[i].thd;
+
+            thd->lock();
+            ctxs[i].pending++;
+            thd->signal();
+            thd->unlock();
+        }
+
+        if (!(j & 63))
+            sched_yield();
+    }
+
+    /* wait all item consumed before stop */
+    for (i = 0; i < WORKER_TEST_THREADS; i++) {
+        MppThread *thd = ctxs[i].thd;
+        RK_S32 pending;
+
+        do {
+            thd->lock();
+            pending = ctxs[i].pending;
+            thd->unlock();
+
+            if (pending)
+                msleep(1);
+        } while (pending);
+    }
+
+    for (i = 0; i < WORKER_TEST_THREADS; i++) {
+        ThreadTestCtx *ctx = &ctxs[i];
+
+        ctx->thd->stop();
+        delete ctx->thd;
+
+        consumed += ctx->consumed;
+        overlap += ctx->overlap;
+    }
+
+    mpp_log("%d threads %d pooled consumed %d items in %lld us\n",
+            WORKER_TEST_THREADS, pooled, consumed, mpp_time() - time_start);
+
+    if (consumed != WORKER_TEST_THREADS * WORKER_TEST_ITEMS || overlap) {
+        mpp_err("consumed %d expect %d overlap %d\n", consumed,
+                WORKER_TEST_THREADS * WORKER_TEST_ITEMS, overlap);
+        return MPP_NOK;
+    }
+
+    if (!pooled) {
+        mpp_err("thread is not on worker pool\n");
+        return MPP_NOK;
+    }
+
+    return MPP_OK;
+}
+
+/*
+ * The blockers take all workers and wait for the releaser which can only run
+ * on the spare worker started by mpp_worker_block_enter.
+ */
+static MppThreadStep block_test_step(void *data)
+{
+    BlockTestCtx *ctx = (BlockTestCtx *)data;
+
+    if (ctx->blocker) {
+        mpp_worker_block_enter();
+        sem_wait(ctx->sem);
+        mpp_worker_block_leave();
+    } else {
+        RK_S32 i;
+
+        for (i = 0; i < WORKER_TEST_BLOCKERS; i++)
+            sem_post(ctx->sem);
+    }
+
+    ctx->done = 1;
+
+    return THREAD_STEP_DONE;
+}
+
+static MPP_RET test_block(void)
+{
+    BlockTestCtx ctxs[WORKER_TEST_BLOCKERS + 1];
+    MppWorkerJob jobs[WORKER_TEST_BLOCKERS + 1];
+    RK_S32 count = WORKER_TEST_BLOCKERS + 1;
+    MPP_RET ret = MPP_OK;
+    sem_t sem;
+    RK_S32 i;
+
+    sem_init(&sem, 0, 0);
+
+    for (i = 0; i < count; i++) {
+        ctxs[i].sem = &sem;
+        ctxs[i].blocker = i < WORKER_TEST_BLOCKERS;
+        ctxs[i].done = 0;
+        mpp_worker_job_init(&jobs[i], block_test_step, &ctxs[i], "block_test");
+    }
+
+    /* let the blockers take the workers first */
+    for (i = 0; i < WORKER_TEST_BLOCKERS; i++)
+        mpp_worker_job_trigger(jobs[i]);
+
+    msleep(10);
+    mpp_worker_job_trigger(jobs[WORKER_TEST_BLOCKERS]);
+
+    for (i = 0; i < count; i++) {
+        mpp_worker_job_join(jobs[i]);
+        if (!ctxs[i].done)
+            ret = MPP_NOK;
+
+        mpp_worker_job_deinit(jobs[i]);
+    }
+
+    sem_destroy(&sem);
+
+    mpp_log("%d blockers with %d workers %s\n", WORKER_TEST_BLOCKERS,
+            WORKER_TEST_COUNT, ret ? "failed" : "done");
+
+    return ret;
+}
+
+int main()
+{
+    MPP_RET ret;
+
+    mpp_log("mpp_worker_test start\n");
+
+    /* enable the pool before its first use */
+    mpp_env_set_u32("mpp_worker_pool", 1);
+    mpp_env_set_u32("mpp_worker_count", WORKER_TEST_COUNT);
+
+    ret = test_thread();
+    if (!ret)
+        ret = test_block();
+
+    mpp_log("mpp_worker_test %s\n", ret ? "failed" : "success");
+    return ret;
+}
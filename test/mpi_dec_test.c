@@ -77,6 +77,7 @@ typedef struct {
     RK_U32          simple;
     RK_S32          timeout;
     RK_S32          frame_num;
+    RK_S32          batch;
     size_t          pkt_size;
 
     // report information
@@ -94,6 +95,7 @@ static OptionInfo mpi_dec_cmd[] = {
     {"d",               "debug",                "debug flag"},
     {"x",               "timeout",              "output timeout interval"},
     {"n",               "frame_number",         "max output frame number"},
+    {"b",               "batch",                "mjpeg batch decode count"},
 };
 
 static int decode_simple(MpiDecLoopData *data)
@@ -489,6 +491,89 @@ static int decode_advanced(MpiDecLoopData *data)
     return ret;
 }
 
+/*
+ * Decode the whole jpeg file batch times with one decode_batch call like the
+ * thumbnail generation case. All the packets share the same input buffer.
+ */
+static int decode_batch(MpiDecLoopData *data, MppBuffer pkt_buf, RK_S32 batch)
+{
+    MPP_RET ret = MPP_OK;
+    MppCtx ctx  = data->ctx;
+    MppApi *mpi = data->mpi;
+    MppPacket *packets = mpp_calloc(MppPacket, batch);
+    MppFrame *frames = mpp_calloc(MppFrame, batch);
+    MPP_RET *results = mpp_calloc(MPP_RET, batch);
+    size_t frm_size = mpp_buffer_get_size(mpp_frame_get_buffer(data->frame));
+    size_t read_size = fread(data->buf, 1, data->packet_size, data->fp_input);
+    RK_S64 time_start;
+    RK_S64 time_end;
+    RK_S32 i;
+
+    data->eos = 1;
+
+    if (NULL == packets || NULL == frames || NULL == results) {
+        mpp_err("%p failed to malloc batch %d\n", ctx, batch);
+        ret = MPP_ERR_MALLOC;
+        goto DONE;
+    }
+
+    for (i = 0; i < batch; i++) {
+        MppBuffer frm_buf = NULL;
+
+        mpp_packet_init_with_buffer(&packets[i], pkt_buf);
+        mpp_packet_set_length(packets[i], read_size);
+
+        ret = mpp_buffer_get(data->frm_grp, &frm_buf, frm_size);
+        if (ret) {
+            mpp_err("%p failed to get frame buffer %d\n", ctx, i);
+            goto DONE;
+        }
+
+        mpp_frame_init(&frames[i]);
+        mpp_frame_set_buffer(frames[i], frm_buf);
+        // frame holds the buffer reference now
+        mpp_buffer_put(frm_buf);
+    }
+
+    time_start = mpp_time();
+    ret = mpi->decode_batch(ctx, packets, frames, results, batch);
+    time_end = mpp_time();
+    if (ret) {
+        mpp_err("%p decode_batch failed ret %d\n", ctx, ret);
+        goto DONE;
+    }
+
+    for (i = 0; i < batch; i++) {
+        if (results[i]) {
+            mpp_log("%p batch frame %d has error\n", ctx, i);
+            continue;
+        }
+
+        if (data->fp_output)
+            dump_mpp_frame_to_file(frames[i], data->fp_output);
+
+        data->frame_count++;
+    }
+
+    mpp_log("%p batch decoded %d/%d frames %dx%d cost %lld us\n", ctx,
+            data->frame_count, batch, mpp_frame_get_width(frames[0]),
+            mpp_frame_get_height(frames[0]), time_end - time_start);
+
+DONE:
+    for (i = 0; i < batch; i++) {
+        if (packets && packets[i])
+            mpp_packet_deinit(&packets[i]);
+        if (frames && frames[i])
+            mpp_frame_deinit(&frames[i]);
+    }
+
+    MPP_FREE(packets);
+    MPP_FREE(frames);
+    MPP_FREE(results);
+
+    return ret;
+}
+
 int mpi_dec_test_decode(MpiDecTestCmd *cmd)
 {
     MPP_RET ret         = MPP_OK;
@@ -650,6 +735,14 @@ int mpi_dec_test_decode(MpiDecTestCmd *cmd)
         }
     }
 
+    // NOTE: input and output task should be enough for the whole batch
+    if (cmd->batch > 1) {
+        RK_S32 task_count = MPP_MIN(cmd->batch, MPP_TASK_COUNT_MAX);
+
+        mpi->control(ctx, MPP_SET_INPUT_TASK_COUNT, &task_count);
+        mpi->control(ctx, MPP_SET_OUTPUT_TASK_COUNT, &task_count);
+    }
+
     ret = mpp_init(ctx, MPP_CTX_DEC, type);
     if (MPP_OK != ret) {
         mpp_err("%p mpp_init failed\n", ctx);
@@ -675,6 +768,12 @@ int mpi_dec_test_decode(MpiDecTestCmd *cmd)
         if (cmd->format < MPP_FMT_BUTT)
             ret = mpi->control(ctx, MPP_DEC_SET_OUTPUT_FORMAT, &cmd->format);
 
+        if (cmd->batch > 1) {
+            ret = decode_batch(&data, pkt_buf, cmd->batch);
+            if (ret)
+                goto MPP_TEST_OUT;
+        }
+
         while (!data.eos) {
             decode_advanced(&data);
         }
@@ -682,6 +781,13 @@ int mpi_dec_test_decode(MpiDecTestCmd *cmd)
 
     cmd->max_usage = data.max_usage;
 
+    {
+        MppLatencyStat stat;
+
+        if (MPP_OK == mpi->control(ctx, MPP_GET_LATENCY_STAT, &stat))
+            show_latency_stat(&stat);
+    }
+
     ret = mpi->reset(ctx);
     if (MPP_OK != ret) {
         mpp_err("%p mpi->reset failed\n", ctx);
@@ -882,6 +988,14 @@ static RK_S32 mpi_dec_test_parse_options(int argc, char **argv, MpiDecTestCmd* c
                     goto PARSE_OPINIONS_OUT;
                 }
                 break;
+            case 'b':
+                if (next) {
+                    cmd->batch = atoi(next);
+                } else {
+                    mpp_err("invalid batch count\n");
+                    goto PARSE_OPINIONS_OUT;
+                }
+                break;
             default:
                 mpp_err("skip invalid opt %c\n", *opt);
                 break;
@@ -908,6 +1022,8 @@ static void mpi_dec_test_show_options(MpiDecTestCmd* cmd)
     mpp_log("type       : %d\n", cmd->type);
     mpp_log("debug flag : %x\n", cmd->debug);
     mpp_log("max frames : %d\n", cmd->frame_num);
+    if (cmd->batch > 1)
+        mpp_log("batch      : %d\n", cmd->batch);
 }
 
 int main(int argc, char **argv)
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2015 Rockchip Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define MODULE_TAG "mpi_enc_pipe_test"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rk_mpi.h"
+
+#include "mpp_env.h"
+#include "mpp_log.h"
+#include "mpp_time.h"
+#include "mpp_common.h"
+#include "mpp_platform.h"
+
+/*
+ * encoder pipeline throughput benchmark on mock device
+ *
+ * usage: mpi_enc_pipe_test [hw latency us] [frame count]
+ *
+ * hw latency - hardware time for each frame simulated by mock device
+ *
+ * The rkvenc H.264 hal runs on the mock device so the cpu part of each frame
+ * is the real encoder flow and register generation. Each frame carries a
+ * moving roi region so the roi buffer update runs with tasks in flight.
+ */
+#define ENC_PIPE_WIDTH          1280
+#define ENC_PIPE_HEIGHT         720
+#define ENC_PIPE_MAX_TASK       2
+/* rkvenc stream length register reg132 and the length reported by it */
+#define ENC_PIPE_BSL_REG        132
+#define ENC_PIPE_FRAME_BYTES    8192
+
+typedef struct EncPipeCtx_t {
+    MppCtx          ctx;
+    MppApi          *mpi;
+    MppBufferGroup  group;
+    MppBuffer       buf[ENC_PIPE_MAX_TASK];
+    MppFrame        frame[ENC_PIPE_MAX_TASK];
+    MppEncROIRegion roi_region[ENC_PIPE_MAX_TASK];
+    MppEncROICfg    roi_cfg[ENC_PIPE_MAX_TASK];
+    RK_S32          frm_put;
+    RK_S32          pkt_get;
+} EncPipeCtx;
+
+static MPP_RET enc_pipe_cfg(EncPipeCtx *p)
+{
+    MppEncCfg cfg = NULL;
+    MPP_RET ret = MPP_OK;
+
+    mpp_enc_cfg_init(&cfg);
+
+    mpp_enc_cfg_set_s32(cfg, "prep:width", ENC_PIPE_WIDTH);
+    mpp_enc_cfg_set_s32(cfg, "prep:height", ENC_PIPE_HEIGHT);
+    mpp_enc_cfg_set_s32(cfg, "prep:hor_stride", ENC_PIPE_WIDTH);
+    mpp_enc_cfg_set_s32(cfg, "prep:ver_stride", ENC_PIPE_HEIGHT);
+    mpp_enc_cfg_set_s32(cfg, "prep:format", MPP_FMT_YUV420SP);
+
+    mpp_enc_cfg_set_s32(cfg, "rc:mode", MPP_ENC_RC_MODE_CBR);
+    mpp_enc_cfg_set_s32(cfg, "rc:bps_target", 2 * 1024 * 1024);
+    mpp_enc_cfg_set_s32(cfg, "rc:bps_max", 2 * 1024 * 1024 * 17 / 16);
+    mpp_enc_cfg_set_s32(cfg, "rc:bps_min", 2 * 1024 * 1024 * 15 / 16);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_in_num", 30);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_in_denorm", 1);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_out_num", 30);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_out_denorm", 1);
+    mpp_enc_cfg_set_s32(cfg, "rc:gop", 60);
+
+    mpp_enc_cfg_set_s32(cfg, "codec:type", MPP_VIDEO_CodingAVC);
+    mpp_enc_cfg_set_s32(cfg, "h264:profile", 100);
+    mpp_enc_cfg_set_s32(cfg, "h264:level", 40);
+
+    ret = p->mpi->control(p->ctx, MPP_ENC_SET_CFG, cfg);
+
+    mpp_enc_cfg_deinit(cfg);
+    return ret;
+}
+
+static MPP_RET enc_pipe_get_packet(EncPipeCtx *p)
+{
+    MppPacket packet = NULL;
+    MPP_RET ret = p->mpi->encode_get_packet(p->ctx, &packet);
+
+    if (ret || NULL == packet) {
+        mpp_err("get packet %d failed ret %d\n", p->pkt_get, ret);
+        return MPP_NOK;
+    }
+
+    mpp_packet_deinit(&packet);
+
+    /* input frame can be released when its packet is returned */
+    mpp_frame_deinit(&p->frame[p->pkt_get % ENC_PIPE_MAX_TASK]);
+    p->pkt_get++;
+
+    return MPP_OK;
+}
+
+static MPP_RET enc_pipe_run(RK_U32 pipeline, RK_S32 frame_count, RK_S64 *time)
+{
+    EncPipeCtx ctx;
+    EncPipeCtx *p = &ctx;
+    MppPollType timeout = MPP_POLL_BLOCK;
+    RK_S32 task_count = (pipeline) ? ENC_PIPE_MAX_TASK : 1;
+    RK_S32 size = ENC_PIPE_WIDTH * ENC_PIPE_HEIGHT * 3 / 2;
+    RK_S64 time_start;
+    MPP_RET ret = MPP_NOK;
+    RK_S32 i;
+
+    memset(p, 0, sizeof(*p));
+
+    if (mpp_create(&p->ctx, &p->mpi))
+        return MPP_NOK;
+
+    p->mpi->control(p->ctx, MPP_SET_OUTPUT_TIMEOUT, &timeout);
+    p->mpi->control(p->ctx, MPP_ENC_SET_TASK_PIPELINE, &pipeline);
+
+    if (mpp_init(p->ctx, MPP_CTX_ENC, MPP_VIDEO_CodingAVC))
+        goto DONE;
+
+    if (enc_pipe_cfg(p))
+        goto DONE;
+
+    mpp_buffer_group_get_internal(&p->group, MPP_BUFFER_TYPE_ION);
+    for (i = 0; i < ENC_PIPE_MAX_TASK; i++) {
+        if (mpp_buffer_get(p->group, &p->buf[i], size))
+            goto DONE;
+    }
+
+    time_start = mpp_time();
+
+    for (i = 0; i < frame_count; i++) {
+        MppEncROIRegion *region = &p->roi_region[i % ENC_PIPE_MAX_TASK];
+        MppEncROICfg *roi = &p->roi_cfg[i % ENC_PIPE_MAX_TASK];
+        MppFrame frame = NULL;
+
+        /* keep task_count frames in flight */
+        if (p->frm_put - p->pkt_get >= task_count) {
+            if (enc_pipe_get_packet(p))
+                goto DONE;
+        }
+
+        mpp_frame_init(&frame);
+        mpp_frame_set_width(frame, ENC_PIPE_WIDTH);
+        mpp_frame_set_height(frame, ENC_PIPE_HEIGHT);
+        mpp_frame_set_hor_stride(frame, ENC_PIPE_WIDTH);
+        mpp_frame_set_ver_stride(frame, ENC_PIPE_HEIGHT);
+        mpp_frame_set_fmt(frame, MPP_FMT_YUV420SP);
+        mpp_frame_set_buffer(frame, p->buf[i % ENC_PIPE_MAX_TASK]);
+        mpp_frame_set_pts(frame, i);
+
+        region->x = (i * 16) % (ENC_PIPE_WIDTH - 256);
+        region->y = 64;
+        region->w = 256;
+        region->h = 256;
+        region->intra = 0;
+        region->quality = 24;
+        region->abs_qp_en = 1;
+        region->area_map_en = 1;
+        region->qp_area_idx = 0;
+
+        roi->number = 1;
+        roi->regions = region;
+        mpp_meta_set_ptr(mpp_frame_get_meta(frame), KEY_ROI_DATA, roi);
+
+        p->frame[i % ENC_PIPE_MAX_TASK] = frame;
+
+        if (p->mpi->encode_put_frame(p->ctx, frame)) {
+            mpp_err("put frame %d failed\n", i);
+            goto DONE;
+        }
+
+        p->frm_put++;
+    }
+
+    while (p->pkt_get < p->frm_put) {
+        if (enc_pipe_get_packet(p))
+            goto DONE;
+    }
+
+    *time = mpp_time() - time_start;
+    ret = MPP_OK;
+
+DONE:
+    if (p->ctx) {
+        p->mpi->reset(p->ctx);
+        mpp_destroy(p->ctx);
+    }
+
+    for (i = 0; i < ENC_PIPE_MAX_TASK; i++) {
+        if (p->frame[i])
+            mpp_frame_deinit(&p->frame[i]);
+        if (p->buf[i])
+            mpp_buffer_put(p->buf[i]);
+    }
+
+    if (p->group)
+        mpp_buffer_group_put(p->group);
+
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    RK_U32 latency = 10000;
+    RK_S32 frame_count = 100;
+    RK_S64 time[2] = { 0 };
+    MPP_RET ret = MPP_OK;
+    RK_U32 i;
+
+    if (argc > 1)
+        latency = atoi(argv[1]);
+    if (argc > 2)
+        frame_count = atoi(argv[2]);
+
+    mpp_log("mpi_enc_pipe_test start latency %d us frames %d\n",
+            latency, frame_count);
+
+    mpp_env_set_u32("mpp_device_mock", 1);
+    mpp_env_set_u32("mpp_device_mock_latency", latency);
+    mpp_env_set_u32("mpp_vcodec_type", HAVE_RKVENC);
+    /* rate control needs non-zero stream length from st_bsl register */
+    mpp_env_set_u32("mpp_device_mock_status_reg", ENC_PIPE_BSL_REG);
+    mpp_env_set_u32("mpp_device_mock_status_val", ENC_PIPE_FRAME_BYTES);
+
+    for (i = 0; i < 2; i++) {
+        ret = enc_pipe_run(i, frame_count, &time[i]);
+        if (ret)
+            goto DONE;
+
+        mpp_log("%s mode %d frames in %lld us - %.2f fps\n",
+                i ? "pipeline" : "serial  ", frame_count, time[i],
+                (float)frame_count * 1000000 / time[i]);
+    }
+
+    mpp_log("pipeline speedup %.2f\n", (float)time[0] / time[1]);
+
+DONE:
+    mpp_log("mpi_enc_pipe_test %s\n", ret ? "failed" : "success");
+    return ret;
+}
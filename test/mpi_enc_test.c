@@ -990,6 +990,13 @@ int mpi_enc_test(MpiEncTestArgs *cmd)
         goto MPP_TEST_OUT;
     }
 
+    {
+        MppLatencyStat stat;
+
+        if (MPP_OK == p->mpi->control(p->ctx, MPP_GET_LATENCY_STAT, &stat))
+            show_latency_stat(&stat);
+    }
+
     ret = p->mpi->reset(p->ctx);
     if (ret) {
         mpp_err("mpi->reset failed\n");
@@ -655,3 +655,24 @@ MPP_RET name_to_coding_type(const char *name, MppCodingType *coding)
 
     return ret;
 }
+
+static const char *latency_type_name[MPP_LATENCY_BUTT] = MPP_LATENCY_NAMES;
+
+void show_latency_stat(MppLatencyStat *stat)
+{
+    RK_U32 i;
+
+    mpp_log("%-10s %8s %8s %8s %8s %8s %8s %8s (us)\n", "latency",
+            "count", "avg", "p50", "p90", "p99", "p999", "max");
+
+    for (i = 0; i < MPP_LATENCY_BUTT; i++) {
+        MppLatencyInfo *info = &stat->info[i];
+
+        if (!info->count)
+            continue;
+
+        mpp_log("%-10s %8lld %8lld %8lld %8lld %8lld %8lld %8lld\n",
+                latency_type_name[i], info->count, info->sum / info->count,
+                info->p50, info->p90, info->p99, info->p999, info->max);
+    }
+}
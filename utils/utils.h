@@ -20,6 +20,7 @@
 #include <stdio.h>
 
 #include "mpp_frame.h"
+#include "rk_mpi_stat.h"
 
 typedef struct OptionInfo_t {
     const char*     name;
@@ -78,6 +79,8 @@ RK_S32 parse_config_line(const char *str, OpsLine *info);
 MPP_RET name_to_frame_format(const char *name, MppFrameFormat *fmt);
 MPP_RET name_to_coding_type(const char *name, MppCodingType *coding);
 
+void show_latency_stat(MppLatencyStat *stat);
+
 #ifdef __cplusplus
 }
 #endif